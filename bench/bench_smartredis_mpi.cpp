@@ -0,0 +1,197 @@
+// Exchange benchmark: sweeps rank counts, points per rank, uneven
+// decompositions and call patterns, and reports latency percentiles and
+// throughput. Built by `make bench`, against the in-process fake store
+// (BENCH_BACKEND=fake, default) or a live database (BENCH_BACKEND=redis).
+//
+//   mpirun -n 8 build/bench/bench_smartredis_mpi --points 1000,100000 --uneven 0,0.5
+//
+// Options (comma-separated lists):
+//   --ranks     sub-communicator sizes (default 1,2,4,... up to the job size)
+//   --points    mean points per rank (default 1000,10000,100000)
+//   --uneven    spread of points per rank: rank i gets points*(1+u*(2i/(p-1)-1))
+//   --patterns  put_state,get_action,step,step_wait,step_exchange (step reads an
+//               action already in place; step_wait and step_exchange wait for it)
+//   --iters     timed iterations per case (default 100)
+//   --warmup    untimed iterations per case (default 10)
+//   --transport smartredis (default) or shm
+//   --collective flat,hierarchical (default flat)
+// Each iteration starts on a barrier; its latency is the slowest rank's.
+
+#include "SmartRedisMPI.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+
+struct BenchConfig {
+    std::vector<int> ranks;
+    std::vector<long> points = {1000, 10000, 100000};
+    std::vector<double> uneven = {0.0};
+    std::vector<std::string> patterns = {"put_state", "get_action", "step", "step_wait", "step_exchange"};
+    int iters = 100;
+    int warmup = 10;
+    int transport = TRANSPORT_SMARTREDIS;
+    std::vector<std::string> collectives = {"flat"};
+};
+
+template <typename T>
+static std::vector<T> parse_list(const std::string &s) {
+    std::vector<T> out;
+    std::stringstream in(s);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        std::stringstream v(item);
+        T x;
+        v >> x;
+        out.push_back(x);
+    }
+    return out;
+}
+
+static BenchConfig parse_args(int argc, char **argv, int nprocs) {
+    BenchConfig cfg;
+    for (int i=1;i+1<argc;i+=2) {
+        const std::string opt = argv[i];
+        const std::string val = argv[i+1];
+        if (opt == "--ranks") cfg.ranks = parse_list<int>(val);
+        else if (opt == "--points") cfg.points = parse_list<long>(val);
+        else if (opt == "--uneven") cfg.uneven = parse_list<double>(val);
+        else if (opt == "--patterns") cfg.patterns = parse_list<std::string>(val);
+        else if (opt == "--iters") cfg.iters = std::atoi(val.c_str());
+        else if (opt == "--warmup") cfg.warmup = std::atoi(val.c_str());
+        else if (opt == "--transport") cfg.transport = val == "shm" ? TRANSPORT_SHM : TRANSPORT_SMARTREDIS;
+        else if (opt == "--collective") cfg.collectives = parse_list<std::string>(val);
+        else throw std::invalid_argument("unknown option " + opt);
+    }
+    if (cfg.ranks.empty()) {
+        for (int r=1;r<nprocs;r*=2) cfg.ranks.push_back(r);
+        cfg.ranks.push_back(nprocs);
+    }
+    return cfg;
+}
+
+static double percentile(std::vector<double> v, double q) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    size_t i = static_cast<size_t>(std::ceil(q * v.size()));
+    return v[std::min(v.size() - 1, i > 0 ? i - 1 : 0)];
+}
+
+// One (ranks, points, uneven, pattern) case on the sub-communicator
+static void run_case(SmartRedisMPI &sr, Transport *agent, MPI_Comm comm, const BenchConfig &cfg,
+                     long points, double uneven, const std::string &pattern, int world_rank) {
+    int rank, nprocs;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &nprocs);
+
+    double share = nprocs > 1 ? 1.0 + uneven * (2.0 * rank / (nprocs - 1) - 1.0) : 1.0;
+    const size_t n = static_cast<size_t>(std::max(1L, std::lround(points * share)));
+    long n_total = 0;
+    long n_local = static_cast<long>(n);
+    MPI_Allreduce(&n_local, &n_total, 1, MPI_LONG, MPI_SUM, comm);
+
+    std::vector<double> state(n, 1.0 + rank), reward(n, 0.5), action(n, 0.0);
+    std::vector<double> agent_action(rank == 0 ? n_total : 0, 0.25);
+
+    std::ostringstream tag;
+    tag << "bench." << nprocs << "." << points << "." << uneven << "." << pattern;
+    const std::string key = tag.str();
+    const std::string action_key = pattern == "step_exchange" ? key + ".action" : key + ".act";
+    const bool needs_action = pattern != "put_state";
+
+    std::vector<double> samples;
+    for (int it=0; it<cfg.warmup + cfg.iters; it++) {
+        // The agent's action is in place before the clock starts
+        if (needs_action && rank == 0)
+            agent->put_tensor(action_key, agent_action.data(), {static_cast<size_t>(n_total)},
+                              SRTensorTypeDouble, SRMemLayoutContiguous);
+        MPI_Barrier(comm);
+        const auto t0 = std::chrono::steady_clock::now();
+        if (pattern == "put_state") {
+            sr.put_state(key + ".state", state.data(), n);
+        } else if (pattern == "get_action") {
+            sr.get_action(action_key, action.data(), n);
+        } else if (pattern == "step") {
+            sr.put_state(key + ".state", state.data(), n);
+            sr.put_reward(key + ".reward", reward.data(), n);
+            sr.get_action(action_key, action.data(), n);
+        } else if (pattern == "step_wait") {
+            sr.put_state(key + ".state", state.data(), n);
+            sr.put_reward(key + ".reward", reward.data(), n);
+            sr.wait_action(action_key, action.data(), n);
+        } else if (pattern == "step_exchange") {
+            sr.step_exchange(key, state.data(), n, reward.data(), n, 0, action.data(), n);
+        } else {
+            throw std::invalid_argument("unknown pattern " + pattern);
+        }
+        double dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        double slowest = 0.0;
+        MPI_Reduce(&dt, &slowest, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+        if (it >= cfg.warmup) samples.push_back(slowest);
+    }
+    sr.invalidate_plans();
+
+    if (rank != 0 || world_rank != 0) return;
+    double mean = 0.0;
+    for (double s : samples) mean += s;
+    mean /= std::max<size_t>(samples.size(), 1);
+    const int arrays = pattern == "put_state" || pattern == "get_action" ? 1 : 3;
+    const double bytes = static_cast<double>(n_total) * sizeof(double) * arrays;
+    std::printf("%-14s %-12s %6d %9ld %6.2f %12.0f %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+                pattern.c_str(), sr.get_collective_mode() == SmartRedisMPI::COLLECTIVE_HIERARCHICAL ? "hierarchical" : "flat",
+                nprocs, points, uneven, bytes, mean * 1e6,
+                percentile(samples, 0.5) * 1e6, percentile(samples, 0.9) * 1e6,
+                percentile(samples, 0.99) * 1e6, mean > 0.0 ? bytes / mean / 1e6 : 0.0);
+    std::fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+    MPI_Init(&argc, &argv);
+    int world_rank, world_size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+
+    int status = 0;
+    try {
+        BenchConfig cfg = parse_args(argc, argv, world_size);
+        if (world_rank == 0) {
+            std::printf("# %-12s %-12s %6s %9s %6s %12s %10s %10s %10s %10s %10s\n", "pattern", "collective",
+                        "ranks", "points", "uneven", "bytes", "mean_us", "p50_us", "p90_us", "p99_us", "MB/s");
+        }
+        for (int r : cfg.ranks) {
+            if (r < 1 || r > world_size) continue;
+            MPI_Comm comm;
+            MPI_Comm_split(MPI_COMM_WORLD, world_rank < r ? 0 : MPI_UNDEFINED, world_rank, &comm);
+            if (comm != MPI_COMM_NULL) {
+                {
+                    SmartRedisMPI sr(false, comm, cfg.transport);
+                    Transport *agent = world_rank == 0 ? create_transport(cfg.transport, false) : nullptr;
+                    for (const std::string &collective : cfg.collectives) {
+                        if (collective != "flat" && collective != "hierarchical")
+                            throw std::invalid_argument("unknown collective " + collective);
+                        sr.set_collective_mode(collective == "hierarchical" ? SmartRedisMPI::COLLECTIVE_HIERARCHICAL
+                                                                            : SmartRedisMPI::COLLECTIVE_FLAT);
+                        for (long points : cfg.points)
+                            for (double u : cfg.uneven)
+                                for (const std::string &pattern : cfg.patterns)
+                                    run_case(sr, agent, comm, cfg, points, u, pattern, world_rank);
+                    }
+                    delete agent;
+                }
+                MPI_Comm_free(&comm);
+            }
+            MPI_Barrier(MPI_COMM_WORLD);
+        }
+    } catch (const std::exception &e) {
+        std::fprintf(stderr, "[rank %d] benchmark failed: %s\n", world_rank, e.what());
+        status = 1;
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    MPI_Finalize();
+    return status;
+}
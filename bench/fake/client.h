@@ -0,0 +1,262 @@
+#ifndef SMARTREDIS_FAKE_CLIENT_H
+#define SMARTREDIS_FAKE_CLIENT_H
+
+// In-process stand-in for the SmartRedis client used by the benchmark
+// (make bench BENCH_BACKEND=fake). It shadows SmartRedis' client.h and keeps
+// every tensor and DataSet in a process-wide map, so no Redis is needed.
+// Each call can be slowed down to mimic the network:
+//   SRMPI_FAKE_LATENCY_US    fixed cost per client call (default 0)
+//   SRMPI_FAKE_BANDWIDTH_MBS payload bandwidth in MB/s (default 0 = unlimited)
+// Only the part of the client API used by SmartRedisMPI is provided.
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <cstring>
+#include <cstdlib>
+#include <stdexcept>
+
+typedef enum {
+    SRTensorTypeInvalid = 0,
+    SRTensorTypeDouble = 1,
+    SRTensorTypeFloat = 2,
+    SRTensorTypeInt8 = 3,
+    SRTensorTypeInt16 = 4,
+    SRTensorTypeInt32 = 5,
+    SRTensorTypeInt64 = 6,
+    SRTensorTypeUint8 = 7,
+    SRTensorTypeUint16 = 8
+} SRTensorType;
+
+typedef enum {
+    SRMemLayoutInvalid = 0,
+    SRMemLayoutNested = 1,
+    SRMemLayoutContiguous = 2,
+    SRMemLayoutFortranNested = 3,
+    SRMemLayoutFortranContiguous = 4
+} SRMemoryLayout;
+
+typedef enum {
+    SRMetadataTypeInvalid = 0,
+    SRMetadataTypeDouble = 1,
+    SRMetadataTypeFloat = 2,
+    SRMetadataTypeInt32 = 3,
+    SRMetadataTypeInt64 = 4,
+    SRMetadataTypeUint32 = 5,
+    SRMetadataTypeUint64 = 6,
+    SRMetadataTypeString = 7
+} SRMetadataType;
+
+namespace SmartRedis {
+
+namespace fake {
+
+inline size_t type_size(SRTensorType type) {
+    switch (type) {
+    case SRTensorTypeDouble:
+    case SRTensorTypeInt64: return 8;
+    case SRTensorTypeFloat:
+    case SRTensorTypeInt32: return 4;
+    case SRTensorTypeInt16:
+    case SRTensorTypeUint16: return 2;
+    default: return 1;
+    }
+}
+
+inline size_t count(const std::vector<size_t> &dims) {
+    size_t n = 1;
+    for (size_t d : dims) n *= d;
+    return n;
+}
+
+struct Tensor {
+    std::vector<size_t> dims;
+    SRTensorType type = SRTensorTypeInvalid;
+    std::vector<unsigned char> bytes;
+};
+
+struct Store {
+    std::mutex mutex;
+    std::map<std::string, Tensor> tensors;
+    std::map<std::string, std::map<std::string, Tensor>> datasets;
+    double latency_s = 0.0;
+    double bandwidth_bps = 0.0;
+
+    Store() {
+        if (const char *v = std::getenv("SRMPI_FAKE_LATENCY_US")) latency_s = std::atof(v) * 1e-6;
+        if (const char *v = std::getenv("SRMPI_FAKE_BANDWIDTH_MBS")) bandwidth_bps = std::atof(v) * 1e6;
+    }
+
+    // Injected cost of one call moving `bytes`; spins below 100 us, where
+    // sleeping is too coarse
+    void delay(size_t bytes) const {
+        double t = latency_s;
+        if (bandwidth_bps > 0.0) t += bytes / bandwidth_bps;
+        if (t <= 0.0) return;
+        typedef std::chrono::steady_clock clock;
+        const clock::time_point end = clock::now() + std::chrono::duration_cast<clock::duration>(
+                                                          std::chrono::duration<double>(t));
+        if (t > 1e-4) std::this_thread::sleep_until(end);
+        while (clock::now() < end) {}
+    }
+};
+
+inline Store &store() {
+    static Store s;
+    return s;
+}
+
+inline Tensor make_tensor(const void *data, const std::vector<size_t> &dims, SRTensorType type) {
+    Tensor t;
+    t.dims = dims;
+    t.type = type;
+    const unsigned char *p = static_cast<const unsigned char*>(data);
+    t.bytes.assign(p, p + count(dims) * type_size(type));
+    return t;
+}
+
+inline void copy_out(const Tensor &t, const std::string &name, void *data,
+                     const std::vector<size_t> &dims, SRTensorType type) {
+    if (t.type != type || count(t.dims) != count(dims))
+        throw std::runtime_error("fake client: '" + name + "' does not match the requested type and size");
+    if (!t.bytes.empty()) std::memcpy(data, t.bytes.data(), t.bytes.size());
+}
+
+} // namespace fake
+
+class DataSet {
+public:
+    explicit DataSet(const std::string &name) : _name(name) {}
+
+    void add_tensor(const std::string &name, const void *data, const std::vector<size_t> &dims,
+                    SRTensorType type, SRMemoryLayout) {
+        _tensors[name] = fake::make_tensor(data, dims, type);
+    }
+    void add_meta_scalar(const std::string &name, const void *data, SRMetadataType type) {
+        size_t n = (type == SRMetadataTypeDouble || type == SRMetadataTypeInt64 ||
+                    type == SRMetadataTypeUint64) ? 8 : 4;
+        fake::Tensor &t = _meta[name];
+        const unsigned char *p = static_cast<const unsigned char*>(data);
+        t.bytes.insert(t.bytes.end(), p, p + n);
+    }
+    void get_tensor(const std::string &name, void *&data, std::vector<size_t> &dims,
+                    SRTensorType &type, SRMemoryLayout) {
+        auto it = _tensors.find(name);
+        if (it == _tensors.end()) throw std::runtime_error("fake client: no tensor '" + name + "' in " + _name);
+        data = it->second.bytes.data();
+        dims = it->second.dims;
+        type = it->second.type;
+    }
+    void unpack_tensor(const std::string &name, void *data, const std::vector<size_t> &dims,
+                       SRTensorType type, SRMemoryLayout) {
+        auto it = _tensors.find(name);
+        if (it == _tensors.end()) throw std::runtime_error("fake client: no tensor '" + name + "' in " + _name);
+        fake::copy_out(it->second, name, data, dims, type);
+    }
+    std::vector<std::string> get_tensor_names() const {
+        std::vector<std::string> names;
+        for (const auto &kv : _tensors) names.push_back(kv.first);
+        return names;
+    }
+    const std::string &get_name() const { return _name; }
+
+private:
+    friend class Client;
+    std::string _name;
+    std::map<std::string, fake::Tensor> _tensors;
+    std::map<std::string, fake::Tensor> _meta;
+};
+
+class Client {
+public:
+    Client(bool, const std::string &) {}
+
+    void put_tensor(const std::string &name, const void *data, const std::vector<size_t> &dims,
+                    SRTensorType type, SRMemoryLayout) {
+        fake::Store &s = fake::store();
+        fake::Tensor t = fake::make_tensor(data, dims, type);
+        s.delay(t.bytes.size());
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.tensors[name] = std::move(t);
+    }
+
+    void unpack_tensor(const std::string &name, void *data, const std::vector<size_t> &dims,
+                       SRTensorType type, SRMemoryLayout) {
+        fake::Store &s = fake::store();
+        std::unique_lock<std::mutex> lock(s.mutex);
+        auto it = s.tensors.find(name);
+        if (it == s.tensors.end()) throw std::runtime_error("fake client: no tensor '" + name + "'");
+        fake::copy_out(it->second, name, data, dims, type);
+        const size_t bytes = it->second.bytes.size();
+        lock.unlock();
+        s.delay(bytes);
+    }
+
+    void delete_tensor(const std::string &name) {
+        fake::Store &s = fake::store();
+        s.delay(0);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.tensors.erase(name);
+    }
+
+    bool tensor_exists(const std::string &name) {
+        fake::Store &s = fake::store();
+        s.delay(0);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        return s.tensors.count(name) != 0;
+    }
+
+    bool poll_tensor(const std::string &name, int poll_frequency_ms, int num_tries) {
+        for (int i=0;i<num_tries;i++) {
+            if (tensor_exists(name)) return true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(poll_frequency_ms));
+        }
+        return false;
+    }
+
+    void put_dataset(DataSet &dataset) {
+        fake::Store &s = fake::store();
+        size_t bytes = 0;
+        for (const auto &kv : dataset._tensors) bytes += kv.second.bytes.size();
+        s.delay(bytes);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.datasets[dataset._name] = dataset._tensors;
+    }
+
+    DataSet get_dataset(const std::string &name) {
+        fake::Store &s = fake::store();
+        DataSet dataset(name);
+        size_t bytes = 0;
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            auto it = s.datasets.find(name);
+            if (it == s.datasets.end()) throw std::runtime_error("fake client: no dataset '" + name + "'");
+            dataset._tensors = it->second;
+        }
+        for (const auto &kv : dataset._tensors) bytes += kv.second.bytes.size();
+        s.delay(bytes);
+        return dataset;
+    }
+
+    bool dataset_exists(const std::string &name) {
+        fake::Store &s = fake::store();
+        s.delay(0);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        return s.datasets.count(name) != 0;
+    }
+
+    void delete_dataset(const std::string &name) {
+        fake::Store &s = fake::store();
+        s.delay(0);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.datasets.erase(name);
+    }
+};
+
+} // namespace SmartRedis
+
+#endif
@@ -1,6 +1,8 @@
 #include "SmartRedisMPI_CWrappers.h"
 #include "SmartRedisMPI_CInterface.h"
 #include <cstring>   // strlen
+#include <string>
+#include <vector>
 
 extern "C" {
 
@@ -14,15 +16,43 @@ int destroy_smartredis_mpi(SR_HANDLE handle) {
 }
 
 /* init/finalize wrap sr_init / sr_finalize
-   comm: -1 => MPI_COMM_WORLD forwarded as -1 in sr_init */
+   comm: Fortran handle, -1 => MPI_COMM_WORLD forwarded as -1 in sr_init */
 int init_smartredis_mpi(SR_HANDLE handle, int clustered, int comm) {
     return sr_init(handle, clustered, comm);
 }
 
+int init_smartredis_mpi_transport(SR_HANDLE handle, int clustered, int comm, int transport) {
+    return sr_init_transport(handle, clustered, comm, transport);
+}
+
+int init_smartredis_mpi_comm(SR_HANDLE handle, int clustered, MPI_Comm comm, int transport) {
+    return sr_init_transport(handle, clustered, (int)MPI_Comm_c2f(comm), transport);
+}
+
 int finalize_smartredis_mpi(SR_HANDLE handle) {
     return sr_finalize(handle);
 }
 
+int set_writer_mode(SR_HANDLE handle, int mode, int stride) {
+    return sr_set_writer_mode(handle, mode, stride);
+}
+
+int set_collective_mode(SR_HANDLE handle, int mode) {
+    return sr_set_collective_mode(handle, mode);
+}
+
+int init_mpi_threads(int* provided) {
+    return sr_init_mpi_threads(provided);
+}
+
+int set_threads(SR_HANDLE handle, int n_threads) {
+    return sr_set_threads(handle, n_threads);
+}
+
+int bind_thread(int lane) {
+    return sr_bind_thread(lane);
+}
+
 /* put_state / put_reward / get_action wrappers that forward to sr_* */
 int put_state(SR_HANDLE handle, const char* key, const double* state, size_t n) {
     if (!key) return SR_ERR;
@@ -39,6 +69,155 @@ int get_action(SR_HANDLE handle, const char* key, double* action, size_t n) {
     return sr_get_action(handle, key, (int)std::strlen(key), action, (int)n);
 }
 
+int wait_action(SR_HANDLE handle, const char* key, double* action, size_t n, double timeout) {
+    if (!key) return SR_ERR;
+    return sr_wait_action(handle, key, (int)std::strlen(key), action, (int)n, timeout);
+}
+
+/* registered keys: the string is converted once, the *_id calls pass the id through */
+int register_key(SR_HANDLE handle, const char* key, int per_step, int* id) {
+    if (!key) return SR_ERR;
+    return sr_register_key(handle, key, (int)std::strlen(key), per_step, id);
+}
+
+int set_step(SR_HANDLE handle, long long step) {
+    return sr_set_step(handle, step);
+}
+
+int put_state_id(SR_HANDLE handle, int id, const double* state, size_t n) {
+    return sr_put_state_id(handle, id, state, (int)n);
+}
+
+int put_reward_id(SR_HANDLE handle, int id, const double* reward, size_t n) {
+    return sr_put_reward_id(handle, id, reward, (int)n);
+}
+
+int put_info_id(SR_HANDLE handle, int id, const int* info, size_t n) {
+    return sr_put_info_id(handle, id, info, (int)n);
+}
+
+int get_action_id(SR_HANDLE handle, int id, double* action, size_t n) {
+    return sr_get_action_id(handle, id, action, (int)n);
+}
+
+int wait_action_id(SR_HANDLE handle, int id, double* action, size_t n, double timeout) {
+    return sr_wait_action_id(handle, id, action, (int)n, timeout);
+}
+
+int put_step_type_id(SR_HANDLE handle, int id, int step_type) {
+    return sr_put_step_type_id(handle, id, step_type);
+}
+
+int put_real_scalar_id(SR_HANDLE handle, int id, double value) {
+    return sr_put_real_scalar_id(handle, id, value);
+}
+
+int register_ring_key(SR_HANDLE handle, const char* key, int slots, int* id) {
+    if (!key) return SR_ERR;
+    return sr_register_ring_key(handle, key, (int)std::strlen(key), slots, id);
+}
+
+int get_action_step(SR_HANDLE handle, int id, long long step, double* action, size_t n) {
+    return sr_get_action_step(handle, id, step, action, (int)n);
+}
+
+int wait_action_step(SR_HANDLE handle, int id, long long step, double* action, size_t n, double timeout) {
+    return sr_wait_action_step(handle, id, step, action, (int)n, timeout);
+}
+
+/* batched keys: NUL-terminated keys are packed for sr_put_states / sr_get_actions */
+static bool pack_keys(const char* const* keys, int n_keys, const size_t* sizes,
+                      std::string &packed, std::vector<int> &lens, std::vector<int> &counts) {
+    if (!keys || !sizes || n_keys < 0) return false;
+    for (int k=0;k<n_keys;k++) {
+        if (!keys[k]) return false;
+        packed += keys[k];
+        lens.push_back((int)std::strlen(keys[k]));
+        counts.push_back((int)sizes[k]);
+    }
+    return true;
+}
+
+int put_states(SR_HANDLE handle, const char* const* keys, int n_keys, const double* states, const size_t* sizes) {
+    std::string packed;
+    std::vector<int> lens, counts;
+    if (!pack_keys(keys, n_keys, sizes, packed, lens, counts)) return SR_ERR;
+    return sr_put_states(handle, packed.data(), lens.data(), n_keys, states, counts.data());
+}
+
+int get_actions(SR_HANDLE handle, const char* const* keys, int n_keys, double* actions, const size_t* sizes) {
+    std::string packed;
+    std::vector<int> lens, counts;
+    if (!pack_keys(keys, n_keys, sizes, packed, lens, counts)) return SR_ERR;
+    return sr_get_actions(handle, packed.data(), lens.data(), n_keys, actions, counts.data());
+}
+
+int wait_actions(SR_HANDLE handle, const char* const* keys, int n_keys, double* actions, const size_t* sizes,
+                 double timeout) {
+    std::string packed;
+    std::vector<int> lens, counts;
+    if (!pack_keys(keys, n_keys, sizes, packed, lens, counts)) return SR_ERR;
+    return sr_wait_actions(handle, packed.data(), lens.data(), n_keys, actions, counts.data(), timeout);
+}
+
+/* sparse states and actions forward to sr_*_sparse */
+int put_state_sparse(SR_HANDLE handle, const char* key, const double* state, size_t n,
+                     const int* indices, size_t n_indices) {
+    if (!key) return SR_ERR;
+    return sr_put_state_sparse(handle, key, (int)std::strlen(key), state, (int)n, indices, (int)n_indices);
+}
+
+int put_state_masked(SR_HANDLE handle, const char* key, const double* state, size_t n, const int* mask) {
+    if (!key) return SR_ERR;
+    return sr_put_state_masked(handle, key, (int)std::strlen(key), state, (int)n, mask);
+}
+
+int put_state_delta(SR_HANDLE handle, const char* key, const double* state, size_t n, double threshold) {
+    if (!key) return SR_ERR;
+    return sr_put_state_delta(handle, key, (int)std::strlen(key), state, (int)n, threshold);
+}
+
+int get_action_sparse(SR_HANDLE handle, const char* key, double* action, size_t n) {
+    if (!key) return SR_ERR;
+    return sr_get_action_sparse(handle, key, (int)std::strlen(key), action, (int)n);
+}
+
+int wait_action_sparse(SR_HANDLE handle, const char* key, double* action, size_t n, double timeout) {
+    if (!key) return SR_ERR;
+    return sr_wait_action_sparse(handle, key, (int)std::strlen(key), action, (int)n, timeout);
+}
+
+int open_trajectory(SR_HANDLE handle, const char* key, size_t n_steps, size_t n_features, size_t n_points,
+                    size_t n_reward, int async) {
+    if (!key) return SR_ERR;
+    return sr_open_trajectory(handle, key, (int)std::strlen(key), (int)n_steps, (int)n_features, (int)n_points,
+                              (int)n_reward, async);
+}
+
+int append_step(SR_HANDLE handle, const char* key, const double* state, size_t n_state,
+                const double* reward, size_t n_reward, int step_type) {
+    if (!key) return SR_ERR;
+    return sr_append_step(handle, key, (int)std::strlen(key), state, (int)n_state, reward, (int)n_reward, step_type);
+}
+
+int flush_trajectory(SR_HANDLE handle, const char* key) {
+    if (!key) return SR_ERR;
+    return sr_flush_trajectory(handle, key, (int)std::strlen(key));
+}
+
+int close_trajectory(SR_HANDLE handle, const char* key) {
+    if (!key) return SR_ERR;
+    return sr_close_trajectory(handle, key, (int)std::strlen(key));
+}
+
+int set_wait_policy(SR_HANDLE handle, int spin_checks, int short_sleep_us, int short_polls, int max_sleep_us) {
+    return sr_set_wait_policy(handle, spin_checks, short_sleep_us, short_polls, max_sleep_us);
+}
+
+int get_action_wait_time(SR_HANDLE handle, double* total, double* last) {
+    return sr_get_action_wait_time(handle, total, last);
+}
+
 /* optional forwards for other helpers */
 int put_step_type(SR_HANDLE handle, const char* key, int step_type) {
     if (!key) return SR_ERR;
@@ -50,9 +229,168 @@ int put_info(SR_HANDLE handle, const char* key, const int* info, size_t n) {
     return sr_put_info(handle, key, (int)std::strlen(key), info, (int)n);
 }
 
+int put_state_nd(SR_HANDLE handle, const char* key, const double* state, const int* dims, int ndims, int layout) {
+    if (!key) return SR_ERR;
+    return sr_put_state_nd(handle, key, (int)std::strlen(key), state, dims, ndims, layout);
+}
+
+int put_fields(SR_HANDLE handle, const char* key, const double* const* fields, int n_fields,
+               size_t n_points, int stride, int layout) {
+    if (!key) return SR_ERR;
+    return sr_put_fields(handle, key, (int)std::strlen(key), fields, n_fields, (int)n_points, stride, layout);
+}
+
 int put_real_scalar(SR_HANDLE handle, const char* key, double value) {
     if (!key) return SR_ERR;
     return sr_put_real_scalar(handle, key, (int)std::strlen(key), value);
 }
 
+int put_tensor(SR_HANDLE handle, const char* key, const void* data, size_t n, int type) {
+    if (!key) return SR_ERR;
+    return sr_put_tensor(handle, key, (int)std::strlen(key), data, (int)n, type);
+}
+
+int get_tensor(SR_HANDLE handle, const char* key, void* data, size_t n, int type) {
+    if (!key) return SR_ERR;
+    return sr_get_tensor(handle, key, (int)std::strlen(key), data, (int)n, type);
+}
+
+int wait_tensor(SR_HANDLE handle, const char* key, void* data, size_t n, int type, double timeout) {
+    if (!key) return SR_ERR;
+    return sr_wait_tensor(handle, key, (int)std::strlen(key), data, (int)n, type, timeout);
+}
+
+int put_state_typed(SR_HANDLE handle, const char* key, const void* state, int type, const int* dims, int ndims,
+                    int layout) {
+    if (!key) return SR_ERR;
+    return sr_put_state_typed(handle, key, (int)std::strlen(key), state, type, dims, ndims, layout);
+}
+
+int get_action_typed(SR_HANDLE handle, const char* key, void* action, size_t n, int type) {
+    if (!key) return SR_ERR;
+    return sr_get_action_typed(handle, key, (int)std::strlen(key), action, (int)n, type);
+}
+
+int wait_action_typed(SR_HANDLE handle, const char* key, void* action, size_t n, int type, double timeout) {
+    if (!key) return SR_ERR;
+    return sr_wait_action_typed(handle, key, (int)std::strlen(key), action, (int)n, type, timeout);
+}
+
+/* fused step exchange */
+int step_exchange(SR_HANDLE handle, const char* tag,
+                  const double* state, size_t n_state,
+                  const double* reward, size_t n_reward,
+                  int step_type,
+                  double* action, size_t n_action,
+                  const double* scalars, size_t n_scalars, double timeout) {
+    if (!tag) return SR_ERR;
+    return sr_step_exchange(handle, tag, (int)std::strlen(tag),
+                            state, (int)n_state, reward, (int)n_reward,
+                            step_type, action, (int)n_action,
+                            scalars, (int)n_scalars, timeout);
+}
+
+/* non-blocking puts */
+int iput_state(SR_HANDLE handle, const char* key, const double* state, size_t n, int* request) {
+    if (!key) return SR_ERR;
+    return sr_iput_state(handle, key, (int)std::strlen(key), state, (int)n, request);
+}
+
+int iput_reward(SR_HANDLE handle, const char* key, const double* reward, size_t n, int* request) {
+    if (!key) return SR_ERR;
+    return sr_iput_reward(handle, key, (int)std::strlen(key), reward, (int)n, request);
+}
+
+int iput_info(SR_HANDLE handle, const char* key, const int* info, size_t n, int* request) {
+    if (!key) return SR_ERR;
+    return sr_iput_info(handle, key, (int)std::strlen(key), info, (int)n, request);
+}
+
+int test_request(SR_HANDLE handle, int request, int* flag) {
+    return sr_test(handle, request, flag);
+}
+
+int wait_request(SR_HANDLE handle, int request) {
+    return sr_wait(handle, request);
+}
+
+int waitall_requests(SR_HANDLE handle) {
+    return sr_waitall(handle);
+}
+
+/* element type of a key on the wire (SR_WIRE_*) */
+int set_wire_precision(SR_HANDLE handle, const char* key, int precision) {
+    if (!key) return SR_ERR;
+    return sr_set_wire_precision(handle, key, (int)std::strlen(key), precision);
+}
+
+/* lossless compression of a key's tensors from threshold_bytes on (SR_CODEC_*) */
+int set_compression(SR_HANDLE handle, const char* key, int codec, long long threshold_bytes) {
+    if (!key) return SR_ERR;
+    return sr_set_compression(handle, key, (int)std::strlen(key), codec, threshold_bytes);
+}
+
+int get_compression_stats(SR_HANDLE handle, const char* key, double* ratio, double* last_ratio,
+                          double* encode_seconds, double* decode_seconds) {
+    if (!key) return SR_ERR;
+    return sr_get_compression_stats(handle, key, (int)std::strlen(key), ratio, last_ratio,
+                                    encode_seconds, decode_seconds);
+}
+
+/* local policy; weights_key "" removes it */
+int set_local_policy(SR_HANDLE handle, const char* action_key, const char* state_key, const char* weights_key,
+                     int refresh_steps) {
+    if (!action_key || !state_key || !weights_key) return SR_ERR;
+    return sr_set_local_policy(handle, action_key, (int)std::strlen(action_key), state_key,
+                               (int)std::strlen(state_key), weights_key, (int)std::strlen(weights_key),
+                               refresh_steps);
+}
+
+int get_policy_version(SR_HANDLE handle, const char* action_key, int* version) {
+    if (!action_key) return SR_ERR;
+    return sr_get_policy_version(handle, action_key, (int)std::strlen(action_key), version);
+}
+
+/* statistics; a NULL path dumps to stdout */
+int enable_stats(SR_HANDLE handle, int enabled, int trace) {
+    return sr_enable_stats(handle, enabled, trace);
+}
+
+int get_stats(SR_HANDLE handle, int op, const char* key, int phase, double* values) {
+    if (!key) return SR_ERR;
+    return sr_get_stats(handle, op, key, (int)std::strlen(key), phase, values);
+}
+
+int reset_stats(SR_HANDLE handle) {
+    return sr_reset_stats(handle);
+}
+
+int dump_stats(SR_HANDLE handle, const char* path) {
+    return sr_dump_stats(handle, path, path ? (int)std::strlen(path) : 0);
+}
+
+int dump_trace(SR_HANDLE handle, const char* prefix) {
+    if (!prefix) return SR_ERR;
+    return sr_dump_trace(handle, prefix, (int)std::strlen(prefix));
+}
+
+/* exchange plan invalidation */
+int invalidate_plan(SR_HANDLE handle, const char* key) {
+    if (!key) return SR_ERR;
+    return sr_invalidate_plan(handle, key, (int)std::strlen(key));
+}
+
+int invalidate_plans(SR_HANDLE handle) {
+    return sr_invalidate_plans(handle);
+}
+
+int set_record_log(SR_HANDLE handle, const char* prefix) {
+    return sr_set_record_log(handle, prefix, prefix ? (int)std::strlen(prefix) : 0);
+}
+
+int set_replay_log(SR_HANDLE handle, const char* prefix) {
+    if (!prefix) return SR_ERR;
+    return sr_set_replay_log(handle, prefix, (int)std::strlen(prefix));
+}
+
 } // extern "C"
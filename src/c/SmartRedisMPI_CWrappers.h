@@ -1,6 +1,8 @@
 #ifndef SMARTREDISMPI_CWRAPPERS_H
 #define SMARTREDISMPI_CWRAPPERS_H
 
+#include <mpi.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -13,19 +15,169 @@ typedef void* SR_HANDLE;
 /* Return codes */
 #define SR_OK 0
 #define SR_ERR 1
+#define SR_TIMEOUT 2
+
+/* Memory layouts */
+#define SR_LAYOUT_CONTIGUOUS 0
+#define SR_LAYOUT_FORTRAN 1
+
+/* Element types of put_tensor / get_tensor */
+#define SR_TYPE_FLOAT64 1
+#define SR_TYPE_FLOAT32 2
+#define SR_TYPE_INT8 3
+#define SR_TYPE_INT16 4
+#define SR_TYPE_INT32 5
+#define SR_TYPE_INT64 6
+#define SR_TYPE_UINT8 7
+#define SR_TYPE_UINT16 8
+
+/* Compression codecs */
+#define SR_CODEC_NONE 0
+#define SR_CODEC_SHUFFLE_LZ 1
+#define SR_CODEC_XOR_SHUFFLE_LZ 2
+
+/* Statistics: operations, phases, values per sr_get_stats call */
+#define SR_OP_PUT_STATE 0
+#define SR_OP_PUT_INFO 1
+#define SR_OP_PUT_FIELDS 2
+#define SR_OP_GET_ACTION 3
+#define SR_OP_STEP_EXCHANGE 4
+#define SR_OP_IPUT 5
+#define SR_OP_PUT_SCALAR 6
+#define SR_OP_PUT_BATCH 7
+#define SR_OP_GET_BATCH 8
+#define SR_OP_PUT_SPARSE 9
+#define SR_OP_GET_SPARSE 10
+#define SR_OP_PUT_TRAJECTORY 11
+#define SR_OP_PUT_TENSOR 12
+#define SR_OP_GET_TENSOR 13
+#define SR_OP_RING_GC 14
+#define SR_OP_POLICY_LOAD 15
+#define SR_OP_POLICY_EVAL 16
+#define SR_PHASE_TOTAL 0
+#define SR_PHASE_MPI 1
+#define SR_PHASE_REDIS 2
+#define SR_PHASE_WAIT 3
+#define SR_STAT_NVALUES 7
+
+/* Transports */
+#define SR_TRANSPORT_DEFAULT -1
+#define SR_TRANSPORT_SMARTREDIS 0
+#define SR_TRANSPORT_SHM 1
+#define SR_TRANSPORT_REPLAY 2
+
+/* Writer modes */
+#define SR_WRITER_ROOT 0
+#define SR_WRITER_NODE 1
+#define SR_WRITER_STRIDE 2
+
+/* Collective modes */
+#define SR_COLLECTIVE_FLAT 0
+#define SR_COLLECTIVE_HIERARCHICAL 1
 
 SR_HANDLE create_smartredis_mpi(int clustered);
 int       destroy_smartredis_mpi(SR_HANDLE handle);
 
+/* comm is a Fortran communicator handle, -1 for MPI_COMM_WORLD */
 int init_smartredis_mpi(SR_HANDLE handle, int clustered, int comm);
+int init_smartredis_mpi_transport(SR_HANDLE handle, int clustered, int comm, int transport);
+/* Same with a C communicator, e.g. one environment's part of MPI_Comm_split */
+int init_smartredis_mpi_comm(SR_HANDLE handle, int clustered, MPI_Comm comm, int transport);
 int finalize_smartredis_mpi(SR_HANDLE handle);
+int set_writer_mode(SR_HANDLE handle, int mode, int stride);
+int set_collective_mode(SR_HANDLE handle, int mode);
+/* Hybrid MPI + threads: one lane per thread (OpenMP thread number or bind_thread) */
+int init_mpi_threads(int* provided);
+int set_threads(SR_HANDLE handle, int n_threads);
+int bind_thread(int lane);
 int put_state(SR_HANDLE handle, const char* key, const double* state, size_t n);
 int put_reward(SR_HANDLE handle, const char* key, const double* reward, size_t n);
 int get_action(SR_HANDLE handle, const char* key, double* action, size_t n);
+int wait_action(SR_HANDLE handle, const char* key, double* action, size_t n, double timeout);
+/* Pre-registered keys: the *_id calls take the id from register_key instead of a key */
+int register_key(SR_HANDLE handle, const char* key, int per_step, int* id);
+int set_step(SR_HANDLE handle, long long step);
+int put_state_id(SR_HANDLE handle, int id, const double* state, size_t n);
+int put_reward_id(SR_HANDLE handle, int id, const double* reward, size_t n);
+int put_info_id(SR_HANDLE handle, int id, const int* info, size_t n);
+int get_action_id(SR_HANDLE handle, int id, double* action, size_t n);
+int wait_action_id(SR_HANDLE handle, int id, double* action, size_t n, double timeout);
+int put_step_type_id(SR_HANDLE handle, int id, int step_type);
+int put_real_scalar_id(SR_HANDLE handle, int id, double value);
+/* Step-versioned ring: a per-step key keeping the last `slots` steps; the *_step calls read
+   the action of a given step of the window */
+int register_ring_key(SR_HANDLE handle, const char* key, int slots, int* id);
+int get_action_step(SR_HANDLE handle, int id, long long step, double* action, size_t n);
+int wait_action_step(SR_HANDLE handle, int id, long long step, double* action, size_t n, double timeout);
+/* Batched keys: block k of states / actions holds sizes[k] values of keys[k] */
+int put_states(SR_HANDLE handle, const char* const* keys, int n_keys, const double* states, const size_t* sizes);
+int get_actions(SR_HANDLE handle, const char* const* keys, int n_keys, double* actions, const size_t* sizes);
+int wait_actions(SR_HANDLE handle, const char* const* keys, int n_keys, double* actions, const size_t* sizes,
+                 double timeout);
+/* Sparse states and actions: indices are 0-based, mask entries != 0 are sent */
+int put_state_sparse(SR_HANDLE handle, const char* key, const double* state, size_t n,
+                     const int* indices, size_t n_indices);
+int put_state_masked(SR_HANDLE handle, const char* key, const double* state, size_t n, const int* mask);
+int put_state_delta(SR_HANDLE handle, const char* key, const double* state, size_t n, double threshold);
+int get_action_sparse(SR_HANDLE handle, const char* key, double* action, size_t n);
+int wait_action_sparse(SR_HANDLE handle, const char* key, double* action, size_t n, double timeout);
+/* Trajectory buffering: state is [n_features, n_points] per step */
+int open_trajectory(SR_HANDLE handle, const char* key, size_t n_steps, size_t n_features, size_t n_points,
+                    size_t n_reward, int async);
+int append_step(SR_HANDLE handle, const char* key, const double* state, size_t n_state,
+                const double* reward, size_t n_reward, int step_type);
+int flush_trajectory(SR_HANDLE handle, const char* key);
+int close_trajectory(SR_HANDLE handle, const char* key);
+int set_wait_policy(SR_HANDLE handle, int spin_checks, int short_sleep_us, int short_polls, int max_sleep_us);
+int get_action_wait_time(SR_HANDLE handle, double* total, double* last);
 
 int put_step_type(SR_HANDLE handle, const char* key, int step_type);
 int put_info(SR_HANDLE handle, const char* key, const int* info, size_t n);
+int put_state_nd(SR_HANDLE handle, const char* key, const double* state, const int* dims, int ndims, int layout);
+int put_fields(SR_HANDLE handle, const char* key, const double* const* fields, int n_fields,
+               size_t n_points, int stride, int layout);
 int put_real_scalar(SR_HANDLE handle, const char* key, double value);
+/* Typed tensors: n values of SR_TYPE_* type, sent and stored without conversion */
+int put_tensor(SR_HANDLE handle, const char* key, const void* data, size_t n, int type);
+int get_tensor(SR_HANDLE handle, const char* key, void* data, size_t n, int type);
+int wait_tensor(SR_HANDLE handle, const char* key, void* data, size_t n, int type, double timeout);
+/* States and actions of SR_TYPE_FLOAT64 / FLOAT32 / INT32 / INT64, converted to and from the key's wire precision */
+int put_state_typed(SR_HANDLE handle, const char* key, const void* state, int type, const int* dims, int ndims,
+                    int layout);
+int get_action_typed(SR_HANDLE handle, const char* key, void* action, size_t n, int type);
+int wait_action_typed(SR_HANDLE handle, const char* key, void* action, size_t n, int type, double timeout);
+
+int step_exchange(SR_HANDLE handle, const char* tag,
+                  const double* state, size_t n_state,
+                  const double* reward, size_t n_reward,
+                  int step_type,
+                  double* action, size_t n_action,
+                  const double* scalars, size_t n_scalars, double timeout);
+
+int iput_state(SR_HANDLE handle, const char* key, const double* state, size_t n, int* request);
+int iput_reward(SR_HANDLE handle, const char* key, const double* reward, size_t n, int* request);
+int iput_info(SR_HANDLE handle, const char* key, const int* info, size_t n, int* request);
+int test_request(SR_HANDLE handle, int request, int* flag);
+int wait_request(SR_HANDLE handle, int request);
+int waitall_requests(SR_HANDLE handle);
+
+int set_wire_precision(SR_HANDLE handle, const char* key, int precision);
+int set_compression(SR_HANDLE handle, const char* key, int codec, long long threshold_bytes);
+int get_compression_stats(SR_HANDLE handle, const char* key, double* ratio, double* last_ratio,
+                          double* encode_seconds, double* decode_seconds);
+int set_local_policy(SR_HANDLE handle, const char* action_key, const char* state_key, const char* weights_key,
+                     int refresh_steps);
+int get_policy_version(SR_HANDLE handle, const char* action_key, int* version);
+int enable_stats(SR_HANDLE handle, int enabled, int trace);
+int get_stats(SR_HANDLE handle, int op, const char* key, int phase, double* values);
+int reset_stats(SR_HANDLE handle);
+int dump_stats(SR_HANDLE handle, const char* path);
+int dump_trace(SR_HANDLE handle, const char* prefix);
+int invalidate_plan(SR_HANDLE handle, const char* key);
+int invalidate_plans(SR_HANDLE handle);
+/* Record to <prefix>.<rank>.srlog (NULL or "" stops) / replay from such logs */
+int set_record_log(SR_HANDLE handle, const char* prefix);
+int set_replay_log(SR_HANDLE handle, const char* prefix);
 
 #ifdef __cplusplus
 }
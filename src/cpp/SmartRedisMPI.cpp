@@ -3,16 +3,50 @@
 #include <stdexcept>
 #include <vector>
 #include <cstring>
+#include <algorithm>
+#include <cstdint>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <limits>
 
-SmartRedisMPI::SmartRedisMPI(bool clustered, MPI_Comm comm)
-: mpi_comm_local(comm), client(nullptr)
+static int default_collective_mode() {
+    const char *v = std::getenv("SRMPI_COLLECTIVE");
+    if (v && std::strcmp(v, "hierarchical") == 0) return SmartRedisMPI::COLLECTIVE_HIERARCHICAL;
+    return SmartRedisMPI::COLLECTIVE_FLAT;
+}
+
+SmartRedisMPI::SmartRedisMPI(bool clustered, MPI_Comm comm, int transport)
+: SmartRedisMPI(clustered, comm, transport, true) {}
+
+SmartRedisMPI::SmartRedisMPI(bool clustered, MPI_Comm comm, int transport, bool connect)
+: mpi_comm_local(comm), client(nullptr), db_clustered(clustered),
+  transport_kind(transport < 0 ? default_transport_kind() : transport),
+  writer_mode(WRITER_ROOT), writer_stride(0), shard_comm(comm), leader_comm(MPI_COMM_NULL), own_comm(MPI_COMM_NULL),
+  shard_id(0), n_shards(1), collective_mode(default_collective_mode()),
+  node_comm(MPI_COMM_NULL), node_leader_comm(MPI_COMM_NULL), async_leader_comm(MPI_COMM_NULL), node_rank(0),
+#ifdef _SINGLE_PRECISION
+  default_wire_precision(WIRE_FLOAT32),
+#else
+  default_wire_precision(WIRE_FLOAT64),
+#endif
+  action_wait_total(0.0), action_wait_last(0.0), current_step(0),
+  next_request(0), progress_stop(false), io_client(nullptr), io_stop(false)
 {
     MPI_Comm_rank(mpi_comm_local, &myid);
     MPI_Comm_size(mpi_comm_local, &nprocs);
+    shard_rank = myid;
+    shard_nprocs = nprocs;
+    if (!transport_kind_valid(transport_kind))
+        throw std::invalid_argument("SmartRedisMPI: unknown transport");
+    if (!connect) return;
+    if (const char *v = std::getenv("SRMPI_RECORD")) record_prefix = v;
+    if (const char *v = std::getenv("SRMPI_REPLAY")) replay_prefix = v;
 
     if (myid == 0) {
         try {
-            client = new SmartRedis::Client(clustered, "default");
+            client = open_transport();
         } catch (const std::exception &e) {
             std::cerr << "SmartRedis client creation failed: " << e.what() << std::endl;
             throw;
@@ -21,125 +55,2908 @@ SmartRedisMPI::SmartRedisMPI(bool clustered, MPI_Comm comm)
 }
 
 SmartRedisMPI::~SmartRedisMPI() {
-    if (myid == 0 && client) {
+    lanes.clear();
+    int finalized = 0;
+    MPI_Finalized(&finalized);
+    if (!finalized) {
+        try {
+            close_trajectories();
+        } catch (const std::exception &e) {
+            std::cerr << "SmartRedisMPI: closing trajectories failed: " << e.what() << std::endl;
+        }
+        try {
+            waitall();
+        } catch (const std::exception &e) {
+            std::cerr << "SmartRedisMPI: completing requests failed: " << e.what() << std::endl;
+        }
+    }
+    stop_io_thread();
+    if (!finalized) {
+        invalidate_plans();
+        free_writer_comms();
+        release_comm();
+    }
+    if (client) {
         delete client;
         client = nullptr;
     }
 }
 
-void SmartRedisMPI::init_smartredis_mpi(bool clustered, MPI_Comm comm) {
-    mpi_comm_local = (comm != MPI_COMM_NULL) ? comm : MPI_COMM_WORLD;
+void SmartRedisMPI::init_smartredis_mpi(bool clustered, MPI_Comm comm, int transport) {
+    if (transport >= 0 && !transport_kind_valid(transport))
+        throw std::invalid_argument("SmartRedisMPI: unknown transport");
+    close_lanes();
+    close_trajectories();
+    invalidate_plans();
+    free_writer_comms();
+    release_comm();
+    if ((transport >= 0 && transport != transport_kind) || clustered != db_clustered) {
+        stop_io_thread();
+        delete client;
+        client = nullptr;
+        if (transport >= 0) transport_kind = transport;
+    }
+    db_clustered = clustered;
+    // A private duplicate keeps this instance's collectives apart from the
+    // caller's and from other instances sharing ranks of the same comm
+    MPI_Comm_dup((comm != MPI_COMM_NULL) ? comm : MPI_COMM_WORLD, &own_comm);
+    mpi_comm_local = own_comm;
     MPI_Comm_rank(mpi_comm_local, &myid);
     MPI_Comm_size(mpi_comm_local, &nprocs);
+    shard_comm = mpi_comm_local;
+    shard_rank = myid;
+    shard_nprocs = nprocs;
 
+    // The constructor connected rank 0 of its comm, which may not be the root here
+    if (myid != 0 && client) {
+        stop_io_thread();
+        delete client;
+        client = nullptr;
+    }
     if (myid == 0 && !client) {
-        client = new SmartRedis::Client(clustered, "default");
+        client = open_transport();
     }
 }
 
+void SmartRedisMPI::release_comm() {
+    if (own_comm == MPI_COMM_NULL) return;
+    MPI_Comm_free(&own_comm);
+    mpi_comm_local = MPI_COMM_NULL;
+    shard_comm = MPI_COMM_NULL;
+}
+
 void SmartRedisMPI::finalize_smartredis_mpi() {
-    if (myid == 0 && client) {
+    close_lanes();
+    close_trajectories();
+    invalidate_plans();
+    free_writer_comms();
+    stop_io_thread();
+    release_comm();
+    if (client) {
+        delete client;
+        client = nullptr;
+    }
+    record_log.reset();
+}
+
+Transport *SmartRedisMPI::open_transport() {
+    Transport *t = nullptr;
+    if (transport_kind == TRANSPORT_REPLAY) {
+        if (!replay_prefix.empty() && replay_prefix == record_prefix)
+            throw std::invalid_argument("SmartRedisMPI: cannot record into the log being replayed");
+        t = new ReplayTransport(replay_prefix.empty() ? "" : record_log_path(replay_prefix, myid));
+    } else {
+        t = create_transport(transport_kind, db_clustered);
+    }
+    if (record_prefix.empty()) return t;
+    try {
+        const std::string path = record_log_path(record_prefix, myid);
+        if (!record_log || record_log->path() != path) record_log = std::make_shared<RecordLog>(path, myid);
+    } catch (...) {
+        delete t;
+        throw;
+    }
+    return new RecordTransport(t, record_log);
+}
+
+void SmartRedisMPI::reopen_transport() {
+    stop_io_thread();  // queued puts land in the old log
+    if (client) {
         delete client;
         client = nullptr;
     }
+    record_log.reset();
+    if (shard_rank == 0) client = open_transport();
+}
+
+void SmartRedisMPI::set_record_log(const std::string &prefix) {
+    record_prefix = prefix;
+    reopen_transport();
+    for (size_t i=0;i<lanes.size();i++)
+        lanes[i]->set_record_log(prefix.empty() ? prefix : prefix + ".lane" + std::to_string(i));
+}
+
+void SmartRedisMPI::set_replay_log(const std::string &prefix) {
+    replay_prefix = prefix;
+    if (transport_kind == TRANSPORT_REPLAY) reopen_transport();
+    for (size_t i=0;i<lanes.size();i++)
+        lanes[i]->set_replay_log(prefix.empty() ? prefix : prefix + ".lane" + std::to_string(i));
+}
+
+// === Thread lanes ===
+
+// Resolved at link time: null unless the program links an OpenMP runtime
+extern "C" int omp_get_thread_num(void) __attribute__((weak));
+
+static thread_local int bound_lane = -1;
+
+void SmartRedisMPI::bind_thread(int lane) {
+    bound_lane = lane;
+}
+
+int SmartRedisMPI::init_mpi_threads(int *argc, char ***argv) {
+    int initialized = 0, provided = MPI_THREAD_SINGLE;
+    MPI_Initialized(&initialized);
+    if (initialized) MPI_Query_thread(&provided);
+    else MPI_Init_thread(argc, argv, MPI_THREAD_MULTIPLE, &provided);
+    return provided;
+}
+
+SmartRedisMPI &SmartRedisMPI::for_thread() {
+    if (lanes.empty()) return *this;
+    int lane = bound_lane;
+    if (lane < 0) lane = omp_get_thread_num ? omp_get_thread_num() : 0;
+    if (lane >= static_cast<int>(lanes.size()))
+        throw std::out_of_range("SmartRedisMPI: thread " + std::to_string(lane) + " has no lane (set_threads(" +
+                                std::to_string(lanes.size()) + "))");
+    return *lanes[lane];
+}
+
+void SmartRedisMPI::set_threads(int n_threads) {
+    if (n_threads < 1) throw std::invalid_argument("SmartRedisMPI: the number of threads must be positive");
+    int provided = MPI_THREAD_SINGLE;
+    MPI_Query_thread(&provided);
+    if (n_threads > 1 && provided < MPI_THREAD_MULTIPLE)
+        throw std::logic_error("SmartRedisMPI: threads need MPI initialized with MPI_THREAD_MULTIPLE");
+    close_lanes();
+    if (n_threads == 1) return;
+
+    // Each lane dups mpi_comm_local in its init, collectively and in lane order
+    for (int i=0;i<n_threads;i++) {
+        std::unique_ptr<SmartRedisMPI> lane(new SmartRedisMPI(db_clustered, mpi_comm_local, transport_kind, false));
+        const std::string suffix = ".lane" + std::to_string(i);
+        if (!record_prefix.empty()) lane->record_prefix = record_prefix + suffix;
+        if (!replay_prefix.empty()) lane->replay_prefix = replay_prefix + suffix;
+        lane->init_smartredis_mpi(db_clustered, mpi_comm_local, -1);
+        lane->wire_precision = wire_precision;
+        lane->default_wire_precision = default_wire_precision;
+        lane->compression = compression;
+        lane->policies = policies;
+        // Same ids on every lane; plans and ring slots are the lane's own
+        lane->key_handles = key_handles;
+        for (KeyHandle &h : lane->key_handles) {
+            h.plan = nullptr;
+            h.resolved = false;
+            h.live.clear();
+        }
+        lane->wait_policy = wait_policy;
+        lane->current_step = current_step;
+        lane->set_collective_mode(collective_mode);
+        if (writer_mode != WRITER_ROOT) lane->set_writer_mode(writer_mode, writer_stride);
+        if (stats.enabled()) lane->enable_stats(true, stats.tracing());
+        lanes.push_back(std::move(lane));
+    }
+}
+
+void SmartRedisMPI::close_lanes() {
+    for (auto &lane : lanes) lane->finalize_smartredis_mpi();
+    lanes.clear();
+}
+
+ExchangeStats SmartRedisMPI::lane_stats() const {
+    ExchangeStats sum;
+    sum.merge(stats);
+    for (const auto &lane : lanes) sum.merge(lane->stats);
+    return sum;
+}
+
+void SmartRedisMPI::set_wait_policy(const WaitPolicy &policy) {
+    wait_policy = policy;
+    for (auto &lane : lanes) lane->wait_policy = policy;
+}
+
+void SmartRedisMPI::set_step(long long step) {
+    current_step = step;
+    for (auto &lane : lanes) lane->set_step(step);
+    if (shard_rank == 0 && client) collect_slots();
 }
 
 // === Helper for rank0-only operations ===
 #define RANK0_ONLY if(myid != 0) return;
+#define WRITER_ONLY if(shard_rank != 0) return;
+
+static size_t tensor_type_size(SRTensorType type) {
+    switch (type) {
+    case SRTensorTypeDouble:
+    case SRTensorTypeInt64: return 8;
+    case SRTensorTypeFloat:
+    case SRTensorTypeInt32: return 4;
+    case SRTensorTypeInt16:
+    case SRTensorTypeUint16: return 2;
+    default: return 1;
+    }
+}
+
+// Element types of typed states and actions
+static void check_value_type(SRTensorType type) {
+    if (type != SRTensorTypeDouble && type != SRTensorTypeFloat && type != SRTensorTypeInt32 &&
+        type != SRTensorTypeInt64)
+        throw std::invalid_argument("SmartRedisMPI: states and actions are float64, float32, int32 or int64");
+}
+
+template <typename T>
+static void widen_from(const void *src, size_t n, double *dst) {
+    const T *p = static_cast<const T*>(src);
+    for (size_t i=0;i<n;i++) dst[i] = static_cast<double>(p[i]);
+}
+
+template <typename T>
+static void narrow_to(const double *src, size_t n, void *dst) {
+    T *p = static_cast<T*>(dst);
+    for (size_t i=0;i<n;i++) p[i] = static_cast<T>(std::nearbyint(src[i]));
+}
+
+static void widen_values(const void *src, SRTensorType type, size_t n, double *dst) {
+    switch (type) {
+    case SRTensorTypeFloat: widen_from<float>(src, n, dst); break;
+    case SRTensorTypeInt32: widen_from<int32_t>(src, n, dst); break;
+    case SRTensorTypeInt64: widen_from<int64_t>(src, n, dst); break;
+    default: check_value_type(type); std::memcpy(dst, src, n * sizeof(double));
+    }
+}
+
+static void narrow_values(const double *src, size_t n, SRTensorType type, void *dst) {
+    switch (type) {
+    case SRTensorTypeFloat: {
+        float *p = static_cast<float*>(dst);
+        for (size_t i=0;i<n;i++) p[i] = static_cast<float>(src[i]);
+        break;
+    }
+    case SRTensorTypeInt32: narrow_to<int32_t>(src, n, dst); break;
+    case SRTensorTypeInt64: narrow_to<int64_t>(src, n, dst); break;
+    default: check_value_type(type); std::memcpy(dst, src, n * sizeof(double));
+    }
+}
+
+static MPI_Datatype tensor_mpi_type(SRTensorType type) {
+    switch (type) {
+    case SRTensorTypeDouble: return TensorTraits<double>::mpi_type();
+    case SRTensorTypeFloat: return TensorTraits<float>::mpi_type();
+    case SRTensorTypeInt8: return TensorTraits<int8_t>::mpi_type();
+    case SRTensorTypeInt16: return TensorTraits<int16_t>::mpi_type();
+    case SRTensorTypeInt32: return TensorTraits<int32_t>::mpi_type();
+    case SRTensorTypeInt64: return TensorTraits<int64_t>::mpi_type();
+    case SRTensorTypeUint8: return TensorTraits<uint8_t>::mpi_type();
+    case SRTensorTypeUint16: return TensorTraits<uint16_t>::mpi_type();
+    default: throw std::invalid_argument("SmartRedisMPI: unsupported tensor type");
+    }
+}
+
+// === Writer shards ===
+
+void SmartRedisMPI::free_writer_comms() {
+    free_node_comms();
+    if (shard_comm != MPI_COMM_NULL && shard_comm != mpi_comm_local) MPI_Comm_free(&shard_comm);
+    if (leader_comm != MPI_COMM_NULL) MPI_Comm_free(&leader_comm);
+    writer_mode = WRITER_ROOT;
+    shard_comm = mpi_comm_local;
+    shard_rank = myid;
+    shard_nprocs = nprocs;
+    shard_id = 0;
+    n_shards = 1;
+    shard_ranks.clear();
+}
+
+void SmartRedisMPI::set_writer_mode(int mode, int stride) {
+    if (mode != WRITER_ROOT && mode != WRITER_NODE && mode != WRITER_STRIDE)
+        throw std::invalid_argument("SmartRedisMPI: unknown writer mode");
+    if (mode == WRITER_STRIDE && stride <= 0)
+        throw std::invalid_argument("SmartRedisMPI: writer stride must be positive");
+    if (!trajectories.empty())
+        throw std::logic_error("SmartRedisMPI: close open trajectories before changing the writer mode");
+
+    for (auto &lane : lanes) lane->set_writer_mode(mode, stride);
+    invalidate_plans();
+    free_writer_comms();
+    if (mode == WRITER_ROOT) return;
+
+    if (mode == WRITER_NODE) {
+        MPI_Comm_split_type(mpi_comm_local, MPI_COMM_TYPE_SHARED, myid, MPI_INFO_NULL, &shard_comm);
+    } else {
+        MPI_Comm_split(mpi_comm_local, myid / stride, myid, &shard_comm);
+    }
+    writer_mode = mode;
+    writer_stride = stride;
+    MPI_Comm_rank(shard_comm, &shard_rank);
+    MPI_Comm_size(shard_comm, &shard_nprocs);
+
+    // Writers are ordered by global rank, so rank 0 is always shard 0
+    MPI_Comm_split(mpi_comm_local, shard_rank == 0 ? 0 : MPI_UNDEFINED, myid, &leader_comm);
+    if (leader_comm != MPI_COMM_NULL) {
+        MPI_Comm_rank(leader_comm, &shard_id);
+        MPI_Comm_size(leader_comm, &n_shards);
+    }
+    MPI_Bcast(&shard_id, 1, MPI_INT, 0, shard_comm);
+    MPI_Bcast(&n_shards, 1, MPI_INT, 0, shard_comm);
+    shard_ranks.resize(shard_rank == 0 ? shard_nprocs : 0);
+    MPI_Gather(&myid, 1, MPI_INT, shard_ranks.data(), 1, MPI_INT, 0, shard_comm);
+
+    if (shard_rank == 0 && !client) {
+        try {
+            client = open_transport();
+        } catch (const std::exception &e) {
+            std::cerr << "SmartRedis client creation failed on writer " << shard_id << ": " << e.what() << std::endl;
+            throw;
+        }
+    }
+}
+
+void SmartRedisMPI::set_collective_mode(int mode) {
+    if (mode != COLLECTIVE_FLAT && mode != COLLECTIVE_HIERARCHICAL)
+        throw std::invalid_argument("SmartRedisMPI: unknown collective mode");
+    invalidate_plans();
+    collective_mode = mode;
+    for (auto &lane : lanes) lane->set_collective_mode(mode);
+}
+
+std::string SmartRedisMPI::shard_key(const std::string &key) const {
+    if (writer_mode == WRITER_ROOT) return key;
+    return key + ".shard" + std::to_string(shard_id);
+}
+
+// Manifests of a sharded key, written by shard 0; lengths (writers only)
+// holds the values of each shard rank:
+//   <key>.manifest        int64 [n_shards, 2]: (global offset, length) per shard
+//   <key>.manifest_ranks  int64 [nprocs, 3]: (shard, offset within the shard,
+//                         length) of every rank, in rank order
+// A shard lists its ranks in rank order, but need not be a contiguous range
+// of ranks (WRITER_NODE with round-robin placement), so the rank order of
+// the whole key comes from manifest_ranks, not from concatenating shards
+void SmartRedisMPI::put_manifest(const std::string &key, const std::vector<int> &lengths) {
+    if (writer_mode == WRITER_ROOT || leader_comm == MPI_COMM_NULL) return;
+
+    const int n_local = 2 * shard_nprocs;
+    std::vector<int64_t> local(n_local);
+    for (int i=0;i<shard_nprocs;i++) {
+        local[2*i] = shard_ranks[i];
+        local[2*i+1] = lengths[i];
+    }
+    std::vector<int> counts(shard_id == 0 ? n_shards : 0);
+    std::vector<int> displs(counts.size());
+    std::vector<int64_t> all;
+    MPI_Gather(&n_local, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, leader_comm);
+    if (shard_id == 0) {
+        int n = 0;
+        for (int i=0;i<n_shards;i++) {
+            displs[i] = n;
+            n += counts[i];
+        }
+        all.resize(n);
+    }
+    MPI_Gatherv(local.data(), n_local, MPI_INT64_T, all.data(), counts.data(), displs.data(), MPI_INT64_T, 0,
+                leader_comm);
+    if (shard_id != 0) return;
+
+    std::vector<int64_t> manifest(2 * static_cast<size_t>(n_shards));
+    std::vector<int64_t> ranks(3 * static_cast<size_t>(nprocs));
+    int64_t offset = 0;
+    for (int s=0;s<n_shards;s++) {
+        int64_t in_shard = 0;
+        for (int j=displs[s]; j<displs[s]+counts[s]; j+=2) {
+            const size_t r = static_cast<size_t>(all[j]);
+            ranks[3*r] = s;
+            ranks[3*r+1] = in_shard;
+            ranks[3*r+2] = all[j+1];
+            in_shard += all[j+1];
+        }
+        manifest[2*s] = offset;
+        manifest[2*s+1] = in_shard;
+        offset += in_shard;
+    }
+    client->put_tensor(key + ".manifest", manifest.data(), {static_cast<size_t>(n_shards), 2}, SRTensorTypeInt64,
+                       SRMemLayoutContiguous);
+    client->put_tensor(key + ".manifest_ranks", ranks.data(), {static_cast<size_t>(nprocs), 3}, SRTensorTypeInt64,
+                       SRMemLayoutContiguous);
+}
+
+// === Exchange plans ===
+
+// A size change seen by some ranks only throws there and leaves the others
+// waiting in the gather. With stats enabled the shard agrees on it first, so
+// every rank throws; the check costs one small allreduce per call
+bool SmartRedisMPI::agree_plan_changed(bool changed) {
+    if (!stats.enabled()) return changed;
+    PhaseScope phase(stats, PHASE_MPI);
+    int any = changed ? 1 : 0;
+    MPI_Allreduce(MPI_IN_PLACE, &any, 1, MPI_INT, MPI_MAX, shard_comm);
+    return any != 0;
+}
+
+ExchangePlan &SmartRedisMPI::get_plan(const std::string &key, int size_local, MPI_Datatype datatype) {
+    auto it = plans.find(key);
+    if (it != plans.end()) {
+        ExchangePlan &plan = it->second;
+        if (agree_plan_changed(plan.local_size != size_local)) {
+            throw std::runtime_error("SmartRedisMPI: local size of '" + key +
+                                     "' changed; call invalidate_plan on all ranks first");
+        }
+        if (plan.datatype != datatype) {
+            // Same layout, different element type: only the buffers change
+            free_plan(plan);
+            int elem_size = 0;
+            MPI_Type_size(datatype, &elem_size);
+            plan.datatype = datatype;
+            plan.elem_size = elem_size;
+            if (shard_rank == 0) plan.root_buffer.assign(static_cast<size_t>(plan.total_size) * elem_size, 0);
+#if SRMPI_USE_PERSISTENT
+            plan.local_buffer.assign(static_cast<size_t>(size_local) * elem_size, 0);
+#endif
+        }
+        return plan;
+    }
+
+    ExchangePlan plan;
+    plan.local_size = size_local;
+    plan.datatype = datatype;
+    MPI_Type_size(datatype, &plan.elem_size);
+
+    if (shard_rank == 0) plan.sizes.assign(shard_nprocs, 0);
+    {
+        PhaseScope phase(stats, PHASE_MPI);
+        MPI_Gather(&size_local, 1, MPI_INT,
+                   shard_rank==0 ? plan.sizes.data() : nullptr, 1, MPI_INT, 0, shard_comm);
+    }
+
+    if (shard_rank == 0) {
+        plan.displs.assign(shard_nprocs, 0);
+        for (int i=0;i<shard_nprocs;i++) {
+            plan.displs[i] = plan.total_size;
+            plan.total_size += plan.sizes[i];
+        }
+        plan.root_buffer.assign(static_cast<size_t>(plan.total_size) * plan.elem_size, 0);
+    }
+#if SRMPI_USE_PERSISTENT
+    plan.local_buffer.assign(static_cast<size_t>(size_local) * plan.elem_size, 0);
+#endif
+    put_manifest(key, plan.sizes);
+    return plans.emplace(key, std::move(plan)).first->second;
+}
+
+ExchangePlan &SmartRedisMPI::get_step_plan(const std::string &key, int n_state, int n_reward,
+                                           MPI_Datatype datatype) {
+    auto it = plans.find(key);
+    if (it != plans.end()) {
+        ExchangePlan &plan = it->second;
+        if (agree_plan_changed(plan.local_size != n_state + n_reward || plan.local_split != n_state)) {
+            throw std::runtime_error("SmartRedisMPI: local sizes of '" + key +
+                                     "' changed; call invalidate_plan on all ranks first");
+        }
+        if (plan.datatype != datatype) {
+            // New wire precision: same layout, other buffers
+            free_plan(plan);
+            MPI_Type_size(datatype, &plan.elem_size);
+            plan.datatype = datatype;
+            if (shard_rank == 0) step_buffers(plan);
+#if SRMPI_USE_PERSISTENT
+            plan.local_buffer.assign(static_cast<size_t>(plan.local_size) * plan.elem_size, 0);
+#endif
+        }
+        return plan;
+    }
+
+    ExchangePlan plan;
+    plan.local_size = n_state + n_reward;
+    plan.local_split = n_state;
+    plan.datatype = datatype;
+    MPI_Type_size(datatype, &plan.elem_size);
+
+    int local[2] = {n_state, n_reward};
+    std::vector<int> both(shard_rank == 0 ? 2 * shard_nprocs : 0);
+    MPI_Gather(local, 2, MPI_INT, both.data(), 2, MPI_INT, 0, shard_comm);
+
+    if (shard_rank == 0) {
+        plan.sizes.assign(shard_nprocs, 0);
+        plan.displs.assign(shard_nprocs, 0);
+        plan.splits.assign(shard_nprocs, 0);
+        plan.split_displs.assign(shard_nprocs, 0);
+        plan.reward_sizes.assign(shard_nprocs, 0);
+        plan.reward_displs.assign(shard_nprocs, 0);
+        int total_reward = 0;
+        for (int i=0;i<shard_nprocs;i++) {
+            plan.splits[i] = both[2*i];
+            plan.reward_sizes[i] = both[2*i+1];
+            plan.sizes[i] = both[2*i] + both[2*i+1];
+            plan.displs[i] = plan.total_size;
+            plan.split_displs[i] = plan.total_split;
+            plan.reward_displs[i] = total_reward;
+            plan.total_size += plan.sizes[i];
+            plan.total_split += plan.splits[i];
+            total_reward += plan.reward_sizes[i];
+        }
+        step_buffers(plan);
+    }
+#if SRMPI_USE_PERSISTENT
+    plan.local_buffer.assign(static_cast<size_t>(plan.local_size) * plan.elem_size, 0);
+#endif
+    return plans.emplace(key, std::move(plan)).first->second;
+}
+
+// Writer buffers of a step plan; only the hierarchical gather stages rank
+// blocks in root_buffer
+void SmartRedisMPI::step_buffers(ExchangePlan &plan) {
+    const size_t bytes = static_cast<size_t>(plan.total_size) * plan.elem_size;
+    plan.pack_buffer.assign(bytes, 0);
+    if (collective_mode == COLLECTIVE_HIERARCHICAL) plan.root_buffer.assign(bytes, 0);
+    else plan.root_buffer.clear();
+}
+
+void SmartRedisMPI::free_plan(ExchangePlan &plan) {
+    free_field_types(plan);
+    if (plan.node_win != MPI_WIN_NULL) {
+        MPI_Win_unlock_all(plan.node_win);
+        MPI_Win_free(&plan.node_win);
+        plan.node_buffer = nullptr;
+        plan.node_parity = 0;
+    }
+#if SRMPI_USE_PERSISTENT
+    if (plan.gather_req != MPI_REQUEST_NULL) MPI_Request_free(&plan.gather_req);
+    if (plan.scatter_req != MPI_REQUEST_NULL) MPI_Request_free(&plan.scatter_req);
+#endif
+}
+
+void SmartRedisMPI::free_field_types(ExchangePlan &plan) {
+    if (plan.recv_type != MPI_DATATYPE_NULL) MPI_Type_free(&plan.recv_type);
+    if (plan.send_type != MPI_DATATYPE_NULL) MPI_Type_free(&plan.send_type);
+    plan.send_addrs.clear();
+    plan.n_features = 0;
+}
+
+static std::string sparse_plan_name(const std::string &key) {
+    return "sparse:" + key;
+}
+
+static std::string fields_plan_name(const std::string &key) {
+    return "fields:" + key;
+}
+
+void SmartRedisMPI::invalidate_plan(const std::string &key) {
+    for (auto &lane : lanes) lane->invalidate_plan(key);
+    for (const std::string &name : {key, sparse_plan_name(key), fields_plan_name(key)}) {
+        auto it = plans.find(name);
+        if (it == plans.end()) continue;
+        waitall();  // in-flight gathers still reference the plan counts
+        for (KeyHandle &h : key_handles)
+            if (h.plan == &it->second) h.plan = nullptr;
+        free_plan(it->second);
+        plans.erase(it);
+    }
+}
+
+// Also called before every change of the shard layout, so registered keys
+// rebuild their shard names on next use
+void SmartRedisMPI::invalidate_plans() {
+    for (auto &lane : lanes) lane->invalidate_plans();
+    waitall();
+    for (auto &kv : plans) free_plan(kv.second);
+    plans.clear();
+    for (KeyHandle &h : key_handles) {
+        h.plan = nullptr;
+        h.resolved = false;
+    }
+}
+
+void SmartRedisMPI::gather_to_root(ExchangePlan &plan, const void *local) {
+    PhaseScope phase(stats, PHASE_MPI);
+    poll_requests();
+    if (collective_mode == COLLECTIVE_HIERARCHICAL) {
+        gather_hierarchical(plan, local);
+        return;
+    }
+#if SRMPI_USE_PERSISTENT
+    if (plan.gather_req == MPI_REQUEST_NULL) {
+        MPI_Gatherv_init(plan.local_buffer.data(), plan.local_size, plan.datatype,
+                         shard_rank==0 ? plan.root_buffer.data() : nullptr,
+                         shard_rank==0 ? plan.sizes.data() : nullptr,
+                         shard_rank==0 ? plan.displs.data() : nullptr,
+                         plan.datatype, 0, shard_comm, MPI_INFO_NULL, &plan.gather_req);
+    }
+    if (plan.local_size > 0)
+        std::memcpy(plan.local_buffer.data(), local, static_cast<size_t>(plan.local_size) * plan.elem_size);
+    MPI_Start(&plan.gather_req);
+    MPI_Wait(&plan.gather_req, MPI_STATUS_IGNORE);
+#else
+    MPI_Gatherv(local, plan.local_size, plan.datatype,
+                shard_rank==0 ? plan.root_buffer.data() : nullptr,
+                shard_rank==0 ? plan.sizes.data() : nullptr,
+                shard_rank==0 ? plan.displs.data() : nullptr,
+                plan.datatype, 0, shard_comm);
+#endif
+}
+
+void SmartRedisMPI::scatter_from_root(ExchangePlan &plan, void *local) {
+    PhaseScope phase(stats, PHASE_MPI);
+    poll_requests();
+    if (collective_mode == COLLECTIVE_HIERARCHICAL) {
+        scatter_hierarchical(plan, local);
+        return;
+    }
+#if SRMPI_USE_PERSISTENT
+    if (plan.scatter_req == MPI_REQUEST_NULL) {
+        MPI_Scatterv_init(shard_rank==0 ? plan.root_buffer.data() : nullptr,
+                          shard_rank==0 ? plan.sizes.data() : nullptr,
+                          shard_rank==0 ? plan.displs.data() : nullptr,
+                          plan.datatype, plan.local_buffer.data(), plan.local_size,
+                          plan.datatype, 0, shard_comm, MPI_INFO_NULL, &plan.scatter_req);
+    }
+    MPI_Start(&plan.scatter_req);
+    MPI_Wait(&plan.scatter_req, MPI_STATUS_IGNORE);
+    if (plan.local_size > 0)
+        std::memcpy(local, plan.local_buffer.data(), static_cast<size_t>(plan.local_size) * plan.elem_size);
+#else
+    MPI_Scatterv(shard_rank==0 ? plan.root_buffer.data() : nullptr,
+                 shard_rank==0 ? plan.sizes.data() : nullptr,
+                 shard_rank==0 ? plan.displs.data() : nullptr,
+                 plan.datatype, local, plan.local_size,
+                 plan.datatype, 0, shard_comm);
+#endif
+}
+
+// === Hierarchical collectives ===
+
+// SRMPI_NODES=k splits each shared-memory node further, shard rank r going
+// to node r % k, so tests on one host see ranks not numbered node by node
+void SmartRedisMPI::build_node_comms() {
+    MPI_Comm_split_type(shard_comm, MPI_COMM_TYPE_SHARED, shard_rank, MPI_INFO_NULL, &node_comm);
+    const char *v = std::getenv("SRMPI_NODES");
+    const int fake_nodes = v ? std::atoi(v) : 0;
+    if (fake_nodes > 1) {
+        MPI_Comm shared = node_comm;
+        MPI_Comm_split(shared, shard_rank % fake_nodes, shard_rank, &node_comm);
+        MPI_Comm_free(&shared);
+    }
+    MPI_Comm_rank(node_comm, &node_rank);
+    // Keyed by shard rank, so the writer leads its node and is leader 0
+    MPI_Comm_split(shard_comm, node_rank == 0 ? 0 : MPI_UNDEFINED, shard_rank, &node_leader_comm);
+    if (node_leader_comm != MPI_COMM_NULL) MPI_Comm_dup(node_leader_comm, &async_leader_comm);
+}
+
+void SmartRedisMPI::free_node_comms() {
+    if (node_comm != MPI_COMM_NULL) MPI_Comm_free(&node_comm);
+    if (node_leader_comm != MPI_COMM_NULL) MPI_Comm_free(&node_leader_comm);
+    if (async_leader_comm != MPI_COMM_NULL) MPI_Comm_free(&async_leader_comm);
+    node_rank = 0;
+}
+
+// Collective over the shard: the node window of one plan, and on the writer
+// the node blocks and the shard ranks they carry
+void SmartRedisMPI::setup_node_plan(ExchangePlan &plan) {
+    if (node_comm == MPI_COMM_NULL) build_node_comms();
+    int node_nprocs = 0;
+    MPI_Comm_size(node_comm, &node_nprocs);
+
+    int local[2] = {plan.local_size, shard_rank};
+    std::vector<int> members(2 * static_cast<size_t>(node_nprocs));
+    MPI_Allgather(local, 2, MPI_INT, members.data(), 2, MPI_INT, node_comm);
+    plan.node_total = 0;
+    for (int i=0;i<node_nprocs;i++) {
+        if (i == node_rank) plan.node_offset = static_cast<size_t>(plan.node_total) * plan.elem_size;
+        plan.node_total += members[2*i];
+    }
+
+    const MPI_Aint bytes = node_rank == 0 ? 2 * static_cast<MPI_Aint>(plan.node_total) * plan.elem_size : 0;
+    void *base = nullptr;
+    MPI_Win_allocate_shared(bytes, 1, MPI_INFO_NULL, node_comm, &base, &plan.node_win);
+    MPI_Aint leader_bytes = 0;
+    int disp_unit = 0;
+    MPI_Win_shared_query(plan.node_win, 0, &leader_bytes, &disp_unit, &base);
+    plan.node_buffer = static_cast<unsigned char*>(base);
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, plan.node_win);
+    if (node_rank != 0) return;
+    plan.member_sizes.assign(node_nprocs, 0);
+    plan.member_displs.assign(node_nprocs, 0);
+    for (int i=0;i<node_nprocs;i++) {
+        plan.member_sizes[i] = members[2*i];
+        if (i > 0) plan.member_displs[i] = plan.member_displs[i-1] + plan.member_sizes[i-1];
+    }
+
+    int n_leaders = 0;
+    MPI_Comm_size(node_leader_comm, &n_leaders);
+    int node[2] = {plan.node_total, node_nprocs};
+    std::vector<int> nodes(shard_rank == 0 ? 2 * static_cast<size_t>(n_leaders) : 0);
+    MPI_Gather(node, 2, MPI_INT, nodes.data(), 2, MPI_INT, 0, node_leader_comm);
+
+    std::vector<int> ranks(node_nprocs), rank_counts, rank_displs;
+    for (int i=0;i<node_nprocs;i++) ranks[i] = members[2*i+1];
+    if (shard_rank == 0) {
+        plan.node_sizes.assign(n_leaders, 0);
+        plan.node_displs.assign(n_leaders, 0);
+        rank_counts.assign(n_leaders, 0);
+        rank_displs.assign(n_leaders, 0);
+        int total = 0, n_ranks = 0;
+        for (int l=0;l<n_leaders;l++) {
+            plan.node_sizes[l] = nodes[2*l];
+            plan.node_displs[l] = total;
+            total += nodes[2*l];
+            rank_counts[l] = nodes[2*l+1];
+            rank_displs[l] = n_ranks;
+            n_ranks += nodes[2*l+1];
+        }
+        plan.node_order.assign(n_ranks, 0);
+    }
+    MPI_Gatherv(ranks.data(), node_nprocs, MPI_INT, plan.node_order.data(), rank_counts.data(),
+                rank_displs.data(), MPI_INT, 0, node_leader_comm);
+
+    // Ranks placed node by node in order arrive in place
+    if (shard_rank == 0) {
+        bool in_order = true;
+        for (size_t i=0;i<plan.node_order.size();i++) in_order = in_order && plan.node_order[i] == static_cast<int>(i);
+        if (in_order) plan.node_order.clear();
+        else plan.node_stage.assign(static_cast<size_t>(plan.total_size) * plan.elem_size, 0);
+    }
+}
+
+// A half of the window is rewritten two calls later, past a barrier its
+// leader only enters once it is done with it, so one barrier per call suffices
+void SmartRedisMPI::gather_hierarchical(ExchangePlan &plan, const void *local) {
+    if (plan.node_win == MPI_WIN_NULL) setup_node_plan(plan);
+    unsigned char *half = plan.node_buffer + static_cast<size_t>(plan.node_parity) * plan.node_total * plan.elem_size;
+    plan.node_parity ^= 1;
+    if (plan.local_size > 0)
+        std::memcpy(half + plan.node_offset, local, static_cast<size_t>(plan.local_size) * plan.elem_size);
+    MPI_Win_sync(plan.node_win);
+    MPI_Barrier(node_comm);
+    MPI_Win_sync(plan.node_win);
+    if (node_rank != 0) return;
+
+    const bool writer = shard_rank == 0;
+    unsigned char *dest = nullptr;
+    if (writer) dest = plan.node_order.empty() ? plan.root_buffer.data() : plan.node_stage.data();
+    MPI_Gatherv(half, plan.node_total, plan.datatype, dest,
+                writer ? plan.node_sizes.data() : nullptr,
+                writer ? plan.node_displs.data() : nullptr,
+                plan.datatype, 0, node_leader_comm);
+    if (!writer || plan.node_order.empty()) return;
+
+    const unsigned char *src = plan.node_stage.data();
+    for (int r : plan.node_order) {
+        const size_t n = static_cast<size_t>(plan.sizes[r]) * plan.elem_size;
+        std::memcpy(plan.root_buffer.data() + static_cast<size_t>(plan.displs[r]) * plan.elem_size, src, n);
+        src += n;
+    }
+}
+
+void SmartRedisMPI::scatter_hierarchical(ExchangePlan &plan, void *local) {
+    if (plan.node_win == MPI_WIN_NULL) setup_node_plan(plan);
+    unsigned char *half = plan.node_buffer + static_cast<size_t>(plan.node_parity) * plan.node_total * plan.elem_size;
+    plan.node_parity ^= 1;
+    if (node_rank == 0) {
+        const bool writer = shard_rank == 0;
+        const unsigned char *src = writer ? plan.root_buffer.data() : nullptr;
+        if (writer && !plan.node_order.empty()) {
+            unsigned char *dst = plan.node_stage.data();
+            for (int r : plan.node_order) {
+                const size_t n = static_cast<size_t>(plan.sizes[r]) * plan.elem_size;
+                std::memcpy(dst, plan.root_buffer.data() + static_cast<size_t>(plan.displs[r]) * plan.elem_size, n);
+                dst += n;
+            }
+            src = plan.node_stage.data();
+        }
+        MPI_Scatterv(src, writer ? plan.node_sizes.data() : nullptr,
+                     writer ? plan.node_displs.data() : nullptr,
+                     plan.datatype, half, plan.node_total, plan.datatype, 0, node_leader_comm);
+    }
+    MPI_Win_sync(plan.node_win);
+    MPI_Barrier(node_comm);
+    MPI_Win_sync(plan.node_win);
+    if (plan.local_size > 0)
+        std::memcpy(local, half + plan.node_offset, static_cast<size_t>(plan.local_size) * plan.elem_size);
+}
 
 // === Data operations ===
 
 void SmartRedisMPI::put_step_type(const std::string &key, int step_type) {
     RANK0_ONLY
+    OpScope op(stats, OP_PUT_SCALAR, key, sizeof(int32_t));
+    PhaseScope phase(stats, PHASE_REDIS);
     int32_t v = step_type;
     client->put_tensor(key, &v, {1}, SRTensorTypeInt32, SRMemLayoutContiguous);
 }
 
 void SmartRedisMPI::put_state(const std::string &key, const std::vector<double> &state) {
-    int size_local = static_cast<int>(state.size());
-    std::vector<int> sizes(nprocs,0);
-    MPI_Gather(&size_local, 1, MPI_INT, sizes.data(), 1, MPI_INT, 0, mpi_comm_local);
+    put_state(key, state.data(), state.size());
+}
 
-    std::vector<int> displs(nprocs,0);
-    int total_size = 0;
-    if(myid==0){
-        for(int i=0;i<nprocs;i++){
-            displs[i] = total_size;
-            total_size += sizes[i];
-        }
+void SmartRedisMPI::put_state(const std::string &key, const double *state, size_t n) {
+    OpScope op(stats, OP_PUT_STATE, key, n * sizeof(double));
+    SRTensorType type;
+    ExchangePlan &plan = gather_state(key, state, n, type);
+
+    WRITER_ONLY
+    write_tensor(key, shard_key(key), plan.root_buffer.data(), {static_cast<size_t>(plan.total_size)}, type,
+                 SRMemLayoutContiguous);
+}
+
+void SmartRedisMPI::put_state(const std::string &key, const void *state, size_t n, SRTensorType src) {
+    check_value_type(src);
+    OpScope op(stats, OP_PUT_STATE, key, n * tensor_type_size(src));
+    SRTensorType type;
+    ExchangePlan &plan = gather_state(key, state, n, src, type);
+
+    WRITER_ONLY
+    write_tensor(key, shard_key(key), plan.root_buffer.data(), {static_cast<size_t>(plan.total_size)}, type,
+                 SRMemLayoutContiguous);
+}
+
+// Gather a state to the writer in the key's wire precision; the conversion
+// runs before the gather so the MPI traffic shrinks too
+ExchangePlan &SmartRedisMPI::gather_state(const std::string &key, const double *state, size_t n, SRTensorType &type) {
+    if (!policies.empty()) keep_policy_state(key, state, n, SRTensorTypeDouble);
+    const int precision = get_wire_precision(key);
+    ExchangePlan &plan = get_plan(key, static_cast<int>(n), wire_mpi_type(precision));
+    type = wire_tensor_type(precision);
+    gather_wire(plan, state, n, precision);
+    return plan;
+}
+
+// Typed states: float arrays of WIRE_FLOAT32 keys are gathered as they
+// are, anything else is widened to double first
+ExchangePlan &SmartRedisMPI::gather_state(const std::string &key, const void *state, size_t n, SRTensorType src,
+                                          SRTensorType &type) {
+    if (src == SRTensorTypeDouble) return gather_state(key, static_cast<const double*>(state), n, type);
+    if (!policies.empty()) keep_policy_state(key, state, n, src);
+    const int precision = get_wire_precision(key);
+    ExchangePlan &plan = get_plan(key, static_cast<int>(n), wire_mpi_type(precision));
+    type = wire_tensor_type(precision);
+    if (src == SRTensorTypeFloat && precision == WIRE_FLOAT32) {
+        gather_to_root(plan, state);
+        return plan;
     }
+    convert_buffer.resize(n);
+    widen_values(state, src, n, convert_buffer.data());
+    gather_wire(plan, convert_buffer.data(), n, precision);
+    return plan;
+}
 
-    std::vector<double> global(total_size,0.0);
-    MPI_Gatherv(state.data(), size_local, MPI_DOUBLE,
-                myid==0 ? global.data() : nullptr,
-                myid==0 ? sizes.data() : nullptr,
-                myid==0 ? displs.data() : nullptr,
-                MPI_DOUBLE, 0, mpi_comm_local);
+void SmartRedisMPI::gather_wire(ExchangePlan &plan, const double *state, size_t n, int precision) {
+    if (precision == WIRE_FLOAT64) {
+        gather_to_root(plan, state);
+        return;
+    }
+    plan.wire_buffer.resize(n * plan.elem_size);
+    pack_wire(state, plan.wire_buffer.data(), n, precision);
+    gather_to_root(plan, plan.wire_buffer.data());
+}
 
-    RANK0_ONLY
-    client->put_tensor(key, global.data(), {static_cast<size_t>(total_size)}, SRTensorTypeDouble, SRMemLayoutContiguous);
+void SmartRedisMPI::set_wire_precision(const std::string &key, int precision) {
+    if (!wire_precision_valid(precision))
+        throw std::invalid_argument("SmartRedisMPI: unknown wire precision");
+    wire_precision[key] = precision;
+    for (auto &lane : lanes) lane->set_wire_precision(key, precision);
+}
+
+int SmartRedisMPI::get_wire_precision(const std::string &key) const {
+    auto it = wire_precision.find(key);
+    return it == wire_precision.end() ? default_wire_precision : it->second;
 }
 
 void SmartRedisMPI::put_reward(const std::string &key, const std::vector<double> &reward) {
     put_state(key, reward);  // same pattern
 }
 
+void SmartRedisMPI::put_reward(const std::string &key, const double *reward, size_t n) {
+    put_state(key, reward, n);
+}
+
 void SmartRedisMPI::get_action(const std::string &key, std::vector<double> &action) {
-    int size_local = static_cast<int>(action.size());
-    std::vector<int> sizes(nprocs,0);
-    MPI_Gather(&size_local,1,MPI_INT,sizes.data(),1,MPI_INT,0,mpi_comm_local);
+    get_action(key, action.data(), action.size());
+}
+
+void SmartRedisMPI::get_action(const std::string &key, double *action, size_t n) {
+    receive_action(key, action, n, false, -1.0);
+}
+
+bool SmartRedisMPI::wait_action(const std::string &key, std::vector<double> &action, double timeout) {
+    return wait_action(key, action.data(), action.size(), timeout);
+}
+
+bool SmartRedisMPI::wait_action(const std::string &key, double *action, size_t n, double timeout) {
+    return receive_action(key, action, n, true, timeout);
+}
+
+void SmartRedisMPI::get_action(const std::string &key, void *action, size_t n, SRTensorType type) {
+    receive_typed_action(key, action, n, type, false, -1.0);
+}
+
+bool SmartRedisMPI::wait_action(const std::string &key, void *action, size_t n, SRTensorType type,
+                                double timeout) {
+    return receive_typed_action(key, action, n, type, true, timeout);
+}
 
-    std::vector<int> displs(nprocs,0);
-    int total_size=0;
-    if(myid==0){
-        for(int i=0;i<nprocs;i++){
-            displs[i] = total_size;
-            total_size += sizes[i];
+// Mirror of the typed gather_state: scattered straight into float arrays of
+// WIRE_FLOAT32 keys, through double otherwise
+bool SmartRedisMPI::receive_typed_action(const std::string &key, void *action, size_t n, SRTensorType type,
+                                         bool wait, double timeout) {
+    check_value_type(type);
+    if (type == SRTensorTypeDouble) return receive_action(key, static_cast<double*>(action), n, wait, timeout);
+    if (!policies.empty()) {
+        convert_buffer.resize(n);
+        if (local_action(key, convert_buffer.data(), n)) {
+            narrow_values(convert_buffer.data(), n, type, action);
+            return true;
         }
     }
+    OpScope op(stats, OP_GET_ACTION, key, n * tensor_type_size(type));
+    const int precision = get_wire_precision(key);
+    ExchangePlan &plan = get_plan(key, static_cast<int>(n), wire_mpi_type(precision));
+    const std::string skey = shard_rank == 0 ? shard_key(key) : std::string();
+    if (type == SRTensorTypeFloat && precision == WIRE_FLOAT32)
+        return fetch_action(key, skey, plan, action, wait, timeout, SRTensorTypeFloat);
 
-    std::vector<double> global(total_size,0.0);
-    RANK0_ONLY
-    client->unpack_tensor(key, global.data(), {static_cast<size_t>(total_size)}, SRTensorTypeDouble, SRMemLayoutContiguous);
-    client->delete_tensor(key);
+    convert_buffer.resize(n);
+    if (!receive_action(key, skey, plan, precision, convert_buffer.data(), n, wait, timeout)) return false;
+    narrow_values(convert_buffer.data(), n, type, action);
+    return true;
+}
 
-    MPI_Scatterv(myid==0 ? global.data() : nullptr,
-                 myid==0 ? sizes.data() : nullptr,
-                 myid==0 ? displs.data() : nullptr,
-                 MPI_DOUBLE,
-                 action.data(),
-                 size_local,
-                 MPI_DOUBLE,
-                 0,
-                 mpi_comm_local);
+// Scatter an action stored in the key's wire precision back to doubles
+bool SmartRedisMPI::receive_action(const std::string &key, double *action, size_t n, bool wait, double timeout) {
+    if (!policies.empty() && local_action(key, action, n)) return true;
+    OpScope op(stats, OP_GET_ACTION, key, n * sizeof(double));
+    const int precision = get_wire_precision(key);
+    ExchangePlan &plan = get_plan(key, static_cast<int>(n), wire_mpi_type(precision));
+    const std::string skey = shard_rank == 0 ? shard_key(key) : std::string();
+    return receive_action(key, skey, plan, precision, action, n, wait, timeout);
 }
 
-void SmartRedisMPI::put_info(const std::string &key, const std::vector<int> &info) {
-    int size_local = static_cast<int>(info.size());
-    std::vector<int> sizes(nprocs,0);
-    MPI_Gather(&size_local,1,MPI_INT,sizes.data(),1,MPI_INT,0,mpi_comm_local);
+bool SmartRedisMPI::receive_action(const std::string &key, const std::string &skey, ExchangePlan &plan,
+                                   int precision, double *action, size_t n, bool wait, double timeout) {
+    if (precision == WIRE_FLOAT64)
+        return fetch_action(key, skey, plan, action, wait, timeout, SRTensorTypeDouble);
+
+    plan.wire_buffer.resize(n * plan.elem_size);
+    if (!fetch_action(key, skey, plan, plan.wire_buffer.data(), wait, timeout, wire_tensor_type(precision)))
+        return false;
+    unpack_wire(plan.wire_buffer.data(), action, n, precision);
+    return true;
+}
+
+// Writer side of wait_action: adaptive backoff on the shard key
+bool SmartRedisMPI::poll_action(const std::string &key, double timeout, bool frame) {
+    PhaseScope phase(stats, PHASE_WAIT);
+    using clock = std::chrono::steady_clock;
+    const clock::time_point start = clock::now();
+    auto expired = [&]() {
+        return timeout >= 0.0 && std::chrono::duration<double>(clock::now() - start).count() >= timeout;
+    };
+    auto exists = [&]() {
+        return frame ? client->frame_exists(key) : client->tensor_exists(key);
+    };
+
+    bool found = false;
+    for (int i=0;i<wait_policy.spin_checks && !found;i++) found = exists();
+
+    // The transport sleeps between checks, or wakes on arrival if it can
+    int sleep_us = std::max(wait_policy.short_sleep_us, 1);
+    for (int polls=0; !found && !expired(); polls++) {
+        found = client->wait_for(key, frame, sleep_us);
+        if (polls >= wait_policy.short_polls)
+            sleep_us = std::min(2 * sleep_us, std::max(wait_policy.max_sleep_us, sleep_us));
+    }
 
-    std::vector<int> displs(nprocs,0);
-    int total_size=0;
-    if(myid==0){
-        for(int i=0;i<nprocs;i++){
-            displs[i] = total_size;
-            total_size += sizes[i];
+    action_wait_last = std::chrono::duration<double>(clock::now() - start).count();
+    action_wait_total += action_wait_last;
+    return found;
+}
+
+// Read (optionally waiting for) the action shard on the writer, then scatter
+// it. Without a timeout every rank ends up with the action (or the writer's
+// error), so the wait needs no readiness allreduce: the shard only waits for
+// the writer's status broadcast
+bool SmartRedisMPI::fetch_action(const std::string &key, const std::string &skey, ExchangePlan &plan, void *action,
+                                 bool wait, double timeout, SRTensorType type) {
+    const bool wait_forever = wait && timeout < 0.0;
+    if (wait && !wait_forever) {
+        int ready = 1;
+        std::exception_ptr failure;
+        if (shard_rank == 0) {
+            try {
+                ready = poll_action(skey, timeout, compressed(key)) ? 1 : 0;
+            } catch (...) {
+                failure = std::current_exception();
+                ready = -1;
+            }
         }
+        if (!agree_ready(ready, failure)) return false;
     }
 
-    std::vector<int> global(total_size,0);
-    MPI_Gatherv(info.data(), size_local, MPI_INT,
-                myid==0 ? global.data() : nullptr,
-                myid==0 ? sizes.data() : nullptr,
-                myid==0 ? displs.data() : nullptr,
-                MPI_INT,0,mpi_comm_local);
+    std::exception_ptr failure;
+    if (shard_rank == 0) {
+        try {
+            if (wait_forever) poll_action(skey, timeout, compressed(key));
+            read_action(key, skey, plan.root_buffer.data(), static_cast<size_t>(plan.total_size), type);
+        } catch (...) {
+            failure = std::current_exception();
+        }
+    }
+    agree_status(failure, wait_forever);
 
-    RANK0_ONLY
-    client->put_tensor(key, global.data(), {static_cast<size_t>(total_size)}, SRTensorTypeInt32, SRMemLayoutContiguous);
+    scatter_from_root(plan, action);
+    return true;
 }
 
-void SmartRedisMPI::put_real_scalar(const std::string &key, const double &rscalar) {
-    RANK0_ONLY
-    client->put_tensor(key, &rscalar, {1}, SRTensorTypeDouble, SRMemLayoutContiguous);
+// A writer failure (read, decode, malformed action) is agreed on over the
+// shard before anything is scattered: the writer rethrows it and the other
+// ranks throw its message, instead of waiting in a scatter the writer never
+// joins. One int broadcast when all went well; with idle the other ranks
+// back off while the writer waits for the agent
+void SmartRedisMPI::agree_status(std::exception_ptr failure, bool idle) {
+    PhaseScope phase(stats, PHASE_MPI);
+    std::string message;
+    int length = -1;  // -1: success, else the length of the writer's message
+    if (shard_rank == 0 && failure) {
+        try {
+            std::rethrow_exception(failure);
+        } catch (const std::exception &e) {
+            message = e.what();
+        } catch (...) {
+            message = "unknown error";
+        }
+        length = static_cast<int>(message.size());
+    }
+    if (idle) {
+        MPI_Request req = MPI_REQUEST_NULL;
+        MPI_Ibcast(&length, 1, MPI_INT, 0, shard_comm, &req);
+        wait_idle(req);
+    } else {
+        MPI_Bcast(&length, 1, MPI_INT, 0, shard_comm);
+    }
+    if (length < 0) return;
+    message.resize(length);
+    if (length > 0) MPI_Bcast(&message[0], length, MPI_CHAR, 0, shard_comm);
+    if (shard_rank == 0) std::rethrow_exception(failure);
+    throw std::runtime_error("SmartRedisMPI: writer failed: " + message);
+}
+
+// Readiness is agreed on with one non-blocking allreduce so idle ranks back
+// off instead of spinning inside a blocking collective. A writer whose
+// polling threw passes ready = -1 and its failure: it rethrows, and every
+// other rank throws as well
+bool SmartRedisMPI::agree_ready(int ready, std::exception_ptr failure) {
+    PhaseScope phase(stats, PHASE_MPI);
+    int all_ready = 0;
+    MPI_Request req = MPI_REQUEST_NULL;
+    MPI_Iallreduce(&ready, &all_ready, 1, MPI_INT, MPI_MIN, mpi_comm_local, &req);
+    wait_idle(req);
+    if (all_ready < 0) {
+        if (failure) std::rethrow_exception(failure);
+        throw std::runtime_error("SmartRedisMPI: a writer failed while waiting for an action");
+    }
+    return all_ready != 0;
+}
+
+// Completes a readiness request: writers block, the other ranks test it
+// with a short backoff
+void SmartRedisMPI::wait_idle(MPI_Request &req) {
+    if (shard_rank == 0) {
+        MPI_Wait(&req, MPI_STATUS_IGNORE);
+        return;
+    }
+    int done = 0;
+    int sleep_us = 1;
+    for (int polls=0; ; polls++) {
+        MPI_Test(&req, &done, MPI_STATUS_IGNORE);
+        if (done) return;
+        if (polls >= wait_policy.spin_checks) {
+            std::this_thread::sleep_for(std::chrono::microseconds(sleep_us));
+            sleep_us = std::min(2 * sleep_us, std::max(wait_policy.short_sleep_us, 1));
+        }
+    }
+}
+
+// Writer: take (read and delete) the action shard skey of key, framed or plain
+void SmartRedisMPI::read_action(const std::string &key, const std::string &skey, void *data, size_t count,
+                                SRTensorType type) {
+    PhaseScope phase(stats, PHASE_REDIS);
+    if (compressed(key)) {
+        read_frame(key, skey, data, count * tensor_type_size(type));
+    } else {
+        client->unpack_tensor(skey, data, {count}, type, SRMemLayoutContiguous);
+        client->delete_tensor(skey);
+    }
+}
+
+void SmartRedisMPI::put_info(const std::string &key, const std::vector<int> &info) {
+    put_info(key, info.data(), info.size());
+}
+
+void SmartRedisMPI::put_info(const std::string &key, const int *info, size_t n) {
+    put_native(key, info, n, SRTensorTypeInt32, MPI_INT, OP_PUT_INFO);
+}
+
+void SmartRedisMPI::put_tensor(const std::string &key, const void *data, size_t n, SRTensorType type) {
+    put_native(key, data, n, type, tensor_mpi_type(type), OP_PUT_TENSOR);
+}
+
+void SmartRedisMPI::get_tensor(const std::string &key, void *data, size_t n, SRTensorType type) {
+    receive_native(key, data, n, type, tensor_mpi_type(type), false, -1.0);
+}
+
+bool SmartRedisMPI::wait_tensor(const std::string &key, void *data, size_t n, SRTensorType type, double timeout) {
+    return receive_native(key, data, n, type, tensor_mpi_type(type), true, timeout);
+}
+
+// Gather in the caller's element type and store it as is
+void SmartRedisMPI::put_native(const std::string &key, const void *data, size_t n, SRTensorType type,
+                               MPI_Datatype datatype, int op_id) {
+    OpScope op(stats, op_id, key, n * tensor_type_size(type));
+    ExchangePlan &plan = get_plan(key, static_cast<int>(n), datatype);
+    gather_to_root(plan, data);
+
+    WRITER_ONLY
+    write_tensor(key, shard_key(key), plan.root_buffer.data(), {static_cast<size_t>(plan.total_size)},
+                 type, SRMemLayoutContiguous);
+}
+
+bool SmartRedisMPI::receive_native(const std::string &key, void *data, size_t n, SRTensorType type,
+                                   MPI_Datatype datatype, bool wait, double timeout) {
+    OpScope op(stats, OP_GET_TENSOR, key, n * tensor_type_size(type));
+    ExchangePlan &plan = get_plan(key, static_cast<int>(n), datatype);
+    const std::string skey = shard_rank == 0 ? shard_key(key) : std::string();
+    return fetch_action(key, skey, plan, data, wait, timeout, type);
+}
+
+void SmartRedisMPI::put_state_nd(const std::string &key, const double *state,
+                                 const std::vector<size_t> &local_dims, SRMemoryLayout layout) {
+    put_state_nd(key, state, SRTensorTypeDouble, local_dims, layout);
+}
+
+void SmartRedisMPI::put_state_nd(const std::string &key, const void *state, SRTensorType src,
+                                 const std::vector<size_t> &local_dims, SRMemoryLayout layout) {
+    check_value_type(src);
+    if (local_dims.empty())
+        throw std::invalid_argument("SmartRedisMPI: put_state_nd needs at least one dimension");
+    if (layout != SRMemLayoutContiguous && layout != SRMemLayoutFortranContiguous)
+        throw std::invalid_argument("SmartRedisMPI: put_state_nd needs a contiguous layout");
+
+    // Each rank's block is contiguous in the global array, so a plain gather suffices
+    const size_t dist = (layout == SRMemLayoutContiguous) ? 0 : local_dims.size() - 1;
+    size_t row = 1;
+    for (size_t i=0;i<local_dims.size();i++) if (i != dist) row *= local_dims[i];
+    OpScope op(stats, OP_PUT_STATE, key, row * local_dims[dist] * tensor_type_size(src));
+    SRTensorType type;
+    ExchangePlan &plan = gather_state(key, state, row * local_dims[dist], src, type);
+
+    WRITER_ONLY
+    std::vector<size_t> dims = local_dims;
+    dims[dist] = row > 0 ? static_cast<size_t>(plan.total_size) / row : 0;
+    write_tensor(key, shard_key(key), plan.root_buffer.data(), dims, type, layout);
+}
+
+void SmartRedisMPI::put_fields(const std::string &key, const std::vector<const double*> &fields,
+                               size_t n_points, SRMemoryLayout layout, size_t stride) {
+    const int nf = static_cast<int>(fields.size());
+    if (nf == 0 || stride == 0)
+        throw std::invalid_argument("SmartRedisMPI: put_fields needs fields and a positive stride");
+    if (layout != SRMemLayoutContiguous && layout != SRMemLayoutFortranContiguous)
+        throw std::invalid_argument("SmartRedisMPI: put_fields needs a contiguous layout");
+    OpScope op(stats, OP_PUT_FIELDS, key, n_points * nf * sizeof(double));
+
+    const int precision = get_wire_precision(key);
+    if (precision != WIRE_FLOAT64 || collective_mode == COLLECTIVE_HIERARCHICAL) {
+        put_fields_packed(key, fields, n_points, layout, stride, precision);
+        return;
+    }
+
+    ExchangePlan &plan = get_plan(key, static_cast<int>(n_points), MPI_DOUBLE);
+    if (plan.n_features != nf || plan.layout != layout) {
+        free_field_types(plan);
+        plan.n_features = nf;
+        plan.layout = layout;
+        if (shard_rank == 0) {
+            // One received point lands as a column of [nf, N] (C order) or
+            // as nf consecutive values (Fortran order)
+            if (layout == SRMemLayoutContiguous) {
+                MPI_Datatype column;
+                MPI_Type_vector(nf, 1, std::max(plan.total_size, 1), MPI_DOUBLE, &column);
+                MPI_Type_create_resized(column, 0, sizeof(double), &plan.recv_type);
+                MPI_Type_free(&column);
+            } else {
+                MPI_Type_contiguous(nf, MPI_DOUBLE, &plan.recv_type);
+            }
+            MPI_Type_commit(&plan.recv_type);
+            plan.root_buffer.assign(static_cast<size_t>(plan.total_size) * nf * sizeof(double), 0);
+        }
+    }
+
+    // One sent point picks field[f][i*stride] for every f; rebuilt only when
+    // the caller's arrays move
+    std::vector<MPI_Aint> addrs(nf);
+    for (int f=0;f<nf;f++) MPI_Get_address(fields[f], &addrs[f]);
+    if (plan.send_type == MPI_DATATYPE_NULL || addrs != plan.send_addrs || stride != plan.send_stride) {
+        if (plan.send_type != MPI_DATATYPE_NULL) MPI_Type_free(&plan.send_type);
+        std::vector<int> ones(nf, 1);
+        MPI_Datatype point;
+        MPI_Type_create_hindexed(nf, ones.data(), addrs.data(), MPI_DOUBLE, &point);
+        MPI_Aint lb, extent;
+        MPI_Type_get_extent(point, &lb, &extent);
+        MPI_Type_create_resized(point, lb, static_cast<MPI_Aint>(stride * sizeof(double)), &plan.send_type);
+        MPI_Type_free(&point);
+        MPI_Type_commit(&plan.send_type);
+        plan.send_addrs = addrs;
+        plan.send_stride = stride;
+    }
+
+    {
+        PhaseScope phase(stats, PHASE_MPI);
+        MPI_Gatherv(MPI_BOTTOM, plan.local_size, plan.send_type,
+                    shard_rank==0 ? plan.root_buffer.data() : nullptr,
+                    shard_rank==0 ? plan.sizes.data() : nullptr,
+                    shard_rank==0 ? plan.displs.data() : nullptr,
+                    plan.recv_type, 0, shard_comm);
+    }
+
+    WRITER_ONLY
+    write_tensor(key, shard_key(key), plan.root_buffer.data(),
+                 {static_cast<size_t>(nf), static_cast<size_t>(plan.total_size)},
+                 SRTensorTypeDouble, layout);
+}
+
+// Narrow wire precisions and the hierarchical gather cannot pick values from
+// the caller's arrays: the points are packed point-major in the wire type and
+// go through the usual state gather under their own plan. The writer then
+// holds [N, nf] values, which is [nf, N] in Fortran order, and transposes
+// them for C order
+void SmartRedisMPI::put_fields_packed(const std::string &key, const std::vector<const double*> &fields,
+                                      size_t n_points, SRMemoryLayout layout, size_t stride, int precision) {
+    const size_t nf = fields.size();
+    const size_t n = n_points * nf;
+    convert_buffer.resize(n);
+    for (size_t i=0;i<n_points;i++)
+        for (size_t f=0;f<nf;f++) convert_buffer[i*nf+f] = fields[f][i*stride];
+    ExchangePlan &plan = get_plan(fields_plan_name(key), static_cast<int>(n), wire_mpi_type(precision));
+    gather_wire(plan, convert_buffer.data(), n, precision);
+
+    WRITER_ONLY
+    const size_t total = static_cast<size_t>(plan.total_size) / nf;
+    const size_t elem = static_cast<size_t>(plan.elem_size);
+    const unsigned char *data = plan.root_buffer.data();
+    if (layout == SRMemLayoutContiguous) {
+        plan.pack_buffer.resize(total * nf * elem);
+        for (size_t i=0;i<total;i++)
+            for (size_t f=0;f<nf;f++)
+                std::memcpy(plan.pack_buffer.data() + (f*total + i) * elem, data + (i*nf + f) * elem, elem);
+        data = plan.pack_buffer.data();
+    }
+    write_tensor(key, shard_key(key), data, {nf, total}, wire_tensor_type(precision), layout);
+}
+
+void SmartRedisMPI::put_real_scalar(const std::string &key, const double &rscalar) {
+    RANK0_ONLY
+    OpScope op(stats, OP_PUT_SCALAR, key, sizeof(double));
+    PhaseScope phase(stats, PHASE_REDIS);
+    client->put_tensor(key, &rscalar, {1}, SRTensorTypeDouble, SRMemLayoutContiguous);
+}
+
+// === Registered keys ===
+
+int SmartRedisMPI::register_key(const std::string &name, bool per_step) {
+    for (auto &lane : lanes) lane->register_key(name, per_step);
+    for (size_t i=0;i<key_handles.size();i++)
+        if (key_handles[i].name == name && key_handles[i].per_step == per_step) return static_cast<int>(i) + 1;
+    KeyHandle h;
+    h.name = name;
+    h.per_step = per_step;
+    key_handles.push_back(std::move(h));
+    return static_cast<int>(key_handles.size());
+}
+
+int SmartRedisMPI::register_ring_key(const std::string &name, int slots) {
+    if (slots < 1)
+        throw std::invalid_argument("SmartRedisMPI: a key ring needs at least one slot");
+    const int id = register_key(name, true);
+    key_handles[id - 1].ring = slots;
+    for (auto &lane : lanes) lane->register_ring_key(name, slots);
+    return id;
+}
+
+static void append_number(std::string &s, long long v) {
+    char digits[24];
+    int n = std::snprintf(digits, sizeof(digits), "%lld", v);
+    s.append(digits, n);
+}
+
+// <name>[.<step>][.shard<id>] of a registered key; assign/append keep the
+// capacity of out, so a new step does not allocate
+void SmartRedisMPI::format_key(const KeyHandle &handle, long long step, bool sharded, std::string &out) const {
+    out.assign(handle.name);
+    if (handle.per_step) {
+        out += '.';
+        append_number(out, step);
+    }
+    if (sharded && writer_mode != WRITER_ROOT) {
+        out += ".shard";
+        append_number(out, shard_id);
+    }
+}
+
+// Resolve the names of a registered key for the current step and shard layout
+KeyHandle &SmartRedisMPI::key_handle(int id) {
+    if (id <= 0 || id > static_cast<int>(key_handles.size()))
+        throw std::out_of_range("SmartRedisMPI: unknown key id " + std::to_string(id));
+    KeyHandle &h = key_handles[id - 1];
+    if (h.resolved && (!h.per_step || h.step == current_step)) return h;
+
+    format_key(h, current_step, false, h.store);
+    format_key(h, current_step, true, h.shard_store);
+    h.step = current_step;
+    h.resolved = true;
+    return h;
+}
+
+// Writer: remember a slot of a ring key until collect_slots deletes it
+void SmartRedisMPI::keep_slot(KeyHandle &handle, long long step, const std::string &stored) {
+    if (handle.ring > 0) handle.live.emplace(step, stored);
+}
+
+// Writer: delete the ring slots that left their window. A key's expired
+// slots wait until there are `ring` of them; then every key due goes out
+// in one delete_tensors call
+void SmartRedisMPI::collect_slots() {
+    expired_slots.clear();
+    std::string names;
+    for (KeyHandle &h : key_handles) {
+        if (h.ring <= 0) continue;
+        auto end = h.live.lower_bound(current_step - h.ring + 1);
+        int expired = 0;
+        for (auto it = h.live.begin(); it != end; ++it) expired++;
+        if (expired < h.ring) continue;
+        for (auto it = h.live.begin(); it != end; ++it) expired_slots.push_back(std::move(it->second));
+        h.live.erase(h.live.begin(), end);
+        if (!names.empty()) names += ',';
+        names += h.name;
+    }
+    if (expired_slots.empty()) return;
+
+    OpScope op(stats, OP_RING_GC, names, 0);
+    PhaseScope phase(stats, PHASE_REDIS);
+    client->delete_tensors(expired_slots);
+}
+
+// The plan of <name>, looked up once and kept until invalidated; with stats
+// enabled every call goes through get_plan so all ranks join its size check
+ExchangePlan &SmartRedisMPI::key_plan(KeyHandle &handle, int size_local, MPI_Datatype datatype) {
+    if (!handle.plan || stats.enabled() || handle.plan->local_size != size_local ||
+        handle.plan->datatype != datatype)
+        handle.plan = &get_plan(handle.name, size_local, datatype);
+    return *handle.plan;
+}
+
+const std::string &SmartRedisMPI::key_name(int id) {
+    return key_handle(id).store;
+}
+
+void SmartRedisMPI::put_state(int id, const double *state, size_t n) {
+    KeyHandle &h = key_handle(id);
+    OpScope op(stats, OP_PUT_STATE, h.name, n * sizeof(double));
+    if (!policies.empty()) keep_policy_state(h.name, state, n, SRTensorTypeDouble);
+    const int precision = get_wire_precision(h.name);
+    ExchangePlan &plan = key_plan(h, static_cast<int>(n), wire_mpi_type(precision));
+    gather_wire(plan, state, n, precision);
+
+    WRITER_ONLY
+    write_tensor(h.name, h.shard_store, plan.root_buffer.data(), {static_cast<size_t>(plan.total_size)},
+                 wire_tensor_type(precision), SRMemLayoutContiguous);
+    keep_slot(h, h.step, h.shard_store);
+}
+
+void SmartRedisMPI::put_reward(int id, const double *reward, size_t n) {
+    put_state(id, reward, n);
+}
+
+void SmartRedisMPI::put_info(int id, const int *info, size_t n) {
+    KeyHandle &h = key_handle(id);
+    OpScope op(stats, OP_PUT_INFO, h.name, n * sizeof(int));
+    ExchangePlan &plan = key_plan(h, static_cast<int>(n), MPI_INT);
+    gather_to_root(plan, info);
+
+    WRITER_ONLY
+    write_tensor(h.name, h.shard_store, plan.root_buffer.data(), {static_cast<size_t>(plan.total_size)},
+                 SRTensorTypeInt32, SRMemLayoutContiguous);
+    keep_slot(h, h.step, h.shard_store);
+}
+
+void SmartRedisMPI::get_action(int id, double *action, size_t n) {
+    get_action_step(id, current_step, action, n);
+}
+
+bool SmartRedisMPI::wait_action(int id, double *action, size_t n, double timeout) {
+    return wait_action_step(id, current_step, action, n, timeout);
+}
+
+void SmartRedisMPI::get_action_step(int id, long long step, double *action, size_t n) {
+    receive_action_step(id, step, action, n, false, -1.0);
+}
+
+bool SmartRedisMPI::wait_action_step(int id, long long step, double *action, size_t n, double timeout) {
+    return receive_action_step(id, step, action, n, true, timeout);
+}
+
+// A read consumes its slot (and drops it from the ring if an earlier wait
+// timed out on it); only a timed-out wait leaves one, as the agent may
+// still write it
+bool SmartRedisMPI::receive_action_step(int id, long long step, double *action, size_t n, bool wait,
+                                        double timeout) {
+    KeyHandle &h = key_handle(id);
+    if (h.ring > 0 && step <= current_step - h.ring)
+        throw std::out_of_range("SmartRedisMPI: step " + std::to_string(step) + " has left the ring of '" +
+                                h.name + "'");
+    if (!policies.empty() && step == current_step && local_action(h.name, action, n)) return true;
+    OpScope op(stats, OP_GET_ACTION, h.name, n * sizeof(double));
+    const int precision = get_wire_precision(h.name);
+    ExchangePlan &plan = key_plan(h, static_cast<int>(n), wire_mpi_type(precision));
+    const bool current = !h.per_step || step == h.step;
+    if (!current && shard_rank == 0) format_key(h, step, true, h.slot_store);
+    const std::string &skey = current ? h.shard_store : h.slot_store;
+    const bool done = receive_action(h.name, skey, plan, precision, action, n, wait, timeout);
+    if (shard_rank == 0) {
+        if (done) h.live.erase(step);
+        else keep_slot(h, step, skey);
+    }
+    return done;
+}
+
+void SmartRedisMPI::put_step_type(int id, int step_type) {
+    RANK0_ONLY
+    KeyHandle &h = key_handle(id);
+    OpScope op(stats, OP_PUT_SCALAR, h.name, sizeof(int32_t));
+    PhaseScope phase(stats, PHASE_REDIS);
+    int32_t v = step_type;
+    client->put_tensor(h.store, &v, {1}, SRTensorTypeInt32, SRMemLayoutContiguous);
+    keep_slot(h, h.step, h.store);
+}
+
+void SmartRedisMPI::put_real_scalar(int id, double rscalar) {
+    RANK0_ONLY
+    KeyHandle &h = key_handle(id);
+    OpScope op(stats, OP_PUT_SCALAR, h.name, sizeof(double));
+    PhaseScope phase(stats, PHASE_REDIS);
+    client->put_tensor(h.store, &rscalar, {1}, SRTensorTypeDouble, SRMemLayoutContiguous);
+    keep_slot(h, h.step, h.store);
+}
+
+// === Local policy ===
+
+void SmartRedisMPI::set_local_policy(const std::string &action_key, const std::string &state_key,
+                                     const std::string &weights_key, int refresh_steps) {
+    if (weights_key.empty()) {
+        policies.erase(action_key);
+    } else {
+        if (refresh_steps < 1) throw std::invalid_argument("SmartRedisMPI: refresh_steps must be positive");
+        LocalPolicy &policy = policies[action_key];
+        if (policy.weights_key != weights_key) policy = LocalPolicy();
+        policy.state_key = state_key;
+        policy.weights_key = weights_key;
+        policy.refresh_steps = refresh_steps;
+        policy.calls = 0;
+    }
+    for (auto &lane : lanes) lane->set_local_policy(action_key, state_key, weights_key, refresh_steps);
+}
+
+int SmartRedisMPI::get_policy_version(const std::string &action_key) const {
+    auto it = policies.find(action_key);
+    return it == policies.end() ? -1 : it->second.version;
+}
+
+template <typename T>
+static void float_from(const void *src, size_t n, float *dst) {
+    const T *p = static_cast<const T*>(src);
+    for (size_t i=0;i<n;i++) dst[i] = static_cast<float>(p[i]);
+}
+
+// Keep this rank's copy of a state that feeds a local policy
+void SmartRedisMPI::keep_policy_state(const std::string &key, const void *state, size_t n, SRTensorType type) {
+    for (auto &entry : policies) {
+        LocalPolicy &policy = entry.second;
+        if (policy.state_key != key) continue;
+        policy.state.resize(n);
+        switch (type) {
+        case SRTensorTypeFloat: if (n > 0) std::memcpy(policy.state.data(), state, n * sizeof(float)); break;
+        case SRTensorTypeInt32: float_from<int32_t>(state, n, policy.state.data()); break;
+        case SRTensorTypeInt64: float_from<int64_t>(state, n, policy.state.data()); break;
+        default: float_from<double>(state, n, policy.state.data());
+        }
+    }
+}
+
+// Answer a read of key with its local policy; false (nothing written) if
+// the key has none or no weights were published yet
+bool SmartRedisMPI::local_action(const std::string &key, double *action, size_t n) {
+    auto it = policies.find(key);
+    if (it == policies.end()) return false;
+    LocalPolicy &policy = it->second;
+    if (policy.calls == 0 || !policy.mlp.loaded()) refresh_policy(key, policy);
+    if (++policy.calls == policy.refresh_steps) policy.calls = 0;
+    if (!policy.mlp.loaded()) return false;
+
+    OpScope op(stats, OP_POLICY_EVAL, key, n * sizeof(double));
+    const size_t n_in = static_cast<size_t>(policy.mlp.n_inputs());
+    const size_t n_out = static_cast<size_t>(policy.mlp.n_outputs());
+    if (n % n_out != 0 || policy.state.size() != n / n_out * n_in)
+        throw std::invalid_argument("SmartRedisMPI: the local policy of '" + key + "' maps " + std::to_string(n_in) +
+                                    " values per point to " + std::to_string(n_out) + ", but '" + policy.state_key +
+                                    "' holds " + std::to_string(policy.state.size()) + " values and the action " +
+                                    std::to_string(n));
+    policy.mlp.evaluate(policy.state.data(), n / n_out, action);
+    return true;
+}
+
+// Collective over the shard: the writer reads the meta block and, for a new
+// version, the parameters, then broadcasts both. Store-backed transports
+// other than SmartRedis consume what they read (the shm rings and replay
+// logs hand out messages in order), so the next refresh sees the next
+// publication; Redis keeps the tensors for every writer
+void SmartRedisMPI::refresh_policy(const std::string &key, LocalPolicy &policy) {
+    int32_t meta[POLICY_META_LEN] = {-1};
+    OpScope op(stats, OP_POLICY_LOAD, key, sizeof(meta));
+    const bool consume = transport_kind != TRANSPORT_SMARTREDIS;
+    const std::string meta_key = policy.weights_key + ".meta";
+    const std::string params_key = policy.weights_key + ".params";
+    std::exception_ptr failure;
+    if (shard_rank == 0) {
+        PhaseScope phase(stats, PHASE_REDIS);
+        try {
+            if (client->tensor_exists(meta_key)) {
+                client->unpack_tensor(meta_key, meta, {static_cast<size_t>(POLICY_META_LEN)}, SRTensorTypeInt32,
+                                      SRMemLayoutContiguous);
+                if (consume) client->delete_tensor(meta_key);
+            }
+            const size_t count = policy_param_count(meta);
+            if (meta[0] >= 0 && meta[0] != policy.version && count > 0) {
+                policy.params.resize(count);
+                client->unpack_tensor(params_key, policy.params.data(), {count}, SRTensorTypeFloat,
+                                      SRMemLayoutContiguous);
+                if (consume) client->delete_tensor(params_key);
+            }
+        } catch (...) {
+            failure = std::current_exception();
+        }
+    }
+    agree_status(failure);
+    {
+        PhaseScope phase(stats, PHASE_MPI);
+        MPI_Bcast(meta, POLICY_META_LEN, MPI_INT32_T, 0, shard_comm);
+    }
+    if (meta[0] < 0 || meta[0] == policy.version) return;
+    const size_t count = policy_param_count(meta);
+    if (count == 0)
+        throw std::invalid_argument("SmartRedisMPI: '" + meta_key + "' does not describe a valid policy");
+
+    PhaseScope phase(stats, PHASE_MPI);
+    policy.params.resize(count);
+    MPI_Bcast(policy.params.data(), static_cast<int>(count), MPI_FLOAT, 0, shard_comm);
+    policy.mlp.load(meta, policy.params);
+    policy.version = meta[0];
+}
+
+// === Compression ===
+
+void SmartRedisMPI::set_compression(const std::string &key, int codec, size_t threshold_bytes) {
+    if (!codec_valid(codec))
+        throw std::invalid_argument("SmartRedisMPI: unknown compression codec");
+    for (auto &lane : lanes) lane->set_compression(key, codec, threshold_bytes);
+    if (codec == CODEC_NONE) {
+        compression.erase(key);
+        return;
+    }
+    CompressionSettings &settings = compression[key];
+    settings.codec = codec;
+    settings.threshold_bytes = threshold_bytes;
+}
+
+CompressionStats SmartRedisMPI::get_compression_stats(const std::string &key) const {
+    std::lock_guard<std::mutex> lock(compression_mutex);
+    auto it = compression_stats.find(key);
+    return it == compression_stats.end() ? CompressionStats() : it->second;
+}
+
+bool SmartRedisMPI::compressed(const std::string &key) const {
+    return compression.find(key) != compression.end();
+}
+
+// Writer side of every gathered put, stored as skey: the plain tensor, or its
+// frame when the key is compressed, the tensor is large enough and the codec
+// actually helps
+void SmartRedisMPI::write_tensor(const std::string &key, const std::string &skey, const void *data,
+                                 const std::vector<size_t> &dims, SRTensorType type, SRMemoryLayout layout) {
+    PhaseScope phase(stats, PHASE_REDIS);
+    auto it = compression.find(key);
+    store_tensor(client, key, skey, data, dims, type, layout, it == compression.end() ? nullptr : &it->second,
+                 frame_buffer, frame_scratch);
+}
+
+// write_tensor through a given connection and frame buffers, so the I/O
+// thread can use it with its own
+void SmartRedisMPI::store_tensor(Transport *to, const std::string &key, const std::string &skey, const void *data,
+                                 const std::vector<size_t> &dims, SRTensorType type, SRMemoryLayout layout,
+                                 const CompressionSettings *settings, std::vector<unsigned char> &frame,
+                                 std::vector<unsigned char> &scratch) {
+    size_t n = 1;
+    for (size_t d : dims) n *= d;
+    const size_t raw = n * tensor_type_size(type);
+    if (!settings || raw < settings->threshold_bytes) {
+        to->put_tensor(skey, data, dims, type, layout);
+        return;
+    }
+
+    FrameHeader header;
+    header.codec = settings->codec;
+    header.elem_size = static_cast<int>(tensor_type_size(type));
+    header.dtype = type;
+    header.layout = layout;
+    header.dims = dims;
+    const auto start = std::chrono::steady_clock::now();
+    encode_frame(data, n, header, frame, scratch);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const bool smaller = frame.size() < raw;
+    {
+        std::lock_guard<std::mutex> lock(compression_mutex);
+        CompressionStats &cs = compression_stats[key];
+        cs.last_encode_seconds = seconds;
+        cs.encode_seconds += seconds;
+        cs.last_ratio = static_cast<double>(raw) / frame.size();
+        if (smaller) {
+            cs.calls++;
+            cs.raw_bytes += raw;
+            cs.stored_bytes += frame.size();
+        }
+    }
+    if (!smaller) {
+        to->put_tensor(skey, data, dims, type, layout);
+        return;
+    }
+    to->put_tensor(skey, frame.data(), {frame.size()}, SRTensorTypeUint8, SRMemLayoutContiguous);
+}
+
+// Take (read and delete) the action frame <skey> and decode it
+void SmartRedisMPI::read_frame(const std::string &key, const std::string &skey, void *data, size_t bytes) {
+    client->take_frame(skey, frame_buffer);
+    const size_t n = frame_buffer.size();
+
+    const auto start = std::chrono::steady_clock::now();
+    decode_frame(frame_buffer.data(), n, data, bytes, frame_scratch);
+    std::lock_guard<std::mutex> lock(compression_mutex);
+    CompressionStats &stats = compression_stats[key];
+    stats.decode_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    stats.calls++;
+    stats.raw_bytes += bytes;
+    stats.stored_bytes += n;
+}
+
+// === Statistics ===
+
+void SmartRedisMPI::enable_stats(bool enabled, bool trace) {
+    stats.enable(enabled, trace, mpi_comm_local);
+    for (auto &lane : lanes) lane->enable_stats(enabled, trace);
+}
+
+OpStats SmartRedisMPI::get_stats(int op, const std::string &key) const {
+    if (!lanes.empty()) {
+        const ExchangeStats sum = lane_stats();
+        const OpStats *e = sum.find(op, key);
+        return e ? *e : OpStats();
+    }
+    const OpStats *e = stats.find(op, key);
+    return e ? *e : OpStats();
+}
+
+void SmartRedisMPI::reset_stats() {
+    stats.reset();
+    for (auto &lane : lanes) lane->reset_stats();
+}
+
+void SmartRedisMPI::dump_stats(const std::string &path) const {
+    if (lanes.empty()) stats.dump(path, mpi_comm_local);
+    else lane_stats().dump(path, mpi_comm_local);
+}
+
+// With lanes, lane i writes <prefix>.lane<i>.<rank>.json
+void SmartRedisMPI::dump_trace(const std::string &prefix) const {
+    stats.dump_trace(prefix, myid);
+    for (size_t i=0;i<lanes.size();i++) lanes[i]->dump_trace(prefix + ".lane" + std::to_string(i));
+}
+
+// === Fused step exchange ===
+
+bool SmartRedisMPI::step_exchange(const std::string &tag, const std::vector<double> &state,
+                                  const std::vector<double> &reward, int step_type,
+                                  std::vector<double> &action,
+                                  const std::vector<double> &scalars, double timeout) {
+    return step_exchange(tag, state.data(), state.size(), reward.data(), reward.size(), step_type,
+                         action.data(), action.size(), scalars.data(), scalars.size(), timeout);
+}
+
+bool SmartRedisMPI::step_exchange(const std::string &tag, const double *state, size_t n_state,
+                                  const double *reward, size_t n_reward, int step_type,
+                                  double *action, size_t n_action,
+                                  const double *scalars, size_t n_scalars, double timeout) {
+    const std::string step_key = tag + ".step";
+    OpScope op(stats, OP_STEP_EXCHANGE, tag, (n_state + n_reward + n_action) * sizeof(double));
+    const int precision = get_wire_precision(step_key);
+    ExchangePlan &plan = get_step_plan(step_key, static_cast<int>(n_state), static_cast<int>(n_reward),
+                                       wire_mpi_type(precision));
+    const size_t elem = static_cast<size_t>(plan.elem_size);
+
+    if (collective_mode == COLLECTIVE_HIERARCHICAL) {
+        // The node window takes one contiguous block per rank, which the
+        // writer then regroups
+        plan.wire_buffer.resize((n_state + n_reward) * elem);
+        pack_wire(state, plan.wire_buffer.data(), n_state, precision);
+        pack_wire(reward, plan.wire_buffer.data() + n_state * elem, n_reward, precision);
+        gather_to_root(plan, plan.wire_buffer.data());
+        if (shard_rank == 0) {
+            const unsigned char *gathered = plan.root_buffer.data();
+            unsigned char *packed_state = plan.pack_buffer.data();
+            unsigned char *packed_reward = packed_state + plan.total_split * elem;
+            for (int i=0;i<shard_nprocs;i++) {
+                const unsigned char *src = gathered + plan.displs[i] * elem;
+                const size_t state_bytes = static_cast<size_t>(plan.splits[i]) * elem;
+                const size_t reward_bytes = static_cast<size_t>(plan.reward_sizes[i]) * elem;
+                packed_state = std::copy(src, src + state_bytes, packed_state);
+                packed_reward = std::copy(src + state_bytes, src + state_bytes + reward_bytes, packed_reward);
+            }
+        }
+    } else {
+        // State and reward land straight in [all states | all rewards] with
+        // two concurrent gathers: no derived datatype, no staging copy on the
+        // ranks (unless converted) and no regroup on the writer
+        const unsigned char *send_state = reinterpret_cast<const unsigned char*>(state);
+        const unsigned char *send_reward = reinterpret_cast<const unsigned char*>(reward);
+        if (precision != WIRE_FLOAT64) {
+            plan.wire_buffer.resize((n_state + n_reward) * elem);
+            pack_wire(state, plan.wire_buffer.data(), n_state, precision);
+            pack_wire(reward, plan.wire_buffer.data() + n_state * elem, n_reward, precision);
+            send_state = plan.wire_buffer.data();
+            send_reward = send_state + n_state * elem;
+        }
+        unsigned char *packed = shard_rank==0 ? plan.pack_buffer.data() : nullptr;
+        PhaseScope phase(stats, PHASE_MPI);
+        MPI_Request reqs[2];
+        MPI_Igatherv(send_state, static_cast<int>(n_state), plan.datatype, packed,
+                     shard_rank==0 ? plan.splits.data() : nullptr,
+                     shard_rank==0 ? plan.split_displs.data() : nullptr,
+                     plan.datatype, 0, shard_comm, &reqs[0]);
+        MPI_Igatherv(send_reward, static_cast<int>(n_reward), plan.datatype,
+                     packed ? packed + plan.total_split * elem : nullptr,
+                     shard_rank==0 ? plan.reward_sizes.data() : nullptr,
+                     shard_rank==0 ? plan.reward_displs.data() : nullptr,
+                     plan.datatype, 0, shard_comm, &reqs[1]);
+        MPI_Waitall(2, reqs, MPI_STATUSES_IGNORE);
+    }
+
+    if (shard_rank == 0) {
+        const unsigned char *packed = plan.pack_buffer.data();
+        size_t total_reward = static_cast<size_t>(plan.total_size - plan.total_split);
+        std::vector<GroupTensor> tensors(total_reward > 0 ? 2 : 1);
+        tensors[0].name = "state";
+        tensors[0].data = packed;
+        tensors[0].dims = {static_cast<size_t>(plan.total_split)};
+        tensors[0].type = wire_tensor_type(precision);
+        if (total_reward > 0) {
+            tensors[1].name = "reward";
+            tensors[1].data = packed + plan.total_split * elem;
+            tensors[1].dims = {total_reward};
+            tensors[1].type = wire_tensor_type(precision);
+        }
+        std::vector<GroupMeta> meta(2);
+        meta[0].name = "step_type";
+        meta[0].ints = {step_type};
+        meta[1].name = "scalars";
+        meta[1].doubles.assign(scalars, scalars + n_scalars);
+        if (writer_mode != WRITER_ROOT) {
+            meta.resize(4);
+            meta[2].name = "shard_id";
+            meta[2].ints = {shard_id};
+            meta[3].name = "n_shards";
+            meta[3].ints = {n_shards};
+        }
+        PhaseScope phase(stats, PHASE_REDIS);
+        client->put_group(shard_key(step_key), tensors, meta);
+    }
+
+    return receive_action(tag + ".action", action, n_action, true, timeout);
+}
+
+// === Sparse states ===
+
+// Dense layout of a sparse key: the writer keeps every rank's range, each
+// rank its own offset
+ExchangePlan &SmartRedisMPI::get_sparse_plan(const std::string &key, int size_local) {
+    const std::string name = sparse_plan_name(key);
+    auto it = plans.find(name);
+    if (it != plans.end()) {
+        if (agree_plan_changed(it->second.local_size != size_local)) {
+            throw std::runtime_error("SmartRedisMPI: local size of '" + key +
+                                     "' changed; call invalidate_plan on all ranks first");
+        }
+        return it->second;
+    }
+
+    ExchangePlan plan;
+    plan.local_size = size_local;
+    plan.datatype = MPI_BYTE;
+    plan.elem_size = 1;
+    if (shard_rank == 0) {
+        plan.sizes.assign(shard_nprocs, 0);
+        plan.displs.assign(shard_nprocs, 0);
+        plan.sparse_counts.assign(shard_nprocs, 0);
+        plan.sparse_displs.assign(shard_nprocs, 0);
+    }
+    {
+        PhaseScope phase(stats, PHASE_MPI);
+        MPI_Gather(&size_local, 1, MPI_INT, shard_rank==0 ? plan.sizes.data() : nullptr, 1, MPI_INT, 0, shard_comm);
+        if (shard_rank == 0) {
+            for (int i=0;i<shard_nprocs;i++) {
+                plan.displs[i] = plan.total_size;
+                plan.total_size += plan.sizes[i];
+            }
+        }
+        MPI_Scatter(shard_rank==0 ? plan.displs.data() : nullptr, 1, MPI_INT,
+                    &plan.dense_offset, 1, MPI_INT, 0, shard_comm);
+    }
+    put_manifest(key, plan.sizes);
+    return plans.emplace(name, std::move(plan)).first->second;
+}
+
+void SmartRedisMPI::put_state_sparse(const std::string &key, const double *state, size_t n,
+                                     const int *indices, size_t n_indices) {
+    ExchangePlan &plan = get_sparse_plan(key, static_cast<int>(n));
+    plan.sparse_index.assign(indices, indices + n_indices);
+    for (int i : plan.sparse_index) {
+        if (i < 0 || static_cast<size_t>(i) >= n)
+            throw std::out_of_range("SmartRedisMPI: sparse index out of range for '" + key + "'");
+    }
+    send_sparse(key, plan, state);
+}
+
+void SmartRedisMPI::put_state_masked(const std::string &key, const double *state, size_t n, const int *mask) {
+    ExchangePlan &plan = get_sparse_plan(key, static_cast<int>(n));
+    plan.sparse_index.clear();
+    for (size_t i=0;i<n;i++)
+        if (mask[i]) plan.sparse_index.push_back(static_cast<int>(i));
+    send_sparse(key, plan, state);
+}
+
+void SmartRedisMPI::put_state_delta(const std::string &key, const double *state, size_t n, double threshold) {
+    ExchangePlan &plan = get_sparse_plan(key, static_cast<int>(n));
+    if (plan.last_sent.size() != n) plan.last_sent.assign(n, std::numeric_limits<double>::quiet_NaN());
+    plan.sparse_index.clear();
+    for (size_t i=0;i<n;i++) {
+        // NaN never compares <=, so unsent entries are always picked
+        if (!(std::fabs(state[i] - plan.last_sent[i]) <= threshold))
+            plan.sparse_index.push_back(static_cast<int>(i));
+    }
+    send_sparse(key, plan, state);
+    // Only once sent, so a failed put sends the same entries again
+    for (int i : plan.sparse_index) plan.last_sent[i] = state[i];
+}
+
+// Gather the selected entries (counts first, then one byte block per rank)
+// and regroup them on the writer into all positions, then all values
+void SmartRedisMPI::send_sparse(const std::string &key, ExchangePlan &plan, const double *state) {
+    const int precision = get_wire_precision(key);
+    int elem = 0;
+    MPI_Type_size(wire_mpi_type(precision), &elem);
+    const size_t entry = sizeof(int32_t) + elem;
+    const size_t count = plan.sparse_index.size();
+    OpScope op(stats, OP_PUT_SPARSE, key, count * entry);
+
+    plan.sparse_values.resize(count);
+    plan.wire_buffer.resize(count * entry);
+    int32_t *positions = reinterpret_cast<int32_t*>(plan.wire_buffer.data());
+    for (size_t k=0;k<count;k++) {
+        positions[k] = plan.dense_offset + plan.sparse_index[k];
+        plan.sparse_values[k] = state[plan.sparse_index[k]];
+    }
+    pack_wire(plan.sparse_values.data(), plan.wire_buffer.data() + count * sizeof(int32_t), count, precision);
+
+    const int bytes = static_cast<int>(count * entry);
+    {
+        PhaseScope phase(stats, PHASE_MPI);
+        MPI_Gather(&bytes, 1, MPI_INT, shard_rank==0 ? plan.sparse_counts.data() : nullptr, 1, MPI_INT, 0, shard_comm);
+        int total = 0;
+        if (shard_rank == 0) {
+            for (int i=0;i<shard_nprocs;i++) {
+                plan.sparse_displs[i] = total;
+                total += plan.sparse_counts[i];
+            }
+            plan.root_buffer.resize(total);
+        }
+        MPI_Gatherv(plan.wire_buffer.data(), bytes, MPI_BYTE,
+                    shard_rank==0 ? plan.root_buffer.data() : nullptr,
+                    shard_rank==0 ? plan.sparse_counts.data() : nullptr,
+                    shard_rank==0 ? plan.sparse_displs.data() : nullptr,
+                    MPI_BYTE, 0, shard_comm);
+    }
+
+    WRITER_ONLY
+    const size_t nnz = plan.root_buffer.size() / entry;
+    plan.pack_buffer.resize(plan.root_buffer.size());
+    unsigned char *all_positions = plan.pack_buffer.data();
+    unsigned char *all_values = all_positions + nnz * sizeof(int32_t);
+    for (int i=0;i<shard_nprocs;i++) {
+        const size_t c = plan.sparse_counts[i] / entry;
+        const unsigned char *block = plan.root_buffer.data() + plan.sparse_displs[i];
+        std::memcpy(all_positions, block, c * sizeof(int32_t));
+        std::memcpy(all_values, block + c * sizeof(int32_t), c * elem);
+        all_positions += c * sizeof(int32_t);
+        all_values += c * elem;
+    }
+
+    std::vector<GroupTensor> tensors(nnz > 0 ? 2 : 0);
+    if (nnz > 0) {
+        tensors[0].name = "indices";
+        tensors[0].data = plan.pack_buffer.data();
+        tensors[0].dims = {nnz};
+        tensors[0].type = SRTensorTypeInt32;
+        tensors[1].name = "values";
+        tensors[1].data = plan.pack_buffer.data() + nnz * sizeof(int32_t);
+        tensors[1].dims = {nnz};
+        tensors[1].type = wire_tensor_type(precision);
+    }
+    std::vector<GroupMeta> meta(1);
+    meta[0].name = "size";
+    meta[0].ints = {plan.total_size};
+    if (writer_mode != WRITER_ROOT) {
+        meta.resize(3);
+        meta[1].name = "shard_id";
+        meta[1].ints = {shard_id};
+        meta[2].name = "n_shards";
+        meta[2].ints = {n_shards};
+    }
+    PhaseScope phase(stats, PHASE_REDIS);
+    client->put_group(shard_key(key), tensors, meta);
+}
+
+void SmartRedisMPI::get_action_sparse(const std::string &key, double *action, size_t n) {
+    receive_sparse(key, action, n, false, -1.0);
+}
+
+bool SmartRedisMPI::wait_action_sparse(const std::string &key, double *action, size_t n, double timeout) {
+    return receive_sparse(key, action, n, true, timeout);
+}
+
+// The writer takes the agent's group, buckets its entries by owning rank
+// and scatters each rank [int32 local positions | wire values]
+bool SmartRedisMPI::receive_sparse(const std::string &key, double *action, size_t n, bool wait, double timeout) {
+    OpScope op(stats, OP_GET_SPARSE, key, 0);
+    ExchangePlan &plan = get_sparse_plan(key, static_cast<int>(n));
+    const std::string skey = shard_key(key);
+    const int precision = get_wire_precision(key);
+    int elem = 0;
+    MPI_Type_size(wire_mpi_type(precision), &elem);
+    const size_t entry = sizeof(int32_t) + elem;
+    const bool wait_forever = wait && timeout < 0.0;
+    if (wait && !wait_forever) {
+        int ready = 1;
+        std::exception_ptr failure;
+        if (shard_rank == 0) {
+            try {
+                ready = poll_action(skey, timeout, true) ? 1 : 0;
+            } catch (...) {
+                failure = std::current_exception();
+                ready = -1;
+            }
+        }
+        if (!agree_ready(ready, failure)) return false;
+    }
+
+    std::exception_ptr failure;
+    if (shard_rank == 0) {
+        try {
+            if (wait_forever) poll_action(skey, timeout, true);
+            std::vector<GroupData> group(2);
+            group[0].name = "indices";
+            group[1].name = "values";
+            {
+                PhaseScope phase(stats, PHASE_REDIS);
+                client->take_group(skey, group);
+            }
+            const GroupData &indices = group[0];
+            const GroupData &values_in = group[1];
+            if (indices.found != values_in.found ||
+                (indices.found && (indices.type != SRTensorTypeInt32 || values_in.type != wire_tensor_type(precision) ||
+                                   indices.count != values_in.count)))
+                throw std::runtime_error("SmartRedisMPI: sparse action '" + skey +
+                                         "' is not int32 indices + values in the key's wire precision");
+            const size_t nnz = indices.found ? indices.count : 0;
+            const unsigned char *positions = indices.bytes.data();
+            const unsigned char *values = values_in.bytes.data();
+
+            // Owner of each entry, counted per rank, then packed rank by rank
+            std::vector<int> &owners = plan.sparse_index;
+            owners.resize(nnz);
+            std::fill(plan.sparse_counts.begin(), plan.sparse_counts.end(), 0);
+            for (size_t k=0;k<nnz;k++) {
+                int32_t g;
+                std::memcpy(&g, positions + k * sizeof(int32_t), sizeof(int32_t));
+                if (g < 0 || g >= plan.total_size)
+                    throw std::out_of_range("SmartRedisMPI: sparse action position out of range in '" + skey + "'");
+                const int owner = static_cast<int>(std::upper_bound(plan.displs.begin(), plan.displs.end(), g) -
+                                                   plan.displs.begin()) - 1;
+                owners[k] = owner;
+                plan.sparse_counts[owner]++;
+            }
+            std::vector<size_t> placed(shard_nprocs, 0);
+            int total = 0;
+            for (int i=0;i<shard_nprocs;i++) {
+                plan.sparse_displs[i] = total;
+                total += static_cast<int>(plan.sparse_counts[i] * entry);
+            }
+            plan.root_buffer.resize(total);
+            for (size_t k=0;k<nnz;k++) {
+                const int owner = owners[k];
+                const size_t c = plan.sparse_counts[owner];
+                unsigned char *block = plan.root_buffer.data() + plan.sparse_displs[owner];
+                int32_t g;
+                std::memcpy(&g, positions + k * sizeof(int32_t), sizeof(int32_t));
+                const int32_t local = g - plan.displs[owner];
+                std::memcpy(block + placed[owner] * sizeof(int32_t), &local, sizeof(int32_t));
+                std::memcpy(block + c * sizeof(int32_t) + placed[owner] * elem, values + k * elem, elem);
+                placed[owner]++;
+            }
+            for (int i=0;i<shard_nprocs;i++) plan.sparse_counts[i] *= static_cast<int>(entry);
+        } catch (...) {
+            failure = std::current_exception();
+        }
+    }
+    agree_status(failure, wait_forever);
+
+    int bytes = 0;
+    {
+        PhaseScope phase(stats, PHASE_MPI);
+        MPI_Scatter(shard_rank==0 ? plan.sparse_counts.data() : nullptr, 1, MPI_INT, &bytes, 1, MPI_INT, 0, shard_comm);
+        plan.wire_buffer.resize(bytes);
+        MPI_Scatterv(shard_rank==0 ? plan.root_buffer.data() : nullptr,
+                     shard_rank==0 ? plan.sparse_counts.data() : nullptr,
+                     shard_rank==0 ? plan.sparse_displs.data() : nullptr,
+                     MPI_BYTE, plan.wire_buffer.data(), bytes, MPI_BYTE, 0, shard_comm);
+    }
+    if (stats.active) stats.active->bytes += bytes;
+
+    const size_t count = bytes / entry;
+    const unsigned char *local_positions = plan.wire_buffer.data();
+    plan.sparse_values.resize(count);
+    unpack_wire(local_positions + count * sizeof(int32_t), plan.sparse_values.data(), count, precision);
+    for (size_t k=0;k<count;k++) {
+        int32_t i;
+        std::memcpy(&i, local_positions + k * sizeof(int32_t), sizeof(int32_t));
+        action[i] = plan.sparse_values[k];
+    }
+    return true;
+}
+
+// === Batched keys ===
+
+static std::string batch_name(const std::vector<std::string> &keys) {
+    std::string name;
+    for (size_t k=0;k<keys.size();k++) name += (k ? "," : "") + keys[k];
+    return name;
+}
+
+// Layout of one batch, keyed by its key list. The wire precision of every key
+// is part of the layout; changing one rebuilds the plan on all ranks.
+ExchangePlan &SmartRedisMPI::get_batch_plan(const std::vector<std::string> &keys, const std::vector<size_t> &sizes,
+                                            std::vector<int> &precisions) {
+    const int nk = static_cast<int>(keys.size());
+    std::vector<int> counts(nk), elems(nk);
+    precisions.resize(nk);
+    for (int k=0;k<nk;k++) {
+        precisions[k] = get_wire_precision(keys[k]);
+        counts[k] = static_cast<int>(sizes[k]);
+        elems[k] = static_cast<int>(tensor_type_size(wire_tensor_type(precisions[k])));
+    }
+
+    const std::string plan_key = "batch:" + batch_name(keys);
+    auto it = plans.find(plan_key);
+    if (it != plans.end()) {
+        ExchangePlan &plan = it->second;
+        if (agree_plan_changed(plan.key_counts != counts)) {
+            throw std::runtime_error("SmartRedisMPI: local sizes of batch '" + batch_name(keys) +
+                                     "' changed; call invalidate_plans on all ranks first");
+        }
+        if (plan.key_elems == elems) return plan;
+        free_plan(plan);
+        plans.erase(it);
+    }
+
+    ExchangePlan plan;
+    plan.datatype = MPI_BYTE;
+    plan.elem_size = 1;
+    plan.key_counts = counts;
+    plan.key_elems = elems;
+    for (int k=0;k<nk;k++) plan.local_size += counts[k] * elems[k];
+
+    if (shard_rank == 0) plan.rank_counts.assign(static_cast<size_t>(shard_nprocs) * nk, 0);
+    {
+        PhaseScope phase(stats, PHASE_MPI);
+        MPI_Gather(counts.data(), nk, MPI_INT,
+                   shard_rank==0 ? plan.rank_counts.data() : nullptr, nk, MPI_INT, 0, shard_comm);
+    }
+
+    if (shard_rank == 0) {
+        plan.sizes.assign(shard_nprocs, 0);
+        plan.displs.assign(shard_nprocs, 0);
+        plan.key_totals.assign(nk, 0);
+        for (int i=0;i<shard_nprocs;i++) {
+            for (int k=0;k<nk;k++) {
+                plan.sizes[i] += plan.rank_counts[i*nk + k] * elems[k];
+                plan.key_totals[k] += plan.rank_counts[i*nk + k];
+            }
+            plan.displs[i] = plan.total_size;
+            plan.total_size += plan.sizes[i];
+        }
+        plan.root_buffer.assign(plan.total_size, 0);
+        plan.pack_buffer.assign(plan.total_size, 0);
+    }
+    plan.wire_buffer.assign(plan.local_size, 0);
+#if SRMPI_USE_PERSISTENT
+    plan.local_buffer.assign(plan.local_size, 0);
+#endif
+    std::vector<int> key_sizes(shard_rank == 0 ? shard_nprocs : 0);
+    for (int k=0;k<nk;k++) {
+        for (size_t i=0;i<key_sizes.size();i++) key_sizes[i] = plan.rank_counts[i*nk + k];
+        put_manifest(keys[k], key_sizes);
+    }
+    return plans.emplace(plan_key, std::move(plan)).first->second;
+}
+
+// Byte offset of every key's block in the writer's pack_buffer
+static std::vector<size_t> batch_offsets(const ExchangePlan &plan) {
+    std::vector<size_t> offsets(plan.key_totals.size() + 1, 0);
+    for (size_t k=0;k<plan.key_totals.size();k++)
+        offsets[k+1] = offsets[k] + static_cast<size_t>(plan.key_totals[k]) * plan.key_elems[k];
+    return offsets;
+}
+
+// Move the writer's data between the gathered rank-major layout (root_buffer)
+// and the key-major one (pack_buffer)
+static void regroup_batch(ExchangePlan &plan, int nprocs, bool to_keys) {
+    const size_t nk = plan.key_elems.size();
+    std::vector<size_t> cursor = batch_offsets(plan);
+    for (int i=0;i<nprocs;i++) {
+        unsigned char *rank_block = plan.root_buffer.data() + plan.displs[i];
+        for (size_t k=0;k<nk;k++) {
+            const size_t bytes = static_cast<size_t>(plan.rank_counts[i*nk + k]) * plan.key_elems[k];
+            unsigned char *key_block = plan.pack_buffer.data() + cursor[k];
+            if (bytes > 0) {
+                if (to_keys) std::memcpy(key_block, rank_block, bytes);
+                else std::memcpy(rank_block, key_block, bytes);
+            }
+            cursor[k] += bytes;
+            rank_block += bytes;
+        }
+    }
+}
+
+void SmartRedisMPI::put_states(const std::vector<std::string> &keys, const std::vector<const double*> &states,
+                               const std::vector<size_t> &sizes) {
+    if (states.size() != keys.size() || sizes.size() != keys.size())
+        throw std::invalid_argument("SmartRedisMPI: put_states needs one buffer and size per key");
+    size_t n_total = 0;
+    for (size_t n : sizes) n_total += n;
+    OpScope op(stats, OP_PUT_BATCH, batch_name(keys), n_total * sizeof(double));
+    std::vector<int> precisions;
+    ExchangePlan &plan = get_batch_plan(keys, sizes, precisions);
+
+    unsigned char *local = plan.wire_buffer.data();
+    for (size_t k=0;k<keys.size();k++) {
+        pack_wire(states[k], local, sizes[k], precisions[k]);
+        local += sizes[k] * plan.key_elems[k];
+    }
+    gather_to_root(plan, plan.wire_buffer.data());
+
+    WRITER_ONLY
+    regroup_batch(plan, shard_nprocs, true);
+    const std::vector<size_t> offsets = batch_offsets(plan);
+    for (size_t k=0;k<keys.size();k++)
+        write_tensor(keys[k], shard_key(keys[k]), plan.pack_buffer.data() + offsets[k], {static_cast<size_t>(plan.key_totals[k])},
+                     wire_tensor_type(precisions[k]), SRMemLayoutContiguous);
+}
+
+void SmartRedisMPI::put_states(const std::vector<std::string> &keys, const std::vector<std::vector<double>> &states) {
+    std::vector<const double*> ptrs;
+    std::vector<size_t> sizes;
+    for (const std::vector<double> &s : states) {
+        ptrs.push_back(s.data());
+        sizes.push_back(s.size());
+    }
+    put_states(keys, ptrs, sizes);
+}
+
+void SmartRedisMPI::put_states(const std::vector<std::string> &keys, const double *states, size_t n) {
+    std::vector<const double*> ptrs;
+    for (size_t k=0;k<keys.size();k++) ptrs.push_back(states + k * n);
+    put_states(keys, ptrs, std::vector<size_t>(keys.size(), n));
+}
+
+void SmartRedisMPI::get_actions(const std::vector<std::string> &keys, const std::vector<double*> &actions,
+                                const std::vector<size_t> &sizes) {
+    receive_actions(keys, actions, sizes, false, -1.0);
+}
+
+void SmartRedisMPI::get_actions(const std::vector<std::string> &keys, std::vector<std::vector<double>> &actions) {
+    std::vector<double*> ptrs;
+    std::vector<size_t> sizes;
+    for (std::vector<double> &a : actions) {
+        ptrs.push_back(a.data());
+        sizes.push_back(a.size());
+    }
+    receive_actions(keys, ptrs, sizes, false, -1.0);
+}
+
+void SmartRedisMPI::get_actions(const std::vector<std::string> &keys, double *actions, size_t n) {
+    std::vector<double*> ptrs;
+    for (size_t k=0;k<keys.size();k++) ptrs.push_back(actions + k * n);
+    receive_actions(keys, ptrs, std::vector<size_t>(keys.size(), n), false, -1.0);
+}
+
+bool SmartRedisMPI::wait_actions(const std::vector<std::string> &keys, const std::vector<double*> &actions,
+                                 const std::vector<size_t> &sizes, double timeout) {
+    return receive_actions(keys, actions, sizes, true, timeout);
+}
+
+// The writer waits for every key within one timeout, reads them all, then a
+// single scatter delivers each rank its block of every key
+bool SmartRedisMPI::receive_actions(const std::vector<std::string> &keys, const std::vector<double*> &actions,
+                                    const std::vector<size_t> &sizes, bool wait, double timeout) {
+    if (actions.size() != keys.size() || sizes.size() != keys.size())
+        throw std::invalid_argument("SmartRedisMPI: get_actions needs one buffer and size per key");
+    size_t n_total = 0;
+    for (size_t n : sizes) n_total += n;
+    OpScope op(stats, OP_GET_BATCH, batch_name(keys), n_total * sizeof(double));
+    std::vector<int> precisions;
+    ExchangePlan &plan = get_batch_plan(keys, sizes, precisions);
+
+    // Writer only: every key within the one timeout
+    auto poll_all = [&]() {
+        using clock = std::chrono::steady_clock;
+        const clock::time_point start = clock::now();
+        bool ready = true;
+        for (size_t k=0;k<keys.size() && ready;k++) {
+            double left = timeout;
+            if (timeout >= 0.0)
+                left = std::max(0.0, timeout - std::chrono::duration<double>(clock::now() - start).count());
+            ready = poll_action(shard_key(keys[k]), left, compressed(keys[k]));
+        }
+        action_wait_last = std::chrono::duration<double>(clock::now() - start).count();
+        return ready;
+    };
+
+    // Without a timeout only the writer waits, as in fetch_action
+    const bool wait_forever = wait && timeout < 0.0;
+    if (wait && !wait_forever) {
+        int ready = 1;
+        std::exception_ptr failure;
+        if (shard_rank == 0) {
+            try {
+                ready = poll_all() ? 1 : 0;
+            } catch (...) {
+                failure = std::current_exception();
+                ready = -1;
+            }
+        }
+        if (!agree_ready(ready, failure)) return false;
+    }
+
+    std::exception_ptr failure;
+    if (shard_rank == 0) {
+        try {
+            if (wait_forever) poll_all();
+            const std::vector<size_t> offsets = batch_offsets(plan);
+            for (size_t k=0;k<keys.size();k++)
+                read_action(keys[k], shard_key(keys[k]), plan.pack_buffer.data() + offsets[k],
+                            static_cast<size_t>(plan.key_totals[k]), wire_tensor_type(precisions[k]));
+            regroup_batch(plan, shard_nprocs, false);
+        } catch (...) {
+            failure = std::current_exception();
+        }
+    }
+    agree_status(failure, wait_forever);
+    scatter_from_root(plan, plan.wire_buffer.data());
+
+    const unsigned char *local = plan.wire_buffer.data();
+    for (size_t k=0;k<keys.size();k++) {
+        unpack_wire(local, actions[k], sizes[k], precisions[k]);
+        local += sizes[k] * plan.key_elems[k];
+    }
+    return true;
+}
+
+// === Trajectory buffering ===
+
+void SmartRedisMPI::open_trajectory(const std::string &key, size_t n_steps, size_t n_features, size_t n_points,
+                                    size_t n_reward, bool async) {
+    if (n_steps == 0 || n_features == 0)
+        throw std::invalid_argument("SmartRedisMPI: trajectory '" + key + "' needs n_steps and n_features");
+    if (trajectories.count(key))
+        throw std::invalid_argument("SmartRedisMPI: trajectory '" + key + "' is already open");
+
+    Trajectory traj;
+    traj.store = shard_key(key);
+    traj.n_steps = n_steps;
+    traj.n_features = n_features;
+    traj.n_points = n_points;
+    traj.n_reward = n_reward;
+    traj.precision = get_wire_precision(key);
+    int elem = 0;
+    MPI_Type_size(wire_mpi_type(traj.precision), &elem);
+    traj.elem = elem;
+    traj.async = async;
+    const size_t bytes = n_steps * (n_features * n_points * traj.elem + n_reward * sizeof(double));
+    traj.buffer.resize(bytes);
+    traj.sending.resize(bytes);
+    traj.step_types.resize(n_steps);
+    traj.steps.resize(n_steps);
+
+    int local[2] = {static_cast<int>(n_points), static_cast<int>(n_reward)};
+    std::vector<int> both(shard_rank == 0 ? 2 * shard_nprocs : 0);
+    MPI_Gather(local, 2, MPI_INT, both.data(), 2, MPI_INT, 0, shard_comm);
+    if (shard_rank == 0) {
+        traj.points.resize(shard_nprocs);
+        traj.rewards.resize(shard_nprocs);
+        traj.counts.resize(shard_nprocs);
+        traj.displs.resize(shard_nprocs);
+        for (int i=0;i<shard_nprocs;i++) {
+            traj.points[i] = both[2*i];
+            traj.rewards[i] = both[2*i+1];
+            traj.total_points += traj.points[i];
+            traj.total_reward += traj.rewards[i];
+        }
+    }
+    put_manifest(key, traj.points);
+    trajectories.emplace(key, std::move(traj));
+}
+
+Trajectory &SmartRedisMPI::find_trajectory(const std::string &key) {
+    auto it = trajectories.find(key);
+    if (it == trajectories.end())
+        throw std::invalid_argument("SmartRedisMPI: no open trajectory '" + key + "'");
+    return it->second;
+}
+
+void SmartRedisMPI::append_step(const std::string &key, const double *state, size_t n_state,
+                                const double *reward, size_t n_reward, int step_type) {
+    Trajectory &traj = find_trajectory(key);
+    if (n_state != traj.n_features * traj.n_points || n_reward != traj.n_reward)
+        throw std::invalid_argument("SmartRedisMPI: step of trajectory '" + key + "' has the wrong size");
+
+    const size_t s = traj.filled;
+    const size_t state_values = traj.n_features * traj.n_points;
+    pack_wire(state, traj.buffer.data() + s * state_values * traj.elem, state_values, traj.precision);
+    if (n_reward > 0) {
+        unsigned char *rewards = traj.buffer.data() + traj.n_steps * state_values * traj.elem;
+        std::memcpy(rewards + s * n_reward * sizeof(double), reward, n_reward * sizeof(double));
+    }
+    traj.step_types[s] = step_type;
+    traj.steps[s] = traj.next_step++;
+    traj.filled++;
+
+    if (traj.filled == traj.n_steps) start_flush(key, traj);
+    else if (traj.async) progress_flush(traj, false);
+}
+
+void SmartRedisMPI::append_step(const std::string &key, const std::vector<double> &state,
+                                const std::vector<double> &reward, int step_type) {
+    append_step(key, state.data(), state.size(), reward.data(), reward.size(), step_type);
+}
+
+void SmartRedisMPI::flush_trajectory(const std::string &key) {
+    Trajectory &traj = find_trajectory(key);
+    start_flush(key, traj);
+}
+
+void SmartRedisMPI::close_trajectory(const std::string &key) {
+    Trajectory &traj = find_trajectory(key);
+    start_flush(key, traj);
+    progress_flush(traj, true);
+    trajectories.erase(key);
+}
+
+// In key order, so every rank flushes in the same sequence
+void SmartRedisMPI::close_trajectories() {
+    std::vector<std::string> keys;
+    for (auto &kv : trajectories) keys.push_back(kv.first);
+    std::sort(keys.begin(), keys.end());
+    for (const std::string &key : keys) close_trajectory(key);
+}
+
+// Gather the buffered steps; the previous flush completes first, as its
+// buffers are reused
+void SmartRedisMPI::start_flush(const std::string &key, Trajectory &traj) {
+    const size_t k = traj.filled;
+    if (k == 0) return;
+    progress_flush(traj, true);
+
+    const size_t state_bytes = traj.n_features * traj.n_points * traj.elem;
+    const size_t reward_bytes = traj.n_reward * sizeof(double);
+    const int bytes = static_cast<int>(k * (state_bytes + reward_bytes));
+    OpScope op(stats, OP_PUT_TRAJECTORY, key, bytes);
+
+    std::swap(traj.buffer, traj.sending);
+    std::swap(traj.step_types, traj.sent_types);
+    std::swap(traj.steps, traj.sent_steps);
+    traj.step_types.resize(traj.n_steps);
+    traj.steps.resize(traj.n_steps);
+    traj.sent_count = k;
+    traj.filled = 0;
+    // A partial buffer sends its rewards right after its k states
+    if (k < traj.n_steps && reward_bytes > 0)
+        std::memmove(traj.sending.data() + k * state_bytes, traj.sending.data() + traj.n_steps * state_bytes,
+                     k * reward_bytes);
+
+    size_t total = 0;
+    if (shard_rank == 0) {
+        for (int i=0;i<shard_nprocs;i++) {
+            traj.displs[i] = static_cast<int>(total);
+            traj.counts[i] = static_cast<int>(k * (traj.n_features * traj.points[i] * traj.elem +
+                                                   traj.rewards[i] * sizeof(double)));
+            total += traj.counts[i];
+        }
+        traj.gathered.resize(total);
+    }
+
+    {
+        PhaseScope phase(stats, PHASE_MPI);
+        if (traj.async) {
+            MPI_Igatherv(traj.sending.data(), bytes, MPI_BYTE,
+                         shard_rank==0 ? traj.gathered.data() : nullptr,
+                         shard_rank==0 ? traj.counts.data() : nullptr,
+                         shard_rank==0 ? traj.displs.data() : nullptr,
+                         MPI_BYTE, 0, shard_comm, &traj.req);
+            return;
+        }
+        MPI_Gatherv(traj.sending.data(), bytes, MPI_BYTE,
+                    shard_rank==0 ? traj.gathered.data() : nullptr,
+                    shard_rank==0 ? traj.counts.data() : nullptr,
+                    shard_rank==0 ? traj.displs.data() : nullptr,
+                    MPI_BYTE, 0, shard_comm);
+    }
+
+    WRITER_ONLY
+    std::vector<GroupTensor> tensors;
+    std::vector<GroupMeta> meta;
+    pack_trajectory(traj, tensors, meta);
+    PhaseScope phase(stats, PHASE_REDIS);
+    client->put_group(traj.store, tensors, meta);
+}
+
+// Advance an async flush; true once the gather and (on writers) the write are done
+bool SmartRedisMPI::progress_flush(Trajectory &traj, bool block) {
+    if (traj.req != MPI_REQUEST_NULL) {
+        int flag = 1;
+        if (block) MPI_Wait(&traj.req, MPI_STATUS_IGNORE);
+        else MPI_Test(&traj.req, &flag, MPI_STATUS_IGNORE);
+        if (!flag) return false;
+
+        if (shard_rank == 0) {
+            start_io_thread();
+            IOJob job;
+            job.key = traj.store;
+            pack_trajectory(traj, job.tensors, job.meta);
+            traj.written = job.done.get_future();
+            {
+                std::lock_guard<std::mutex> lock(io_mutex);
+                io_queue.push_back(std::move(job));
+            }
+            io_cv.notify_one();
+        }
+    }
+
+    if (!traj.written.valid()) return true;
+    if (!block && traj.written.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+    traj.written.get();  // rethrows write errors
+    return true;
+}
+
+// Writer: regroup the gathered blocks into [k, n_features, all points] and
+// [k, all rewards]
+void SmartRedisMPI::pack_trajectory(Trajectory &traj, std::vector<GroupTensor> &tensors,
+                                    std::vector<GroupMeta> &meta) {
+    const size_t k = traj.sent_count;
+    const size_t rows = k * traj.n_features;
+    const size_t row_bytes = traj.total_points * traj.elem;
+    traj.packed.resize(rows * row_bytes + k * traj.total_reward * sizeof(double));
+    unsigned char *state_out = traj.packed.data();
+    unsigned char *reward_out = state_out + rows * row_bytes;
+    size_t point_offset = 0, reward_offset = 0;
+    for (int i=0;i<shard_nprocs;i++) {
+        const unsigned char *src = traj.gathered.data() + traj.displs[i];
+        const size_t block = traj.points[i] * traj.elem;
+        for (size_t r=0;r<rows;r++)
+            std::memcpy(state_out + r * row_bytes + point_offset * traj.elem, src + r * block, block);
+        src += rows * block;
+        const size_t reward_block = traj.rewards[i] * sizeof(double);
+        for (size_t s=0;s<k;s++)
+            std::memcpy(reward_out + (s * traj.total_reward + reward_offset) * sizeof(double),
+                        src + s * reward_block, reward_block);
+        point_offset += traj.points[i];
+        reward_offset += traj.rewards[i];
+    }
+
+    tensors.resize(traj.total_reward > 0 ? 4 : 3);
+    tensors[0].name = "state";
+    tensors[0].data = state_out;
+    tensors[0].dims = {k, traj.n_features, traj.total_points};
+    tensors[0].type = wire_tensor_type(traj.precision);
+    tensors[1].name = "step_type";
+    tensors[1].data = traj.sent_types.data();
+    tensors[1].dims = {k};
+    tensors[1].type = SRTensorTypeInt32;
+    tensors[2].name = "step";
+    tensors[2].data = traj.sent_steps.data();
+    tensors[2].dims = {k};
+    tensors[2].type = SRTensorTypeInt64;
+    if (traj.total_reward > 0) {
+        tensors[3].name = "reward";
+        tensors[3].data = reward_out;
+        tensors[3].dims = {k, traj.total_reward};
+    }
+    meta.clear();
+    if (writer_mode != WRITER_ROOT) {
+        meta.resize(2);
+        meta[0].name = "shard_id";
+        meta[0].ints = {shard_id};
+        meta[1].name = "n_shards";
+        meta[1].ints = {n_shards};
+    }
+}
+
+// === Non-blocking puts ===
+
+// Packed to the wire precision up front, like gather_state, so the gather
+// and the stored tensor match put_state
+int SmartRedisMPI::iput_state(const std::string &key, std::vector<double> state) {
+    if (!policies.empty()) keep_policy_state(key, state.data(), state.size(), SRTensorTypeDouble);
+    const int precision = get_wire_precision(key);
+    const int n = static_cast<int>(state.size());
+    if (precision == WIRE_FLOAT64) {
+        auto hold = std::make_shared<std::vector<double>>(std::move(state));
+        return start_iput(key, hold, hold->data(), n, MPI_DOUBLE, SRTensorTypeDouble);
+    }
+    const MPI_Datatype datatype = wire_mpi_type(precision);
+    int type_size = 0;
+    MPI_Type_size(datatype, &type_size);
+    auto hold = std::make_shared<std::vector<unsigned char>>(state.size() * type_size);
+    pack_wire(state.data(), hold->data(), state.size(), precision);
+    return start_iput(key, hold, hold->data(), n, datatype, wire_tensor_type(precision));
+}
+
+int SmartRedisMPI::iput_reward(const std::string &key, std::vector<double> reward) {
+    return iput_state(key, std::move(reward));
+}
+
+int SmartRedisMPI::iput_info(const std::string &key, std::vector<int> info) {
+    auto hold = std::make_shared<std::vector<int>>(std::move(info));
+    return start_iput(key, hold, hold->data(), static_cast<int>(hold->size()), MPI_INT, SRTensorTypeInt32);
+}
+
+// Posts the first gather: to the writer, or in hierarchical mode to the
+// node leader, which forwards the node's block once it has landed
+int SmartRedisMPI::start_iput(const std::string &key, std::shared_ptr<void> hold, const void *local,
+                              int size_local, MPI_Datatype datatype, SRTensorType type) {
+    int type_size = 0;
+    MPI_Type_size(datatype, &type_size);
+    OpScope op(stats, OP_IPUT, key, static_cast<size_t>(size_local) * type_size);
+    poll_requests();
+    ExchangePlan &plan = get_plan(key, size_local, datatype);
+    const bool hierarchical = collective_mode == COLLECTIVE_HIERARCHICAL;
+    if (hierarchical && plan.node_win == MPI_WIN_NULL) setup_node_plan(plan);
+
+    auto req = std::make_shared<AsyncRequest>();
+    req->finished = req->done.get_future();
+    req->hierarchical = hierarchical;
+    req->send_hold = std::move(hold);
+    req->datatype = datatype;
+    req->elem_size = plan.elem_size;
+    if (shard_rank == 0) {
+        req->key = key;
+        req->skey = shard_key(key);
+        req->type = type;
+        req->count = static_cast<size_t>(plan.total_size);
+        if (!buffer_pool.empty()) {
+            req->buffer = std::move(buffer_pool.back());
+            buffer_pool.pop_back();
+        }
+        req->buffer.resize(req->count * plan.elem_size);
+        auto it = compression.find(key);
+        if (it != compression.end()) {
+            req->compress = true;
+            req->compression = it->second;
+        }
+        if (hierarchical) {
+            req->leader_counts = plan.node_sizes;
+            req->leader_displs = plan.node_displs;
+            req->order = plan.node_order;
+            req->sizes = plan.sizes;
+            req->rank_displs = plan.displs;
+            if (!req->order.empty()) req->stage_buffer.resize(req->buffer.size());
+        }
+        start_io_thread();
+    }
+
+    {
+        PhaseScope phase(stats, PHASE_MPI);
+        if (!hierarchical) {
+            if (shard_rank == 0) {
+                req->counts = plan.sizes;
+                req->displs = plan.displs;
+            }
+            MPI_Igatherv(local, size_local, datatype,
+                         shard_rank==0 ? req->buffer.data() : nullptr,
+                         shard_rank==0 ? req->counts.data() : nullptr,
+                         shard_rank==0 ? req->displs.data() : nullptr,
+                         datatype, 0, shard_comm, &req->mpi_req);
+        } else {
+            if (node_rank == 0) {
+                req->counts = plan.member_sizes;
+                req->displs = plan.member_displs;
+                req->node_total = plan.node_total;
+                req->node_buffer.resize(static_cast<size_t>(plan.node_total) * plan.elem_size);
+            }
+            MPI_Igatherv(local, size_local, datatype,
+                         node_rank==0 ? req->node_buffer.data() : nullptr,
+                         node_rank==0 ? req->counts.data() : nullptr,
+                         node_rank==0 ? req->displs.data() : nullptr,
+                         datatype, 0, node_comm, &req->mpi_req);
+        }
+    }
+
+    int id = next_request++;
+    requests[id] = req;
+    {
+        std::lock_guard<std::mutex> lock(progress_mutex);
+        in_flight.push_back(req);
+    }
+    progress_cv.notify_one();
+    int provided = MPI_THREAD_SINGLE;
+    MPI_Query_thread(&provided);
+    if (provided == MPI_THREAD_MULTIPLE) start_progress_thread();
+    return id;
+}
+
+// Advance the gathers of one request; true once it has been handed on.
+// Requests are advanced oldest first, so the leaders start their gathers
+// in the same order everywhere.
+bool SmartRedisMPI::advance_request(AsyncRequest &req, bool block) {
+    while (req.stage < 2) {
+        int flag = 1;
+        if (block) MPI_Wait(&req.mpi_req, MPI_STATUS_IGNORE);
+        else MPI_Test(&req.mpi_req, &flag, MPI_STATUS_IGNORE);
+        if (!flag) return false;
+
+        if (req.stage == 0 && req.hierarchical && node_rank == 0) {
+            const bool writer = shard_rank == 0;
+            unsigned char *dest = nullptr;
+            if (writer) dest = req.order.empty() ? req.buffer.data() : req.stage_buffer.data();
+            MPI_Igatherv(req.node_buffer.data(), req.node_total, req.datatype, dest,
+                         writer ? req.leader_counts.data() : nullptr,
+                         writer ? req.leader_displs.data() : nullptr,
+                         req.datatype, 0, async_leader_comm, &req.mpi_req);
+            req.stage = 1;
+            continue;
+        }
+        req.stage = 2;
+        try {
+            finish_request(req);
+        } catch (...) {
+            req.done.set_exception(std::current_exception());
+        }
+    }
+    return true;
+}
+
+// Gathered: the writer queues the write, the other ranks are done
+void SmartRedisMPI::finish_request(AsyncRequest &req) {
+    req.send_hold.reset();
+    std::vector<unsigned char>().swap(req.node_buffer);
+    if (shard_rank != 0) {
+        req.done.set_value();
+        return;
+    }
+
+    if (!req.order.empty()) {
+        const unsigned char *src = req.stage_buffer.data();
+        for (int r : req.order) {
+            const size_t n = static_cast<size_t>(req.sizes[r]) * req.elem_size;
+            std::memcpy(req.buffer.data() + static_cast<size_t>(req.rank_displs[r]) * req.elem_size, src, n);
+            src += n;
+        }
+        std::vector<unsigned char>().swap(req.stage_buffer);
+    }
+    IOJob job;
+    job.key = req.skey;
+    job.data = req.buffer.data();
+    job.count = req.count;
+    job.type = req.type;
+    job.name = req.key;
+    job.compress = req.compress;
+    job.compression = req.compression;
+    job.done = std::move(req.done);
+    // The progress thread is stopped before the I/O thread, which is running then
+    if (std::this_thread::get_id() != progress_thread.get_id()) start_io_thread();
+    {
+        std::lock_guard<std::mutex> lock(io_mutex);
+        io_queue.push_back(std::move(job));
+    }
+    io_cv.notify_one();
+}
+
+// Advance the oldest requests without blocking
+void SmartRedisMPI::progress_requests() {
+    for (;;) {
+        std::shared_ptr<AsyncRequest> req;
+        {
+            std::lock_guard<std::mutex> lock(progress_mutex);
+            if (in_flight.empty()) return;
+            req = in_flight.front();
+        }
+        if (!advance_request(*req, false)) return;
+        std::lock_guard<std::mutex> lock(progress_mutex);
+        in_flight.pop_front();
+    }
+}
+
+// Without a progress thread the calling thread does its work
+void SmartRedisMPI::poll_requests() {
+    if (!progress_thread.joinable() && !in_flight.empty()) progress_requests();
+}
+
+void SmartRedisMPI::start_progress_thread() {
+    if (progress_thread.joinable()) return;
+    progress_stop = false;
+    progress_thread = std::thread(&SmartRedisMPI::progress_loop, this);
+}
+
+void SmartRedisMPI::stop_progress_thread() {
+    if (!progress_thread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(progress_mutex);
+        progress_stop = true;
+    }
+    progress_cv.notify_all();
+    progress_thread.join();
+    progress_stop = false;
+}
+
+// Tests the oldest request with the writer's backoff between checks, so an
+// idle gather costs little while the caller computes
+void SmartRedisMPI::progress_loop() {
+    int sleep_us = wait_policy.short_sleep_us;
+    for (;;) {
+        std::shared_ptr<AsyncRequest> req;
+        {
+            std::unique_lock<std::mutex> lock(progress_mutex);
+            progress_cv.wait(lock, [this]{ return progress_stop || !in_flight.empty(); });
+            if (in_flight.empty()) return;  // stopping and drained
+            req = in_flight.front();
+        }
+        if (advance_request(*req, false)) {
+            std::lock_guard<std::mutex> lock(progress_mutex);
+            in_flight.pop_front();
+            sleep_us = wait_policy.short_sleep_us;
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(progress_mutex);
+        progress_cv.wait_for(lock, std::chrono::microseconds(sleep_us));
+        sleep_us = std::min(2 * sleep_us, 1000);
+    }
+}
+
+void SmartRedisMPI::complete_request(int request) {
+    auto it = requests.find(request);
+    std::shared_ptr<AsyncRequest> req = std::move(it->second);
+    requests.erase(it);
+    req->finished.wait();
+    if (!req->buffer.empty()) buffer_pool.push_back(std::move(req->buffer));
+    req->finished.get();  // rethrows gather and write errors
+}
+
+bool SmartRedisMPI::test(int request) {
+    auto it = requests.find(request);
+    if (it == requests.end()) throw std::invalid_argument("SmartRedisMPI: unknown request");
+    poll_requests();
+    if (it->second->finished.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+    complete_request(request);
+    return true;
+}
+
+// Only joins the request: the gathers were driven by the progress thread,
+// or are finished here oldest first
+void SmartRedisMPI::wait(int request) {
+    auto it = requests.find(request);
+    if (it == requests.end()) throw std::invalid_argument("SmartRedisMPI: unknown request");
+    if (!progress_thread.joinable()) {
+        while (it->second->stage < 2) {
+            advance_request(*in_flight.front(), true);
+            in_flight.pop_front();
+        }
+    } else {
+        progress_cv.notify_one();
+    }
+    complete_request(request);
+}
+
+void SmartRedisMPI::waitall() {
+    // Oldest first so every rank completes the gathers in the same order
+    std::vector<int> ids;
+    ids.reserve(requests.size());
+    for (auto &kv : requests) ids.push_back(kv.first);
+    std::sort(ids.begin(), ids.end());
+    std::exception_ptr error;
+    for (int id : ids) {
+        try {
+            wait(id);
+        } catch (...) {
+            if (!error) error = std::current_exception();
+        }
+    }
+    if (error) std::rethrow_exception(error);
+}
+
+// === Background I/O thread (writers only) ===
+
+void SmartRedisMPI::start_io_thread() {
+    if (io_thread.joinable()) return;
+    if (!io_client) io_client = open_transport();
+    io_stop = false;
+    io_thread = std::thread(&SmartRedisMPI::io_loop, this);
+}
+
+void SmartRedisMPI::stop_io_thread() {
+    stop_progress_thread();
+    if (io_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(io_mutex);
+            io_stop = true;
+        }
+        io_cv.notify_all();
+        io_thread.join();
+    }
+    delete io_client;
+    io_client = nullptr;
+}
+
+void SmartRedisMPI::io_loop() {
+    std::vector<unsigned char> frame, scratch;
+    for (;;) {
+        IOJob job;
+        {
+            std::unique_lock<std::mutex> lock(io_mutex);
+            io_cv.wait(lock, [this]{ return io_stop || !io_queue.empty(); });
+            if (io_queue.empty()) return;  // stopping and drained
+            job = std::move(io_queue.front());
+            io_queue.pop_front();
+        }
+        try {
+            if (!job.tensors.empty())
+                io_client->put_group(job.key, job.tensors, job.meta);
+            else
+                store_tensor(io_client, job.name, job.key, job.data, {job.count}, job.type, SRMemLayoutContiguous,
+                             job.compress ? &job.compression : nullptr, frame, scratch);
+            job.done.set_value();
+        } catch (...) {
+            job.done.set_exception(std::current_exception());
+        }
+    }
 }
@@ -3,32 +3,770 @@
 
 #include <vector>
 #include <string>
+#include <unordered_map>
+#include <map>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <exception>
 #include <mpi.h>
 #include "client.h"
+#include "SmartRedisMPI_Precision.h"
+#include "SmartRedisMPI_Compression.h"
+#include "SmartRedisMPI_Stats.h"
+#include "SmartRedisMPI_Transport.h"
+#include "SmartRedisMPI_Record.h"
+#include "SmartRedisMPI_Policy.h"
+
+// MPI-4 persistent collectives are opt-in (-DSRMPI_PERSISTENT_COLLECTIVES)
+#if defined(SRMPI_PERSISTENT_COLLECTIVES) && MPI_VERSION >= 4
+#define SRMPI_USE_PERSISTENT 1
+#else
+#define SRMPI_USE_PERSISTENT 0
+#endif
+
+// Element types of the typed tensor calls: SRTensorType and MPI datatype of T
+template <typename T> struct TensorTraits;
+template <> struct TensorTraits<double> {
+    static constexpr SRTensorType type = SRTensorTypeDouble;
+    static MPI_Datatype mpi_type() { return MPI_DOUBLE; }
+};
+template <> struct TensorTraits<float> {
+    static constexpr SRTensorType type = SRTensorTypeFloat;
+    static MPI_Datatype mpi_type() { return MPI_FLOAT; }
+};
+template <> struct TensorTraits<int8_t> {
+    static constexpr SRTensorType type = SRTensorTypeInt8;
+    static MPI_Datatype mpi_type() { return MPI_INT8_T; }
+};
+template <> struct TensorTraits<int16_t> {
+    static constexpr SRTensorType type = SRTensorTypeInt16;
+    static MPI_Datatype mpi_type() { return MPI_INT16_T; }
+};
+template <> struct TensorTraits<int32_t> {
+    static constexpr SRTensorType type = SRTensorTypeInt32;
+    static MPI_Datatype mpi_type() { return MPI_INT32_T; }
+};
+template <> struct TensorTraits<int64_t> {
+    static constexpr SRTensorType type = SRTensorTypeInt64;
+    static MPI_Datatype mpi_type() { return MPI_INT64_T; }
+};
+template <> struct TensorTraits<uint8_t> {
+    static constexpr SRTensorType type = SRTensorTypeUint8;
+    static MPI_Datatype mpi_type() { return MPI_UINT8_T; }
+};
+template <> struct TensorTraits<uint16_t> {
+    static constexpr SRTensorType type = SRTensorTypeUint16;
+    static MPI_Datatype mpi_type() { return MPI_UINT16_T; }
+};
+
+// Cached gather/scatter layout of one key within a shard. Built on the
+// first exchange of the key and reused until invalidated, so steady-state
+// calls skip the size gather and all root-side allocations.
+struct ExchangePlan {
+    int local_size = 0;
+    int total_size = 0;
+    MPI_Datatype datatype = MPI_DATATYPE_NULL;
+    int elem_size = 0;
+    std::vector<unsigned char> wire_buffer; // local values in reduced precision
+    std::vector<int> sizes;                 // writer only
+    std::vector<int> displs;                // writer only
+    std::vector<unsigned char> root_buffer; // writer only, total_size elements
+
+    // Fused step plans: each rank sends [state | reward]; the writer
+    // regroups them into [all states | all rewards] in pack_buffer
+    int local_split = 0;
+    int total_split = 0;
+    std::vector<int> splits;                // writer only, per-rank state length
+    std::vector<int> split_displs;          // writer only, state offsets in pack_buffer
+    std::vector<int> reward_sizes;          // writer only
+    std::vector<int> reward_displs;         // writer only, offsets after the states
+    std::vector<unsigned char> pack_buffer; // writer only
+
+    // Field plans (put_fields): each point carries n_features values that the
+    // datatypes pick from the caller's arrays and place in the global layout
+    int n_features = 0;
+    SRMemoryLayout layout = SRMemLayoutContiguous;
+    MPI_Datatype recv_type = MPI_DATATYPE_NULL; // writer only
+    MPI_Datatype send_type = MPI_DATATYPE_NULL;
+    std::vector<MPI_Aint> send_addrs;
+    size_t send_stride = 0;
+
+    // Batch plans (put_states/get_actions): a rank's block holds every key's
+    // values back to back in the key's wire precision, so the plan counts
+    // bytes (datatype MPI_BYTE); the writer regroups them per key in pack_buffer
+    std::vector<int> key_counts;            // local values per key
+    std::vector<int> key_elems;             // wire element size per key
+    std::vector<int> key_totals;            // writer only, values per key in the shard
+    std::vector<int> rank_counts;           // writer only, [shard_nprocs][n_keys] values
+
+    // Sparse plans: sizes/displs hold the dense layout, which places this
+    // rank's entries at dense_offset in the shard. Per call each rank sends
+    // [int32 shard positions | values] of its selected entries
+    int dense_offset = 0;
+    std::vector<int> sparse_index;          // selected local entries
+    std::vector<double> sparse_values;      // their values, before the wire conversion
+    std::vector<double> last_sent;          // put_state_delta: value as last sent, NaN before
+    std::vector<int> sparse_counts;         // writer only, bytes per rank of the last call
+    std::vector<int> sparse_displs;         // writer only
+
+    // Hierarchical plans (COLLECTIVE_HIERARCHICAL): the ranks of a node write
+    // their blocks into one of two alternating halves of a shared window on
+    // the node leader, and only the leaders join the gather (scatter mirrored)
+    MPI_Win node_win = MPI_WIN_NULL;
+    unsigned char *node_buffer = nullptr;   // both halves, node_total elements each
+    int node_total = 0;
+    size_t node_offset = 0;                 // this rank's block in a half, bytes
+    int node_parity = 0;
+    std::vector<int> node_sizes;            // writer only, per node leader
+    std::vector<int> node_displs;           // writer only
+    std::vector<int> node_order;            // writer only, shard ranks in arrival order; empty if in order
+    std::vector<unsigned char> node_stage;  // writer only, arrivals to reorder
+    std::vector<int> member_sizes;          // node leaders only, per node rank (iput_*)
+    std::vector<int> member_displs;         // node leaders only
+#if SRMPI_USE_PERSISTENT
+    std::vector<unsigned char> local_buffer;
+    MPI_Request gather_req = MPI_REQUEST_NULL;
+    MPI_Request scatter_req = MPI_REQUEST_NULL;
+#endif
+};
+
+// Per-key compression (set_compression): tensors of at least
+// threshold_bytes are stored as frames encoded with codec
+struct CompressionSettings {
+    int codec = CODEC_NONE;
+    size_t threshold_bytes = 0;
+};
+
+// Redis write handed to the background I/O thread of a writer rank
+struct IOJob {
+    std::string key;
+    const void *data = nullptr;
+    size_t count = 0;
+    SRTensorType type = SRTensorTypeDouble;
+    std::string name;                  // settings key of a tensor
+    bool compress = false;             // frame it with compression, as write_tensor does
+    CompressionSettings compression;
+    std::vector<GroupTensor> tensors;  // non-empty: put_group(key, tensors, meta) instead
+    std::vector<GroupMeta> meta;
+    std::promise<void> done;
+};
+
+// Trajectory buffer of one key (open_trajectory). Steps are appended
+// locally in wire format; a flush swaps in the second buffer and gathers
+// the first, so with async the next steps fill while it is in flight.
+// A rank's block is [k, n_features, n_points] state values, then
+// [k, n_reward] float64 rewards.
+struct Trajectory {
+    std::string store;                      // shard key of the group
+    size_t n_steps = 0;
+    size_t n_features = 0;
+    size_t n_points = 0;                    // local
+    size_t n_reward = 0;                    // local, per step
+    int precision = WIRE_FLOAT64;
+    size_t elem = 0;                        // wire bytes per state value
+    bool async = false;
+    size_t filled = 0;
+    int64_t next_step = 0;                  // running index of the next appended step
+    std::vector<unsigned char> buffer;      // n_steps steps
+    std::vector<int32_t> step_types;
+    std::vector<int64_t> steps;
+
+    // Flush in flight
+    std::vector<unsigned char> sending;
+    std::vector<int32_t> sent_types;
+    std::vector<int64_t> sent_steps;
+    size_t sent_count = 0;
+    MPI_Request req = MPI_REQUEST_NULL;
+
+    std::vector<int> points;                // writer only, per rank
+    std::vector<int> rewards;               // writer only, per rank
+    size_t total_points = 0;                // writer only
+    size_t total_reward = 0;                // writer only
+    std::vector<int> counts;                // writer only, bytes per rank of the flush
+    std::vector<int> displs;                // writer only
+    std::vector<unsigned char> gathered;    // writer only
+    std::vector<unsigned char> packed;      // writer only, [state | reward] of the group
+    std::future<void> written;              // writer only, async write
+};
+
+// Local policy of an action key (set_local_policy)
+struct LocalPolicy {
+    std::string state_key;
+    std::string weights_key;
+    int refresh_steps = 1;
+    int calls = 0;                  // evaluations since the last refresh
+    int version = -1;               // of the weights in mlp, -1 before any
+    MLPPolicy mlp;
+    std::vector<float> state;       // last local state put under state_key
+    std::vector<float> params;      // weights being loaded
+};
+
+// One in-flight iput_*: the gather to the writer (hierarchical: to the node
+// leader, then from the leaders) and, on writers, the queued write. Stage 0
+// is the first gather, 1 the leaders' one, 2 gathered.
+struct AsyncRequest {
+    int stage = 0;
+    bool hierarchical = false;
+    MPI_Request mpi_req = MPI_REQUEST_NULL;
+    std::shared_ptr<void> send_hold;        // local data in wire format, until gathered
+    MPI_Datatype datatype = MPI_DATATYPE_NULL;
+    size_t elem_size = 0;
+    std::vector<int> counts;                // root of the first gather, per member
+    std::vector<int> displs;
+    std::vector<unsigned char> node_buffer; // node leaders, hierarchical: the node's block
+    int node_total = 0;
+    std::string key;                        // writer only, settings key
+    std::string skey;                       // writer only, stored name
+    SRTensorType type = SRTensorTypeDouble;
+    size_t count = 0;
+    bool compress = false;                  // writer only, key settings at the call
+    CompressionSettings compression;
+    std::vector<int> leader_counts;         // writer only, hierarchical, per node leader
+    std::vector<int> leader_displs;
+    std::vector<int> order;                 // writer only, node_order of the plan
+    std::vector<int> sizes;                 // writer only, per shard rank
+    std::vector<int> rank_displs;
+    std::vector<unsigned char> stage_buffer;// writer only, arrivals to reorder
+    std::vector<unsigned char> buffer;      // writer only, the gathered tensor
+    std::promise<void> done;                // gathered, and on writers written
+    std::future<void> finished;
+};
+
+// Adaptive backoff used by writers while waiting for an action: first
+// `spin_checks` back-to-back existence checks, then `short_polls` checks
+// `short_sleep_us` apart, then sleeps doubling up to `max_sleep_us`.
+struct WaitPolicy {
+    int spin_checks = 10;
+    int short_sleep_us = 50;
+    int short_polls = 200;
+    int max_sleep_us = 10000;
+};
+
+// Key registered with register_key. The stored and shard names are kept
+// here, so a call by id builds no strings; a per-step key is reformatted
+// (reusing the buffers) only when the step changes.
+struct KeyHandle {
+    std::string name;              // plans, settings and stats are attached to it
+    bool per_step = false;
+    bool resolved = false;         // store/shard_store valid for step and the shard layout
+    long long step = 0;
+    std::string store;             // name, or <name>.<step>
+    std::string shard_store;       // store with the shard suffix of this writer
+    ExchangePlan *plan = nullptr;  // entry of plans, reset when plans are invalidated
+
+    // Step-versioned ring (register_ring_key)
+    int ring = 0;                            // steps kept, 0 = no ring
+    std::map<long long, std::string> live;   // writer only, step -> stored name, until deleted
+    std::string slot_store;                  // shard name of another step (get_action_step)
+};
+
+// Compression counters of one key, accumulated on writers
+struct CompressionStats {
+    size_t calls = 0;           // frames encoded or decoded
+    size_t raw_bytes = 0;
+    size_t stored_bytes = 0;    // frame bytes written or read
+    double encode_seconds = 0.0;
+    double decode_seconds = 0.0;
+    double last_ratio = 1.0;
+    double last_encode_seconds = 0.0;
+    double ratio() const { return stored_bytes ? static_cast<double>(raw_bytes) / stored_bytes : 1.0; }
+};
 
 class SmartRedisMPI {
 public:
-    SmartRedisMPI(bool clustered=false, MPI_Comm comm=MPI_COMM_WORLD);
+    // Which ranks own a client and write a shard of every tensor
+    enum WriterMode {
+        WRITER_ROOT = 0,   // rank 0 only, tensors keep their plain key
+        WRITER_NODE = 1,   // one writer per shared-memory node
+        WRITER_STRIDE = 2  // one writer every `stride` ranks
+    };
+
+    // How gathers to and scatters from each writer travel
+    enum CollectiveMode {
+        COLLECTIVE_FLAT = 0,          // one Gatherv / Scatterv over the shard
+        COLLECTIVE_HIERARCHICAL = 1   // node-local shared windows, then node leaders only
+    };
+
+    // transport is a TransportKind; -1 takes SRMPI_TRANSPORT (default SmartRedis)
+    SmartRedisMPI(bool clustered=false, MPI_Comm comm=MPI_COMM_WORLD, int transport=-1);
     ~SmartRedisMPI();
 
-    void init_smartredis_mpi(bool clustered=false, MPI_Comm comm=MPI_COMM_WORLD);
+    // Collective on comm, which is duplicated: instances on disjoint (or the
+    // same) communicators exchange independently, each with its own writer.
+    // A transport other than the current one replaces the writers' connections;
+    // -1 keeps the current one
+    void init_smartredis_mpi(bool clustered=false, MPI_Comm comm=MPI_COMM_WORLD, int transport=-1);
     void finalize_smartredis_mpi();
 
     void put_step_type(const std::string &key, int step_type);
     void put_state(const std::string &key, const std::vector<double> &state);
     void put_reward(const std::string &key, const std::vector<double> &reward);
     void get_action(const std::string &key, std::vector<double> &action);
+    // Blocking get_action: writers poll until the action exists; false on all
+    // ranks (action untouched) if it did not appear within timeout seconds
+    bool wait_action(const std::string &key, std::vector<double> &action, double timeout=-1.0);
     void put_info(const std::string &key, const std::vector<int> &info);
     void put_real_scalar(const std::string &key, const double &rscalar);
 
+    // Whole DRL step in one store write and one action read: state and
+    // reward go out as DataSet <tag>.step (tensors "state"/"reward" in the
+    // wire precision of <tag>.step, metadata "step_type" and "scalars"), then
+    // the action <tag>.action is awaited like wait_action and scattered;
+    // false on all ranks (action untouched) if it did not appear within
+    // timeout seconds (< 0: no limit). With TRANSPORT_SHM the DataSet
+    // becomes tensors <tag>.step.<name> followed by the marker <tag>.step.
+    bool step_exchange(const std::string &tag, const std::vector<double> &state,
+                       const std::vector<double> &reward, int step_type,
+                       std::vector<double> &action,
+                       const std::vector<double> &scalars = std::vector<double>(), double timeout=-1.0);
+
+    // N-D state: local_dims is the rank's shape, distributed over its first
+    // dimension for SRMemLayoutContiguous or its last for
+    // SRMemLayoutFortranContiguous; that dimension is summed over ranks
+    void put_state_nd(const std::string &key, const double *state,
+                      const std::vector<size_t> &local_dims, SRMemoryLayout layout);
+    // Structure-of-arrays state: n_features arrays of n_points values (element
+    // i of field f at fields[f][i*stride]) packed during the gather into one
+    // [n_features, n_points_global] tensor, in either memory layout. Keys
+    // with a narrower wire precision, or in hierarchical mode, are packed
+    // into a staging array first
+    void put_fields(const std::string &key, const std::vector<const double*> &fields,
+                    size_t n_points, SRMemoryLayout layout=SRMemLayoutContiguous,
+                    size_t stride=1);
+
+    // Several keys (e.g. one per environment) in one exchange: a single gather
+    // carries every key's local values, each in its own wire precision, and
+    // the writer stores them back to back as separate tensors. get_actions
+    // reads every key, then scatters them together. Keys are the same on all
+    // ranks; invalidate_plans() drops the cached batch layouts.
+    void put_states(const std::vector<std::string> &keys, const std::vector<const double*> &states,
+                    const std::vector<size_t> &sizes);
+    void put_states(const std::vector<std::string> &keys, const std::vector<std::vector<double>> &states);
+    // keys.size() blocks of n values each
+    void put_states(const std::vector<std::string> &keys, const double *states, size_t n);
+    void get_actions(const std::vector<std::string> &keys, const std::vector<double*> &actions,
+                     const std::vector<size_t> &sizes);
+    void get_actions(const std::vector<std::string> &keys, std::vector<std::vector<double>> &actions);
+    void get_actions(const std::vector<std::string> &keys, double *actions, size_t n);
+    // Blocking get_actions: false on all ranks if any action did not appear within timeout seconds;
+    // without a timeout only the writers wait, as in wait_action
+    bool wait_actions(const std::vector<std::string> &keys, const std::vector<double*> &actions,
+                      const std::vector<size_t> &sizes, double timeout=-1.0);
+
+    // Sparse states: only the selected local entries (0-based) travel, with
+    // their positions in the shard's dense state. The writer stores group
+    // <key> (DataSet, or tensors <key>.<name> then the marker with
+    // TRANSPORT_SHM): tensors "indices" (int32) and "values" (wire
+    // precision), left out when nothing is selected, and metadata "size",
+    // the dense length. Each rank's dense length n is fixed per key, like
+    // an exchange plan. put_state_delta selects the entries that moved by
+    // more than threshold since they were last sent (all on the first call).
+    void put_state_sparse(const std::string &key, const double *state, size_t n,
+                          const int *indices, size_t n_indices);
+    void put_state_masked(const std::string &key, const double *state, size_t n, const int *mask);
+    void put_state_delta(const std::string &key, const double *state, size_t n, double threshold);
+    // Sparse actions mirror the states: the agent writes group <key> with
+    // tensors "indices" (int32 positions in the shard's dense action) and
+    // "values" (the key's wire precision), both left out for no entries;
+    // only those entries are scattered, the rest of action is left as it was
+    void get_action_sparse(const std::string &key, double *action, size_t n);
+    bool wait_action_sparse(const std::string &key, double *action, size_t n, double timeout=-1.0);
+
+    // Trajectory buffering for off-policy training: append_step copies one
+    // step (local state [n_features, n_points], n_reward rewards) into a
+    // per-rank buffer without communicating. When n_steps are buffered, one
+    // gather sends them all and the writer stores group <key> with tensors
+    // "state" [k, n_features, n_points_global] in the key's wire precision,
+    // "reward" [k, n_reward_global] (omitted if empty), "step_type" (int32)
+    // and "step" (int64, running index since open), k <= n_steps. With async
+    // the gather is non-blocking while the next steps fill the second
+    // buffer, and writers put the group from the I/O thread. open, flush and
+    // close are collective, and all ranks append the same steps. Trajectories
+    // always use the flat gather; finalize closes any still open.
+    void open_trajectory(const std::string &key, size_t n_steps, size_t n_features, size_t n_points,
+                         size_t n_reward=1, bool async=false);
+    void append_step(const std::string &key, const double *state, size_t n_state,
+                     const double *reward, size_t n_reward, int step_type);
+    void append_step(const std::string &key, const std::vector<double> &state,
+                     const std::vector<double> &reward, int step_type);
+    // Send the steps buffered so far (asynchronously with async)
+    void flush_trajectory(const std::string &key);
+    // Flush, wait until the group is written and free the buffers
+    void close_trajectory(const std::string &key);
+
+    // Pre-registered keys: register_key returns an id (> 0) accepted by the
+    // calls below instead of a name. With per_step, the key is stored as
+    // <name>.<step> for the step set with set_step; plans, wire precision,
+    // compression and stats stay attached to <name>. Registering is local
+    // and idempotent; ids name the same key on every rank only if all ranks
+    // register in the same order. With set_threads, keys registered on the
+    // instance (before or after set_threads) get the same id on every lane,
+    // and set_step on the instance moves every lane; make both calls
+    // outside parallel regions, not on a lane.
+    int register_key(const std::string &name, bool per_step=false);
+    void set_step(long long step);
+    long long get_step() const { return current_step; }
+    // Step-versioned ring: a per-step key of which only the steps
+    // (current - slots, current] are kept, so the agent can write the action
+    // of step n+1 while the solver reads that of step n. Writers remember the
+    // slots they put, and those of timed-out waits (the agent may still
+    // write them); a successful read already deleted its slot. In set_step
+    // they delete the slots that left the window, waiting until a key has
+    // `slots` expired ones and then taking every key due in one batch: a
+    // writer tracks, and the store holds, at most 2 * slots steps of a key.
+    // Registering a per-step key again sets its slots.
+    int register_ring_key(const std::string &name, int slots);
+    // Action of a given step of a per-step key; within the ring's window
+    // when the key has one (std::out_of_range otherwise)
+    void get_action_step(int id, long long step, double *action, size_t n);
+    bool wait_action_step(int id, long long step, double *action, size_t n, double timeout=-1.0);
+    // Name stored for the key at the current step
+    const std::string &key_name(int id);
+    void put_state(int id, const double *state, size_t n);
+    void put_reward(int id, const double *reward, size_t n);
+    void put_info(int id, const int *info, size_t n);
+    void get_action(int id, double *action, size_t n);
+    bool wait_action(int id, double *action, size_t n, double timeout=-1.0);
+    void put_step_type(int id, int step_type);
+    void put_real_scalar(int id, double rscalar);
+
+    // Typed tensors: gathered, stored and scattered in their own element
+    // type (no wire precision conversion; compression applies), with T one
+    // of the TensorTraits types. put_state / put_info are the double and
+    // int32 cases with wire precision and stats of their own.
+    template <typename T>
+    void put_tensor(const std::string &key, const T *data, size_t n) {
+        put_native(key, data, n, TensorTraits<T>::type, TensorTraits<T>::mpi_type(), OP_PUT_TENSOR);
+    }
+    template <typename T>
+    void put_tensor(const std::string &key, const std::vector<T> &data) {
+        put_tensor(key, data.data(), data.size());
+    }
+    template <typename T>
+    void get_tensor(const std::string &key, T *data, size_t n) {
+        receive_native(key, data, n, TensorTraits<T>::type, TensorTraits<T>::mpi_type(), false, -1.0);
+    }
+    template <typename T>
+    void get_tensor(const std::string &key, std::vector<T> &data) {
+        get_tensor(key, data.data(), data.size());
+    }
+    // Blocking get_tensor; false on all ranks if the tensor did not appear within timeout seconds
+    template <typename T>
+    bool wait_tensor(const std::string &key, T *data, size_t n, double timeout=-1.0) {
+        return receive_native(key, data, n, TensorTraits<T>::type, TensorTraits<T>::mpi_type(), true, timeout);
+    }
+    // Element type chosen at run time (C / Fortran / Python bindings)
+    void put_tensor(const std::string &key, const void *data, size_t n, SRTensorType type);
+    void get_tensor(const std::string &key, void *data, size_t n, SRTensorType type);
+    bool wait_tensor(const std::string &key, void *data, size_t n, SRTensorType type, double timeout=-1.0);
+
+    // Pointer + length forms: gathered straight from, and scattered straight
+    // into, the caller's memory; the writer side reuses the plan buffers
+    void put_state(const std::string &key, const double *state, size_t n);
+    void put_reward(const std::string &key, const double *reward, size_t n);
+    void get_action(const std::string &key, double *action, size_t n);
+    bool wait_action(const std::string &key, double *action, size_t n, double timeout=-1.0);
+    void put_info(const std::string &key, const int *info, size_t n);
+    bool step_exchange(const std::string &tag, const double *state, size_t n_state,
+                       const double *reward, size_t n_reward, int step_type,
+                       double *action, size_t n_action,
+                       const double *scalars=nullptr, size_t n_scalars=0, double timeout=-1.0);
+
+    // States and actions in the caller's element type (SRTensorTypeDouble,
+    // Float, Int32 or Int64), e.g. a solver's own field arrays: converted
+    // from and to the key's wire precision during the exchange, without a
+    // staging copy by the caller. Float arrays of WIRE_FLOAT32 keys travel
+    // untouched; integer actions are rounded to nearest.
+    void put_state(const std::string &key, const void *state, size_t n, SRTensorType type);
+    void put_state_nd(const std::string &key, const void *state, SRTensorType type,
+                      const std::vector<size_t> &local_dims, SRMemoryLayout layout);
+    void get_action(const std::string &key, void *action, size_t n, SRTensorType type);
+    bool wait_action(const std::string &key, void *action, size_t n, SRTensorType type, double timeout=-1.0);
+
+    // Local policy: get_action / wait_action of action_key are answered in
+    // process by an MLP (SmartRedisMPI_Policy.h) run on the last state this
+    // rank put under state_key, n_inputs() values per point, instead of a
+    // round-trip to the agent. On the first and then every refresh_steps-th
+    // call the writers check <weights_key>.meta and, if its version changed,
+    // load the weights and broadcast them over their shard. Until weights
+    // are published the action is read from the store as usual. States are
+    // still put as before (iput_state keeps the upload asynchronous) for
+    // the agent to train on. Collective; an empty weights_key removes the
+    // policy. Id-based reads use it for the current step only.
+    void set_local_policy(const std::string &action_key, const std::string &state_key,
+                          const std::string &weights_key, int refresh_steps=1);
+    // Version of the weights in use for action_key, -1 before any
+    int get_policy_version(const std::string &action_key) const;
+
+    // Non-blocking puts: start the gather and return a request id. The data
+    // is owned by the request (packed to the key's wire precision), and the
+    // write goes through the key's compression like put_state. With
+    // MPI_THREAD_MULTIPLE a progress thread drives the gather and hands the
+    // write to the I/O thread as soon as it lands, so both overlap the
+    // caller's compute; otherwise requests advance in every iput, test,
+    // wait and blocking exchange of the instance. Complete with
+    // test/wait/waitall on all ranks, in the same order.
+    int iput_state(const std::string &key, std::vector<double> state);
+    int iput_reward(const std::string &key, std::vector<double> reward);
+    int iput_info(const std::string &key, std::vector<int> info);
+    bool test(int request);
+    void wait(int request);
+    void waitall();
+
+    // Per-key wire precision (WirePrecision) for put_state/put_reward/
+    // put_state_nd and get_action/wait_action/step_exchange actions; values
+    // are converted on every rank before the gather and after the scatter
+    void set_wire_precision(const std::string &key, int precision);
+    int get_wire_precision(const std::string &key) const;
+
+    // Per-key lossless compression (CompressionCodec). On writers, states of
+    // at least threshold_bytes go to Redis as uint8 frames; actions of the key
+    // are expected as a DataSet <key> holding the frame as tensor "frame"
+    // (a plain uint8 tensor <key> with TRANSPORT_SHM)
+    void set_compression(const std::string &key, int codec, size_t threshold_bytes=0);
+    CompressionStats get_compression_stats(const std::string &key) const;
+
+    // Per-operation, per-key counters (StatOp / StatPhase). Off by default;
+    // trace additionally records a timeline (collective when it turns on)
+    void enable_stats(bool enabled, bool trace=false);
+    OpStats get_stats(int op, const std::string &key) const;
+    void reset_stats();
+    // Collective: rank 0 writes the table, with MPI time spread over ranks,
+    // to path (stdout if empty)
+    void dump_stats(const std::string &path="") const;
+    // Per rank: <prefix>.<rank>.json, loadable in chrome://tracing / Perfetto
+    void dump_trace(const std::string &prefix) const;
+
+    // Drop cached exchange plans; call on all ranks when the decomposition
+    // changes. A rank whose local size changed without it throws, but the
+    // other ranks of its shard are left waiting in the gather (they hang);
+    // with stats enabled the size check is collective and all ranks throw
+    void invalidate_plan(const std::string &key);
+    void invalidate_plans();
+
+    // Collective: regroup ranks into shards, each pushed by its own writer
+    void set_writer_mode(int mode, int stride=0);
+    // Collective: CollectiveMode of every later exchange (plans are rebuilt);
+    // the default comes from SRMPI_COLLECTIVE (flat or hierarchical)
+    void set_collective_mode(int mode);
+    int get_collective_mode() const { return collective_mode; }
+
     int get_rank() const { return myid; }
     int get_nprocs() const { return nprocs; }
+    void set_wait_policy(const WaitPolicy &policy);
+    const WaitPolicy &get_wait_policy() const { return wait_policy; }
+    // Seconds writers spent waiting on actions (total and last call)
+    double get_action_wait_time() const { return action_wait_total; }
+    double get_last_action_wait() const { return action_wait_last; }
+
+    int get_transport() const { return transport_kind; }
+
+    // Hybrid MPI + threads. set_threads(n) (collective) gives each of n
+    // threads its own lane: an instance with a private duplicate of the
+    // communicator and, on writers, its own transport connection, so threads
+    // exchange distinct keys concurrently. Thread t of every rank must make
+    // the same calls in the same order on its lane, as one rank would.
+    // Exchanges go through for_thread() (the C, Fortran and Python bindings
+    // do this for every exchange call); settings (writer and collective
+    // mode, wire precision, compression, wait policy, stats, step, record
+    // and replay logs, registered keys) apply to all lanes and are made outside parallel
+    // regions. Stats are summed over lanes. Needs MPI_THREAD_MULTIPLE;
+    // set_threads(1) returns to a single lane.
+    void set_threads(int n_threads);
+    int get_threads() const { return lanes.empty() ? 1 : static_cast<int>(lanes.size()); }
+    // Lane of the calling thread: the one given to bind_thread, else its
+    // OpenMP thread number (0 outside parallel regions or without OpenMP);
+    // *this without lanes
+    SmartRedisMPI &for_thread();
+    // Per thread, e.g. for std::thread or Python threads; -1 unbinds
+    static void bind_thread(int lane);
+    // MPI_Init_thread asking for MPI_THREAD_MULTIPLE, unless MPI is already
+    // initialized; returns the provided thread level
+    static int init_mpi_threads(int *argc=nullptr, char ***argv=nullptr);
+    // Record mode: every writer appends what it puts and reads to the log
+    // <prefix>.<rank>.srlog (layout in SmartRedisMPI_Record.h), starting a
+    // new log; "" stops recording. Call on all ranks; default SRMPI_RECORD
+    void set_record_log(const std::string &prefix);
+    // Log prefix TRANSPORT_REPLAY serves actions from (same naming, same
+    // writer layout as the recorded run); default SRMPI_REPLAY. Without one
+    // the replay transport has nothing to serve
+    void set_replay_log(const std::string &prefix);
+    int get_shard_id() const { return shard_id; }
+    int get_num_shards() const { return n_shards; }
 
 private:
+    // Lanes: no transport until init_smartredis_mpi
+    SmartRedisMPI(bool clustered, MPI_Comm comm, int transport, bool connect);
+    void close_lanes();
+    ExchangeStats lane_stats() const;
+
+    ExchangePlan &get_plan(const std::string &key, int size_local, MPI_Datatype datatype);
+    ExchangePlan &get_step_plan(const std::string &key, int n_state, int n_reward, MPI_Datatype datatype);
+    void step_buffers(ExchangePlan &plan);
+    ExchangePlan &get_sparse_plan(const std::string &key, int size_local);
+    void send_sparse(const std::string &key, ExchangePlan &plan, const double *state);
+    bool receive_sparse(const std::string &key, double *action, size_t n, bool wait, double timeout);
+    ExchangePlan &get_batch_plan(const std::vector<std::string> &keys, const std::vector<size_t> &sizes,
+                                 std::vector<int> &precisions);
+    void free_plan(ExchangePlan &plan);
+    void free_field_types(ExchangePlan &plan);
+    bool agree_plan_changed(bool changed);
+    void gather_to_root(ExchangePlan &plan, const void *local);
+    void scatter_from_root(ExchangePlan &plan, void *local);
+    void build_node_comms();
+    void free_node_comms();
+    void setup_node_plan(ExchangePlan &plan);
+    void gather_hierarchical(ExchangePlan &plan, const void *local);
+    void scatter_hierarchical(ExchangePlan &plan, void *local);
+    void put_manifest(const std::string &key, const std::vector<int> &lengths);
+    KeyHandle &key_handle(int id);
+    void format_key(const KeyHandle &handle, long long step, bool sharded, std::string &out) const;
+    void keep_slot(KeyHandle &handle, long long step, const std::string &stored);
+    void collect_slots();
+    bool receive_action_step(int id, long long step, double *action, size_t n, bool wait, double timeout);
+    ExchangePlan &key_plan(KeyHandle &handle, int size_local, MPI_Datatype datatype);
+    bool fetch_action(const std::string &key, const std::string &skey, ExchangePlan &plan, void *action,
+                      bool wait, double timeout, SRTensorType type=SRTensorTypeDouble);
+    bool receive_action(const std::string &key, double *action, size_t n, bool wait, double timeout);
+    void put_native(const std::string &key, const void *data, size_t n, SRTensorType type,
+                    MPI_Datatype datatype, int op_id);
+    bool receive_native(const std::string &key, void *data, size_t n, SRTensorType type,
+                        MPI_Datatype datatype, bool wait, double timeout);
+    bool receive_action(const std::string &key, const std::string &skey, ExchangePlan &plan, int precision,
+                        double *action, size_t n, bool wait, double timeout);
+    bool receive_actions(const std::vector<std::string> &keys, const std::vector<double*> &actions,
+                         const std::vector<size_t> &sizes, bool wait, double timeout);
+    void read_action(const std::string &key, const std::string &skey, void *data, size_t count, SRTensorType type);
+    bool agree_ready(int ready, std::exception_ptr failure = nullptr);
+    void agree_status(std::exception_ptr failure, bool idle=false);
+    void wait_idle(MPI_Request &req);
+    ExchangePlan &gather_state(const std::string &key, const double *state, size_t n, SRTensorType &type);
+    ExchangePlan &gather_state(const std::string &key, const void *state, size_t n, SRTensorType src,
+                               SRTensorType &type);
+    bool receive_typed_action(const std::string &key, void *action, size_t n, SRTensorType type, bool wait,
+                              double timeout);
+    void gather_wire(ExchangePlan &plan, const double *state, size_t n, int precision);
+    void put_fields_packed(const std::string &key, const std::vector<const double*> &fields, size_t n_points,
+                           SRMemoryLayout layout, size_t stride, int precision);
+    void keep_policy_state(const std::string &key, const void *state, size_t n, SRTensorType type);
+    bool local_action(const std::string &key, double *action, size_t n);
+    void refresh_policy(const std::string &key, LocalPolicy &policy);
+    bool poll_action(const std::string &key, double timeout, bool frame=false);
+    bool compressed(const std::string &key) const;
+    void write_tensor(const std::string &key, const std::string &skey, const void *data, const std::vector<size_t> &dims,
+                      SRTensorType type, SRMemoryLayout layout);
+    void store_tensor(Transport *to, const std::string &key, const std::string &skey, const void *data,
+                      const std::vector<size_t> &dims, SRTensorType type, SRMemoryLayout layout,
+                      const CompressionSettings *settings, std::vector<unsigned char> &frame,
+                      std::vector<unsigned char> &scratch);
+    void read_frame(const std::string &key, const std::string &skey, void *data, size_t bytes);
+    std::string shard_key(const std::string &key) const;
+    void free_writer_comms();
+    void release_comm();
+    Transport *open_transport();
+    void reopen_transport();
+
+    Trajectory &find_trajectory(const std::string &key);
+    void start_flush(const std::string &key, Trajectory &traj);
+    bool progress_flush(Trajectory &traj, bool block);
+    void pack_trajectory(Trajectory &traj, std::vector<GroupTensor> &tensors, std::vector<GroupMeta> &meta);
+    void close_trajectories();
+
+    int start_iput(const std::string &key, std::shared_ptr<void> hold, const void *local,
+                   int size_local, MPI_Datatype datatype, SRTensorType type);
+    bool advance_request(AsyncRequest &req, bool block);
+    void finish_request(AsyncRequest &req);
+    void progress_requests();
+    void poll_requests();
+    void complete_request(int request);
+    void start_progress_thread();
+    void stop_progress_thread();
+    void progress_loop();
+    void start_io_thread();
+    void stop_io_thread();
+    void io_loop();
+
     MPI_Comm mpi_comm_local;
     int myid;
     int nprocs;
-    SmartRedis::Client* client;
+    Transport* client;
+    bool db_clustered;
+    int transport_kind;
+    std::string record_prefix;
+    std::string replay_prefix;
+    std::shared_ptr<RecordLog> record_log;  // shared by client and io_client
+
+    // Shard layout; WRITER_ROOT is a single shard spanning mpi_comm_local
+    int writer_mode;
+    int writer_stride;
+    MPI_Comm shard_comm;   // ranks feeding one writer, writer is rank 0
+    MPI_Comm leader_comm;  // writers only, MPI_COMM_NULL elsewhere
+    MPI_Comm own_comm;     // duplicate made by init_smartredis_mpi, freed by release_comm
+    int shard_rank;
+    int shard_nprocs;
+    int shard_id;
+    int n_shards;
+    std::vector<int> shard_ranks;  // writers only, rank in mpi_comm_local of each shard rank
+
+    // Hierarchical collectives within the shard, built on first use
+    int collective_mode;
+    MPI_Comm node_comm;         // shard ranks sharing a node, leader is rank 0
+    MPI_Comm node_leader_comm;  // node leaders only, the writer is rank 0
+    MPI_Comm async_leader_comm; // duplicate for the leaders' iput gathers, started by the progress thread
+    int node_rank;
+
+    // Wire precision per key, default WIRE_FLOAT64 (WIRE_FLOAT32 with _SINGLE_PRECISION)
+    std::unordered_map<std::string, int> wire_precision;
+    int default_wire_precision;
+    std::vector<double> convert_buffer;  // states and actions of other element types, through double
+
+    // Compression per key; frame buffers reused across calls on writers
+    std::unordered_map<std::string, CompressionSettings> compression;
+    std::unordered_map<std::string, CompressionStats> compression_stats;
+    mutable std::mutex compression_mutex;  // compression_stats, also updated by the I/O thread
+    std::vector<unsigned char> frame_buffer;
+    std::vector<unsigned char> frame_scratch;
+
+    ExchangeStats stats;
+
+    // Action waiting
+    WaitPolicy wait_policy;
+    double action_wait_total;
+    double action_wait_last;
+    std::unordered_map<std::string, ExchangePlan> plans;
+
+    // Registered keys, id i at key_handles[i-1]
+    std::vector<KeyHandle> key_handles;
+    long long current_step;
+    std::vector<std::string> expired_slots;  // writer only, the batch of collect_slots
+
+    // Non-blocking puts; the I/O thread uses its own transport connection
+    std::unordered_map<int, std::shared_ptr<AsyncRequest>> requests;
+    int next_request;
+    std::deque<std::shared_ptr<AsyncRequest>> in_flight;  // not yet gathered, oldest first
+    std::thread progress_thread;
+    std::mutex progress_mutex;   // in_flight while the progress thread runs
+    std::condition_variable progress_cv;
+    bool progress_stop;
+    std::vector<std::vector<unsigned char>> buffer_pool;
+    Transport* io_client;
+    std::thread io_thread;
+    std::mutex io_mutex;
+    std::condition_variable io_cv;
+    std::deque<IOJob> io_queue;
+    bool io_stop;
+
+    std::unordered_map<std::string, Trajectory> trajectories;
+
+    // Local policies by action key
+    std::unordered_map<std::string, LocalPolicy> policies;
+
+    // set_threads lanes, lane i used by thread i
+    std::vector<std::unique_ptr<SmartRedisMPI>> lanes;
 };
 
 #endif
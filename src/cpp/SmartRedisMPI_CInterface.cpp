@@ -14,11 +14,16 @@ typedef void* SR_HANDLE;
 /* Return codes: 0 success, non-zero failure */
 #define SR_OK 0
 #define SR_ERR 1
+#define SR_TIMEOUT 2
+
+/* Memory layouts */
+#define SR_LAYOUT_CONTIGUOUS 0
+#define SR_LAYOUT_FORTRAN 1
 
 /* Create/destroy */
 SR_HANDLE sr_mpi_create(int clustered) {
     try {
-        SmartRedisMPI* obj = new SmartRedisMPI(); 
+        SmartRedisMPI* obj = new SmartRedisMPI(clustered != 0);
         return static_cast<SR_HANDLE>(obj);
     } catch (...) {
         return nullptr;
@@ -37,14 +42,20 @@ int sr_mpi_destroy(SR_HANDLE handle) {
     }
 }
 
-/* init: pass clustered (0/1) and an integer MPI_Comm (or -1 for MPI_COMM_WORLD) */
+/* init: pass clustered (0/1) and a Fortran communicator handle (or -1 for MPI_COMM_WORLD) */
 int sr_init(SR_HANDLE handle, int clustered, int comm) {
+    return sr_init_transport(handle, clustered, comm, -1);
+}
+
+/* init_transport: sr_init with a transport kind (-1 keeps the current one).
+   The Fortran handle is valid in every language binding, unlike casting an int to MPI_Comm */
+int sr_init_transport(SR_HANDLE handle, int clustered, int comm, int transport) {
     if (!handle) return SR_ERR;
     SmartRedisMPI* obj = static_cast<SmartRedisMPI*>(handle);
     try {
         MPI_Comm mpi_comm = MPI_COMM_WORLD;
-        if (comm != -1) mpi_comm = (MPI_Comm)comm;
-        obj->init_smartredis_mpi(static_cast<bool>(clustered != 0), mpi_comm);
+        if (comm != -1) mpi_comm = MPI_Comm_f2c(static_cast<MPI_Fint>(comm));
+        obj->init_smartredis_mpi(static_cast<bool>(clustered != 0), mpi_comm, transport);
         return SR_OK;
     } catch (...) {
         return SR_ERR;
@@ -62,16 +73,79 @@ int sr_finalize(SR_HANDLE handle) {
     }
 }
 
+/* set_writer_mode: regroup ranks into shards with one writer each */
+int sr_set_writer_mode(SR_HANDLE handle, int mode, int stride) {
+    if (!handle) return SR_ERR;
+    SmartRedisMPI* obj = static_cast<SmartRedisMPI*>(handle);
+    try {
+        obj->set_writer_mode(mode, stride);
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+/* set_collective_mode: flat or node-hierarchical gathers and scatters */
+int sr_set_collective_mode(SR_HANDLE handle, int mode) {
+    if (!handle) return SR_ERR;
+    SmartRedisMPI* obj = static_cast<SmartRedisMPI*>(handle);
+    try {
+        obj->set_collective_mode(mode);
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+int sr_init_mpi_threads(int* provided) {
+    int level = SmartRedisMPI::init_mpi_threads();
+    if (provided) *provided = level;
+    return level >= MPI_THREAD_MULTIPLE ? SR_OK : SR_ERR;
+}
+
+/* set_threads: one lane per thread, n_threads = 1 returns to a single lane */
+int sr_set_threads(SR_HANDLE handle, int n_threads) {
+    if (!handle) return SR_ERR;
+    SmartRedisMPI* obj = static_cast<SmartRedisMPI*>(handle);
+    try {
+        obj->set_threads(n_threads);
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+int sr_bind_thread(int lane) {
+    SmartRedisMPI::bind_thread(lane);
+    return SR_OK;
+}
+
 /* Utility to convert string + length from Fortran to std::string */
 static std::string fortran_str_to_cpp(const char* s, int len) {
     if (!s || len <= 0) return std::string();
     return std::string(s, static_cast<size_t>(len));
 }
 
+/* Exchanges run on the calling thread's lane (the instance itself without
+   sr_set_threads); nullptr if the thread has none */
+static SmartRedisMPI* lane_of(SR_HANDLE handle) {
+    try {
+        return &static_cast<SmartRedisMPI*>(handle)->for_thread();
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+/* Map SR_LAYOUT_* to the SmartRedis memory layout */
+static SRMemoryLayout layout_to_sr(int layout) {
+    return layout == SR_LAYOUT_FORTRAN ? SRMemLayoutFortranContiguous : SRMemLayoutContiguous;
+}
+
 /* put_step_type: (key, key_len, step_type) */
 int sr_put_step_type(SR_HANDLE handle, const char* key, int key_len, int step_type) {
     if (!handle) return SR_ERR;
-    SmartRedisMPI* obj = static_cast<SmartRedisMPI*>(handle);
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
     try {
         std::string k = fortran_str_to_cpp(key, key_len);
         obj->put_step_type(k, step_type);
@@ -85,12 +159,11 @@ int sr_put_step_type(SR_HANDLE handle, const char* key, int key_len, int step_ty
 int sr_put_state(SR_HANDLE handle, const char* key, int key_len, const double* state, int state_size) {
     if (!handle) return SR_ERR;
     if (state_size < 0) return SR_ERR;
-    SmartRedisMPI* obj = static_cast<SmartRedisMPI*>(handle);
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
     try {
         std::string k = fortran_str_to_cpp(key, key_len);
-        std::vector<double> vec;
-        vec.assign(state, state + state_size);
-        obj->put_state(k, vec);
+        obj->put_state(k, state, static_cast<size_t>(state_size));
         return SR_OK;
     } catch (...) {
         return SR_ERR;
@@ -102,41 +175,103 @@ int sr_put_reward(SR_HANDLE handle, const char* key, int key_len, const double*
     return sr_put_state(handle, key, key_len, reward, reward_size);
 }
 
-/* get_action: (key, key_len, action_ptr, action_size) -- action_ptr is double* writable */
+/* get_action: (key, key_len, action_ptr, action_size) -- scattered directly into action_ptr */
 int sr_get_action(SR_HANDLE handle, const char* key, int key_len, double* action, int action_size) {
     if (!handle) return SR_ERR;
     if (action_size < 0) return SR_ERR;
-    SmartRedisMPI* obj = static_cast<SmartRedisMPI*>(handle);
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
     try {
         std::string k = fortran_str_to_cpp(key, key_len);
-        std::vector<double> vec(action_size);
-        obj->get_action(k, vec);
-        /* copy back */
-        if (static_cast<int>(vec.size()) != action_size) {
-            /* If sizes mismatch we still copy min */
-            int n = std::min<int>(static_cast<int>(vec.size()), action_size);
-            for (int i=0;i<n;++i) action[i] = vec[i];
-            /* zero remainder */
-            for (int i=n;i<action_size;++i) action[i] = 0.0;
-        } else {
-            std::memcpy(action, vec.data(), sizeof(double)*action_size);
-        }
+        obj->get_action(k, action, static_cast<size_t>(action_size));
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+/* wait_action: like get_action but waits for the key, SR_TIMEOUT if it never came */
+int sr_wait_action(SR_HANDLE handle, const char* key, int key_len, double* action, int action_size, double timeout) {
+    if (!handle) return SR_ERR;
+    if (action_size < 0) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        std::string k = fortran_str_to_cpp(key, key_len);
+        if (!obj->wait_action(k, action, static_cast<size_t>(action_size), timeout)) return SR_TIMEOUT;
         return SR_OK;
     } catch (...) {
         return SR_ERR;
     }
 }
 
+int sr_set_wait_policy(SR_HANDLE handle, int spin_checks, int short_sleep_us, int short_polls, int max_sleep_us) {
+    if (!handle) return SR_ERR;
+    SmartRedisMPI* obj = static_cast<SmartRedisMPI*>(handle);
+    WaitPolicy policy;
+    policy.spin_checks = spin_checks;
+    policy.short_sleep_us = short_sleep_us;
+    policy.short_polls = short_polls;
+    policy.max_sleep_us = max_sleep_us;
+    obj->set_wait_policy(policy);
+    return SR_OK;
+}
+
+int sr_get_action_wait_time(SR_HANDLE handle, double* total, double* last) {
+    if (!handle || !total || !last) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    *total = obj->get_action_wait_time();
+    *last = obj->get_last_action_wait();
+    return SR_OK;
+}
+
 /* put_info: integer array */
 int sr_put_info(SR_HANDLE handle, const char* key, int key_len, const int* info, int info_size) {
     if (!handle) return SR_ERR;
     if (info_size < 0) return SR_ERR;
-    SmartRedisMPI* obj = static_cast<SmartRedisMPI*>(handle);
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        std::string k = fortran_str_to_cpp(key, key_len);
+        obj->put_info(k, info, static_cast<size_t>(info_size));
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+/* put_state_nd: shaped state, see SmartRedisMPI::put_state_nd */
+int sr_put_state_nd(SR_HANDLE handle, const char* key, int key_len, const double* state, const int* dims, int ndims, int layout) {
+    if (!handle || !dims) return SR_ERR;
+    if (ndims <= 0) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        std::string k = fortran_str_to_cpp(key, key_len);
+        std::vector<size_t> d(ndims);
+        for (int i=0;i<ndims;++i) {
+            if (dims[i] < 0) return SR_ERR;
+            d[i] = static_cast<size_t>(dims[i]);
+        }
+        obj->put_state_nd(k, state, d, layout_to_sr(layout));
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+/* put_fields: structure-of-arrays state packed during the gather */
+int sr_put_fields(SR_HANDLE handle, const char* key, int key_len, const double* const* fields, int n_fields,
+                  int n_points, int stride, int layout) {
+    if (!handle || !fields) return SR_ERR;
+    if (n_fields <= 0 || n_points < 0 || stride <= 0) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
     try {
         std::string k = fortran_str_to_cpp(key, key_len);
-        std::vector<int> v;
-        v.assign(info, info + info_size);
-        obj->put_info(k, v);
+        std::vector<const double*> f(fields, fields + n_fields);
+        obj->put_fields(k, f, static_cast<size_t>(n_points), layout_to_sr(layout), static_cast<size_t>(stride));
         return SR_OK;
     } catch (...) {
         return SR_ERR;
@@ -146,7 +281,8 @@ int sr_put_info(SR_HANDLE handle, const char* key, int key_len, const int* info,
 /* put_real_scalar: writes a single double */
 int sr_put_real_scalar(SR_HANDLE handle, const char* key, int key_len, double rscalar) {
     if (!handle) return SR_ERR;
-    SmartRedisMPI* obj = static_cast<SmartRedisMPI*>(handle);
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
     try {
         std::string k = fortran_str_to_cpp(key, key_len);
         obj->put_real_scalar(k, rscalar);
@@ -156,4 +292,742 @@ int sr_put_real_scalar(SR_HANDLE handle, const char* key, int key_len, double rs
     }
 }
 
+/* Typed tensors: type is an SR_TYPE_* code, i.e. an SRTensorType */
+static bool tensor_type_valid(int type) {
+    return type >= SR_TYPE_FLOAT64 && type <= SR_TYPE_UINT16;
+}
+
+int sr_put_tensor(SR_HANDLE handle, const char* key, int key_len, const void* data, int size, int type) {
+    if (!handle) return SR_ERR;
+    if (size < 0 || !tensor_type_valid(type)) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        std::string k = fortran_str_to_cpp(key, key_len);
+        obj->put_tensor(k, data, static_cast<size_t>(size), static_cast<SRTensorType>(type));
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+int sr_get_tensor(SR_HANDLE handle, const char* key, int key_len, void* data, int size, int type) {
+    if (!handle) return SR_ERR;
+    if (size < 0 || !tensor_type_valid(type)) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        std::string k = fortran_str_to_cpp(key, key_len);
+        obj->get_tensor(k, data, static_cast<size_t>(size), static_cast<SRTensorType>(type));
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+int sr_wait_tensor(SR_HANDLE handle, const char* key, int key_len, void* data, int size, int type, double timeout) {
+    if (!handle) return SR_ERR;
+    if (size < 0 || !tensor_type_valid(type)) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        std::string k = fortran_str_to_cpp(key, key_len);
+        if (!obj->wait_tensor(k, data, static_cast<size_t>(size), static_cast<SRTensorType>(type), timeout))
+            return SR_TIMEOUT;
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+static bool value_type_valid(int type) {
+    return type == SR_TYPE_FLOAT64 || type == SR_TYPE_FLOAT32 || type == SR_TYPE_INT32 || type == SR_TYPE_INT64;
+}
+
+int sr_put_state_typed(SR_HANDLE handle, const char* key, int key_len, const void* state, int type,
+                       const int* dims, int ndims, int layout) {
+    if (!handle || (ndims > 0 && !dims)) return SR_ERR;
+    if (ndims < 0 || !value_type_valid(type)) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        std::string k = fortran_str_to_cpp(key, key_len);
+        std::vector<size_t> d(ndims);
+        size_t n = 1;
+        for (int i=0;i<ndims;++i) {
+            if (dims[i] < 0) return SR_ERR;
+            d[i] = static_cast<size_t>(dims[i]);
+            n *= d[i];
+        }
+        if (ndims > 1) obj->put_state_nd(k, state, static_cast<SRTensorType>(type), d, layout_to_sr(layout));
+        else obj->put_state(k, state, n, static_cast<SRTensorType>(type));
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+int sr_get_action_typed(SR_HANDLE handle, const char* key, int key_len, void* action, int action_size, int type) {
+    if (!handle) return SR_ERR;
+    if (action_size < 0 || !value_type_valid(type)) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        std::string k = fortran_str_to_cpp(key, key_len);
+        obj->get_action(k, action, static_cast<size_t>(action_size), static_cast<SRTensorType>(type));
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+int sr_wait_action_typed(SR_HANDLE handle, const char* key, int key_len, void* action, int action_size, int type,
+                         double timeout) {
+    if (!handle) return SR_ERR;
+    if (action_size < 0 || !value_type_valid(type)) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        std::string k = fortran_str_to_cpp(key, key_len);
+        if (!obj->wait_action(k, action, static_cast<size_t>(action_size), static_cast<SRTensorType>(type),
+                              timeout))
+            return SR_TIMEOUT;
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+/* step_exchange: one gather of state+reward, one scatter of the action, SR_TIMEOUT if it never came */
+int sr_step_exchange(SR_HANDLE handle, const char* tag, int tag_len,
+                     const double* state, int state_size,
+                     const double* reward, int reward_size,
+                     int step_type,
+                     double* action, int action_size,
+                     const double* scalars, int n_scalars, double timeout) {
+    if (!handle) return SR_ERR;
+    if (state_size < 0 || reward_size < 0 || action_size < 0 || n_scalars < 0) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        std::string t = fortran_str_to_cpp(tag, tag_len);
+        if (!obj->step_exchange(t, state, static_cast<size_t>(state_size),
+                                reward, static_cast<size_t>(reward_size), step_type,
+                                action, static_cast<size_t>(action_size),
+                                scalars, scalars ? static_cast<size_t>(n_scalars) : 0, timeout))
+            return SR_TIMEOUT;
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+/* register_key: the only call of the id path that converts a string. Like
+   the settings, it goes to the instance, which registers on every lane */
+int sr_register_key(SR_HANDLE handle, const char* key, int key_len, int per_step, int* id) {
+    if (!handle || !id) return SR_ERR;
+    try {
+        *id = static_cast<SmartRedisMPI*>(handle)->register_key(fortran_str_to_cpp(key, key_len), per_step != 0);
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+int sr_set_step(SR_HANDLE handle, long long step) {
+    if (!handle) return SR_ERR;
+    try {
+        static_cast<SmartRedisMPI*>(handle)->set_step(step);
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+int sr_key_name(SR_HANDLE handle, int id, char* buf, int buf_len, int* len) {
+    if (!handle || !len || buf_len < 0) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        const std::string &name = obj->key_name(id);
+        *len = static_cast<int>(name.size());
+        if (buf) std::memcpy(buf, name.data(), std::min(name.size(), static_cast<size_t>(buf_len)));
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+int sr_put_step_type_id(SR_HANDLE handle, int id, int step_type) {
+    if (!handle) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        obj->put_step_type(id, step_type);
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+int sr_put_state_id(SR_HANDLE handle, int id, const double* state, int state_size) {
+    if (!handle || state_size < 0) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        obj->put_state(id, state, static_cast<size_t>(state_size));
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+int sr_put_reward_id(SR_HANDLE handle, int id, const double* reward, int reward_size) {
+    return sr_put_state_id(handle, id, reward, reward_size);
+}
+
+int sr_put_info_id(SR_HANDLE handle, int id, const int* info, int info_size) {
+    if (!handle || info_size < 0) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        obj->put_info(id, info, static_cast<size_t>(info_size));
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+int sr_put_real_scalar_id(SR_HANDLE handle, int id, double rscalar) {
+    if (!handle) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        obj->put_real_scalar(id, rscalar);
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+int sr_get_action_id(SR_HANDLE handle, int id, double* action, int action_size) {
+    if (!handle || action_size < 0) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        obj->get_action(id, action, static_cast<size_t>(action_size));
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+int sr_wait_action_id(SR_HANDLE handle, int id, double* action, int action_size, double timeout) {
+    if (!handle || action_size < 0) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        if (!obj->wait_action(id, action, static_cast<size_t>(action_size), timeout)) return SR_TIMEOUT;
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+int sr_register_ring_key(SR_HANDLE handle, const char* key, int key_len, int slots, int* id) {
+    if (!handle || !id) return SR_ERR;
+    try {
+        *id = static_cast<SmartRedisMPI*>(handle)->register_ring_key(fortran_str_to_cpp(key, key_len), slots);
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+int sr_get_action_step(SR_HANDLE handle, int id, long long step, double* action, int action_size) {
+    if (!handle || action_size < 0) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        obj->get_action_step(id, step, action, static_cast<size_t>(action_size));
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+int sr_wait_action_step(SR_HANDLE handle, int id, long long step, double* action, int action_size,
+                        double timeout) {
+    if (!handle || action_size < 0) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        if (!obj->wait_action_step(id, step, action, static_cast<size_t>(action_size), timeout)) return SR_TIMEOUT;
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+/* Batched keys: split the packed key list, and the flat value buffer into one block per key */
+static bool batch_args(const char* keys, const int* key_lens, int n_keys, const int* sizes,
+                       std::vector<std::string> &key_list, std::vector<size_t> &size_list,
+                       std::vector<size_t> &offsets) {
+    if (!keys || !key_lens || !sizes || n_keys < 0) return false;
+    size_t pos = 0, off = 0;
+    for (int k=0;k<n_keys;k++) {
+        if (key_lens[k] < 0 || sizes[k] < 0) return false;
+        key_list.push_back(fortran_str_to_cpp(keys + pos, key_lens[k]));
+        size_list.push_back(static_cast<size_t>(sizes[k]));
+        offsets.push_back(off);
+        pos += key_lens[k];
+        off += sizes[k];
+    }
+    return true;
+}
+
+int sr_put_states(SR_HANDLE handle, const char* keys, const int* key_lens, int n_keys,
+                  const double* states, const int* sizes) {
+    if (!handle) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        std::vector<std::string> key_list;
+        std::vector<size_t> size_list, offsets;
+        if (!batch_args(keys, key_lens, n_keys, sizes, key_list, size_list, offsets)) return SR_ERR;
+        std::vector<const double*> ptrs;
+        for (size_t off : offsets) ptrs.push_back(states + off);
+        obj->put_states(key_list, ptrs, size_list);
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+int sr_get_actions(SR_HANDLE handle, const char* keys, const int* key_lens, int n_keys,
+                   double* actions, const int* sizes) {
+    if (!handle) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        std::vector<std::string> key_list;
+        std::vector<size_t> size_list, offsets;
+        if (!batch_args(keys, key_lens, n_keys, sizes, key_list, size_list, offsets)) return SR_ERR;
+        std::vector<double*> ptrs;
+        for (size_t off : offsets) ptrs.push_back(actions + off);
+        obj->get_actions(key_list, ptrs, size_list);
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+int sr_wait_actions(SR_HANDLE handle, const char* keys, const int* key_lens, int n_keys,
+                    double* actions, const int* sizes, double timeout) {
+    if (!handle) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        std::vector<std::string> key_list;
+        std::vector<size_t> size_list, offsets;
+        if (!batch_args(keys, key_lens, n_keys, sizes, key_list, size_list, offsets)) return SR_ERR;
+        std::vector<double*> ptrs;
+        for (size_t off : offsets) ptrs.push_back(actions + off);
+        if (!obj->wait_actions(key_list, ptrs, size_list, timeout)) return SR_TIMEOUT;
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+/* put_state_sparse: only state[indices[k]] (0-based) are sent, with their dense positions */
+int sr_put_state_sparse(SR_HANDLE handle, const char* key, int key_len, const double* state, int state_size,
+                        const int* indices, int n_indices) {
+    if (!handle) return SR_ERR;
+    if (state_size < 0 || n_indices < 0) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        std::string k = fortran_str_to_cpp(key, key_len);
+        obj->put_state_sparse(k, state, static_cast<size_t>(state_size), indices, static_cast<size_t>(n_indices));
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+/* put_state_masked: entries with mask[i] != 0 */
+int sr_put_state_masked(SR_HANDLE handle, const char* key, int key_len, const double* state, int state_size,
+                        const int* mask) {
+    if (!handle) return SR_ERR;
+    if (state_size < 0) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        std::string k = fortran_str_to_cpp(key, key_len);
+        obj->put_state_masked(k, state, static_cast<size_t>(state_size), mask);
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+/* put_state_delta: entries that moved by more than threshold since last sent */
+int sr_put_state_delta(SR_HANDLE handle, const char* key, int key_len, const double* state, int state_size,
+                       double threshold) {
+    if (!handle) return SR_ERR;
+    if (state_size < 0) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        std::string k = fortran_str_to_cpp(key, key_len);
+        obj->put_state_delta(k, state, static_cast<size_t>(state_size), threshold);
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+/* get_action_sparse: only the entries in the agent's sparse frame are written into action */
+int sr_get_action_sparse(SR_HANDLE handle, const char* key, int key_len, double* action, int action_size) {
+    if (!handle) return SR_ERR;
+    if (action_size < 0) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        std::string k = fortran_str_to_cpp(key, key_len);
+        obj->get_action_sparse(k, action, static_cast<size_t>(action_size));
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+int sr_wait_action_sparse(SR_HANDLE handle, const char* key, int key_len, double* action, int action_size,
+                          double timeout) {
+    if (!handle) return SR_ERR;
+    if (action_size < 0) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        std::string k = fortran_str_to_cpp(key, key_len);
+        if (!obj->wait_action_sparse(k, action, static_cast<size_t>(action_size), timeout)) return SR_TIMEOUT;
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+/* Trajectory buffering: append_step only copies; every n_steps-th step flushes */
+int sr_open_trajectory(SR_HANDLE handle, const char* key, int key_len, int n_steps, int n_features,
+                       int n_points, int n_reward, int async) {
+    if (!handle) return SR_ERR;
+    if (n_steps <= 0 || n_features <= 0 || n_points < 0 || n_reward < 0) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        std::string k = fortran_str_to_cpp(key, key_len);
+        obj->open_trajectory(k, static_cast<size_t>(n_steps), static_cast<size_t>(n_features),
+                             static_cast<size_t>(n_points), static_cast<size_t>(n_reward), async != 0);
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+int sr_append_step(SR_HANDLE handle, const char* key, int key_len, const double* state, int state_size,
+                   const double* reward, int reward_size, int step_type) {
+    if (!handle) return SR_ERR;
+    if (state_size < 0 || reward_size < 0) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        std::string k = fortran_str_to_cpp(key, key_len);
+        obj->append_step(k, state, static_cast<size_t>(state_size), reward, static_cast<size_t>(reward_size),
+                         step_type);
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+int sr_flush_trajectory(SR_HANDLE handle, const char* key, int key_len) {
+    if (!handle) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        std::string k = fortran_str_to_cpp(key, key_len);
+        obj->flush_trajectory(k);
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+int sr_close_trajectory(SR_HANDLE handle, const char* key, int key_len) {
+    if (!handle) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        std::string k = fortran_str_to_cpp(key, key_len);
+        obj->close_trajectory(k);
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+/* iput_state: starts the gather, *request receives the request id */
+int sr_iput_state(SR_HANDLE handle, const char* key, int key_len, const double* state, int state_size, int* request) {
+    if (!handle || !request) return SR_ERR;
+    if (state_size < 0) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        std::string k = fortran_str_to_cpp(key, key_len);
+        std::vector<double> vec(state, state + state_size);
+        *request = obj->iput_state(k, std::move(vec));
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+/* iput_reward: same as iput_state */
+int sr_iput_reward(SR_HANDLE handle, const char* key, int key_len, const double* reward, int reward_size, int* request) {
+    return sr_iput_state(handle, key, key_len, reward, reward_size, request);
+}
+
+/* iput_info: integer array */
+int sr_iput_info(SR_HANDLE handle, const char* key, int key_len, const int* info, int info_size, int* request) {
+    if (!handle || !request) return SR_ERR;
+    if (info_size < 0) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        std::string k = fortran_str_to_cpp(key, key_len);
+        std::vector<int> v(info, info + info_size);
+        *request = obj->iput_info(k, std::move(v));
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+/* test: *flag is 1 once the request has completed (and is released), 0 otherwise */
+int sr_test(SR_HANDLE handle, int request, int* flag) {
+    if (!handle || !flag) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        *flag = obj->test(request) ? 1 : 0;
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+int sr_wait(SR_HANDLE handle, int request) {
+    if (!handle) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        obj->wait(request);
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+int sr_waitall(SR_HANDLE handle) {
+    if (!handle) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        obj->waitall();
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+/* set_wire_precision: element type of a key on the wire (SR_WIRE_*) */
+int sr_set_wire_precision(SR_HANDLE handle, const char* key, int key_len, int precision) {
+    if (!handle) return SR_ERR;
+    SmartRedisMPI* obj = static_cast<SmartRedisMPI*>(handle);
+    try {
+        std::string k = fortran_str_to_cpp(key, key_len);
+        obj->set_wire_precision(k, precision);
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+/* set_compression: frame a key's tensors with codec (SR_CODEC_*) from threshold_bytes on */
+int sr_set_compression(SR_HANDLE handle, const char* key, int key_len, int codec, long long threshold_bytes) {
+    if (!handle) return SR_ERR;
+    if (threshold_bytes < 0) return SR_ERR;
+    SmartRedisMPI* obj = static_cast<SmartRedisMPI*>(handle);
+    try {
+        std::string k = fortran_str_to_cpp(key, key_len);
+        obj->set_compression(k, codec, static_cast<size_t>(threshold_bytes));
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+int sr_get_compression_stats(SR_HANDLE handle, const char* key, int key_len, double* ratio, double* last_ratio,
+                             double* encode_seconds, double* decode_seconds) {
+    if (!handle || !ratio || !last_ratio || !encode_seconds || !decode_seconds) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        CompressionStats stats = obj->get_compression_stats(fortran_str_to_cpp(key, key_len));
+        *ratio = stats.ratio();
+        *last_ratio = stats.last_ratio;
+        *encode_seconds = stats.encode_seconds;
+        *decode_seconds = stats.decode_seconds;
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+/* set_local_policy: answer reads of action_key in process with the MLP published under weights_key */
+int sr_set_local_policy(SR_HANDLE handle, const char* action_key, int action_len, const char* state_key,
+                        int state_len, const char* weights_key, int weights_len, int refresh_steps) {
+    if (!handle) return SR_ERR;
+    SmartRedisMPI* obj = static_cast<SmartRedisMPI*>(handle);
+    try {
+        obj->set_local_policy(fortran_str_to_cpp(action_key, action_len), fortran_str_to_cpp(state_key, state_len),
+                              fortran_str_to_cpp(weights_key, weights_len), refresh_steps);
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+int sr_get_policy_version(SR_HANDLE handle, const char* action_key, int action_len, int* version) {
+    if (!handle || !version) return SR_ERR;
+    SmartRedisMPI* obj = lane_of(handle);
+    if (!obj) return SR_ERR;
+    try {
+        *version = obj->get_policy_version(fortran_str_to_cpp(action_key, action_len));
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+/* enable_stats: turn the per-operation counters (and optionally the timeline) on or off */
+int sr_enable_stats(SR_HANDLE handle, int enabled, int trace) {
+    if (!handle) return SR_ERR;
+    SmartRedisMPI* obj = static_cast<SmartRedisMPI*>(handle);
+    try {
+        obj->enable_stats(enabled != 0, trace != 0);
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+/* get_stats: values[SR_STAT_NVALUES] of one (op, key) and phase on this rank */
+int sr_get_stats(SR_HANDLE handle, int op, const char* key, int key_len, int phase, double* values) {
+    if (!handle || !values) return SR_ERR;
+    if (op < 0 || op >= OP_COUNT || phase < 0 || phase >= PHASE_COUNT) return SR_ERR;
+    SmartRedisMPI* obj = static_cast<SmartRedisMPI*>(handle);
+    try {
+        OpStats stats = obj->get_stats(op, fortran_str_to_cpp(key, key_len));
+        const LatencyStats &lat = stats.phase[phase];
+        values[0] = static_cast<double>(stats.calls);
+        values[1] = static_cast<double>(stats.bytes);
+        values[2] = static_cast<double>(lat.count);
+        values[3] = lat.mean();
+        values[4] = lat.min;
+        values[5] = lat.max;
+        values[6] = lat.percentile(0.99);
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+int sr_reset_stats(SR_HANDLE handle) {
+    if (!handle) return SR_ERR;
+    SmartRedisMPI* obj = static_cast<SmartRedisMPI*>(handle);
+    obj->reset_stats();
+    return SR_OK;
+}
+
+int sr_dump_stats(SR_HANDLE handle, const char* path, int path_len) {
+    if (!handle) return SR_ERR;
+    SmartRedisMPI* obj = static_cast<SmartRedisMPI*>(handle);
+    try {
+        obj->dump_stats(fortran_str_to_cpp(path, path_len));
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+int sr_dump_trace(SR_HANDLE handle, const char* prefix, int prefix_len) {
+    if (!handle) return SR_ERR;
+    SmartRedisMPI* obj = static_cast<SmartRedisMPI*>(handle);
+    try {
+        obj->dump_trace(fortran_str_to_cpp(prefix, prefix_len));
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+/* invalidate_plan: drop the cached gather/scatter layout of one key */
+int sr_invalidate_plan(SR_HANDLE handle, const char* key, int key_len) {
+    if (!handle) return SR_ERR;
+    SmartRedisMPI* obj = static_cast<SmartRedisMPI*>(handle);
+    try {
+        std::string k = fortran_str_to_cpp(key, key_len);
+        obj->invalidate_plan(k);
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+/* invalidate_plans: drop all cached layouts */
+int sr_invalidate_plans(SR_HANDLE handle) {
+    if (!handle) return SR_ERR;
+    SmartRedisMPI* obj = static_cast<SmartRedisMPI*>(handle);
+    try {
+        obj->invalidate_plans();
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+int sr_set_record_log(SR_HANDLE handle, const char* prefix, int prefix_len) {
+    if (!handle) return SR_ERR;
+    SmartRedisMPI* obj = static_cast<SmartRedisMPI*>(handle);
+    try {
+        obj->set_record_log(fortran_str_to_cpp(prefix, prefix_len));
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
+int sr_set_replay_log(SR_HANDLE handle, const char* prefix, int prefix_len) {
+    if (!handle) return SR_ERR;
+    SmartRedisMPI* obj = static_cast<SmartRedisMPI*>(handle);
+    try {
+        obj->set_replay_log(fortran_str_to_cpp(prefix, prefix_len));
+        return SR_OK;
+    } catch (...) {
+        return SR_ERR;
+    }
+}
+
 } // extern "C"
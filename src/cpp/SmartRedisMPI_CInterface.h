@@ -11,23 +11,231 @@ typedef void* SR_HANDLE;
 /* Return codes: 0 success, non-zero failure */
 #define SR_OK 0
 #define SR_ERR 1
+#define SR_TIMEOUT 2
+
+/* Memory layouts of shaped tensors */
+#define SR_LAYOUT_CONTIGUOUS 0
+#define SR_LAYOUT_FORTRAN 1
+
+/* Wire precisions for sr_set_wire_precision */
+#define SR_WIRE_FLOAT64 0
+#define SR_WIRE_FLOAT32 1
+#define SR_WIRE_BFLOAT16 2
+#define SR_WIRE_FLOAT16 3
+
+/* Compression codecs for sr_set_compression */
+#define SR_CODEC_NONE 0
+#define SR_CODEC_SHUFFLE_LZ 1
+#define SR_CODEC_XOR_SHUFFLE_LZ 2
+
+/* Element types of sr_put_tensor / sr_get_tensor (SRTensorType values) */
+#define SR_TYPE_FLOAT64 1
+#define SR_TYPE_FLOAT32 2
+#define SR_TYPE_INT8 3
+#define SR_TYPE_INT16 4
+#define SR_TYPE_INT32 5
+#define SR_TYPE_INT64 6
+#define SR_TYPE_UINT8 7
+#define SR_TYPE_UINT16 8
+
+/* Operations and phases for sr_get_stats */
+#define SR_OP_PUT_STATE 0
+#define SR_OP_PUT_INFO 1
+#define SR_OP_PUT_FIELDS 2
+#define SR_OP_GET_ACTION 3
+#define SR_OP_STEP_EXCHANGE 4
+#define SR_OP_IPUT 5
+#define SR_OP_PUT_SCALAR 6
+#define SR_OP_PUT_BATCH 7
+#define SR_OP_GET_BATCH 8
+#define SR_OP_PUT_SPARSE 9
+#define SR_OP_GET_SPARSE 10
+#define SR_OP_PUT_TRAJECTORY 11
+#define SR_OP_PUT_TENSOR 12
+#define SR_OP_GET_TENSOR 13
+#define SR_OP_RING_GC 14
+#define SR_OP_POLICY_LOAD 15
+#define SR_OP_POLICY_EVAL 16
+#define SR_PHASE_TOTAL 0
+#define SR_PHASE_MPI 1
+#define SR_PHASE_REDIS 2
+#define SR_PHASE_WAIT 3
+/* sr_get_stats values: calls, bytes, then count, mean, min, max, p99 (s) of the phase */
+#define SR_STAT_NVALUES 7
+
+/* Transports for sr_init_transport */
+#define SR_TRANSPORT_DEFAULT -1
+#define SR_TRANSPORT_SMARTREDIS 0
+#define SR_TRANSPORT_SHM 1
+#define SR_TRANSPORT_REPLAY 2
+
+/* Writer modes for sr_set_writer_mode */
+#define SR_WRITER_ROOT 0
+#define SR_WRITER_NODE 1
+#define SR_WRITER_STRIDE 2
+
+/* Collective modes for sr_set_collective_mode */
+#define SR_COLLECTIVE_FLAT 0
+#define SR_COLLECTIVE_HIERARCHICAL 1
 
 /* Create / Destroy */
 SR_HANDLE sr_mpi_create(int clustered);
 int sr_mpi_destroy(SR_HANDLE handle);
 
-/* Initialize / Finalize MPI */
+/* Initialize / Finalize MPI; collective on comm, a Fortran handle (MPI_Comm_c2f, mpi4py Comm.py2f())
+   or -1 for MPI_COMM_WORLD. Each handle works on its own duplicate, so several can run side by side */
 int sr_init(SR_HANDLE handle, int clustered, int comm);
+/* sr_init with an explicit SR_TRANSPORT_*; SR_TRANSPORT_DEFAULT keeps the current one */
+int sr_init_transport(SR_HANDLE handle, int clustered, int comm, int transport);
 int sr_finalize(SR_HANDLE handle);
 
+/* Sharded writers (collective): mode is SR_WRITER_*, stride used by SR_WRITER_STRIDE */
+int sr_set_writer_mode(SR_HANDLE handle, int mode, int stride);
+/* Collective: SR_COLLECTIVE_HIERARCHICAL gathers each node through a shared window, then node leaders only */
+int sr_set_collective_mode(SR_HANDLE handle, int mode);
+/* Hybrid MPI + threads: sr_set_threads (collective) gives each of n_threads threads a lane with
+   its own communicator and connection; data operations below run on the calling thread's lane
+   (OpenMP thread number, or the lane given to sr_bind_thread). Needs MPI_THREAD_MULTIPLE,
+   which sr_init_mpi_threads requests if MPI is not initialized yet */
+int sr_init_mpi_threads(int* provided);
+int sr_set_threads(SR_HANDLE handle, int n_threads);
+int sr_bind_thread(int lane);
+
 /* Data operations */
 int sr_put_step_type(SR_HANDLE handle, const char* key, int key_len, int step_type);
 int sr_put_state(SR_HANDLE handle, const char* key, int key_len, const double* state, int state_size);
 int sr_put_reward(SR_HANDLE handle, const char* key, int key_len, const double* reward, int reward_size);
 int sr_get_action(SR_HANDLE handle, const char* key, int key_len, double* action, int action_size);
+/* Blocking get_action; returns SR_TIMEOUT on all ranks if the key did not appear within timeout s (< 0: no limit) */
+int sr_wait_action(SR_HANDLE handle, const char* key, int key_len, double* action, int action_size, double timeout);
+int sr_set_wait_policy(SR_HANDLE handle, int spin_checks, int short_sleep_us, int short_polls, int max_sleep_us);
+int sr_get_action_wait_time(SR_HANDLE handle, double* total, double* last);
 int sr_put_info(SR_HANDLE handle, const char* key, int key_len, const int* info, int info_size);
+/* N-D state: dims is the local shape, distributed over dims[0] (SR_LAYOUT_CONTIGUOUS) or dims[ndims-1] (SR_LAYOUT_FORTRAN) */
+int sr_put_state_nd(SR_HANDLE handle, const char* key, int key_len, const double* state, const int* dims, int ndims, int layout);
+/* SoA fields: value i of field f at fields[f][i*stride]; stored as [n_fields, n_points_global] */
+int sr_put_fields(SR_HANDLE handle, const char* key, int key_len, const double* const* fields, int n_fields,
+                  int n_points, int stride, int layout);
 int sr_put_real_scalar(SR_HANDLE handle, const char* key, int key_len, double rscalar);
 
+/* Typed tensors: size values of SR_TYPE_* type, gathered and stored in that type without conversion */
+int sr_put_tensor(SR_HANDLE handle, const char* key, int key_len, const void* data, int size, int type);
+int sr_get_tensor(SR_HANDLE handle, const char* key, int key_len, void* data, int size, int type);
+/* Blocking sr_get_tensor; SR_TIMEOUT on all ranks if the tensor did not appear within timeout s */
+int sr_wait_tensor(SR_HANDLE handle, const char* key, int key_len, void* data, int size, int type, double timeout);
+
+/* States and actions in the caller's element type (SR_TYPE_FLOAT64, FLOAT32, INT32 or INT64), converted
+   from and to the key's wire precision. The state has ndims local dims; ndims > 1 stores its shape like
+   sr_put_state_nd, ndims <= 1 stores it flat */
+int sr_put_state_typed(SR_HANDLE handle, const char* key, int key_len, const void* state, int type,
+                       const int* dims, int ndims, int layout);
+int sr_get_action_typed(SR_HANDLE handle, const char* key, int key_len, void* action, int action_size, int type);
+int sr_wait_action_typed(SR_HANDLE handle, const char* key, int key_len, void* action, int action_size, int type,
+                         double timeout);
+
+/* Fused DRL step: state+reward out as DataSet <tag>.step, action <tag>.action back (scalars may be NULL);
+   SR_TIMEOUT on all ranks if the action did not appear within timeout s (< 0: no limit) */
+int sr_step_exchange(SR_HANDLE handle, const char* tag, int tag_len,
+                     const double* state, int state_size,
+                     const double* reward, int reward_size,
+                     int step_type,
+                     double* action, int action_size,
+                     const double* scalars, int n_scalars, double timeout);
+
+/* Pre-registered keys: *id (> 0) replaces the key in the sr_*_id calls; with per_step != 0
+   the key is stored as <key>.<step> for the step set with sr_set_step. Register in the same order on all ranks */
+int sr_register_key(SR_HANDLE handle, const char* key, int key_len, int per_step, int* id);
+int sr_set_step(SR_HANDLE handle, long long step);
+/* Stored name at the current step, truncated to buf_len chars (not NUL-terminated); *len is its full length */
+int sr_key_name(SR_HANDLE handle, int id, char* buf, int buf_len, int* len);
+int sr_put_step_type_id(SR_HANDLE handle, int id, int step_type);
+int sr_put_state_id(SR_HANDLE handle, int id, const double* state, int state_size);
+int sr_put_reward_id(SR_HANDLE handle, int id, const double* reward, int reward_size);
+int sr_put_info_id(SR_HANDLE handle, int id, const int* info, int info_size);
+int sr_put_real_scalar_id(SR_HANDLE handle, int id, double rscalar);
+int sr_get_action_id(SR_HANDLE handle, int id, double* action, int action_size);
+int sr_wait_action_id(SR_HANDLE handle, int id, double* action, int action_size, double timeout);
+/* Step-versioned ring: a per-step key keeping the last `slots` steps; writers delete older slots
+   in batches from sr_set_step. The *_step calls read the action of a given step of the window */
+int sr_register_ring_key(SR_HANDLE handle, const char* key, int key_len, int slots, int* id);
+int sr_get_action_step(SR_HANDLE handle, int id, long long step, double* action, int action_size);
+int sr_wait_action_step(SR_HANDLE handle, int id, long long step, double* action, int action_size,
+                        double timeout);
+
+/* Batched keys in one exchange: key k is key_lens[k] chars of keys (keys back to back),
+   and its sizes[k] local values follow those of key k-1 in states / actions */
+int sr_put_states(SR_HANDLE handle, const char* keys, const int* key_lens, int n_keys,
+                  const double* states, const int* sizes);
+int sr_get_actions(SR_HANDLE handle, const char* keys, const int* key_lens, int n_keys,
+                   double* actions, const int* sizes);
+/* Blocking sr_get_actions; SR_TIMEOUT on all ranks if any key did not appear within timeout s */
+int sr_wait_actions(SR_HANDLE handle, const char* keys, const int* key_lens, int n_keys,
+                    double* actions, const int* sizes, double timeout);
+
+/* Sparse states: only the selected entries travel, stored as group <key> with tensors "indices" (int32
+   positions in the shard's dense state) and "values", and metadata "size". indices are 0-based */
+int sr_put_state_sparse(SR_HANDLE handle, const char* key, int key_len, const double* state, int state_size,
+                        const int* indices, int n_indices);
+int sr_put_state_masked(SR_HANDLE handle, const char* key, int key_len, const double* state, int state_size,
+                        const int* mask);
+/* Entries that moved by more than threshold since they were last sent (all on the first call) */
+int sr_put_state_delta(SR_HANDLE handle, const char* key, int key_len, const double* state, int state_size,
+                       double threshold);
+/* Sparse actions: the agent's frame holds nnz int32 dense positions then nnz float64 values;
+   only those entries of action are written */
+int sr_get_action_sparse(SR_HANDLE handle, const char* key, int key_len, double* action, int action_size);
+int sr_wait_action_sparse(SR_HANDLE handle, const char* key, int key_len, double* action, int action_size,
+                          double timeout);
+
+/* Trajectory buffering (open/flush/close collective): steps are copied into a per-rank buffer and every
+   n_steps steps go out as group <key> with "state" [k, n_features, n_points_global] (wire precision),
+   "reward" [k, n_reward_global], "step_type" (int32) and "step" (int64). The local state of a step is
+   [n_features, n_points]; async != 0 gathers in the background and writes from the I/O thread */
+int sr_open_trajectory(SR_HANDLE handle, const char* key, int key_len, int n_steps, int n_features,
+                       int n_points, int n_reward, int async);
+int sr_append_step(SR_HANDLE handle, const char* key, int key_len, const double* state, int state_size,
+                   const double* reward, int reward_size, int step_type);
+/* Sends the steps buffered so far; close also waits for the write and frees the buffers */
+int sr_flush_trajectory(SR_HANDLE handle, const char* key, int key_len);
+int sr_close_trajectory(SR_HANDLE handle, const char* key, int key_len);
+
+/* Non-blocking puts: the data is copied, *request is completed by sr_test / sr_wait / sr_waitall on all ranks */
+int sr_iput_state(SR_HANDLE handle, const char* key, int key_len, const double* state, int state_size, int* request);
+int sr_iput_reward(SR_HANDLE handle, const char* key, int key_len, const double* reward, int reward_size, int* request);
+int sr_iput_info(SR_HANDLE handle, const char* key, int key_len, const int* info, int info_size, int* request);
+int sr_test(SR_HANDLE handle, int request, int* flag);
+int sr_wait(SR_HANDLE handle, int request);
+int sr_waitall(SR_HANDLE handle);
+
+/* Exchange plans: call on all ranks when the per-rank sizes change */
+/* Precision of a key's state/reward/action on the wire; bf16/fp16 are stored as uint16 bits */
+int sr_set_wire_precision(SR_HANDLE handle, const char* key, int key_len, int precision);
+/* Lossless compression of a key's tensors of at least threshold_bytes (SR_CODEC_NONE disables) */
+int sr_set_compression(SR_HANDLE handle, const char* key, int key_len, int codec, long long threshold_bytes);
+/* ratio: raw / stored bytes over all frames; last_ratio and encode time of the last encode on this writer */
+int sr_get_compression_stats(SR_HANDLE handle, const char* key, int key_len, double* ratio, double* last_ratio,
+                             double* encode_seconds, double* decode_seconds);
+/* Local policy: reads of action_key are answered by an MLP run on each rank's last state_key, with
+   weights (<weights_key>.meta / .params) refreshed every refresh_steps reads; "" weights_key removes it */
+int sr_set_local_policy(SR_HANDLE handle, const char* action_key, int action_len, const char* state_key,
+                        int state_len, const char* weights_key, int weights_len, int refresh_steps);
+/* version: of the weights in use, -1 before any */
+int sr_get_policy_version(SR_HANDLE handle, const char* action_key, int action_len, int* version);
+/* Instrumentation: counters per (op, key) on every rank; trace also keeps a timeline */
+int sr_enable_stats(SR_HANDLE handle, int enabled, int trace);
+int sr_get_stats(SR_HANDLE handle, int op, const char* key, int key_len, int phase, double* values);
+int sr_reset_stats(SR_HANDLE handle);
+/* Collective; rank 0 writes the table to path (stdout if path_len is 0) */
+int sr_dump_stats(SR_HANDLE handle, const char* path, int path_len);
+/* Per rank: <prefix>.<rank>.json in Chrome trace format */
+int sr_dump_trace(SR_HANDLE handle, const char* prefix, int prefix_len);
+int sr_invalidate_plan(SR_HANDLE handle, const char* key, int key_len);
+int sr_invalidate_plans(SR_HANDLE handle);
+/* Record mode: writers log every put and read to <prefix>.<rank>.srlog; prefix_len 0 stops */
+int sr_set_record_log(SR_HANDLE handle, const char* prefix, int prefix_len);
+/* Log prefix SR_TRANSPORT_REPLAY serves actions from */
+int sr_set_replay_log(SR_HANDLE handle, const char* prefix, int prefix_len);
+
 #ifdef __cplusplus
 }
 #endif
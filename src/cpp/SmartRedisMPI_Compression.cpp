@@ -0,0 +1,248 @@
+#include "SmartRedisMPI_Compression.h"
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+
+static const unsigned char FRAME_MAGIC[4] = {'S', 'R', 'Z', '1'};
+static const size_t FRAME_FIXED = 20;
+
+// LZ block: sequences of token (literal length << 4 | match length - 4),
+// extra length bytes (255-continued) for nibbles of 15, the literals, then
+// a uint16 offset and extra match length bytes. The last sequence carries
+// literals only and ends the block.
+static const size_t LZ_MIN_MATCH = 4;
+static const size_t LZ_MAX_OFFSET = 65535;
+static const int LZ_HASH_BITS = 16;
+
+bool codec_valid(int codec) {
+    return codec >= CODEC_NONE && codec <= CODEC_XOR_SHUFFLE_LZ;
+}
+
+// === Little-endian helpers ===
+
+static inline void put_u32(unsigned char *p, uint32_t v) {
+    for (int i=0;i<4;i++) p[i] = static_cast<unsigned char>(v >> (8*i));
+}
+
+static inline void put_u64(unsigned char *p, uint64_t v) {
+    for (int i=0;i<8;i++) p[i] = static_cast<unsigned char>(v >> (8*i));
+}
+
+static inline uint32_t get_u32(const unsigned char *p) {
+    uint32_t v = 0;
+    for (int i=0;i<4;i++) v |= static_cast<uint32_t>(p[i]) << (8*i);
+    return v;
+}
+
+static inline uint64_t get_u64(const unsigned char *p) {
+    uint64_t v = 0;
+    for (int i=0;i<8;i++) v |= static_cast<uint64_t>(p[i]) << (8*i);
+    return v;
+}
+
+static inline uint32_t load32(const unsigned char *p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// === Byte shuffle / XOR delta ===
+
+static void shuffle(const unsigned char *src, unsigned char *dst, size_t n, int elem_size, bool xor_delta) {
+    for (int b=0;b<elem_size;b++) {
+        unsigned char *plane = dst + static_cast<size_t>(b) * n;
+        const unsigned char *in = src + b;
+        if (n == 0) continue;
+        plane[0] = in[0];
+        if (xor_delta) {
+            for (size_t i=1;i<n;i++) plane[i] = in[i*elem_size] ^ in[(i-1)*elem_size];
+        } else {
+            for (size_t i=1;i<n;i++) plane[i] = in[i*elem_size];
+        }
+    }
+}
+
+static void unshuffle(const unsigned char *src, unsigned char *dst, size_t n, int elem_size, bool xor_delta) {
+    for (int b=0;b<elem_size;b++) {
+        const unsigned char *plane = src + static_cast<size_t>(b) * n;
+        unsigned char *out = dst + b;
+        unsigned char prev = 0;
+        for (size_t i=0;i<n;i++) {
+            unsigned char v = xor_delta ? static_cast<unsigned char>(plane[i] ^ prev) : plane[i];
+            out[i*elem_size] = v;
+            prev = v;
+        }
+    }
+}
+
+// === LZ stage ===
+
+static void put_length(std::vector<unsigned char> &out, size_t len) {
+    while (len >= 255) {
+        out.push_back(255);
+        len -= 255;
+    }
+    out.push_back(static_cast<unsigned char>(len));
+}
+
+static void emit_sequence(std::vector<unsigned char> &out, const unsigned char *lit, size_t n_lit,
+                          size_t offset, size_t match) {
+    const size_t m = match ? match - LZ_MIN_MATCH : 0;
+    out.push_back(static_cast<unsigned char>((std::min<size_t>(n_lit, 15) << 4) | std::min<size_t>(m, 15)));
+    if (n_lit >= 15) put_length(out, n_lit - 15);
+    out.insert(out.end(), lit, lit + n_lit);
+    if (!match) return;
+    out.push_back(static_cast<unsigned char>(offset));
+    out.push_back(static_cast<unsigned char>(offset >> 8));
+    if (m >= 15) put_length(out, m - 15);
+}
+
+// Greedy single-probe hash matcher; the probe step grows on long runs of
+// misses so incompressible data passes through quickly
+static void lz_compress(const unsigned char *in, size_t n, std::vector<unsigned char> &out) {
+    static thread_local std::vector<uint32_t> table;
+    table.assign(size_t(1) << LZ_HASH_BITS, 0);
+
+    size_t anchor = 0;
+    size_t i = 0;
+    size_t misses = 0;
+    while (i + LZ_MIN_MATCH <= n) {
+        const uint32_t seq = load32(in + i);
+        const uint32_t h = (seq * 2654435761u) >> (32 - LZ_HASH_BITS);
+        const size_t ref = table[h];
+        table[h] = static_cast<uint32_t>(i + 1);
+        if (ref && i - (ref - 1) <= LZ_MAX_OFFSET && load32(in + ref - 1) == seq) {
+            const size_t r = ref - 1;
+            size_t m = LZ_MIN_MATCH;
+            while (i + m < n && in[r + m] == in[i + m]) m++;
+            emit_sequence(out, in + anchor, i - anchor, i - r, m);
+            i += m;
+            anchor = i;
+            misses = 0;
+        } else {
+            i += 1 + (misses++ >> 6);
+        }
+    }
+    emit_sequence(out, in + anchor, n - anchor, 0, 0);
+}
+
+static size_t get_length(const unsigned char *&ip, const unsigned char *end, size_t len) {
+    unsigned char b;
+    do {
+        if (ip >= end) throw std::runtime_error("SmartRedisMPI: truncated compressed frame");
+        b = *ip++;
+        len += b;
+    } while (b == 255);
+    return len;
+}
+
+static void lz_decompress(const unsigned char *ip, size_t n, unsigned char *out, size_t out_size) {
+    const unsigned char *end = ip + n;
+    unsigned char *op = out;
+    unsigned char *oend = out + out_size;
+    const char *corrupt = "SmartRedisMPI: corrupt compressed frame";
+
+    while (ip < end) {
+        const unsigned char token = *ip++;
+        size_t lit = token >> 4;
+        if (lit == 15) lit = get_length(ip, end, lit);
+        if (lit > static_cast<size_t>(end - ip) || lit > static_cast<size_t>(oend - op))
+            throw std::runtime_error(corrupt);
+        std::memcpy(op, ip, lit);
+        ip += lit;
+        op += lit;
+        if (ip == end) break;
+
+        if (end - ip < 2) throw std::runtime_error(corrupt);
+        const size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        size_t m = token & 15;
+        if (m == 15) m = get_length(ip, end, m);
+        m += LZ_MIN_MATCH;
+        if (offset == 0 || offset > static_cast<size_t>(op - out) || m > static_cast<size_t>(oend - op))
+            throw std::runtime_error(corrupt);
+        const unsigned char *match = op - offset;
+        if (offset >= m) {
+            std::memcpy(op, match, m);
+            op += m;
+        } else {
+            for (size_t k=0;k<m;k++) *op++ = match[k];  // overlapping run
+        }
+    }
+    if (op != oend) throw std::runtime_error(corrupt);
+}
+
+// === Frames ===
+
+void encode_frame(const void *src, size_t n, const FrameHeader &header,
+                  std::vector<unsigned char> &out, std::vector<unsigned char> &scratch) {
+    if (!codec_valid(header.codec))
+        throw std::invalid_argument("SmartRedisMPI: unknown compression codec");
+    if (header.elem_size <= 0 || header.elem_size > 255)
+        throw std::invalid_argument("SmartRedisMPI: invalid element size for compression");
+    const size_t raw = n * static_cast<size_t>(header.elem_size);
+    if (raw > 0xFFFFFFFFu)
+        throw std::invalid_argument("SmartRedisMPI: tensor too large to compress");
+
+    out.clear();
+    out.reserve(FRAME_FIXED + 8 * header.dims.size() + raw + raw / 255 + 16);
+    out.resize(FRAME_FIXED + 8 * header.dims.size());
+    unsigned char *h = out.data();
+    std::memcpy(h, FRAME_MAGIC, 4);
+    h[4] = static_cast<unsigned char>(header.codec);
+    h[5] = static_cast<unsigned char>(header.elem_size);
+    h[6] = static_cast<unsigned char>(header.dtype);
+    h[7] = header.layout == SRMemLayoutFortranContiguous ? 1 : 0;
+    put_u32(h + 8, static_cast<uint32_t>(header.dims.size()));
+    put_u64(h + 12, raw);
+    for (size_t d=0;d<header.dims.size();d++) put_u64(h + FRAME_FIXED + 8*d, header.dims[d]);
+
+    const unsigned char *bytes = static_cast<const unsigned char*>(src);
+    if (header.codec == CODEC_NONE) {
+        out.insert(out.end(), bytes, bytes + raw);
+        return;
+    }
+    scratch.resize(raw);
+    shuffle(bytes, scratch.data(), n, header.elem_size, header.codec == CODEC_XOR_SHUFFLE_LZ);
+    lz_compress(scratch.data(), raw, out);
+}
+
+bool is_frame(const void *src, size_t n) {
+    return n >= FRAME_FIXED && std::memcmp(src, FRAME_MAGIC, 4) == 0;
+}
+
+size_t read_frame_header(const void *src, size_t n, FrameHeader &header) {
+    if (!is_frame(src, n)) throw std::runtime_error("SmartRedisMPI: not a compressed frame");
+    const unsigned char *h = static_cast<const unsigned char*>(src);
+    header.codec = h[4];
+    header.elem_size = h[5];
+    header.dtype = static_cast<SRTensorType>(h[6]);
+    header.layout = h[7] ? SRMemLayoutFortranContiguous : SRMemLayoutContiguous;
+    const size_t ndims = get_u32(h + 8);
+    header.raw_bytes = get_u64(h + 12);
+    if (!codec_valid(header.codec) || header.elem_size == 0 || ndims > (n - FRAME_FIXED) / 8)
+        throw std::runtime_error("SmartRedisMPI: corrupt compressed frame header");
+    header.dims.resize(ndims);
+    for (size_t d=0;d<ndims;d++) header.dims[d] = get_u64(h + FRAME_FIXED + 8*d);
+    return FRAME_FIXED + 8 * ndims;
+}
+
+void decode_frame(const void *src, size_t n, void *dst, size_t dst_bytes,
+                  std::vector<unsigned char> &scratch) {
+    FrameHeader header;
+    const size_t offset = read_frame_header(src, n, header);
+    if (header.raw_bytes != dst_bytes || dst_bytes % header.elem_size != 0)
+        throw std::runtime_error("SmartRedisMPI: compressed frame size does not match the destination");
+
+    const unsigned char *payload = static_cast<const unsigned char*>(src) + offset;
+    const size_t payload_size = n - offset;
+    if (header.codec == CODEC_NONE) {
+        if (payload_size != dst_bytes) throw std::runtime_error("SmartRedisMPI: corrupt compressed frame");
+        if (dst_bytes > 0) std::memcpy(dst, payload, dst_bytes);
+        return;
+    }
+    scratch.resize(dst_bytes);
+    lz_decompress(payload, payload_size, scratch.data(), dst_bytes);
+    unshuffle(scratch.data(), static_cast<unsigned char*>(dst), dst_bytes / header.elem_size,
+              header.elem_size, header.codec == CODEC_XOR_SHUFFLE_LZ);
+}
@@ -0,0 +1,48 @@
+#ifndef SMARTREDIS_MPI_COMPRESSION_H
+#define SMARTREDIS_MPI_COMPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "client.h"
+
+// Lossless codecs for large tensors. A compressed tensor is stored as a
+// uint8 frame: a fixed header (see FrameHeader) followed by the payload.
+// Byte shuffling groups byte b of every element into one plane; the XOR
+// variant first replaces each element by its XOR with the previous one, so
+// smooth or constant fields turn into long runs the LZ stage removes.
+enum CompressionCodec {
+    CODEC_NONE = 0,         // raw bytes, framed only
+    CODEC_SHUFFLE_LZ = 1,   // byte shuffle + LZ
+    CODEC_XOR_SHUFFLE_LZ = 2 // XOR delta + byte shuffle + LZ
+};
+
+// Frame header, little-endian, 20 bytes followed by ndims uint64 dims:
+//   char[4] magic "SRZ1", uint8 codec, uint8 elem_size, uint8 dtype
+//   (SRTensorType), uint8 layout (0 C, 1 Fortran), uint32 ndims,
+//   uint64 raw_bytes
+struct FrameHeader {
+    int codec = CODEC_NONE;
+    int elem_size = 1;
+    SRTensorType dtype = SRTensorTypeUint8;
+    SRMemoryLayout layout = SRMemLayoutContiguous;
+    std::vector<size_t> dims;
+    size_t raw_bytes = 0;
+};
+
+bool codec_valid(int codec);
+
+// Append the frame of n elements of elem_size bytes to out (cleared first);
+// scratch is reused between calls to avoid reallocations
+void encode_frame(const void *src, size_t n, const FrameHeader &header,
+                  std::vector<unsigned char> &out, std::vector<unsigned char> &scratch);
+
+// True if the bytes start with a frame header
+bool is_frame(const void *src, size_t n);
+// Parse the header; returns the payload offset, throws on a malformed frame
+size_t read_frame_header(const void *src, size_t n, FrameHeader &header);
+// Restore the original bytes into dst (exactly dst_bytes = header.raw_bytes)
+void decode_frame(const void *src, size_t n, void *dst, size_t dst_bytes,
+                  std::vector<unsigned char> &scratch);
+
+#endif
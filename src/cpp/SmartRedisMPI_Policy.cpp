@@ -0,0 +1,142 @@
+#include "SmartRedisMPI_Policy.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SRMPI_SIMD_AVX 1
+#endif
+
+// tanh as a [13/6] rational function on [-7.9, 7.9] (saturated beyond),
+// within a few float ulps of std::tanh
+static const float TANH_CLAMP = 7.90531110763549805f;
+static const float TANH_P[7] = {-2.76076847742355e-16f, 2.00018790482477e-13f, -8.60467152213735e-11f,
+                                5.12229709037114e-08f, 1.48572235717979e-05f, 6.37261928875436e-04f,
+                                4.89352455891786e-03f};
+static const float TANH_Q[4] = {1.19825839466702e-06f, 1.18534705686654e-04f, 2.26843463243900e-03f,
+                                4.89352518554385e-03f};
+
+static inline float fast_tanh(float x) {
+    x = std::min(std::max(x, -TANH_CLAMP), TANH_CLAMP);
+    const float x2 = x * x;
+    float p = TANH_P[0];
+    for (int k=1;k<7;k++) p = p * x2 + TANH_P[k];
+    float q = TANH_Q[0];
+    for (int k=1;k<4;k++) q = q * x2 + TANH_Q[k];
+    return x * p / q;
+}
+
+#ifdef SRMPI_SIMD_AVX
+static inline __m256 madd8(__m256 a, __m256 b, __m256 c) {
+#ifdef __FMA__
+    return _mm256_fmadd_ps(a, b, c);
+#else
+    return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+}
+
+static inline __m256 fast_tanh8(__m256 x) {
+    x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-TANH_CLAMP)), _mm256_set1_ps(TANH_CLAMP));
+    const __m256 x2 = _mm256_mul_ps(x, x);
+    __m256 p = _mm256_set1_ps(TANH_P[0]);
+    for (int k=1;k<7;k++) p = madd8(p, x2, _mm256_set1_ps(TANH_P[k]));
+    __m256 q = _mm256_set1_ps(TANH_Q[0]);
+    for (int k=1;k<4;k++) q = madd8(q, x2, _mm256_set1_ps(TANH_Q[k]));
+    return _mm256_div_ps(_mm256_mul_ps(x, p), q);
+}
+#endif
+
+size_t policy_param_count(const int32_t *meta) {
+    const int n_layers = meta[1];
+    if (n_layers < 1 || n_layers > POLICY_MAX_LAYERS) return 0;
+    if (meta[2] != POLICY_TANH && meta[2] != POLICY_RELU) return 0;
+    const int32_t *widths = meta + 3;
+    size_t count = 0;
+    for (int k=0;k<n_layers;k++) {
+        if (widths[k] <= 0 || widths[k+1] <= 0) return 0;
+        count += static_cast<size_t>(widths[k+1]) * (static_cast<size_t>(widths[k]) + 1);
+    }
+    return count;
+}
+
+void MLPPolicy::load(const int32_t *meta, std::vector<float> &new_params) {
+    const int n_layers = meta[1];
+    activation = meta[2];
+    widths.assign(meta + 3, meta + 4 + n_layers);
+    params.swap(new_params);
+    offsets.resize(n_layers);
+    size_t offset = 0;
+    for (int k=0;k<n_layers;k++) {
+        offsets[k] = offset;
+        offset += static_cast<size_t>(widths[k+1]) * (static_cast<size_t>(widths[k]) + 1);
+    }
+    const size_t max_width = static_cast<size_t>(*std::max_element(widths.begin(), widths.end()));
+    block_in.assign(max_width * POLICY_BLOCK, 0.0f);
+    block_out.assign(max_width * POLICY_BLOCK, 0.0f);
+}
+
+void MLPPolicy::evaluate(const float *state, size_t n_points, double *action) {
+    const size_t n_in = static_cast<size_t>(n_inputs());
+    const size_t n_out = static_cast<size_t>(n_outputs());
+    for (size_t p0=0; p0<n_points; p0+=POLICY_BLOCK) {
+        const size_t n = std::min(static_cast<size_t>(POLICY_BLOCK), n_points - p0);
+        const float *x = state + p0 * n_in;
+        for (size_t p=0;p<n;p++)
+            for (size_t i=0;i<n_in;i++) block_in[i * POLICY_BLOCK + p] = x[p * n_in + i];
+
+        forward_block();
+
+        double *y = action + p0 * n_out;
+        for (size_t p=0;p<n;p++)
+            for (size_t o=0;o<n_out;o++) y[p * n_out + o] = block_in[o * POLICY_BLOCK + p];
+    }
+}
+
+// One block through every layer; the result ends up in block_in. All
+// POLICY_BLOCK lanes are computed, those past the last point are ignored.
+void MLPPolicy::forward_block() {
+    const int n_layers = static_cast<int>(offsets.size());
+    for (int k=0;k<n_layers;k++) {
+        const int n_in = widths[k];
+        const int n_out = widths[k+1];
+        const float *w = params.data() + offsets[k];
+        const float *b = w + static_cast<size_t>(n_out) * n_in;
+        const bool hidden = k + 1 < n_layers;
+
+        for (int o=0;o<n_out;o++) {
+            const float *w_o = w + static_cast<size_t>(o) * n_in;
+            float *out = block_out.data() + static_cast<size_t>(o) * POLICY_BLOCK;
+#ifdef SRMPI_SIMD_AVX
+            const int lanes = POLICY_BLOCK / 8;
+            __m256 acc[lanes];
+            for (int v=0;v<lanes;v++) acc[v] = _mm256_set1_ps(b[o]);
+            for (int i=0;i<n_in;i++) {
+                const __m256 wi = _mm256_set1_ps(w_o[i]);
+                const float *x = block_in.data() + static_cast<size_t>(i) * POLICY_BLOCK;
+                for (int v=0;v<lanes;v++) acc[v] = madd8(wi, _mm256_loadu_ps(x + 8 * v), acc[v]);
+            }
+            if (hidden && activation == POLICY_RELU)
+                for (int v=0;v<lanes;v++) acc[v] = _mm256_max_ps(acc[v], _mm256_setzero_ps());
+            if (hidden && activation == POLICY_TANH)
+                for (int v=0;v<lanes;v++) acc[v] = fast_tanh8(acc[v]);
+            for (int v=0;v<lanes;v++) _mm256_storeu_ps(out + 8 * v, acc[v]);
+#else
+            // A local accumulator, so the compiler sees no aliasing with block_in
+            float acc[POLICY_BLOCK];
+            for (int p=0;p<POLICY_BLOCK;p++) acc[p] = b[o];
+            for (int i=0;i<n_in;i++) {
+                const float wi = w_o[i];
+                const float *x = block_in.data() + static_cast<size_t>(i) * POLICY_BLOCK;
+                for (int p=0;p<POLICY_BLOCK;p++) acc[p] += wi * x[p];
+            }
+            if (hidden && activation == POLICY_RELU)
+                for (int p=0;p<POLICY_BLOCK;p++) acc[p] = std::max(acc[p], 0.0f);
+            if (hidden && activation == POLICY_TANH)
+                for (int p=0;p<POLICY_BLOCK;p++) acc[p] = fast_tanh(acc[p]);
+            std::copy(acc, acc + POLICY_BLOCK, out);
+#endif
+        }
+        std::swap(block_in, block_out);
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef SMARTREDIS_MPI_POLICY_H
+#define SMARTREDIS_MPI_POLICY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Activation of the hidden layers of a local policy; the output layer is linear
+enum PolicyActivation {
+    POLICY_TANH = 0,
+    POLICY_RELU = 1
+};
+
+// Weights as the agent publishes them under <weights_key>:
+//   <weights_key>.meta    int32 [POLICY_META_LEN]: version, n_layers,
+//                         activation, then the n_layers + 1 layer widths
+//                         (inputs first), zero padded
+//   <weights_key>.params  float32: W_0, b_0, W_1, b_1, ... back to back,
+//                         W_k row-major [width k+1, width k]
+// The writer reads .meta on every refresh and .params only when the
+// version changed. src/python/srmpi_policy.py writes both.
+const int POLICY_META_LEN = 16;
+const int POLICY_MAX_LAYERS = POLICY_META_LEN - 4;
+
+// Number of float32 parameters of a valid meta block, 0 if it is not valid
+size_t policy_param_count(const int32_t *meta);
+
+// Small MLP evaluated on the points of one rank. Points are processed in
+// blocks of POLICY_BLOCK: the block's activations are kept feature-major so
+// every weight is applied to POLICY_BLOCK contiguous values, with AVX/FMA
+// (8 points per instruction) when the compiler targets them.
+class MLPPolicy {
+public:
+    static const int POLICY_BLOCK = 64;
+
+    // meta as above (validated by the caller with policy_param_count)
+    void load(const int32_t *meta, std::vector<float> &params);
+    bool loaded() const { return !widths.empty(); }
+    int n_inputs() const { return widths.front(); }
+    int n_outputs() const { return widths.back(); }
+
+    // n_points points of n_inputs() values each, point-major (a Fortran
+    // state(n_features, n_points)), to n_points * n_outputs() actions
+    void evaluate(const float *state, size_t n_points, double *action);
+
+private:
+    void forward_block();
+
+    std::vector<int> widths;
+    int activation = POLICY_TANH;
+    std::vector<float> params;
+    std::vector<size_t> offsets;   // W_k in params; b_k follows it
+    std::vector<float> block_in;   // [max width, POLICY_BLOCK]
+    std::vector<float> block_out;
+};
+
+#endif
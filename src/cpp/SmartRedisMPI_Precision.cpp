@@ -0,0 +1,193 @@
+#include "SmartRedisMPI_Precision.h"
+#include <cstring>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__AVX__) && defined(__SSE4_1__)
+#include <immintrin.h>
+#define SRMPI_SIMD_AVX 1
+#endif
+#if defined(SRMPI_SIMD_AVX) && defined(__F16C__)
+#define SRMPI_SIMD_F16C 1
+#endif
+
+bool wire_precision_valid(int precision) {
+    return precision >= WIRE_FLOAT64 && precision <= WIRE_FLOAT16;
+}
+
+MPI_Datatype wire_mpi_type(int precision) {
+    switch (precision) {
+    case WIRE_FLOAT32: return MPI_FLOAT;
+    case WIRE_BFLOAT16:
+    case WIRE_FLOAT16: return MPI_UINT16_T;
+    default: return MPI_DOUBLE;
+    }
+}
+
+SRTensorType wire_tensor_type(int precision) {
+    switch (precision) {
+    case WIRE_FLOAT32: return SRTensorTypeFloat;
+    case WIRE_BFLOAT16:
+    case WIRE_FLOAT16: return SRTensorTypeUint16;
+    default: return SRTensorTypeDouble;
+    }
+}
+
+// === Scalar kernels (tails and non-x86 builds) ===
+
+static inline uint32_t float_bits(float f) {
+    uint32_t x;
+    std::memcpy(&x, &f, sizeof(x));
+    return x;
+}
+
+static inline float bits_float(uint32_t x) {
+    float f;
+    std::memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+static inline uint16_t float_to_bf16(float f) {
+    uint32_t x = float_bits(f);
+    if ((x & 0x7FFFFFFFu) > 0x7F800000u) return static_cast<uint16_t>((x >> 16) | 0x40);  // quiet NaN
+    x += 0x7FFFu + ((x >> 16) & 1u);
+    return static_cast<uint16_t>(x >> 16);
+}
+
+static inline float bf16_to_float(uint16_t h) {
+    return bits_float(static_cast<uint32_t>(h) << 16);
+}
+
+static inline uint16_t float_to_half(float f) {
+    uint32_t x = float_bits(f);
+    uint32_t sign = (x >> 16) & 0x8000u;
+    uint32_t mant = x & 0x007FFFFFu;
+    int exp = static_cast<int>((x >> 23) & 0xFFu);
+
+    if (exp == 0xFF) return static_cast<uint16_t>(sign | 0x7C00u | (mant ? 0x200u : 0u));
+    int e = exp - 127 + 15;
+    if (e >= 0x1F) return static_cast<uint16_t>(sign | 0x7C00u);
+    if (e <= 0) {
+        if (e < -10) return static_cast<uint16_t>(sign);
+        mant |= 0x00800000u;
+        uint32_t shift = static_cast<uint32_t>(14 - e);
+        uint32_t h = mant >> shift;
+        uint32_t rem = mant & ((1u << shift) - 1u);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rem > halfway || (rem == halfway && (h & 1u))) h++;
+        return static_cast<uint16_t>(sign | h);
+    }
+    uint32_t h = (static_cast<uint32_t>(e) << 10) | (mant >> 13);
+    uint32_t rem = mant & 0x1FFFu;
+    if (rem > 0x1000u || (rem == 0x1000u && (h & 1u))) h++;  // may carry into inf
+    return static_cast<uint16_t>(sign | h);
+}
+
+static inline float half_to_float(uint16_t h) {
+    uint32_t sign = static_cast<uint32_t>(h & 0x8000u) << 16;
+    uint32_t exp = (h >> 10) & 0x1Fu;
+    uint32_t mant = h & 0x3FFu;
+    if (exp == 0) {
+        float v = std::ldexp(static_cast<float>(mant), -24);
+        return sign ? -v : v;
+    }
+    if (exp == 0x1F) return bits_float(sign | 0x7F800000u | (mant << 13));
+    return bits_float(sign | ((exp + 112u) << 23) | (mant << 13));
+}
+
+// === Vector kernels, 4 values per iteration ===
+
+#ifdef SRMPI_SIMD_AVX
+static inline __m128i bf16_round4(__m128 f) {
+    __m128i x = _mm_castps_si128(f);
+    __m128i lsb = _mm_and_si128(_mm_srli_epi32(x, 16), _mm_set1_epi32(1));
+    __m128i r = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(x, _mm_set1_epi32(0x7FFF)), lsb), 16);
+    __m128i nan = _mm_castps_si128(_mm_cmpunord_ps(f, f));
+    __m128i qnan = _mm_or_si128(_mm_srli_epi32(x, 16), _mm_set1_epi32(0x40));
+    return _mm_blendv_epi8(r, qnan, nan);
+}
+#endif
+
+void pack_wire(const double *src, void *dst, size_t n, int precision) {
+    size_t i = 0;
+    switch (precision) {
+    case WIRE_FLOAT64:
+        if (n > 0) std::memcpy(dst, src, n * sizeof(double));
+        return;
+    case WIRE_FLOAT32: {
+        float *out = static_cast<float*>(dst);
+#ifdef SRMPI_SIMD_AVX
+        for (; i + 4 <= n; i += 4)
+            _mm_storeu_ps(out + i, _mm256_cvtpd_ps(_mm256_loadu_pd(src + i)));
+#endif
+        for (; i < n; i++) out[i] = static_cast<float>(src[i]);
+        return;
+    }
+    case WIRE_BFLOAT16: {
+        uint16_t *out = static_cast<uint16_t*>(dst);
+#ifdef SRMPI_SIMD_AVX
+        for (; i + 4 <= n; i += 4) {
+            __m128i r = bf16_round4(_mm256_cvtpd_ps(_mm256_loadu_pd(src + i)));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi32(r, r));
+        }
+#endif
+        for (; i < n; i++) out[i] = float_to_bf16(static_cast<float>(src[i]));
+        return;
+    }
+    case WIRE_FLOAT16: {
+        uint16_t *out = static_cast<uint16_t*>(dst);
+#ifdef SRMPI_SIMD_F16C
+        for (; i + 4 <= n; i += 4) {
+            __m128i h = _mm_cvtps_ph(_mm256_cvtpd_ps(_mm256_loadu_pd(src + i)), _MM_FROUND_TO_NEAREST_INT);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), h);
+        }
+#endif
+        for (; i < n; i++) out[i] = float_to_half(static_cast<float>(src[i]));
+        return;
+    }
+    default:
+        throw std::invalid_argument("SmartRedisMPI: unknown wire precision");
+    }
+}
+
+void unpack_wire(const void *src, double *dst, size_t n, int precision) {
+    size_t i = 0;
+    switch (precision) {
+    case WIRE_FLOAT64:
+        if (n > 0) std::memcpy(dst, src, n * sizeof(double));
+        return;
+    case WIRE_FLOAT32: {
+        const float *in = static_cast<const float*>(src);
+#ifdef SRMPI_SIMD_AVX
+        for (; i + 4 <= n; i += 4)
+            _mm256_storeu_pd(dst + i, _mm256_cvtps_pd(_mm_loadu_ps(in + i)));
+#endif
+        for (; i < n; i++) dst[i] = in[i];
+        return;
+    }
+    case WIRE_BFLOAT16: {
+        const uint16_t *in = static_cast<const uint16_t*>(src);
+#ifdef SRMPI_SIMD_AVX
+        for (; i + 4 <= n; i += 4) {
+            __m128i h = _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + i)));
+            _mm256_storeu_pd(dst + i, _mm256_cvtps_pd(_mm_castsi128_ps(_mm_slli_epi32(h, 16))));
+        }
+#endif
+        for (; i < n; i++) dst[i] = bf16_to_float(in[i]);
+        return;
+    }
+    case WIRE_FLOAT16: {
+        const uint16_t *in = static_cast<const uint16_t*>(src);
+#ifdef SRMPI_SIMD_F16C
+        for (; i + 4 <= n; i += 4) {
+            __m128 f = _mm_cvtph_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + i)));
+            _mm256_storeu_pd(dst + i, _mm256_cvtps_pd(f));
+        }
+#endif
+        for (; i < n; i++) dst[i] = half_to_float(in[i]);
+        return;
+    }
+    default:
+        throw std::invalid_argument("SmartRedisMPI: unknown wire precision");
+    }
+}
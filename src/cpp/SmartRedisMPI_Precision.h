@@ -0,0 +1,28 @@
+#ifndef SMARTREDIS_MPI_PRECISION_H
+#define SMARTREDIS_MPI_PRECISION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mpi.h>
+#include "client.h"
+
+// Element type used on the wire (MPI gather/scatter and Redis) for a key.
+// Callers always see double; half-width types travel as SRTensorTypeUint16
+// holding the raw bfloat16 / IEEE binary16 bits.
+enum WirePrecision {
+    WIRE_FLOAT64 = 0,
+    WIRE_FLOAT32 = 1,
+    WIRE_BFLOAT16 = 2,
+    WIRE_FLOAT16 = 3
+};
+
+bool wire_precision_valid(int precision);
+MPI_Datatype wire_mpi_type(int precision);
+SRTensorType wire_tensor_type(int precision);
+
+// double <-> wire conversion, round-to-nearest-even; vectorized with
+// AVX/SSE4.1 (and F16C for float16) when the compiler targets them
+void pack_wire(const double *src, void *dst, size_t n, int precision);
+void unpack_wire(const void *src, double *dst, size_t n, int precision);
+
+#endif
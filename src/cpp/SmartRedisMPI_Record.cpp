@@ -0,0 +1,333 @@
+#include "SmartRedisMPI_Record.h"
+#include <cerrno>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace {
+
+const uint64_t LOG_MAGIC = 0x474f4c49504d5253ULL; // "SRMPILOG" as a little-endian u64
+const uint32_t LOG_VERSION = 1;
+const size_t HEADER_BYTES = 64;
+const size_t RECORD_HEADER_BYTES = 48;
+const uint64_t MIN_CAPACITY = 1 << 20;
+
+// Header fields
+const size_t H_MAGIC = 0, H_VERSION = 8, H_RANK = 12, H_USED = 16, H_T0 = 24;
+// Record fields
+const size_t R_KIND = 0, R_TYPE = 4, R_NDIMS = 8, R_KEYLEN = 12, R_STEP = 16, R_TBEGIN = 24,
+             R_TEND = 32, R_NBYTES = 40, R_DIMS = 48;
+
+template <typename T>
+T *field(unsigned char *base, size_t offset) { return reinterpret_cast<T*>(base + offset); }
+
+template <typename T>
+T get(const unsigned char *base, size_t offset) {
+    T v;
+    std::memcpy(&v, base + offset, sizeof(T));
+    return v;
+}
+
+uint64_t pad8(uint64_t n) { return (n + 7) / 8 * 8; }
+
+size_t type_size(uint32_t type) {
+    switch (type) {
+    case SRTensorTypeDouble:
+    case SRTensorTypeInt64: return 8;
+    case SRTensorTypeFloat:
+    case SRTensorTypeInt32: return 4;
+    case SRTensorTypeInt16:
+    case SRTensorTypeUint16: return 2;
+    default: return 1;
+    }
+}
+
+} // namespace
+
+std::string record_log_path(const std::string &prefix, int rank) {
+    return prefix + "." + std::to_string(rank) + ".srlog";
+}
+
+// === RecordLog ===
+
+RecordLog::RecordLog(const std::string &path, int rank)
+: file(path), fd(-1), base(nullptr), capacity(0), used(HEADER_BYTES) {
+    fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        throw std::runtime_error("SmartRedisMPI: cannot create record log '" + path + "': " + std::strerror(errno));
+    reserve(MIN_CAPACITY);
+    start = std::chrono::steady_clock::now();
+    const int64_t t0 = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    *field<uint32_t>(base, H_VERSION) = LOG_VERSION;
+    *field<uint32_t>(base, H_RANK) = static_cast<uint32_t>(rank);
+    *field<int64_t>(base, H_T0) = t0;
+    *field<uint64_t>(base, H_USED) = used;
+    *field<uint64_t>(base, H_MAGIC) = LOG_MAGIC;
+}
+
+RecordLog::~RecordLog() {
+    if (base) munmap(base, capacity);
+    if (fd >= 0) {
+        if (ftruncate(fd, used) != 0) {}  // the header still says how much is valid
+        close(fd);
+    }
+}
+
+uint64_t RecordLog::now() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+void RecordLog::reserve(uint64_t bytes) {
+    if (bytes <= capacity) return;
+    uint64_t grown = std::max<uint64_t>(capacity, MIN_CAPACITY);
+    while (grown < bytes) grown *= 2;
+    if (base) munmap(base, capacity);
+    base = nullptr;
+    void *p = MAP_FAILED;
+    if (ftruncate(fd, grown) == 0)
+        p = mmap(nullptr, grown, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)
+        throw std::runtime_error("SmartRedisMPI: cannot grow record log '" + file + "': " + std::strerror(errno));
+    base = static_cast<unsigned char*>(p);
+    capacity = grown;
+}
+
+void RecordLog::append(RecordKind kind, const std::string &key, const void *data, const std::vector<size_t> &dims,
+                       SRTensorType type, uint64_t t_begin, uint64_t t_end) {
+    uint64_t n = 1;
+    for (size_t d : dims) n *= d;
+    const uint64_t nbytes = n * type_size(type);
+    const uint64_t bytes = pad8(RECORD_HEADER_BYTES + 8 * dims.size() + key.size() + nbytes);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    reserve(used + bytes);
+    unsigned char *rec = base + used;
+    std::memset(rec, 0, bytes);
+    *field<uint32_t>(rec, R_KIND) = kind;
+    *field<uint32_t>(rec, R_TYPE) = type;
+    *field<uint32_t>(rec, R_NDIMS) = static_cast<uint32_t>(dims.size());
+    *field<uint32_t>(rec, R_KEYLEN) = static_cast<uint32_t>(key.size());
+    *field<uint64_t>(rec, R_STEP) = steps[kind][key]++;
+    *field<uint64_t>(rec, R_TBEGIN) = t_begin;
+    *field<uint64_t>(rec, R_TEND) = t_end;
+    *field<uint64_t>(rec, R_NBYTES) = nbytes;
+    for (size_t i=0;i<dims.size();i++) field<uint64_t>(rec, R_DIMS)[i] = dims[i];
+    unsigned char *p = rec + R_DIMS + 8 * dims.size();
+    std::memcpy(p, key.data(), key.size());
+    if (nbytes > 0) std::memcpy(p + key.size(), data, nbytes);
+    used += bytes;
+    *field<uint64_t>(base, H_USED) = used;
+}
+
+// === RecordTransport ===
+
+RecordTransport::RecordTransport(Transport *inner, std::shared_ptr<RecordLog> log)
+: inner(inner), log(log) {}
+
+RecordTransport::~RecordTransport() {
+    delete inner;
+}
+
+void RecordTransport::put_tensor(const std::string &key, const void *data, const std::vector<size_t> &dims,
+                                 SRTensorType type, SRMemoryLayout layout) {
+    const uint64_t t_begin = log->now();
+    inner->put_tensor(key, data, dims, type, layout);
+    log->append(RECORD_PUT, key, data, dims, type, t_begin, log->now());
+}
+
+void RecordTransport::unpack_tensor(const std::string &key, void *data, const std::vector<size_t> &dims,
+                                    SRTensorType type, SRMemoryLayout layout) {
+    const uint64_t t_begin = log->now();
+    inner->unpack_tensor(key, data, dims, type, layout);
+    log->append(RECORD_GET, key, data, dims, type, t_begin, log->now());
+}
+
+void RecordTransport::delete_tensor(const std::string &key) {
+    inner->delete_tensor(key);
+}
+
+void RecordTransport::delete_tensors(const std::vector<std::string> &keys) {
+    inner->delete_tensors(keys);
+}
+
+bool RecordTransport::tensor_exists(const std::string &key) {
+    return inner->tensor_exists(key);
+}
+
+bool RecordTransport::frame_exists(const std::string &key) {
+    return inner->frame_exists(key);
+}
+
+void RecordTransport::take_frame(const std::string &key, std::vector<unsigned char> &frame) {
+    const uint64_t t_begin = log->now();
+    inner->take_frame(key, frame);
+    log->append(RECORD_FRAME, key, frame.data(), {frame.size()}, SRTensorTypeUint8, t_begin, log->now());
+}
+
+void RecordTransport::put_group(const std::string &key, const std::vector<GroupTensor> &tensors,
+                                const std::vector<GroupMeta> &meta) {
+    const uint64_t t_begin = log->now();
+    inner->put_group(key, tensors, meta);
+    const uint64_t t_end = log->now();
+    for (const GroupTensor &t : tensors)
+        log->append(RECORD_PUT, key + "." + t.name, t.data, t.dims, t.type, t_begin, t_end);
+    for (const GroupMeta &m : meta) {
+        if (!m.ints.empty())
+            log->append(RECORD_PUT, key + "." + m.name, m.ints.data(), {m.ints.size()}, SRTensorTypeInt32,
+                        t_begin, t_end);
+        else
+            log->append(RECORD_PUT, key + "." + m.name, m.doubles.data(), {m.doubles.size()}, SRTensorTypeDouble,
+                        t_begin, t_end);
+    }
+    int32_t entries = static_cast<int32_t>(tensors.size() + meta.size());
+    log->append(RECORD_GROUP, key, &entries, {1}, SRTensorTypeInt32, t_begin, t_end);
+}
+
+void RecordTransport::take_group(const std::string &key, std::vector<GroupData> &tensors) {
+    const uint64_t t_begin = log->now();
+    inner->take_group(key, tensors);
+    const uint64_t t_end = log->now();
+    std::vector<int32_t> held;
+    for (const GroupData &t : tensors) {
+        held.push_back(t.found ? 1 : 0);
+        if (t.found) log->append(RECORD_GET, key + "." + t.name, t.bytes.data(), {t.count}, t.type, t_begin, t_end);
+    }
+    log->append(RECORD_TAKE, key, held.data(), {held.size()}, SRTensorTypeInt32, t_begin, t_end);
+}
+
+bool RecordTransport::wait_for(const std::string &key, bool frame, int timeout_us) {
+    return inner->wait_for(key, frame, timeout_us);
+}
+
+// === ReplayTransport ===
+
+ReplayTransport::ReplayTransport(const std::string &path)
+: file(path), base(nullptr), size(0) {
+    if (path.empty()) return;  // no log set yet: nothing to read
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("SmartRedisMPI: cannot open replay log '" + path + "': " + std::strerror(errno));
+    struct stat st;
+    void *p = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= HEADER_BYTES)
+        p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        throw std::runtime_error("SmartRedisMPI: cannot map replay log '" + path + "'");
+    base = static_cast<unsigned char*>(p);
+    size = st.st_size;
+    if (get<uint64_t>(base, H_MAGIC) != LOG_MAGIC || get<uint32_t>(base, H_VERSION) != LOG_VERSION)
+        throw std::runtime_error("SmartRedisMPI: '" + path + "' is not a SmartRedisMPI record log");
+
+    // Index the reads per key; a truncated last record is ignored
+    const uint64_t used = std::min<uint64_t>(get<uint64_t>(base, H_USED), size);
+    uint64_t off = HEADER_BYTES;
+    while (off + RECORD_HEADER_BYTES <= used) {
+        const unsigned char *rec = base + off;
+        const uint32_t ndims = get<uint32_t>(rec, R_NDIMS);
+        const uint32_t key_len = get<uint32_t>(rec, R_KEYLEN);
+        const uint64_t nbytes = get<uint64_t>(rec, R_NBYTES);
+        const uint64_t bytes = pad8(RECORD_HEADER_BYTES + 8ull * ndims + key_len + nbytes);
+        if (off + bytes > used) break;
+        const uint32_t kind = get<uint32_t>(rec, R_KIND);
+        if (kind == RECORD_GET || kind == RECORD_FRAME || kind == RECORD_TAKE) {
+            Entry e;
+            e.kind = kind;
+            e.type = get<uint32_t>(rec, R_TYPE);
+            for (uint32_t i=0;i<ndims;i++) e.dims.push_back(get<uint64_t>(rec, R_DIMS + 8 * i));
+            e.nbytes = nbytes;
+            const unsigned char *key = rec + R_DIMS + 8 * ndims;
+            e.payload = key + key_len;
+            entries[std::string(reinterpret_cast<const char*>(key), key_len)].push_back(e);
+        }
+        off += bytes;
+    }
+}
+
+ReplayTransport::~ReplayTransport() {
+    if (base) munmap(base, size);
+}
+
+const ReplayTransport::Entry *ReplayTransport::front(const std::string &key, bool frame) {
+    auto it = entries.find(key);
+    if (it == entries.end() || it->second.empty()) return nullptr;
+    const Entry &e = it->second.front();
+    return (e.kind != RECORD_GET) == frame ? &e : nullptr;
+}
+
+void ReplayTransport::put_tensor(const std::string &, const void *, const std::vector<size_t> &,
+                                 SRTensorType, SRMemoryLayout) {}
+
+void ReplayTransport::unpack_tensor(const std::string &key, void *data, const std::vector<size_t> &dims,
+                                    SRTensorType type, SRMemoryLayout) {
+    const Entry *e = front(key, false);
+    if (!e)
+        throw std::runtime_error("SmartRedisMPI: no recorded tensor '" + key + "' left in " +
+                                 (file.empty() ? std::string("(no replay log)") : file));
+    uint64_t n = 1;
+    for (size_t d : dims) n *= d;
+    if (e->type != static_cast<uint32_t>(type) || e->nbytes != n * type_size(type))
+        throw std::runtime_error("SmartRedisMPI: recorded '" + key + "' does not match the requested type and shape");
+    if (e->nbytes > 0) std::memcpy(data, e->payload, e->nbytes);
+}
+
+void ReplayTransport::delete_tensor(const std::string &key) {
+    auto it = entries.find(key);
+    if (it != entries.end() && !it->second.empty()) it->second.pop_front();
+}
+
+bool ReplayTransport::tensor_exists(const std::string &key) {
+    return front(key, false) != nullptr;
+}
+
+bool ReplayTransport::frame_exists(const std::string &key) {
+    return front(key, true) != nullptr;
+}
+
+void ReplayTransport::take_frame(const std::string &key, std::vector<unsigned char> &frame) {
+    const Entry *e = front(key, true);
+    if (!e || e->kind != RECORD_FRAME)
+        throw std::runtime_error("SmartRedisMPI: no recorded frame '" + key + "' left in " +
+                                 (file.empty() ? std::string("(no replay log)") : file));
+    frame.assign(e->payload, e->payload + e->nbytes);
+    entries[key].pop_front();
+}
+
+void ReplayTransport::put_group(const std::string &, const std::vector<GroupTensor> &,
+                                const std::vector<GroupMeta> &) {}
+
+void ReplayTransport::take_group(const std::string &key, std::vector<GroupData> &tensors) {
+    const Entry *e = front(key, true);
+    if (!e || e->kind != RECORD_TAKE || e->nbytes != tensors.size() * sizeof(int32_t))
+        throw std::runtime_error("SmartRedisMPI: no recorded group '" + key + "' left in " +
+                                 (file.empty() ? std::string("(no replay log)") : file));
+    std::vector<int32_t> held(tensors.size());
+    if (!held.empty()) std::memcpy(held.data(), e->payload, e->nbytes);
+    entries[key].pop_front();
+    for (size_t i=0;i<tensors.size();i++) {
+        GroupData &t = tensors[i];
+        t.found = false;
+        t.bytes.clear();
+        t.count = 0;
+        if (!held[i]) continue;
+        const Entry *g = front(key + "." + t.name, false);
+        if (!g)
+            throw std::runtime_error("SmartRedisMPI: recorded group '" + key + "' lacks '" + t.name + "'");
+        t.found = true;
+        t.type = static_cast<SRTensorType>(g->type);
+        t.bytes.assign(g->payload, g->payload + g->nbytes);
+        t.count = g->nbytes / type_size(g->type);
+        entries[key + "." + t.name].pop_front();
+    }
+}
+
+bool ReplayTransport::wait_for(const std::string &key, bool frame, int timeout_us) {
+    if (front(key, frame)) return true;
+    return Transport::wait_for(key, frame, timeout_us);
+}
@@ -0,0 +1,132 @@
+#ifndef SMARTREDIS_MPI_RECORD_H
+#define SMARTREDIS_MPI_RECORD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "SmartRedisMPI_Transport.h"
+
+// Append-only, memory-mapped log of everything one writer exchanged with its
+// store, written to <prefix>.<rank>.srlog (rank in the instance's comm).
+// The file grows in doubling chunks and is cut to its used length on close;
+// header.used is advanced after each complete record, so the log of a job
+// that died is readable up to its last record. src/python/srmpi_log.py reads
+// the same layout.
+//
+// Layout, little-endian, offsets in bytes:
+//   header (64):  0 magic "SRMPILOG", 8 u32 version, 12 u32 rank,
+//                 16 u64 used (bytes incl. header), 24 i64 t0 (Unix epoch ns)
+//   record:       0 u32 kind (RecordKind), 4 u32 type (SRTensorType),
+//                 8 u32 ndims, 12 u32 key_len, 16 u64 step (earlier records
+//                 of the same key and kind), 24 u64 t_begin, 32 u64 t_end
+//                 (ns since t0), 40 u64 nbytes, 48 u64 dims[ndims], then the
+//                 key and the payload, padded to 8 bytes
+enum RecordKind {
+    RECORD_PUT = 0,    // tensor written (compressed keys: their uint8 frame)
+    RECORD_GET = 1,    // tensor read (the action)
+    RECORD_FRAME = 2,  // uint8 frame taken (compressed action)
+    RECORD_GROUP = 3,  // group marker: int32 entry count, entries are PUTs of <key>.<name>
+    RECORD_TAKE = 4    // group taken (sparse action): int32 per requested tensor, 1 if the
+                       // group held it; those are GETs of <key>.<name> logged before it
+};
+
+class RecordLog {
+public:
+    RecordLog(const std::string &path, int rank);
+    ~RecordLog();
+
+    const std::string &path() const { return file; }
+    // Nanoseconds since the log was opened
+    uint64_t now() const;
+    void append(RecordKind kind, const std::string &key, const void *data, const std::vector<size_t> &dims,
+                SRTensorType type, uint64_t t_begin, uint64_t t_end);
+
+private:
+    void reserve(uint64_t bytes);
+
+    std::string file;
+    int fd;
+    unsigned char *base;
+    uint64_t capacity;
+    uint64_t used;
+    std::chrono::steady_clock::time_point start;
+    std::unordered_map<std::string, uint64_t> steps[5];
+    std::mutex mutex;  // the writer and its I/O thread share a log
+};
+
+// Path of the log of one rank
+std::string record_log_path(const std::string &prefix, int rank);
+
+// Passes everything to inner and logs puts and reads with their timing
+class RecordTransport : public Transport {
+public:
+    RecordTransport(Transport *inner, std::shared_ptr<RecordLog> log);
+    ~RecordTransport() override;
+
+    void put_tensor(const std::string &key, const void *data, const std::vector<size_t> &dims,
+                    SRTensorType type, SRMemoryLayout layout) override;
+    void unpack_tensor(const std::string &key, void *data, const std::vector<size_t> &dims,
+                       SRTensorType type, SRMemoryLayout layout) override;
+    void delete_tensor(const std::string &key) override;
+    void delete_tensors(const std::vector<std::string> &keys) override;
+    bool tensor_exists(const std::string &key) override;
+    bool frame_exists(const std::string &key) override;
+    void take_frame(const std::string &key, std::vector<unsigned char> &frame) override;
+    void put_group(const std::string &key, const std::vector<GroupTensor> &tensors,
+                   const std::vector<GroupMeta> &meta) override;
+    void take_group(const std::string &key, std::vector<GroupData> &tensors) override;
+    bool wait_for(const std::string &key, bool frame, int timeout_us) override;
+
+private:
+    Transport *inner;
+    std::shared_ptr<RecordLog> log;
+};
+
+// No store: puts are dropped and every key reads back, in order, what the
+// recorded run read under it (GET and FRAME records of the log). A read
+// past the end of a key's records finds nothing, like an agent that stopped;
+// a taken group (TAKE) counts as a frame;
+// so does every read without a log (empty path).
+class ReplayTransport : public Transport {
+public:
+    explicit ReplayTransport(const std::string &path);
+    ~ReplayTransport() override;
+
+    void put_tensor(const std::string &key, const void *data, const std::vector<size_t> &dims,
+                    SRTensorType type, SRMemoryLayout layout) override;
+    void unpack_tensor(const std::string &key, void *data, const std::vector<size_t> &dims,
+                       SRTensorType type, SRMemoryLayout layout) override;
+    void delete_tensor(const std::string &key) override;
+    bool tensor_exists(const std::string &key) override;
+    bool frame_exists(const std::string &key) override;
+    void take_frame(const std::string &key, std::vector<unsigned char> &frame) override;
+    void put_group(const std::string &key, const std::vector<GroupTensor> &tensors,
+                   const std::vector<GroupMeta> &meta) override;
+    void take_group(const std::string &key, std::vector<GroupData> &tensors) override;
+    // Answers at once while the key has records left
+    bool wait_for(const std::string &key, bool frame, int timeout_us) override;
+
+private:
+    struct Entry {
+        uint32_t kind = 0;
+        uint32_t type = 0;
+        std::vector<size_t> dims;
+        uint64_t nbytes = 0;
+        const unsigned char *payload = nullptr;
+    };
+
+    const Entry *front(const std::string &key, bool frame);
+
+    std::string file;
+    unsigned char *base;
+    size_t size;
+    std::unordered_map<std::string, std::deque<Entry>> entries;
+};
+
+#endif
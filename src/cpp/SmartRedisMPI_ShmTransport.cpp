@@ -0,0 +1,379 @@
+#include "SmartRedisMPI_ShmTransport.h"
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+namespace {
+
+const uint64_t SHM_MAGIC = 0x4d485349504d5253ULL; // "SRMPISHM" as a little-endian u64
+const uint32_t SHM_VERSION = 1;
+const size_t HEADER_BYTES = 128;
+const size_t SLOT_HEADER_BYTES = 128;
+const size_t MAX_DIMS = 8;
+const uint64_t MIN_CAPACITY = 4096;
+
+// Header fields
+const size_t H_MAGIC = 0, H_VERSION = 8, H_NSLOTS = 12, H_CAPACITY = 16, H_STRIDE = 24,
+             H_WRITE_SEQ = 32, H_READ_SEQ = 40, H_NOTIFY = 48, H_RETIRED = 52;
+// Slot header fields
+const size_t S_STATE = 0, S_TYPE = 8, S_NDIMS = 12, S_NBYTES = 16, S_DIMS = 24, S_LAYOUT = 88;
+
+template <typename T>
+T *field(unsigned char *base, size_t offset) { return reinterpret_cast<T*>(base + offset); }
+
+template <typename T>
+T load_acquire(unsigned char *base, size_t offset) { return __atomic_load_n(field<T>(base, offset), __ATOMIC_ACQUIRE); }
+
+template <typename T>
+void store_release(unsigned char *base, size_t offset, T v) { __atomic_store_n(field<T>(base, offset), v, __ATOMIC_RELEASE); }
+
+uint32_t slot_count(unsigned char *base) { return *field<uint32_t>(base, H_NSLOTS); }
+uint64_t slot_capacity(unsigned char *base) { return *field<uint64_t>(base, H_CAPACITY); }
+
+unsigned char *slot_at(unsigned char *base, uint64_t seq) {
+    return base + HEADER_BYTES + (seq % slot_count(base)) * *field<uint64_t>(base, H_STRIDE);
+}
+
+// Oldest message still in the ring: a lapped reader skips ahead
+uint64_t oldest(uint64_t read_seq, uint64_t write_seq, uint32_t n_slots) {
+    return std::max(read_seq, write_seq > n_slots ? write_seq - n_slots : 0);
+}
+
+// Shared (not process-private) futex on the header's notify word
+void futex_wake(unsigned char *base) {
+    syscall(SYS_futex, field<uint32_t>(base, H_NOTIFY), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+void futex_wait(unsigned char *base, uint32_t seen, long timeout_us) {
+    struct timespec ts;
+    ts.tv_sec = timeout_us / 1000000;
+    ts.tv_nsec = (timeout_us % 1000000) * 1000;
+    syscall(SYS_futex, field<uint32_t>(base, H_NOTIFY), FUTEX_WAIT, seen, &ts, nullptr, 0);
+}
+
+size_t type_size(uint32_t type) {
+    switch (type) {
+    case SRTensorTypeDouble:
+    case SRTensorTypeInt64: return 8;
+    case SRTensorTypeFloat:
+    case SRTensorTypeInt32: return 4;
+    case SRTensorTypeInt16:
+    case SRTensorTypeUint16: return 2;
+    default: return 1;
+    }
+}
+
+} // namespace
+
+ShmTransport::ShmTransport()
+: prefix("srmpi"), n_slots(4) {
+    if (const char *v = std::getenv("SRMPI_SHM_PREFIX")) prefix = v;
+    if (const char *v = std::getenv("SRMPI_SHM_SLOTS")) n_slots = static_cast<uint32_t>(std::max(1, std::atoi(v)));
+}
+
+ShmTransport::~ShmTransport() {
+    for (auto &kv : segments) munmap(kv.second.base, kv.second.size);
+}
+
+std::string ShmTransport::segment_name(const std::string &key) const {
+    std::string name = "/" + prefix + "." + key;
+    std::replace(name.begin() + 1, name.end(), '/', '_');
+    return name;
+}
+
+// === Segments ===
+
+bool ShmTransport::map_segment(const std::string &name, Segment &seg) const {
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < HEADER_BYTES) {
+        close(fd);
+        return false;  // still being created
+    }
+    void *p = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return false;
+    unsigned char *base = static_cast<unsigned char*>(p);
+    if (load_acquire<uint64_t>(base, H_MAGIC) != SHM_MAGIC || *field<uint32_t>(base, H_VERSION) != SHM_VERSION ||
+        HEADER_BYTES + slot_count(base) * *field<uint64_t>(base, H_STRIDE) > static_cast<size_t>(st.st_size)) {
+        munmap(p, st.st_size);
+        return false;
+    }
+    seg.base = base;
+    seg.size = st.st_size;
+    return true;
+}
+
+bool ShmTransport::create_segment(const std::string &name, uint64_t capacity, const Segment *from, Segment &seg) const {
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) return false;
+    const uint64_t stride = SLOT_HEADER_BYTES + (capacity + 63) / 64 * 64;
+    const size_t size = HEADER_BYTES + n_slots * stride;
+    void *p = MAP_FAILED;
+    if (ftruncate(fd, size) == 0)
+        p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        throw std::runtime_error("SmartRedisMPI: cannot size shared-memory segment '" + name + "'");
+    }
+    unsigned char *base = static_cast<unsigned char*>(p);
+    *field<uint32_t>(base, H_VERSION) = SHM_VERSION;
+    *field<uint32_t>(base, H_NSLOTS) = n_slots;
+    *field<uint64_t>(base, H_CAPACITY) = capacity;
+    *field<uint64_t>(base, H_STRIDE) = stride;
+    // A replaced segment hands over its unread messages under their sequence numbers
+    uint64_t w = 0, r = 0;
+    if (from) {
+        w = load_acquire<uint64_t>(from->base, H_WRITE_SEQ);
+        r = oldest(oldest(load_acquire<uint64_t>(from->base, H_READ_SEQ), w, slot_count(from->base)), w, n_slots);
+        for (uint64_t q=r;q<w;q++) {
+            unsigned char *src = slot_at(from->base, q);
+            std::memcpy(slot_at(base, q), src, SLOT_HEADER_BYTES + *field<uint64_t>(src, S_NBYTES));
+        }
+    }
+    *field<uint64_t>(base, H_WRITE_SEQ) = w;
+    *field<uint64_t>(base, H_READ_SEQ) = r;
+    store_release<uint64_t>(base, H_MAGIC, SHM_MAGIC);  // readers map only complete headers
+    seg.base = base;
+    seg.size = size;
+    return true;
+}
+
+ShmTransport::Segment *ShmTransport::producer_segment(const std::string &key, uint64_t nbytes) {
+    auto it = segments.find(key);
+    if (it != segments.end() && slot_capacity(it->second.base) >= nbytes) return &it->second;
+
+    const std::string name = segment_name(key);
+    Segment seg;
+    if (it != segments.end()) {
+        seg = it->second;
+        segments.erase(it);
+    } else if (map_segment(name, seg) && slot_capacity(seg.base) >= nbytes &&
+               !load_acquire<uint32_t>(seg.base, H_RETIRED)) {
+        return &segments.emplace(key, seg).first->second;
+    }
+
+    // Too small (or absent): retire it and start a larger one where it left off
+    Segment fresh;
+    if (!seg.base) {
+        if (!create_segment(name, std::max(nbytes, MIN_CAPACITY), nullptr, fresh))
+            throw std::runtime_error("SmartRedisMPI: cannot create shared-memory segment '" + name +
+                                     "': " + std::strerror(errno));
+        return &segments.emplace(key, fresh).first->second;
+    }
+    store_release<uint32_t>(seg.base, H_RETIRED, 1);
+    shm_unlink(name.c_str());
+    const bool created = create_segment(name, std::max(nbytes, 2 * slot_capacity(seg.base)), &seg, fresh);
+    __atomic_add_fetch(field<uint32_t>(seg.base, H_NOTIFY), 1, __ATOMIC_RELEASE);
+    futex_wake(seg.base);
+    munmap(seg.base, seg.size);
+    if (!created)
+        throw std::runtime_error("SmartRedisMPI: cannot create shared-memory segment '" + name +
+                                 "': " + std::strerror(errno));
+    return &segments.emplace(key, fresh).first->second;
+}
+
+ShmTransport::Segment *ShmTransport::consumer_segment(const std::string &key) {
+    auto it = segments.find(key);
+    Segment seg;
+    if (it != segments.end()) {
+        Segment &old = it->second;
+        if (!load_acquire<uint32_t>(old.base, H_RETIRED) || available(old)) return &old;
+        // Drained a retired segment: switch once its successor exists, skipping
+        // the handed-over messages consumed here
+        if (!map_segment(segment_name(key), seg)) return &old;
+        const uint64_t consumed = load_acquire<uint64_t>(old.base, H_READ_SEQ);
+        if (load_acquire<uint64_t>(seg.base, H_READ_SEQ) < consumed)
+            store_release<uint64_t>(seg.base, H_READ_SEQ, consumed);
+        munmap(old.base, old.size);
+        old = seg;
+        return &old;
+    }
+    if (!map_segment(segment_name(key), seg)) return nullptr;
+    return &segments.emplace(key, seg).first->second;
+}
+
+// === Slots ===
+
+bool ShmTransport::available(const Segment &seg) const {
+    return load_acquire<uint64_t>(seg.base, H_WRITE_SEQ) > load_acquire<uint64_t>(seg.base, H_READ_SEQ);
+}
+
+bool ShmTransport::read_oldest(Segment &seg, Message &msg, void *out, uint64_t out_bytes,
+                               std::vector<unsigned char> *grow) {
+    for (;;) {
+        const uint64_t w = load_acquire<uint64_t>(seg.base, H_WRITE_SEQ);
+        const uint64_t r = load_acquire<uint64_t>(seg.base, H_READ_SEQ);
+        if (w <= r) return false;
+        const uint64_t s = oldest(r, w, slot_count(seg.base));
+        unsigned char *slot = slot_at(seg.base, s);
+        const uint64_t state = load_acquire<uint64_t>(slot, S_STATE);
+        if (state != 2 * s + 2) continue;  // lapped while reading the counters
+
+        msg.type = *field<uint32_t>(slot, S_TYPE);
+        msg.layout = *field<uint32_t>(slot, S_LAYOUT);
+        msg.nbytes = *field<uint64_t>(slot, S_NBYTES);
+        const uint32_t ndims = std::min<uint32_t>(*field<uint32_t>(slot, S_NDIMS), MAX_DIMS);
+        msg.dims.assign(field<uint64_t>(slot, S_DIMS), field<uint64_t>(slot, S_DIMS) + ndims);
+        const uint64_t nbytes = std::min(msg.nbytes, slot_capacity(seg.base));
+        if (grow) {
+            grow->resize(nbytes);
+            out = grow->data();
+            out_bytes = nbytes;
+        }
+        if (nbytes == out_bytes && nbytes > 0)
+            std::memcpy(out, slot + SLOT_HEADER_BYTES, nbytes);
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(field<uint64_t>(slot, S_STATE), __ATOMIC_RELAXED) == state) return true;
+    }
+}
+
+void ShmTransport::consume(Segment &seg) {
+    const uint64_t w = load_acquire<uint64_t>(seg.base, H_WRITE_SEQ);
+    const uint64_t r = load_acquire<uint64_t>(seg.base, H_READ_SEQ);
+    if (w <= r) return;
+    store_release<uint64_t>(seg.base, H_READ_SEQ, oldest(r, w, slot_count(seg.base)) + 1);
+}
+
+// === Transport ===
+
+void ShmTransport::put_tensor(const std::string &key, const void *data, const std::vector<size_t> &dims,
+                              SRTensorType type, SRMemoryLayout layout) {
+    if (dims.size() > MAX_DIMS)
+        throw std::invalid_argument("SmartRedisMPI: shared-memory tensors have at most 8 dimensions");
+    uint64_t n = 1;
+    for (size_t d : dims) n *= d;
+    const uint64_t nbytes = n * type_size(type);
+    Segment *seg = producer_segment(key, nbytes);
+
+    // Single producer: the slot is ours, readers retry while it is odd
+    const uint64_t s = *field<uint64_t>(seg->base, H_WRITE_SEQ);
+    unsigned char *slot = slot_at(seg->base, s);
+    __atomic_store_n(field<uint64_t>(slot, S_STATE), 2 * s + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    *field<uint32_t>(slot, S_TYPE) = type;
+    *field<uint32_t>(slot, S_NDIMS) = static_cast<uint32_t>(dims.size());
+    *field<uint64_t>(slot, S_NBYTES) = nbytes;
+    for (size_t i=0;i<dims.size();i++) field<uint64_t>(slot, S_DIMS)[i] = dims[i];
+    *field<uint32_t>(slot, S_LAYOUT) = layout;
+    if (nbytes > 0) std::memcpy(slot + SLOT_HEADER_BYTES, data, nbytes);
+    store_release<uint64_t>(slot, S_STATE, 2 * s + 2);
+    store_release<uint64_t>(seg->base, H_WRITE_SEQ, s + 1);
+
+    __atomic_add_fetch(field<uint32_t>(seg->base, H_NOTIFY), 1, __ATOMIC_RELEASE);
+    futex_wake(seg->base);
+}
+
+void ShmTransport::unpack_tensor(const std::string &key, void *data, const std::vector<size_t> &dims,
+                                 SRTensorType type, SRMemoryLayout layout) {
+    Segment *seg = consumer_segment(key);
+    Message msg;
+    uint64_t n = 1;
+    for (size_t d : dims) n *= d;
+    const uint64_t nbytes = n * type_size(type);
+    if (!seg || !read_oldest(*seg, msg, data, nbytes, nullptr))
+        throw std::runtime_error("SmartRedisMPI: no tensor '" + key + "' in shared memory");
+    if (msg.type != static_cast<uint32_t>(type) || msg.nbytes != nbytes || msg.dims.size() != dims.size() ||
+        (dims.size() > 1 && msg.layout != static_cast<uint32_t>(layout)))
+        throw std::runtime_error("SmartRedisMPI: '" + key + "' does not match the requested type and shape");
+}
+
+void ShmTransport::delete_tensor(const std::string &key) {
+    Segment *seg = consumer_segment(key);
+    if (seg) consume(*seg);
+}
+
+void ShmTransport::delete_tensors(const std::vector<std::string> &keys) {
+    for (const std::string &key : keys) {
+        auto it = segments.find(key);
+        if (it != segments.end()) {
+            munmap(it->second.base, it->second.size);
+            segments.erase(it);
+        }
+        shm_unlink(segment_name(key).c_str());
+    }
+}
+
+bool ShmTransport::tensor_exists(const std::string &key) {
+    Segment *seg = consumer_segment(key);
+    return seg && available(*seg);
+}
+
+bool ShmTransport::frame_exists(const std::string &key) {
+    return tensor_exists(key);
+}
+
+void ShmTransport::take_frame(const std::string &key, std::vector<unsigned char> &frame) {
+    Segment *seg = consumer_segment(key);
+    Message msg;
+    if (!seg || !read_oldest(*seg, msg, nullptr, 0, &frame))
+        throw std::runtime_error("SmartRedisMPI: no frame '" + key + "' in shared memory");
+    if (msg.type != SRTensorTypeUint8 || msg.dims.size() != 1)
+        throw std::runtime_error("SmartRedisMPI: '" + key + "' does not hold a uint8 frame");
+    consume(*seg);
+}
+
+void ShmTransport::put_group(const std::string &key, const std::vector<GroupTensor> &tensors,
+                             const std::vector<GroupMeta> &meta) {
+    for (const GroupTensor &t : tensors)
+        put_tensor(key + "." + t.name, t.data, t.dims, t.type, SRMemLayoutContiguous);
+    for (const GroupMeta &m : meta) {
+        // Empty entries are written too, so readers find every name each step
+        if (!m.ints.empty())
+            put_tensor(key + "." + m.name, m.ints.data(), {m.ints.size()}, SRTensorTypeInt32, SRMemLayoutContiguous);
+        else
+            put_tensor(key + "." + m.name, m.doubles.data(), {m.doubles.size()}, SRTensorTypeDouble, SRMemLayoutContiguous);
+    }
+    int32_t entries = static_cast<int32_t>(tensors.size() + meta.size());
+    put_tensor(key, &entries, {1}, SRTensorTypeInt32, SRMemLayoutContiguous);
+}
+
+void ShmTransport::take_group(const std::string &key, std::vector<GroupData> &tensors) {
+    Segment *marker = consumer_segment(key);
+    if (!marker || !available(*marker))
+        throw std::runtime_error("SmartRedisMPI: no group '" + key + "' in shared memory");
+    // Entries are published before the marker, so all of them are here
+    for (GroupData &t : tensors) {
+        Segment *seg = consumer_segment(key + "." + t.name);
+        Message msg;
+        t.found = seg && read_oldest(*seg, msg, nullptr, 0, &t.bytes);
+        t.count = 0;
+        if (!t.found) {
+            t.bytes.clear();
+            continue;
+        }
+        t.type = static_cast<SRTensorType>(msg.type);
+        t.count = t.bytes.size() / type_size(msg.type);
+        consume(*seg);
+    }
+    consume(*marker);
+}
+
+bool ShmTransport::wait_for(const std::string &key, bool, int timeout_us) {
+    typedef std::chrono::steady_clock clock;
+    const clock::time_point deadline = clock::now() + std::chrono::microseconds(std::max(timeout_us, 0));
+    for (;;) {
+        Segment *seg = consumer_segment(key);
+        const uint32_t seen = seg ? load_acquire<uint32_t>(seg->base, H_NOTIFY) : 0;
+        if (seg && available(*seg)) return true;
+        const long remaining = std::chrono::duration_cast<std::chrono::microseconds>(deadline - clock::now()).count();
+        if (remaining <= 0) return false;
+        // Without a segment there is nothing to sleep on yet
+        if (seg) futex_wait(seg->base, seen, remaining);
+        else std::this_thread::sleep_for(std::chrono::microseconds(std::min(remaining, 100L)));
+    }
+}
@@ -0,0 +1,89 @@
+#ifndef SMARTREDIS_MPI_SHM_TRANSPORT_H
+#define SMARTREDIS_MPI_SHM_TRANSPORT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "SmartRedisMPI_Transport.h"
+
+// Node-local transport: every key is a POSIX shared-memory segment
+// /<prefix>.<key> ('/' in keys becomes '_') holding a ring of n_slots
+// sequence-numbered slots. A put publishes the next slot and wakes waiters
+// through a futex in the header; a read returns the oldest unconsumed slot
+// and a delete consumes it, so a reader that keeps up sees every message in
+// order and a slow one skips to the newest n_slots. One producer and one
+// consumer per key (shard keys keep writers apart).
+//   SRMPI_SHM_PREFIX  segment name prefix (default "srmpi")
+//   SRMPI_SHM_SLOTS   slots per new segment (default 4)
+// Segments outlive the job; remove stale ones (/dev/shm/<prefix>.*) before
+// a new run. The segment layout is mirrored by src/python/srmpi_shm.py.
+//
+// Layout, little-endian, offsets in bytes:
+//   header (128):  0 magic "SRMPISHM", 8 u32 version, 12 u32 n_slots,
+//                  16 u64 slot_capacity, 24 u64 slot_stride, 32 u64 write_seq,
+//                  40 u64 read_seq, 48 u32 notify (futex), 52 u32 retired
+//   slot i at 128 + i*slot_stride, header (128): 0 u64 state (2s+1 while
+//                  message s is written, 2s+2 once ready), 8 u32 type
+//                  (SRTensorType), 12 u32 ndims, 16 u64 nbytes, 24 u64 dims[8],
+//                  88 u32 layout (SRMemoryLayout); payload follows
+// A put larger than slot_capacity retires the segment (retired = 1, unlink)
+// and recreates it with the unread slots copied over under their sequence
+// numbers; a reader drains its old mapping, then switches and skips what it
+// already consumed.
+class ShmTransport : public Transport {
+public:
+    ShmTransport();
+    ~ShmTransport() override;
+
+    void put_tensor(const std::string &key, const void *data, const std::vector<size_t> &dims,
+                    SRTensorType type, SRMemoryLayout layout) override;
+    void unpack_tensor(const std::string &key, void *data, const std::vector<size_t> &dims,
+                       SRTensorType type, SRMemoryLayout layout) override;
+    void delete_tensor(const std::string &key) override;
+    // Unlinks the segments of the keys; peers that still map one keep it
+    // until they unmap
+    void delete_tensors(const std::vector<std::string> &keys) override;
+    bool tensor_exists(const std::string &key) override;
+    bool frame_exists(const std::string &key) override;
+    void take_frame(const std::string &key, std::vector<unsigned char> &frame) override;
+    // Tensors and metadata become <key>.<name>, published before the marker
+    // tensor <key> (int32, number of entries) that readers wait on
+    void put_group(const std::string &key, const std::vector<GroupTensor> &tensors,
+                   const std::vector<GroupMeta> &meta) override;
+    // Takes the named <key>.<name> that have a message, then the marker
+    void take_group(const std::string &key, std::vector<GroupData> &tensors) override;
+    // Sleeps on the segment's futex instead of polling
+    bool wait_for(const std::string &key, bool frame, int timeout_us) override;
+
+private:
+    struct Segment {
+        unsigned char *base = nullptr;
+        size_t size = 0;
+    };
+    // Header and payload of one message, read under the slot's seqlock
+    struct Message {
+        uint32_t type = 0;
+        uint32_t layout = 0;
+        std::vector<size_t> dims;
+        uint64_t nbytes = 0;
+    };
+
+    std::string segment_name(const std::string &key) const;
+    bool map_segment(const std::string &name, Segment &seg) const;
+    bool create_segment(const std::string &name, uint64_t capacity, const Segment *from, Segment &seg) const;
+    Segment *producer_segment(const std::string &key, uint64_t nbytes);
+    Segment *consumer_segment(const std::string &key);
+    bool available(const Segment &seg) const;
+    // Copy the oldest unconsumed message; out is resized by grow when given
+    bool read_oldest(Segment &seg, Message &msg, void *out, uint64_t out_bytes,
+                     std::vector<unsigned char> *grow);
+    void consume(Segment &seg);
+
+    std::string prefix;
+    uint32_t n_slots;
+    std::unordered_map<std::string, Segment> segments;
+};
+
+#endif
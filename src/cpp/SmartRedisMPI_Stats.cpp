@@ -0,0 +1,231 @@
+#include "SmartRedisMPI_Stats.h"
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <stdexcept>
+
+const char *stat_op_name(int op) {
+    static const char *names[OP_COUNT] = {
+        "put_state", "put_info", "put_fields", "get_action", "step_exchange", "iput", "put_scalar",
+        "put_batch", "get_batch", "put_sparse", "get_sparse",
+        "put_trajectory", "put_tensor", "get_tensor", "ring_gc", "policy_load", "policy_eval"
+    };
+    return (op >= 0 && op < OP_COUNT) ? names[op] : "unknown";
+}
+
+const char *stat_phase_name(int phase) {
+    static const char *names[PHASE_COUNT] = {"total", "mpi", "redis", "wait"};
+    return (phase >= 0 && phase < PHASE_COUNT) ? names[phase] : "unknown";
+}
+
+// === Latency histogram ===
+
+void LatencyStats::add(double seconds) {
+    if (count == 0 || seconds < min) min = seconds;
+    if (count == 0 || seconds > max) max = seconds;
+    count++;
+    total += seconds;
+    const double ns = seconds * 1e9;
+    int b = ns > 1.0 ? static_cast<int>(std::log2(ns) * 8.0) : 0;
+    hist[std::min(b, N_BUCKETS - 1)]++;
+}
+
+void LatencyStats::merge(const LatencyStats &other) {
+    if (other.count == 0) return;
+    if (count == 0 || other.min < min) min = other.min;
+    if (count == 0 || other.max > max) max = other.max;
+    count += other.count;
+    total += other.total;
+    for (int b=0;b<N_BUCKETS;b++) hist[b] += other.hist[b];
+}
+
+double LatencyStats::percentile(double q) const {
+    if (count == 0) return 0.0;
+    const uint64_t target = static_cast<uint64_t>(std::ceil(q * count));
+    uint64_t seen = 0;
+    for (int b=0;b<N_BUCKETS;b++) {
+        seen += hist[b];
+        if (seen >= target) return std::min(std::exp2((b + 1) / 8.0) * 1e-9, max);
+    }
+    return max;
+}
+
+// === Counters ===
+
+void ExchangeStats::enable(bool stats, bool trace, MPI_Comm comm) {
+    on = stats || trace;
+    if (trace && !trace_on) {
+        MPI_Barrier(comm);
+        origin = clock::now();
+        events.clear();
+    }
+    trace_on = trace;
+}
+
+void ExchangeStats::reset() {
+    entries.clear();
+    events.clear();
+    active = nullptr;
+    active_op = -1;
+    active_key = nullptr;
+}
+
+void ExchangeStats::merge(const ExchangeStats &other) {
+    for (const auto &kv : other.entries) {
+        OpStats &e = entries[kv.first];
+        e.calls += kv.second.calls;
+        e.bytes += kv.second.bytes;
+        for (int p=0;p<PHASE_COUNT;p++) e.phase[p].merge(kv.second.phase[p]);
+    }
+}
+
+OpStats &ExchangeStats::entry(int op, const std::string &key, const std::string *&stored_key) {
+    auto it = entries.emplace(std::make_pair(op, key), OpStats()).first;
+    stored_key = &it->first.second;
+    return it->second;
+}
+
+const OpStats *ExchangeStats::find(int op, const std::string &key) const {
+    auto it = entries.find(std::make_pair(op, key));
+    return it == entries.end() ? nullptr : &it->second;
+}
+
+void ExchangeStats::trace_event(int op, int phase, const std::string *key,
+                                clock::time_point start, clock::time_point end) {
+    TraceEvent ev;
+    ev.op = op;
+    ev.phase = phase;
+    ev.key = key;
+    ev.ts_us = std::chrono::duration<double, std::micro>(start - origin).count();
+    ev.dur_us = std::chrono::duration<double, std::micro>(end - start).count();
+    events.push_back(ev);
+}
+
+OpScope::OpScope(ExchangeStats &stats, int op, const std::string &key, size_t bytes)
+: stats(stats) {
+    if (!stats.enabled() || stats.active) return;
+    owner = true;
+    OpStats &e = stats.entry(op, key, stats.active_key);
+    e.calls++;
+    e.bytes += bytes;
+    stats.active = &e;
+    stats.active_op = op;
+    start = ExchangeStats::clock::now();
+}
+
+OpScope::~OpScope() {
+    if (!owner) return;
+    const ExchangeStats::clock::time_point end = ExchangeStats::clock::now();
+    if (stats.active) {
+        stats.active->phase[PHASE_TOTAL].add(std::chrono::duration<double>(end - start).count());
+        if (stats.tracing()) stats.trace_event(stats.active_op, PHASE_TOTAL, stats.active_key, start, end);
+    }
+    stats.active = nullptr;
+    stats.active_op = -1;
+    stats.active_key = nullptr;
+}
+
+PhaseScope::~PhaseScope() {
+    if (!on || !stats.active) return;
+    const ExchangeStats::clock::time_point end = ExchangeStats::clock::now();
+    stats.active->phase[phase].add(std::chrono::duration<double>(end - start).count());
+    if (stats.tracing()) stats.trace_event(stats.active_op, phase, stats.active_key, start, end);
+}
+
+// === Reports ===
+
+void ExchangeStats::dump(const std::string &path, MPI_Comm comm) const {
+    int rank = 0, nprocs = 1;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &nprocs);
+
+    // Rank 0's entry list, "op key" per line, defines the rows
+    std::string list;
+    if (rank == 0) {
+        for (const auto &kv : entries) list += std::to_string(kv.first.first) + " " + kv.first.second + "\n";
+    }
+    int len = static_cast<int>(list.size());
+    MPI_Bcast(&len, 1, MPI_INT, 0, comm);
+    list.resize(len);
+    MPI_Bcast(&list[0], len, MPI_CHAR, 0, comm);
+
+    std::vector<std::pair<int, std::string>> rows;
+    std::istringstream in(list);
+    std::string line;
+    while (std::getline(in, line)) {
+        const size_t sp = line.find(' ');
+        rows.emplace_back(std::stoi(line.substr(0, sp)), line.substr(sp + 1));
+    }
+
+    // MPI time per row across ranks: the spread shows who waits at the root
+    std::vector<double> mpi(rows.size(), 0.0), mpi_min(rows.size()), mpi_max(rows.size()), mpi_sum(rows.size());
+    for (size_t i=0;i<rows.size();i++) {
+        const OpStats *e = find(rows[i].first, rows[i].second);
+        if (e) mpi[i] = e->phase[PHASE_MPI].total;
+    }
+    const int n = static_cast<int>(rows.size());
+    MPI_Reduce(mpi.data(), mpi_min.data(), n, MPI_DOUBLE, MPI_MIN, 0, comm);
+    MPI_Reduce(mpi.data(), mpi_max.data(), n, MPI_DOUBLE, MPI_MAX, 0, comm);
+    MPI_Reduce(mpi.data(), mpi_sum.data(), n, MPI_DOUBLE, MPI_SUM, 0, comm);
+    if (rank != 0) return;
+
+    std::ofstream file;
+    if (!path.empty()) {
+        file.open(path);
+        if (!file) throw std::runtime_error("SmartRedisMPI: cannot write stats to '" + path + "'");
+    }
+    std::ostream &out = path.empty() ? std::cout : file;
+    const double ms = 1e3;
+    out << std::fixed << std::setprecision(3);
+    out << "# SmartRedisMPI stats, rank 0 of " << nprocs << ", times in ms\n";
+    out << "# op key calls bytes | total mean min max p99 | mpi mean p99 | redis mean p99 | wait mean p99"
+           " | mpi_total rank_min rank_mean rank_max imbalance\n";
+    for (size_t i=0;i<rows.size();i++) {
+        const OpStats &e = *find(rows[i].first, rows[i].second);
+        const LatencyStats &t = e.phase[PHASE_TOTAL];
+        out << stat_op_name(rows[i].first) << " " << rows[i].second << " " << e.calls << " " << e.bytes
+            << " | " << t.mean()*ms << " " << t.min*ms << " " << t.max*ms << " " << t.percentile(0.99)*ms;
+        for (int p=PHASE_MPI;p<PHASE_COUNT;p++)
+            out << " | " << e.phase[p].mean()*ms << " " << e.phase[p].percentile(0.99)*ms;
+        out << " | " << mpi_min[i]*ms << " " << mpi_sum[i]/nprocs*ms << " " << mpi_max[i]*ms
+            << " " << (mpi_max[i] - mpi_min[i])*ms << "\n";
+    }
+    out.flush();
+}
+
+static std::string json_escape(const std::string &s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (static_cast<unsigned char>(c) < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+            continue;
+        }
+        out += c;
+    }
+    return out;
+}
+
+void ExchangeStats::dump_trace(const std::string &prefix, int rank) const {
+    const std::string path = prefix + "." + std::to_string(rank) + ".json";
+    std::ofstream out(path);
+    if (!out) throw std::runtime_error("SmartRedisMPI: cannot write trace to '" + path + "'");
+    out << std::fixed << std::setprecision(3);
+    out << "{\"traceEvents\":[";
+    for (size_t i=0;i<events.size();i++) {
+        const TraceEvent &ev = events[i];
+        // One row per phase under the rank's process
+        out << (i ? ",\n" : "\n")
+            << "{\"name\":\"" << stat_op_name(ev.op) << "\",\"cat\":\"" << stat_phase_name(ev.phase)
+            << "\",\"ph\":\"X\",\"ts\":" << ev.ts_us << ",\"dur\":" << ev.dur_us
+            << ",\"pid\":" << rank << ",\"tid\":" << ev.phase
+            << ",\"args\":{\"key\":\"" << json_escape(ev.key ? *ev.key : std::string()) << "\"}}";
+    }
+    out << "\n]}\n";
+}
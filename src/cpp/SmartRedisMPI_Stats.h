@@ -0,0 +1,140 @@
+#ifndef SMARTREDIS_MPI_STATS_H
+#define SMARTREDIS_MPI_STATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <mpi.h>
+
+// Public operations with their own counters
+enum StatOp {
+    OP_PUT_STATE = 0,      // put_state, put_reward, put_state_nd
+    OP_PUT_INFO = 1,
+    OP_PUT_FIELDS = 2,
+    OP_GET_ACTION = 3,     // get_action, wait_action
+    OP_STEP_EXCHANGE = 4,
+    OP_IPUT = 5,           // iput_* start (gather posted, write queued later)
+    OP_PUT_SCALAR = 6,     // put_step_type, put_real_scalar
+    OP_PUT_BATCH = 7,      // put_states, keyed by the comma-joined keys
+    OP_GET_BATCH = 8,      // get_actions, wait_actions
+    OP_PUT_SPARSE = 9,     // put_state_sparse, put_state_masked, put_state_delta
+    OP_GET_SPARSE = 10,    // get_action_sparse, wait_action_sparse
+    OP_PUT_TRAJECTORY = 11, // trajectory flushes
+    OP_PUT_TENSOR = 12,    // typed put_tensor
+    OP_GET_TENSOR = 13,    // typed get_tensor, wait_tensor
+    OP_RING_GC = 14,       // deletes of expired ring slots, keyed by the comma-joined keys
+    OP_POLICY_LOAD = 15,   // local policy refreshes, keyed by action key
+    OP_POLICY_EVAL = 16,   // local policy evaluations (get_action served in process)
+    OP_COUNT = 17
+};
+
+// Where the time of an operation went
+enum StatPhase {
+    PHASE_TOTAL = 0,   // whole call
+    PHASE_MPI = 1,     // gather / scatter / readiness agreement
+    PHASE_REDIS = 2,   // client calls on the writer
+    PHASE_WAIT = 3,    // writer polling for the agent's action
+    PHASE_COUNT = 4
+};
+
+const char *stat_op_name(int op);
+const char *stat_phase_name(int phase);
+
+// Latency summary; percentiles come from a log histogram with 8 buckets
+// per power of two (about 9% resolution), from 1 ns up to ~18 minutes
+struct LatencyStats {
+    static const int N_BUCKETS = 8 * 40;
+    uint64_t count = 0;
+    double total = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+    uint32_t hist[N_BUCKETS] = {};
+
+    void add(double seconds);
+    void merge(const LatencyStats &other);
+    double mean() const { return count ? total / count : 0.0; }
+    double percentile(double q) const;
+};
+
+struct OpStats {
+    uint64_t calls = 0;
+    uint64_t bytes = 0;        // local bytes sent or received by this rank
+    LatencyStats phase[PHASE_COUNT];
+};
+
+// Per-rank counters and optional Chrome trace timeline. Disabled by default;
+// then OpScope/PhaseScope only test one flag and read no clock.
+class ExchangeStats {
+public:
+    typedef std::chrono::steady_clock clock;
+
+    bool enabled() const { return on; }
+    bool tracing() const { return trace_on; }
+    // Collective when trace is set: ranks align their time origin on a barrier
+    void enable(bool stats, bool trace, MPI_Comm comm);
+    void reset();
+    // Add the counters (not the trace) of other, e.g. of another thread's lane
+    void merge(const ExchangeStats &other);
+
+    // Innermost public call in progress, nullptr outside calls or when disabled
+    OpStats *active = nullptr;
+    int active_op = -1;
+    const std::string *active_key = nullptr;
+
+    OpStats &entry(int op, const std::string &key, const std::string *&stored_key);
+    const OpStats *find(int op, const std::string &key) const;
+    void trace_event(int op, int phase, const std::string *key, clock::time_point start, clock::time_point end);
+
+    // Collective over comm: reduces the MPI time of every entry of rank 0
+    // (min / mean / max over ranks) and rank 0 writes the table to path,
+    // or to stdout when path is empty
+    void dump(const std::string &path, MPI_Comm comm) const;
+    // Per rank: <prefix>.<rank>.json in Chrome trace event format
+    void dump_trace(const std::string &prefix, int rank) const;
+
+private:
+    struct TraceEvent {
+        int op;
+        int phase;
+        const std::string *key;
+        double ts_us;
+        double dur_us;
+    };
+
+    bool on = false;
+    bool trace_on = false;
+    clock::time_point origin = clock::now();
+    std::map<std::pair<int, std::string>, OpStats> entries;
+    std::vector<TraceEvent> events;
+};
+
+// Scope of one public call: the outermost scope claims the counters
+class OpScope {
+public:
+    OpScope(ExchangeStats &stats, int op, const std::string &key, size_t bytes);
+    ~OpScope();
+private:
+    ExchangeStats &stats;
+    bool owner = false;
+    ExchangeStats::clock::time_point start;
+};
+
+// Time of one phase within the active call
+class PhaseScope {
+public:
+    PhaseScope(ExchangeStats &stats, int phase)
+    : stats(stats), phase(phase), on(stats.active != nullptr) {
+        if (on) start = ExchangeStats::clock::now();
+    }
+    ~PhaseScope();
+private:
+    ExchangeStats &stats;
+    int phase;
+    bool on;
+    ExchangeStats::clock::time_point start;
+};
+
+#endif
@@ -0,0 +1,124 @@
+#include "SmartRedisMPI_Transport.h"
+#include "SmartRedisMPI_ShmTransport.h"
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <stdexcept>
+
+namespace {
+
+size_t type_size(uint32_t type) {
+    switch (type) {
+    case SRTensorTypeDouble:
+    case SRTensorTypeInt64: return 8;
+    case SRTensorTypeFloat:
+    case SRTensorTypeInt32: return 4;
+    case SRTensorTypeInt16:
+    case SRTensorTypeUint16: return 2;
+    default: return 1;
+    }
+}
+
+} // namespace
+
+bool Transport::wait_for(const std::string &key, bool frame, int timeout_us) {
+    if (timeout_us > 0) std::this_thread::sleep_for(std::chrono::microseconds(timeout_us));
+    return frame ? frame_exists(key) : tensor_exists(key);
+}
+
+void Transport::delete_tensors(const std::vector<std::string> &keys) {
+    for (const std::string &key : keys) delete_tensor(key);
+}
+
+int default_transport_kind() {
+    const char *v = std::getenv("SRMPI_TRANSPORT");
+    if (v && std::strcmp(v, "shm") == 0) return TRANSPORT_SHM;
+    if (v && std::strcmp(v, "replay") == 0) return TRANSPORT_REPLAY;
+    return TRANSPORT_SMARTREDIS;
+}
+
+bool transport_kind_valid(int kind) {
+    return kind == TRANSPORT_SMARTREDIS || kind == TRANSPORT_SHM || kind == TRANSPORT_REPLAY;
+}
+
+Transport *create_transport(int kind, bool clustered) {
+    switch (kind) {
+    case TRANSPORT_SMARTREDIS: return new SmartRedisTransport(clustered);
+    case TRANSPORT_SHM: return new ShmTransport();
+    case TRANSPORT_REPLAY: throw std::invalid_argument("SmartRedisMPI: the replay transport needs a record log");
+    default: throw std::invalid_argument("SmartRedisMPI: unknown transport");
+    }
+}
+
+// === SmartRedis ===
+
+SmartRedisTransport::SmartRedisTransport(bool clustered)
+: client(clustered, "default") {}
+
+void SmartRedisTransport::put_tensor(const std::string &key, const void *data, const std::vector<size_t> &dims,
+                                     SRTensorType type, SRMemoryLayout layout) {
+    client.put_tensor(key, data, dims, type, layout);
+}
+
+void SmartRedisTransport::unpack_tensor(const std::string &key, void *data, const std::vector<size_t> &dims,
+                                        SRTensorType type, SRMemoryLayout layout) {
+    client.unpack_tensor(key, data, dims, type, layout);
+}
+
+void SmartRedisTransport::delete_tensor(const std::string &key) {
+    client.delete_tensor(key);
+}
+
+bool SmartRedisTransport::tensor_exists(const std::string &key) {
+    return client.tensor_exists(key);
+}
+
+bool SmartRedisTransport::frame_exists(const std::string &key) {
+    return client.dataset_exists(key);
+}
+
+void SmartRedisTransport::take_frame(const std::string &key, std::vector<unsigned char> &frame) {
+    SmartRedis::DataSet dataset = client.get_dataset(key);
+    void *data = nullptr;
+    std::vector<size_t> dims;
+    SRTensorType type;
+    dataset.get_tensor("frame", data, dims, type, SRMemLayoutContiguous);
+    if (type != SRTensorTypeUint8 || dims.size() != 1)
+        throw std::runtime_error("SmartRedisMPI: '" + key + "' does not hold a uint8 frame");
+    const unsigned char *bytes = static_cast<const unsigned char*>(data);
+    frame.assign(bytes, bytes + dims[0]);
+    client.delete_dataset(key);
+}
+
+void SmartRedisTransport::put_group(const std::string &key, const std::vector<GroupTensor> &tensors,
+                                    const std::vector<GroupMeta> &meta) {
+    SmartRedis::DataSet dataset(key);
+    for (const GroupTensor &t : tensors)
+        dataset.add_tensor(t.name, t.data, t.dims, t.type, SRMemLayoutContiguous);
+    for (const GroupMeta &m : meta) {
+        for (const int32_t &v : m.ints) dataset.add_meta_scalar(m.name, &v, SRMetadataTypeInt32);
+        for (const double &v : m.doubles) dataset.add_meta_scalar(m.name, &v, SRMetadataTypeDouble);
+    }
+    client.put_dataset(dataset);
+}
+
+void SmartRedisTransport::take_group(const std::string &key, std::vector<GroupData> &tensors) {
+    SmartRedis::DataSet dataset = client.get_dataset(key);
+    const std::vector<std::string> names = dataset.get_tensor_names();
+    for (GroupData &t : tensors) {
+        t.found = std::find(names.begin(), names.end(), t.name) != names.end();
+        t.bytes.clear();
+        t.count = 0;
+        if (!t.found) continue;
+        void *data = nullptr;
+        std::vector<size_t> dims;
+        dataset.get_tensor(t.name, data, dims, t.type, SRMemLayoutContiguous);
+        t.count = 1;
+        for (size_t d : dims) t.count *= d;
+        const unsigned char *bytes = static_cast<const unsigned char*>(data);
+        t.bytes.assign(bytes, bytes + t.count * type_size(t.type));
+    }
+    client.delete_dataset(key);
+}
@@ -0,0 +1,104 @@
+#ifndef SMARTREDIS_MPI_TRANSPORT_H
+#define SMARTREDIS_MPI_TRANSPORT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "client.h"
+
+// Backends a writer rank can talk to
+enum TransportKind {
+    TRANSPORT_SMARTREDIS = 0, // SmartRedis client (Redis over TCP)
+    TRANSPORT_SHM = 1,        // node-local POSIX shared-memory rings
+    TRANSPORT_REPLAY = 2      // a record log, no store (SmartRedisMPI_Record.h)
+};
+
+// One tensor of a group written with put_group
+struct GroupTensor {
+    std::string name;
+    const void *data = nullptr;
+    std::vector<size_t> dims;
+    SRTensorType type = SRTensorTypeDouble;
+};
+
+// One metadata entry of a group: a list of int32 or of double values
+struct GroupMeta {
+    std::string name;
+    std::vector<int32_t> ints;
+    std::vector<double> doubles;
+};
+
+// One tensor of a group read back with take_group, whatever its length;
+// found is false (and bytes empty) when the group does not hold it
+struct GroupData {
+    std::string name;
+    std::vector<unsigned char> bytes;
+    SRTensorType type = SRTensorTypeUint8;
+    size_t count = 0;
+    bool found = false;
+};
+
+// What the core needs from a store. Only writer ranks own one; the I/O
+// thread of a writer uses a second instance.
+class Transport {
+public:
+    virtual ~Transport() {}
+
+    virtual void put_tensor(const std::string &key, const void *data, const std::vector<size_t> &dims,
+                            SRTensorType type, SRMemoryLayout layout) = 0;
+    // The stored tensor must match dims and type exactly
+    virtual void unpack_tensor(const std::string &key, void *data, const std::vector<size_t> &dims,
+                               SRTensorType type, SRMemoryLayout layout) = 0;
+    virtual void delete_tensor(const std::string &key) = 0;
+    virtual bool tensor_exists(const std::string &key) = 0;
+    // Remove keys for good (expired ring slots), whether or not they still
+    // exist; the default deletes them one by one
+    virtual void delete_tensors(const std::vector<std::string> &keys);
+
+    // Variable-length uint8 frames (compressed actions): take_frame reads
+    // and deletes the frame stored under key
+    virtual bool frame_exists(const std::string &key) = 0;
+    virtual void take_frame(const std::string &key, std::vector<unsigned char> &frame) = 0;
+
+    // Tensors and metadata stored together under key (the step DataSet)
+    virtual void put_group(const std::string &key, const std::vector<GroupTensor> &tensors,
+                           const std::vector<GroupMeta> &meta) = 0;
+    // Read the named tensors of the group under key, then delete it (sparse
+    // actions). frame_exists and wait_for(key, true) see the group.
+    virtual void take_group(const std::string &key, std::vector<GroupData> &tensors) = 0;
+
+    // Wait up to timeout_us for a tensor (or frame) to appear. The default
+    // sleeps and checks once; backends with notification wake up early.
+    virtual bool wait_for(const std::string &key, bool frame, int timeout_us);
+};
+
+// SRMPI_TRANSPORT=smartredis|shm|replay selects the default kind, else TRANSPORT_SMARTREDIS
+int default_transport_kind();
+bool transport_kind_valid(int kind);
+// Store-backed kinds only; a ReplayTransport is built from its log path
+Transport *create_transport(int kind, bool clustered);
+
+class SmartRedisTransport : public Transport {
+public:
+    explicit SmartRedisTransport(bool clustered);
+
+    void put_tensor(const std::string &key, const void *data, const std::vector<size_t> &dims,
+                    SRTensorType type, SRMemoryLayout layout) override;
+    void unpack_tensor(const std::string &key, void *data, const std::vector<size_t> &dims,
+                       SRTensorType type, SRMemoryLayout layout) override;
+    void delete_tensor(const std::string &key) override;
+    bool tensor_exists(const std::string &key) override;
+    // Frames are DataSets holding tensor "frame"; the DataSet owns the read
+    // memory, so nothing accumulates in the client
+    bool frame_exists(const std::string &key) override;
+    void take_frame(const std::string &key, std::vector<unsigned char> &frame) override;
+    void put_group(const std::string &key, const std::vector<GroupTensor> &tensors,
+                   const std::vector<GroupMeta> &meta) override;
+    void take_group(const std::string &key, std::vector<GroupData> &tensors) override;
+
+private:
+    SmartRedis::Client client;
+};
+
+#endif
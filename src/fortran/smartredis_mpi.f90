@@ -1,16 +1,61 @@
 module smartredis_mpi
   use iso_c_binding
+  use iso_fortran_env, only: error_unit
   use mpi
   implicit none
 
   private
   public :: init_smartredis_mpi, finalize_smartredis_mpi, &
             put_step_type, put_state, put_reward, get_action, &
-            put_info, put_real_scalar, create_handle, destroy_handle
+            put_info, put_real_scalar, create_handle, destroy_handle, select_handle, &
+            invalidate_plan, invalidate_plans, set_writer_mode, set_collective_mode, &
+            init_mpi_threads, set_threads, bind_thread, &
+            iput_state, iput_reward, iput_info, test_request, wait_request, &
+            waitall_requests, step_exchange, wait_action, set_wait_policy, &
+            put_states, get_actions, wait_actions, &
+            put_state_sparse, put_state_masked, put_state_delta, get_action_sparse, wait_action_sparse, &
+            open_trajectory, append_step, flush_trajectory, close_trajectory, &
+            put_tensor, get_tensor, wait_tensor, &
+            get_action_wait_time, put_fields, set_wire_precision, &
+            set_compression, get_compression_stats, set_local_policy, get_policy_version, &
+            enable_stats, get_stats, &
+            reset_stats, dump_stats, dump_trace, register_key, set_step, &
+            register_ring_key, get_action_step, wait_action_step, &
+            set_record_log, set_replay_log, c_key
+  public :: SR_WRITER_ROOT, SR_WRITER_NODE, SR_WRITER_STRIDE, &
+            SR_COLLECTIVE_FLAT, SR_COLLECTIVE_HIERARCHICAL, &
+            SR_TRANSPORT_DEFAULT, SR_TRANSPORT_SMARTREDIS, SR_TRANSPORT_SHM, SR_TRANSPORT_REPLAY, &
+            SR_LAYOUT_CONTIGUOUS, SR_LAYOUT_FORTRAN, &
+            SR_WIRE_FLOAT64, SR_WIRE_FLOAT32, SR_WIRE_BFLOAT16, SR_WIRE_FLOAT16, &
+            SR_CODEC_NONE, SR_CODEC_SHUFFLE_LZ, SR_CODEC_XOR_SHUFFLE_LZ, &
+            SR_OP_PUT_STATE, SR_OP_PUT_INFO, SR_OP_PUT_FIELDS, SR_OP_GET_ACTION, &
+            SR_OP_STEP_EXCHANGE, SR_OP_IPUT, SR_OP_PUT_SCALAR, SR_OP_PUT_BATCH, SR_OP_GET_BATCH, &
+            SR_OP_PUT_SPARSE, SR_OP_GET_SPARSE, SR_OP_PUT_TRAJECTORY, SR_OP_PUT_TENSOR, SR_OP_GET_TENSOR, &
+            SR_OP_RING_GC, SR_OP_POLICY_LOAD, SR_OP_POLICY_EVAL, &
+            SR_TYPE_FLOAT64, SR_TYPE_FLOAT32, SR_TYPE_INT8, SR_TYPE_INT16, SR_TYPE_INT32, &
+            SR_TYPE_INT64, SR_PHASE_TOTAL, SR_PHASE_MPI, SR_PHASE_REDIS, SR_PHASE_WAIT, SR_STAT_NVALUES
 
+  integer, parameter :: SR_WRITER_ROOT = 0, SR_WRITER_NODE = 1, SR_WRITER_STRIDE = 2
+  integer, parameter :: SR_COLLECTIVE_FLAT = 0, SR_COLLECTIVE_HIERARCHICAL = 1
+  integer, parameter :: SR_TRANSPORT_DEFAULT = -1, SR_TRANSPORT_SMARTREDIS = 0, SR_TRANSPORT_SHM = 1, &
+                        SR_TRANSPORT_REPLAY = 2
+  integer, parameter :: SR_LAYOUT_CONTIGUOUS = 0, SR_LAYOUT_FORTRAN = 1
+  integer, parameter :: SR_WIRE_FLOAT64 = 0, SR_WIRE_FLOAT32 = 1, &
+                        SR_WIRE_BFLOAT16 = 2, SR_WIRE_FLOAT16 = 3
+  integer, parameter :: SR_CODEC_NONE = 0, SR_CODEC_SHUFFLE_LZ = 1, SR_CODEC_XOR_SHUFFLE_LZ = 2
+  integer, parameter :: SR_OP_PUT_STATE = 0, SR_OP_PUT_INFO = 1, SR_OP_PUT_FIELDS = 2, &
+                        SR_OP_GET_ACTION = 3, SR_OP_STEP_EXCHANGE = 4, SR_OP_IPUT = 5, &
+                        SR_OP_PUT_SCALAR = 6, SR_OP_PUT_BATCH = 7, SR_OP_GET_BATCH = 8, &
+                        SR_OP_PUT_SPARSE = 9, SR_OP_GET_SPARSE = 10, SR_OP_PUT_TRAJECTORY = 11, &
+                        SR_OP_PUT_TENSOR = 12, SR_OP_GET_TENSOR = 13, SR_OP_RING_GC = 14, &
+                        SR_OP_POLICY_LOAD = 15, SR_OP_POLICY_EVAL = 16
+  integer, parameter :: SR_TYPE_FLOAT64 = 1, SR_TYPE_FLOAT32 = 2, SR_TYPE_INT8 = 3, &
+                        SR_TYPE_INT16 = 4, SR_TYPE_INT32 = 5, SR_TYPE_INT64 = 6
+  integer, parameter :: SR_PHASE_TOTAL = 0, SR_PHASE_MPI = 1, SR_PHASE_REDIS = 2, SR_PHASE_WAIT = 3
+  integer, parameter :: SR_STAT_NVALUES = 7
+
+  ! Read by every call; only create/select/init/finalize change it, outside parallel regions
   type(c_ptr) :: global_handle = c_null_ptr
-  integer :: nprocs = 1, myid = 0, ierr = 0
-  integer(kind=C_INT) :: mpi_comm_local = 0
 
   interface
     function sr_mpi_create(clustered) bind(C, name="sr_mpi_create")
@@ -33,12 +78,49 @@ module smartredis_mpi
       integer(C_INT) :: sr_init
     end function
 
+    function sr_init_transport(handle, clustered, comm, transport) bind(C, name="sr_init_transport")
+      import :: C_PTR, C_INT
+      type(C_PTR), value :: handle
+      integer(C_INT), value :: clustered
+      integer(C_INT), value :: comm
+      integer(C_INT), value :: transport
+      integer(C_INT) :: sr_init_transport
+    end function
+
     function sr_finalize(handle) bind(C, name="sr_finalize")
       import :: C_PTR, C_INT
       type(C_PTR), value :: handle
       integer(C_INT) :: sr_finalize
     end function
 
+    function sr_set_writer_mode(handle, mode, stride) bind(C, name="sr_set_writer_mode")
+      import :: C_PTR, C_INT
+      type(C_PTR), value :: handle
+      integer(C_INT), value :: mode
+      integer(C_INT), value :: stride
+      integer(C_INT) :: sr_set_writer_mode
+    end function
+
+    function sr_set_collective_mode(handle, mode) bind(C, name="sr_set_collective_mode")
+      import :: C_PTR, C_INT
+      type(C_PTR), value :: handle
+      integer(C_INT), value :: mode
+      integer(C_INT) :: sr_set_collective_mode
+    end function
+
+    function sr_set_threads(handle, n_threads) bind(C, name="sr_set_threads")
+      import :: C_PTR, C_INT
+      type(C_PTR), value :: handle
+      integer(C_INT), value :: n_threads
+      integer(C_INT) :: sr_set_threads
+    end function
+
+    function sr_bind_thread(lane) bind(C, name="sr_bind_thread")
+      import :: C_INT
+      integer(C_INT), value :: lane
+      integer(C_INT) :: sr_bind_thread
+    end function
+
     function sr_put_step_type(handle, key, key_len, step_type) bind(C, name="sr_put_step_type")
       import :: C_PTR, C_INT, C_CHAR
       type(C_PTR), value :: handle
@@ -78,153 +160,1798 @@ module smartredis_mpi
       integer(C_INT) :: sr_get_action
     end function
 
-    function sr_put_info(handle, key, key_len, info, info_size) bind(C, name="sr_put_info")
-      import :: C_PTR, C_INT, C_CHAR
+    function sr_wait_action(handle, key, key_len, action, action_size, timeout) bind(C, name="sr_wait_action")
+      import :: C_PTR, C_INT, C_DOUBLE, C_CHAR
       type(C_PTR), value :: handle
       character(kind=C_CHAR), dimension(*) :: key
       integer(C_INT), value :: key_len
-      integer(C_INT), dimension(*) :: info
-      integer(C_INT), value :: info_size
-      integer(C_INT) :: sr_put_info
+      real(C_DOUBLE), dimension(*) :: action
+      integer(C_INT), value :: action_size
+      real(C_DOUBLE), value :: timeout
+      integer(C_INT) :: sr_wait_action
     end function
 
-    function sr_put_real_scalar(handle, key, key_len, rscalar) bind(C, name="sr_put_real_scalar")
+    function sr_put_states(handle, keys, key_lens, n_keys, states, sizes) bind(C, name="sr_put_states")
+      import :: C_PTR, C_INT, C_DOUBLE, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: keys
+      integer(C_INT), dimension(*) :: key_lens
+      integer(C_INT), value :: n_keys
+      real(C_DOUBLE), dimension(*) :: states
+      integer(C_INT), dimension(*) :: sizes
+      integer(C_INT) :: sr_put_states
+    end function
+
+    function sr_get_actions(handle, keys, key_lens, n_keys, actions, sizes) bind(C, name="sr_get_actions")
+      import :: C_PTR, C_INT, C_DOUBLE, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: keys
+      integer(C_INT), dimension(*) :: key_lens
+      integer(C_INT), value :: n_keys
+      real(C_DOUBLE), dimension(*) :: actions
+      integer(C_INT), dimension(*) :: sizes
+      integer(C_INT) :: sr_get_actions
+    end function
+
+    function sr_wait_actions(handle, keys, key_lens, n_keys, actions, sizes, timeout) &
+                             bind(C, name="sr_wait_actions")
+      import :: C_PTR, C_INT, C_DOUBLE, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: keys
+      integer(C_INT), dimension(*) :: key_lens
+      integer(C_INT), value :: n_keys
+      real(C_DOUBLE), dimension(*) :: actions
+      integer(C_INT), dimension(*) :: sizes
+      real(C_DOUBLE), value :: timeout
+      integer(C_INT) :: sr_wait_actions
+    end function
+
+    function sr_put_state_sparse(handle, key, key_len, state, state_size, indices, n_indices) &
+                                 bind(C, name="sr_put_state_sparse")
       import :: C_PTR, C_INT, C_DOUBLE, C_CHAR
       type(C_PTR), value :: handle
       character(kind=C_CHAR), dimension(*) :: key
       integer(C_INT), value :: key_len
-      real(C_DOUBLE), value :: rscalar
-      integer(C_INT) :: sr_put_real_scalar
+      real(C_DOUBLE), dimension(*) :: state
+      integer(C_INT), value :: state_size
+      integer(C_INT), dimension(*) :: indices
+      integer(C_INT), value :: n_indices
+      integer(C_INT) :: sr_put_state_sparse
     end function
-  end interface
 
-contains
+    function sr_put_state_masked(handle, key, key_len, state, state_size, mask) &
+                                 bind(C, name="sr_put_state_masked")
+      import :: C_PTR, C_INT, C_DOUBLE, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: key
+      integer(C_INT), value :: key_len
+      real(C_DOUBLE), dimension(*) :: state
+      integer(C_INT), value :: state_size
+      integer(C_INT), dimension(*) :: mask
+      integer(C_INT) :: sr_put_state_masked
+    end function
 
-  pure function key_length(key) result(len_key)
-    character(kind=C_CHAR), intent(in), dimension(:) :: key
-    integer :: len_key, i
-    len_key = 0
-    do i = 1, size(key)
-      if (key(i) == C_NULL_CHAR) exit
-      len_key = len_key + 1
-    end do
-  end function key_length
+    function sr_put_state_delta(handle, key, key_len, state, state_size, threshold) &
+                                bind(C, name="sr_put_state_delta")
+      import :: C_PTR, C_INT, C_DOUBLE, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: key
+      integer(C_INT), value :: key_len
+      real(C_DOUBLE), dimension(*) :: state
+      integer(C_INT), value :: state_size
+      real(C_DOUBLE), value :: threshold
+      integer(C_INT) :: sr_put_state_delta
+    end function
 
-  function create_handle(clustered) result(res)
-    integer, intent(in), optional :: clustered
-    type(c_ptr) :: res
-    integer(C_INT) :: ccluster
-    if (present(clustered)) then
-      ccluster = clustered
-    else
-      ccluster = 1
-    end if
-    res = sr_mpi_create(ccluster)
-    if (c_associated(res)) then
-      global_handle = res
-    end if
-  end function create_handle
+    function sr_get_action_sparse(handle, key, key_len, action, action_size) bind(C, name="sr_get_action_sparse")
+      import :: C_PTR, C_INT, C_DOUBLE, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: key
+      integer(C_INT), value :: key_len
+      real(C_DOUBLE), dimension(*) :: action
+      integer(C_INT), value :: action_size
+      integer(C_INT) :: sr_get_action_sparse
+    end function
 
-  function destroy_handle() result(code)
-    integer :: code
-    if (.not. c_associated(global_handle)) then
-      code = 1
-      return
-    end if
-    code = sr_mpi_destroy(global_handle)
-    if (code == 0) global_handle = c_null_ptr
-  end function destroy_handle
+    function sr_wait_action_sparse(handle, key, key_len, action, action_size, timeout) &
+                                   bind(C, name="sr_wait_action_sparse")
+      import :: C_PTR, C_INT, C_DOUBLE, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: key
+      integer(C_INT), value :: key_len
+      real(C_DOUBLE), dimension(*) :: action
+      integer(C_INT), value :: action_size
+      real(C_DOUBLE), value :: timeout
+      integer(C_INT) :: sr_wait_action_sparse
+    end function
 
-  subroutine init_smartredis_mpi(db_clustered, comm)
-    logical, intent(in), optional :: db_clustered
-    integer, intent(in), optional :: comm
-    integer(C_INT) :: code, ccluster, ccomm
+    function sr_put_tensor(handle, key, key_len, data, data_size, data_type) bind(C, name="sr_put_tensor")
+      import :: C_PTR, C_INT, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: key
+      integer(C_INT), value :: key_len
+      type(C_PTR), value :: data
+      integer(C_INT), value :: data_size, data_type
+      integer(C_INT) :: sr_put_tensor
+    end function
 
-    if (.not. c_associated(global_handle)) then
-      global_handle = sr_mpi_create(1)
-      if (.not. c_associated(global_handle)) then
-        stop 'Failed to create SmartRedis handle'
-      end if
-    end if
+    function sr_get_tensor(handle, key, key_len, data, data_size, data_type) bind(C, name="sr_get_tensor")
+      import :: C_PTR, C_INT, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: key
+      integer(C_INT), value :: key_len
+      type(C_PTR), value :: data
+      integer(C_INT), value :: data_size, data_type
+      integer(C_INT) :: sr_get_tensor
+    end function
 
-    if (present(db_clustered)) then
-      ccluster = merge(1,0,db_clustered)
-    else
-      ccluster = 1
-    end if
+    function sr_wait_tensor(handle, key, key_len, data, data_size, data_type, timeout) &
+                            bind(C, name="sr_wait_tensor")
+      import :: C_PTR, C_INT, C_DOUBLE, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: key
+      integer(C_INT), value :: key_len
+      type(C_PTR), value :: data
+      integer(C_INT), value :: data_size, data_type
+      real(C_DOUBLE), value :: timeout
+      integer(C_INT) :: sr_wait_tensor
+    end function
 
-    if (present(comm)) then
-      ccomm = comm
-    else
-      ccomm = -1
-    end if
+    function sr_put_state_typed(handle, key, key_len, state, state_type, dims, ndims, layout) &
+                                bind(C, name="sr_put_state_typed")
+      import :: C_PTR, C_INT, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: key
+      integer(C_INT), value :: key_len
+      type(C_PTR), value :: state
+      integer(C_INT), value :: state_type
+      integer(C_INT), dimension(*) :: dims
+      integer(C_INT), value :: ndims, layout
+      integer(C_INT) :: sr_put_state_typed
+    end function
 
-    code = sr_init(global_handle, ccluster, ccomm)
-    if (code /= 0) stop 'sr_init failed'
+    function sr_get_action_typed(handle, key, key_len, action, action_size, action_type) &
+                                 bind(C, name="sr_get_action_typed")
+      import :: C_PTR, C_INT, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: key
+      integer(C_INT), value :: key_len
+      type(C_PTR), value :: action
+      integer(C_INT), value :: action_size, action_type
+      integer(C_INT) :: sr_get_action_typed
+    end function
 
-    call MPI_Comm_rank(MPI_COMM_WORLD, myid, ierr)
-    call MPI_Comm_size(MPI_COMM_WORLD, nprocs, ierr)
-  end subroutine init_smartredis_mpi
+    function sr_wait_action_typed(handle, key, key_len, action, action_size, action_type, timeout) &
+                                  bind(C, name="sr_wait_action_typed")
+      import :: C_PTR, C_INT, C_DOUBLE, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: key
+      integer(C_INT), value :: key_len
+      type(C_PTR), value :: action
+      integer(C_INT), value :: action_size, action_type
+      real(C_DOUBLE), value :: timeout
+      integer(C_INT) :: sr_wait_action_typed
+    end function
 
-  subroutine finalize_smartredis_mpi()
-    integer :: code
-    if (.not. c_associated(global_handle)) return
-    code = sr_finalize(global_handle)
-    if (code /= 0) stop 'sr_finalize failed'
-    code = sr_mpi_destroy(global_handle)
-    global_handle = c_null_ptr
-  end subroutine finalize_smartredis_mpi
+    function sr_open_trajectory(handle, key, key_len, n_steps, n_features, n_points, n_reward, async) &
+                                bind(C, name="sr_open_trajectory")
+      import :: C_PTR, C_INT, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: key
+      integer(C_INT), value :: key_len, n_steps, n_features, n_points, n_reward, async
+      integer(C_INT) :: sr_open_trajectory
+    end function
 
-  subroutine put_step_type(key, step_type)
-    character(kind=C_CHAR), intent(in), dimension(:) :: key
-    integer, intent(in) :: step_type
-    integer(C_INT) :: code
-    code = sr_put_step_type(global_handle, key, key_length(key), step_type)
-    if (code /= 0) stop 'sr_put_step_type failed'
-  end subroutine put_step_type
+    function sr_append_step(handle, key, key_len, state, state_size, reward, reward_size, step_type) &
+                            bind(C, name="sr_append_step")
+      import :: C_PTR, C_INT, C_DOUBLE, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: key
+      integer(C_INT), value :: key_len
+      real(C_DOUBLE), dimension(*) :: state
+      integer(C_INT), value :: state_size
+      real(C_DOUBLE), dimension(*) :: reward
+      integer(C_INT), value :: reward_size, step_type
+      integer(C_INT) :: sr_append_step
+    end function
 
-  subroutine put_state(key, dims, state)
-    character(kind=C_CHAR), intent(in), dimension(:) :: key
-    integer, intent(in), dimension(:) :: dims
-    real(C_DOUBLE), intent(in), dimension(product(dims)) :: state
-    integer(C_INT) :: code
-    code = sr_put_state(global_handle, key, key_length(key), state, size(state))
-    if (code /= 0) stop 'sr_put_state failed'
-  end subroutine put_state
+    function sr_flush_trajectory(handle, key, key_len) bind(C, name="sr_flush_trajectory")
+      import :: C_PTR, C_INT, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: key
+      integer(C_INT), value :: key_len
+      integer(C_INT) :: sr_flush_trajectory
+    end function
 
-  subroutine put_reward(key, dims, reward)
-    character(kind=C_CHAR), intent(in), dimension(:) :: key
-    integer, intent(in), dimension(:) :: dims
-    real(C_DOUBLE), intent(in), dimension(product(dims)) :: reward
-    integer(C_INT) :: code
-    code = sr_put_reward(global_handle, key, key_length(key), reward, size(reward))
-    if (code /= 0) stop 'sr_put_reward failed'
-  end subroutine put_reward
+    function sr_close_trajectory(handle, key, key_len) bind(C, name="sr_close_trajectory")
+      import :: C_PTR, C_INT, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: key
+      integer(C_INT), value :: key_len
+      integer(C_INT) :: sr_close_trajectory
+    end function
 
-  subroutine get_action(key, dims, action)
-    character(kind=C_CHAR), intent(in), dimension(:) :: key
-    integer, intent(in), dimension(:) :: dims
-    real(C_DOUBLE), intent(out), dimension(product(dims)) :: action
-    integer(C_INT) :: code
-    code = sr_get_action(global_handle, key, key_length(key), action, size(action))
-    if (code /= 0) stop 'sr_get_action failed'
-  end subroutine get_action
+    function sr_set_wait_policy(handle, spin_checks, short_sleep_us, short_polls, max_sleep_us) &
+                                bind(C, name="sr_set_wait_policy")
+      import :: C_PTR, C_INT
+      type(C_PTR), value :: handle
+      integer(C_INT), value :: spin_checks, short_sleep_us, short_polls, max_sleep_us
+      integer(C_INT) :: sr_set_wait_policy
+    end function
 
-  subroutine put_info(key, dims, info)
-    character(kind=C_CHAR), intent(in), dimension(:) :: key
-    integer, intent(in), dimension(:) :: dims
-    integer(C_INT), intent(in), dimension(product(dims)) :: info
-    integer(C_INT) :: code
-    code = sr_put_info(global_handle, key, key_length(key), info, size(info))
-    if (code /= 0) stop 'sr_put_info failed'
-  end subroutine put_info
+    function sr_get_action_wait_time(handle, total, last) bind(C, name="sr_get_action_wait_time")
+      import :: C_PTR, C_INT, C_DOUBLE
+      type(C_PTR), value :: handle
+      real(C_DOUBLE) :: total, last
+      integer(C_INT) :: sr_get_action_wait_time
+    end function
 
-  subroutine put_real_scalar(key, rscalar)
-    character(kind=C_CHAR), intent(in), dimension(:) :: key
-    real(C_DOUBLE), intent(in) :: rscalar
-    integer(C_INT) :: code
-    code = sr_put_real_scalar(global_handle, key, key_length(key), rscalar)
-    if (code /= 0) stop 'sr_put_real_scalar failed'
-  end subroutine put_real_scalar
+    function sr_put_info(handle, key, key_len, info, info_size) bind(C, name="sr_put_info")
+      import :: C_PTR, C_INT, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: key
+      integer(C_INT), value :: key_len
+      integer(C_INT), dimension(*) :: info
+      integer(C_INT), value :: info_size
+      integer(C_INT) :: sr_put_info
+    end function
+
+    function sr_put_state_nd(handle, key, key_len, state, dims, ndims, layout) bind(C, name="sr_put_state_nd")
+      import :: C_PTR, C_INT, C_DOUBLE, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: key
+      integer(C_INT), value :: key_len
+      real(C_DOUBLE), dimension(*) :: state
+      integer(C_INT), dimension(*) :: dims
+      integer(C_INT), value :: ndims
+      integer(C_INT), value :: layout
+      integer(C_INT) :: sr_put_state_nd
+    end function
+
+    function sr_put_fields(handle, key, key_len, fields, n_fields, n_points, stride, layout) &
+                           bind(C, name="sr_put_fields")
+      import :: C_PTR, C_INT, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: key
+      integer(C_INT), value :: key_len
+      type(C_PTR), dimension(*) :: fields
+      integer(C_INT), value :: n_fields
+      integer(C_INT), value :: n_points
+      integer(C_INT), value :: stride
+      integer(C_INT), value :: layout
+      integer(C_INT) :: sr_put_fields
+    end function
+
+    function sr_put_real_scalar(handle, key, key_len, rscalar) bind(C, name="sr_put_real_scalar")
+      import :: C_PTR, C_INT, C_DOUBLE, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: key
+      integer(C_INT), value :: key_len
+      real(C_DOUBLE), value :: rscalar
+      integer(C_INT) :: sr_put_real_scalar
+    end function
+
+    function sr_step_exchange(handle, tag, tag_len, state, state_size, reward, reward_size, &
+                              step_type, action, action_size, scalars, n_scalars, timeout) &
+                              bind(C, name="sr_step_exchange")
+      import :: C_PTR, C_INT, C_DOUBLE, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: tag
+      integer(C_INT), value :: tag_len
+      real(C_DOUBLE), dimension(*) :: state
+      integer(C_INT), value :: state_size
+      real(C_DOUBLE), dimension(*) :: reward
+      integer(C_INT), value :: reward_size
+      integer(C_INT), value :: step_type
+      real(C_DOUBLE), dimension(*) :: action
+      integer(C_INT), value :: action_size
+      real(C_DOUBLE), dimension(*) :: scalars
+      integer(C_INT), value :: n_scalars
+      real(C_DOUBLE), value :: timeout
+      integer(C_INT) :: sr_step_exchange
+    end function
+
+    function sr_iput_state(handle, key, key_len, state, state_size, request) bind(C, name="sr_iput_state")
+      import :: C_PTR, C_INT, C_DOUBLE, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: key
+      integer(C_INT), value :: key_len
+      real(C_DOUBLE), dimension(*) :: state
+      integer(C_INT), value :: state_size
+      integer(C_INT) :: request
+      integer(C_INT) :: sr_iput_state
+    end function
+
+    function sr_iput_reward(handle, key, key_len, reward, reward_size, request) bind(C, name="sr_iput_reward")
+      import :: C_PTR, C_INT, C_DOUBLE, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: key
+      integer(C_INT), value :: key_len
+      real(C_DOUBLE), dimension(*) :: reward
+      integer(C_INT), value :: reward_size
+      integer(C_INT) :: request
+      integer(C_INT) :: sr_iput_reward
+    end function
+
+    function sr_iput_info(handle, key, key_len, info, info_size, request) bind(C, name="sr_iput_info")
+      import :: C_PTR, C_INT, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: key
+      integer(C_INT), value :: key_len
+      integer(C_INT), dimension(*) :: info
+      integer(C_INT), value :: info_size
+      integer(C_INT) :: request
+      integer(C_INT) :: sr_iput_info
+    end function
+
+    function sr_test(handle, request, flag) bind(C, name="sr_test")
+      import :: C_PTR, C_INT
+      type(C_PTR), value :: handle
+      integer(C_INT), value :: request
+      integer(C_INT) :: flag
+      integer(C_INT) :: sr_test
+    end function
+
+    function sr_wait(handle, request) bind(C, name="sr_wait")
+      import :: C_PTR, C_INT
+      type(C_PTR), value :: handle
+      integer(C_INT), value :: request
+      integer(C_INT) :: sr_wait
+    end function
+
+    function sr_waitall(handle) bind(C, name="sr_waitall")
+      import :: C_PTR, C_INT
+      type(C_PTR), value :: handle
+      integer(C_INT) :: sr_waitall
+    end function
+
+    function sr_set_wire_precision(handle, key, key_len, precision) bind(C, name="sr_set_wire_precision")
+      import :: C_PTR, C_INT, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: key
+      integer(C_INT), value :: key_len
+      integer(C_INT), value :: precision
+      integer(C_INT) :: sr_set_wire_precision
+    end function
+
+    function sr_set_compression(handle, key, key_len, codec, threshold_bytes) bind(C, name="sr_set_compression")
+      import :: C_PTR, C_INT, C_CHAR, C_LONG_LONG
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: key
+      integer(C_INT), value :: key_len
+      integer(C_INT), value :: codec
+      integer(C_LONG_LONG), value :: threshold_bytes
+      integer(C_INT) :: sr_set_compression
+    end function
+
+    function sr_get_compression_stats(handle, key, key_len, ratio, last_ratio, encode_seconds, decode_seconds) &
+                                      bind(C, name="sr_get_compression_stats")
+      import :: C_PTR, C_INT, C_CHAR, C_DOUBLE
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: key
+      integer(C_INT), value :: key_len
+      real(C_DOUBLE) :: ratio, last_ratio, encode_seconds, decode_seconds
+      integer(C_INT) :: sr_get_compression_stats
+    end function
+
+    function sr_set_local_policy(handle, action_key, action_len, state_key, state_len, weights_key, weights_len, &
+                                 refresh_steps) bind(C, name="sr_set_local_policy")
+      import :: C_PTR, C_INT, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: action_key, state_key, weights_key
+      integer(C_INT), value :: action_len, state_len, weights_len, refresh_steps
+      integer(C_INT) :: sr_set_local_policy
+    end function
+
+    function sr_get_policy_version(handle, action_key, action_len, version) bind(C, name="sr_get_policy_version")
+      import :: C_PTR, C_INT, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: action_key
+      integer(C_INT), value :: action_len
+      integer(C_INT) :: version
+      integer(C_INT) :: sr_get_policy_version
+    end function
+
+    function sr_enable_stats(handle, enabled, trace) bind(C, name="sr_enable_stats")
+      import :: C_PTR, C_INT
+      type(C_PTR), value :: handle
+      integer(C_INT), value :: enabled, trace
+      integer(C_INT) :: sr_enable_stats
+    end function
+
+    function sr_get_stats(handle, op, key, key_len, phase, values) bind(C, name="sr_get_stats")
+      import :: C_PTR, C_INT, C_CHAR, C_DOUBLE
+      type(C_PTR), value :: handle
+      integer(C_INT), value :: op
+      character(kind=C_CHAR), dimension(*) :: key
+      integer(C_INT), value :: key_len
+      integer(C_INT), value :: phase
+      real(C_DOUBLE), dimension(*) :: values
+      integer(C_INT) :: sr_get_stats
+    end function
+
+    function sr_reset_stats(handle) bind(C, name="sr_reset_stats")
+      import :: C_PTR, C_INT
+      type(C_PTR), value :: handle
+      integer(C_INT) :: sr_reset_stats
+    end function
+
+    function sr_dump_stats(handle, path, path_len) bind(C, name="sr_dump_stats")
+      import :: C_PTR, C_INT, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: path
+      integer(C_INT), value :: path_len
+      integer(C_INT) :: sr_dump_stats
+    end function
+
+    function sr_dump_trace(handle, prefix, prefix_len) bind(C, name="sr_dump_trace")
+      import :: C_PTR, C_INT, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: prefix
+      integer(C_INT), value :: prefix_len
+      integer(C_INT) :: sr_dump_trace
+    end function
+
+    function sr_invalidate_plan(handle, key, key_len) bind(C, name="sr_invalidate_plan")
+      import :: C_PTR, C_INT, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: key
+      integer(C_INT), value :: key_len
+      integer(C_INT) :: sr_invalidate_plan
+    end function
+
+    function sr_invalidate_plans(handle) bind(C, name="sr_invalidate_plans")
+      import :: C_PTR, C_INT
+      type(C_PTR), value :: handle
+      integer(C_INT) :: sr_invalidate_plans
+    end function
+
+    function sr_set_record_log(handle, prefix, prefix_len) bind(C, name="sr_set_record_log")
+      import :: C_PTR, C_INT, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: prefix
+      integer(C_INT), value :: prefix_len
+      integer(C_INT) :: sr_set_record_log
+    end function
+
+    function sr_set_replay_log(handle, prefix, prefix_len) bind(C, name="sr_set_replay_log")
+      import :: C_PTR, C_INT, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: prefix
+      integer(C_INT), value :: prefix_len
+      integer(C_INT) :: sr_set_replay_log
+    end function
+  end interface
+
+  interface
+    function sr_register_key(handle, key, key_len, per_step, id) bind(C, name="sr_register_key")
+      import :: C_PTR, C_INT, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: key
+      integer(C_INT), value :: key_len
+      integer(C_INT), value :: per_step
+      integer(C_INT) :: id
+      integer(C_INT) :: sr_register_key
+    end function
+
+    function sr_set_step(handle, step) bind(C, name="sr_set_step")
+      import :: C_PTR, C_INT, C_LONG_LONG
+      type(C_PTR), value :: handle
+      integer(C_LONG_LONG), value :: step
+      integer(C_INT) :: sr_set_step
+    end function
+
+    function sr_put_step_type_id(handle, id, step_type) bind(C, name="sr_put_step_type_id")
+      import :: C_PTR, C_INT
+      type(C_PTR), value :: handle
+      integer(C_INT), value :: id, step_type
+      integer(C_INT) :: sr_put_step_type_id
+    end function
+
+    function sr_put_state_id(handle, id, state, state_size) bind(C, name="sr_put_state_id")
+      import :: C_PTR, C_INT, C_DOUBLE
+      type(C_PTR), value :: handle
+      integer(C_INT), value :: id
+      real(C_DOUBLE), dimension(*) :: state
+      integer(C_INT), value :: state_size
+      integer(C_INT) :: sr_put_state_id
+    end function
+
+    function sr_put_reward_id(handle, id, reward, reward_size) bind(C, name="sr_put_reward_id")
+      import :: C_PTR, C_INT, C_DOUBLE
+      type(C_PTR), value :: handle
+      integer(C_INT), value :: id
+      real(C_DOUBLE), dimension(*) :: reward
+      integer(C_INT), value :: reward_size
+      integer(C_INT) :: sr_put_reward_id
+    end function
+
+    function sr_put_info_id(handle, id, info, info_size) bind(C, name="sr_put_info_id")
+      import :: C_PTR, C_INT
+      type(C_PTR), value :: handle
+      integer(C_INT), value :: id
+      integer(C_INT), dimension(*) :: info
+      integer(C_INT), value :: info_size
+      integer(C_INT) :: sr_put_info_id
+    end function
+
+    function sr_put_real_scalar_id(handle, id, rscalar) bind(C, name="sr_put_real_scalar_id")
+      import :: C_PTR, C_INT, C_DOUBLE
+      type(C_PTR), value :: handle
+      integer(C_INT), value :: id
+      real(C_DOUBLE), value :: rscalar
+      integer(C_INT) :: sr_put_real_scalar_id
+    end function
+
+    function sr_get_action_id(handle, id, action, action_size) bind(C, name="sr_get_action_id")
+      import :: C_PTR, C_INT, C_DOUBLE
+      type(C_PTR), value :: handle
+      integer(C_INT), value :: id
+      real(C_DOUBLE), dimension(*) :: action
+      integer(C_INT), value :: action_size
+      integer(C_INT) :: sr_get_action_id
+    end function
+
+    function sr_wait_action_id(handle, id, action, action_size, timeout) bind(C, name="sr_wait_action_id")
+      import :: C_PTR, C_INT, C_DOUBLE
+      type(C_PTR), value :: handle
+      integer(C_INT), value :: id
+      real(C_DOUBLE), dimension(*) :: action
+      integer(C_INT), value :: action_size
+      real(C_DOUBLE), value :: timeout
+      integer(C_INT) :: sr_wait_action_id
+    end function
+
+    function sr_register_ring_key(handle, key, key_len, slots, id) bind(C, name="sr_register_ring_key")
+      import :: C_PTR, C_INT, C_CHAR
+      type(C_PTR), value :: handle
+      character(kind=C_CHAR), dimension(*) :: key
+      integer(C_INT), value :: key_len
+      integer(C_INT), value :: slots
+      integer(C_INT) :: id
+      integer(C_INT) :: sr_register_ring_key
+    end function
+
+    function sr_get_action_step(handle, id, step, action, action_size) bind(C, name="sr_get_action_step")
+      import :: C_PTR, C_INT, C_LONG_LONG, C_DOUBLE
+      type(C_PTR), value :: handle
+      integer(C_INT), value :: id
+      integer(C_LONG_LONG), value :: step
+      real(C_DOUBLE), dimension(*) :: action
+      integer(C_INT), value :: action_size
+      integer(C_INT) :: sr_get_action_step
+    end function
+
+    function sr_wait_action_step(handle, id, step, action, action_size, timeout) &
+        bind(C, name="sr_wait_action_step")
+      import :: C_PTR, C_INT, C_LONG_LONG, C_DOUBLE
+      type(C_PTR), value :: handle
+      integer(C_INT), value :: id
+      integer(C_LONG_LONG), value :: step
+      real(C_DOUBLE), dimension(*) :: action
+      integer(C_INT), value :: action_size
+      real(C_DOUBLE), value :: timeout
+      integer(C_INT) :: sr_wait_action_step
+    end function
+  end interface
+
+  ! Data operations take a key or an id from register_key; states, rewards
+  ! and actions also come in the native form (character(len=*) key, array
+  ! of any rank and kind real64/real32/int32/int64, optional ierr)
+  interface put_step_type
+    module procedure put_step_type_key, put_step_type_id
+  end interface
+  interface put_state
+    module procedure put_state_key, put_state_id, put_state_r8, put_state_r4, put_state_i4, put_state_i8
+  end interface
+  interface put_reward
+    module procedure put_reward_key, put_reward_id, put_reward_r8, put_reward_r4, put_reward_i4, put_reward_i8
+  end interface
+  interface put_info
+    module procedure put_info_key, put_info_id
+  end interface
+  interface put_real_scalar
+    module procedure put_real_scalar_key, put_real_scalar_id
+  end interface
+  interface get_action
+    module procedure get_action_key, get_action_id, get_action_r8, get_action_r4, get_action_i4, get_action_i8
+  end interface
+  interface wait_action
+    module procedure wait_action_key, wait_action_id, wait_action_r8, wait_action_r4, wait_action_i4, &
+                     wait_action_i8
+  end interface
+
+  ! Typed tensors, sent and stored in the kind of data
+  interface put_tensor
+    module procedure put_tensor_r8, put_tensor_r4, put_tensor_i1, put_tensor_i2, put_tensor_i4, put_tensor_i8
+  end interface
+  interface get_tensor
+    module procedure get_tensor_r8, get_tensor_r4, get_tensor_i1, get_tensor_i2, get_tensor_i4, get_tensor_i8
+  end interface
+  interface wait_tensor
+    module procedure wait_tensor_r8, wait_tensor_r4, wait_tensor_i1, wait_tensor_i2, wait_tensor_i4, wait_tensor_i8
+  end interface
+
+contains
+
+  pure function key_length(key) result(len_key)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer :: len_key, i
+    len_key = 0
+    do i = 1, size(key)
+      if (key(i) == C_NULL_CHAR) exit
+      len_key = len_key + 1
+    end do
+  end function key_length
+
+  ! character(len=*) key as the C_CHAR array the other calls take, e.g.
+  ! call set_wire_precision(c_key('wall.state'), SR_WIRE_FLOAT32)
+  pure function c_key(key) result(chars)
+    character(len=*), intent(in) :: key
+    character(kind=C_CHAR), dimension(len_trim(key)) :: chars
+    integer :: i
+    do i = 1, size(chars)
+      chars(i) = key(i:i)
+    end do
+  end function c_key
+
+  function create_handle(clustered) result(res)
+    integer, intent(in), optional :: clustered
+    type(c_ptr) :: res
+    integer(C_INT) :: ccluster
+    if (present(clustered)) then
+      ccluster = clustered
+    else
+      ccluster = 1
+    end if
+    res = sr_mpi_create(ccluster)
+    if (c_associated(res)) then
+      global_handle = res
+    end if
+  end function create_handle
+
+  ! Several instances, e.g. one per environment on its own sub-communicator:
+  ! create_handle makes the new one current, select_handle switches back
+  subroutine select_handle(handle)
+    type(c_ptr), intent(in) :: handle
+    global_handle = handle
+  end subroutine select_handle
+
+  function destroy_handle(handle) result(code)
+    type(c_ptr), intent(in), optional :: handle
+    integer :: code
+    type(c_ptr) :: h
+    h = global_handle
+    if (present(handle)) h = handle
+    if (.not. c_associated(h)) then
+      code = 1
+      return
+    end if
+    code = sr_mpi_destroy(h)
+    if (code == 0 .and. c_associated(h, global_handle)) global_handle = c_null_ptr
+  end function destroy_handle
+
+  subroutine init_smartredis_mpi(db_clustered, comm, transport)
+    logical, intent(in), optional :: db_clustered
+    integer, intent(in), optional :: comm
+    integer, intent(in), optional :: transport
+    integer(C_INT) :: code, ccluster, ccomm, ctransport
+
+    if (present(db_clustered)) then
+      ccluster = merge(1,0,db_clustered)
+    else
+      ccluster = 1
+    end if
+
+    if (.not. c_associated(global_handle)) then
+      global_handle = sr_mpi_create(ccluster)
+      if (.not. c_associated(global_handle)) then
+        stop 'Failed to create SmartRedis handle'
+      end if
+    end if
+
+    ! comm is passed as its Fortran handle and converted with MPI_Comm_f2c
+    if (present(comm)) then
+      ccomm = comm
+    else
+      ccomm = -1
+    end if
+
+    if (present(transport)) then
+      ctransport = transport
+    else
+      ctransport = SR_TRANSPORT_DEFAULT
+    end if
+
+    code = sr_init_transport(global_handle, ccluster, ccomm, ctransport)
+    if (code /= 0) stop 'sr_init failed'
+  end subroutine init_smartredis_mpi
+
+  subroutine finalize_smartredis_mpi()
+    integer :: code
+    if (.not. c_associated(global_handle)) return
+    code = sr_finalize(global_handle)
+    if (code /= 0) stop 'sr_finalize failed'
+    code = sr_mpi_destroy(global_handle)
+    global_handle = c_null_ptr
+  end subroutine finalize_smartredis_mpi
+
+  subroutine set_writer_mode(mode, stride)
+    integer, intent(in) :: mode
+    integer, intent(in), optional :: stride
+    integer(C_INT) :: code, cstride
+    if (present(stride)) then
+      cstride = stride
+    else
+      cstride = 0
+    end if
+    code = sr_set_writer_mode(global_handle, mode, cstride)
+    if (code /= 0) stop 'sr_set_writer_mode failed'
+  end subroutine set_writer_mode
+
+  subroutine set_collective_mode(mode)
+    integer, intent(in) :: mode
+    integer(C_INT) :: code
+    code = sr_set_collective_mode(global_handle, mode)
+    if (code /= 0) stop 'sr_set_collective_mode failed'
+  end subroutine set_collective_mode
+
+  ! MPI_Init_thread with MPI_THREAD_MULTIPLE unless MPI is initialized; call
+  ! instead of MPI_Init before using set_threads
+  subroutine init_mpi_threads(provided)
+    integer, intent(out), optional :: provided
+    integer :: level, ierror
+    logical :: initialized
+    call MPI_Initialized(initialized, ierror)
+    if (initialized) then
+      call MPI_Query_thread(level, ierror)
+    else
+      call MPI_Init_thread(MPI_THREAD_MULTIPLE, level, ierror)
+    end if
+    if (present(provided)) provided = level
+  end subroutine init_mpi_threads
+
+  ! Collective: each of n_threads OpenMP threads exchanges on its own lane
+  ! (own communicator and connection); data calls then run concurrently on
+  ! distinct keys. Settings are changed outside parallel regions.
+  subroutine set_threads(n_threads)
+    integer, intent(in) :: n_threads
+    integer(C_INT) :: code
+    code = sr_set_threads(global_handle, n_threads)
+    if (code /= 0) stop 'sr_set_threads failed'
+  end subroutine set_threads
+
+  ! Lane of the calling thread when it is not its OpenMP thread number
+  subroutine bind_thread(lane)
+    integer, intent(in) :: lane
+    integer(C_INT) :: code
+    code = sr_bind_thread(lane)
+  end subroutine bind_thread
+
+  subroutine put_step_type_key(key, step_type)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer, intent(in) :: step_type
+    integer(C_INT) :: code
+    code = sr_put_step_type(global_handle, key, key_length(key), step_type)
+    if (code /= 0) stop 'sr_put_step_type failed'
+  end subroutine put_step_type_key
+
+  ! dims is the local shape; the last dimension is summed over ranks and the
+  ! tensor keeps its shape, e.g. state(3,n) lands as [3, n_global]
+  subroutine put_state_key(key, dims, state)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer, intent(in), dimension(:) :: dims
+    real(C_DOUBLE), intent(in), dimension(product(dims)) :: state
+    integer(C_INT) :: code
+    if (size(dims) > 1) then
+      code = sr_put_state_nd(global_handle, key, key_length(key), state, int(dims, C_INT), &
+                             size(dims), SR_LAYOUT_FORTRAN)
+    else
+      code = sr_put_state(global_handle, key, key_length(key), state, size(state))
+    end if
+    if (code /= 0) stop 'sr_put_state failed'
+  end subroutine put_state_key
+
+  subroutine put_reward_key(key, dims, reward)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer, intent(in), dimension(:) :: dims
+    real(C_DOUBLE), intent(in), dimension(product(dims)) :: reward
+    integer(C_INT) :: code
+    if (size(dims) > 1) then
+      code = sr_put_state_nd(global_handle, key, key_length(key), reward, int(dims, C_INT), &
+                             size(dims), SR_LAYOUT_FORTRAN)
+    else
+      code = sr_put_reward(global_handle, key, key_length(key), reward, size(reward))
+    end if
+    if (code /= 0) stop 'sr_put_reward failed'
+  end subroutine put_reward_key
+
+  ! Structure-of-arrays state: fields(f) = c_loc of the f-th array of
+  ! n_points values, packed during the gather into [n_fields, n_points_global]
+  subroutine put_fields(key, fields, n_points, stride, layout)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    type(C_PTR), intent(in), dimension(:) :: fields
+    integer, intent(in) :: n_points
+    integer, intent(in), optional :: stride, layout
+    integer(C_INT) :: code, cstride, clayout
+    cstride = 1
+    if (present(stride)) cstride = stride
+    clayout = SR_LAYOUT_CONTIGUOUS
+    if (present(layout)) clayout = layout
+    code = sr_put_fields(global_handle, key, key_length(key), fields, size(fields), &
+                         n_points, cstride, clayout)
+    if (code /= 0) stop 'sr_put_fields failed'
+  end subroutine put_fields
+
+  subroutine get_action_key(key, dims, action)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer, intent(in), dimension(:) :: dims
+    real(C_DOUBLE), intent(out), dimension(product(dims)) :: action
+    integer(C_INT) :: code
+    code = sr_get_action(global_handle, key, key_length(key), action, size(action))
+    if (code /= 0) stop 'sr_get_action failed'
+  end subroutine get_action_key
+
+  subroutine wait_action_key(key, dims, action, timeout, timed_out)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer, intent(in), dimension(:) :: dims
+    real(C_DOUBLE), intent(inout), dimension(product(dims)) :: action
+    real(C_DOUBLE), intent(in), optional :: timeout
+    logical, intent(out), optional :: timed_out
+    real(C_DOUBLE) :: ctimeout
+    integer(C_INT) :: code
+    ctimeout = -1.0_C_DOUBLE
+    if (present(timeout)) ctimeout = timeout
+    code = sr_wait_action(global_handle, key, key_length(key), action, size(action), ctimeout)
+    if (present(timed_out)) then
+      timed_out = (code == 2)
+      if (code == 2) return
+    end if
+    if (code /= 0) stop 'sr_wait_action failed'
+  end subroutine wait_action_key
+
+  ! Native interface: a character(len=*) key (trailing blanks ignored) and the
+  ! caller's own contiguous array of any rank, passed by address with no
+  ! staging copy. real32, int32 and int64 values are converted to and from
+  ! the key's wire precision during the exchange (int actions are rounded);
+  ! a state of rank > 1 keeps its shape like put_state(key, dims, state).
+  ! With ierr, a failure returns its status (1 error, 2 timeout) instead of
+  ! stopping the run.
+  subroutine report_status(code, ierr, what)
+    integer(C_INT), intent(in) :: code
+    integer, intent(out), optional :: ierr
+    character(len=*), intent(in) :: what
+    if (present(ierr)) then
+      ierr = code
+    else if (code /= 0) then
+      write(error_unit, '(a)') what // ' failed'
+      stop 1
+    end if
+  end subroutine report_status
+
+  subroutine put_state_values(key, state, state_type, dims, ierr, what)
+    character(kind=C_CHAR, len=*), intent(in) :: key
+    type(C_PTR), intent(in) :: state
+    integer, intent(in) :: state_type
+    integer, intent(in), dimension(:) :: dims
+    integer, intent(out), optional :: ierr
+    character(len=*), intent(in) :: what
+    integer(C_INT) :: code
+    code = sr_put_state_typed(global_handle, key, len_trim(key), state, state_type, int(dims, C_INT), &
+                              size(dims), SR_LAYOUT_FORTRAN)
+    call report_status(code, ierr, what)
+  end subroutine put_state_values
+
+  subroutine receive_action_values(key, action, action_size, action_type, wait, timeout, timed_out, ierr)
+    character(kind=C_CHAR, len=*), intent(in) :: key
+    type(C_PTR), intent(in) :: action
+    integer, intent(in) :: action_size, action_type
+    logical, intent(in) :: wait
+    real(C_DOUBLE), intent(in), optional :: timeout
+    logical, intent(out), optional :: timed_out
+    integer, intent(out), optional :: ierr
+    real(C_DOUBLE) :: ctimeout
+    integer(C_INT) :: code
+    if (.not. wait) then
+      code = sr_get_action_typed(global_handle, key, len_trim(key), action, action_size, action_type)
+      call report_status(code, ierr, 'sr_get_action')
+      return
+    end if
+    ctimeout = -1.0_C_DOUBLE
+    if (present(timeout)) ctimeout = timeout
+    code = sr_wait_action_typed(global_handle, key, len_trim(key), action, action_size, action_type, ctimeout)
+    if (present(timed_out)) then
+      timed_out = (code == 2)
+      if (code == 2 .and. .not. present(ierr)) return
+    end if
+    call report_status(code, ierr, 'sr_wait_action')
+  end subroutine receive_action_values
+
+  subroutine put_state_r8(key, state, ierr)
+    character(kind=C_CHAR, len=*), intent(in) :: key
+    real(C_DOUBLE), intent(in), target, contiguous, dimension(..) :: state
+    integer, intent(out), optional :: ierr
+    call put_state_values(key, c_loc(state), SR_TYPE_FLOAT64, shape(state), ierr, 'sr_put_state')
+  end subroutine put_state_r8
+
+  subroutine put_state_r4(key, state, ierr)
+    character(kind=C_CHAR, len=*), intent(in) :: key
+    real(C_FLOAT), intent(in), target, contiguous, dimension(..) :: state
+    integer, intent(out), optional :: ierr
+    call put_state_values(key, c_loc(state), SR_TYPE_FLOAT32, shape(state), ierr, 'sr_put_state')
+  end subroutine put_state_r4
+
+  subroutine put_state_i4(key, state, ierr)
+    character(kind=C_CHAR, len=*), intent(in) :: key
+    integer(C_INT32_T), intent(in), target, contiguous, dimension(..) :: state
+    integer, intent(out), optional :: ierr
+    call put_state_values(key, c_loc(state), SR_TYPE_INT32, shape(state), ierr, 'sr_put_state')
+  end subroutine put_state_i4
+
+  subroutine put_state_i8(key, state, ierr)
+    character(kind=C_CHAR, len=*), intent(in) :: key
+    integer(C_INT64_T), intent(in), target, contiguous, dimension(..) :: state
+    integer, intent(out), optional :: ierr
+    call put_state_values(key, c_loc(state), SR_TYPE_INT64, shape(state), ierr, 'sr_put_state')
+  end subroutine put_state_i8
+
+  subroutine put_reward_r8(key, reward, ierr)
+    character(kind=C_CHAR, len=*), intent(in) :: key
+    real(C_DOUBLE), intent(in), target, contiguous, dimension(..) :: reward
+    integer, intent(out), optional :: ierr
+    call put_state_values(key, c_loc(reward), SR_TYPE_FLOAT64, shape(reward), ierr, 'sr_put_reward')
+  end subroutine put_reward_r8
+
+  subroutine put_reward_r4(key, reward, ierr)
+    character(kind=C_CHAR, len=*), intent(in) :: key
+    real(C_FLOAT), intent(in), target, contiguous, dimension(..) :: reward
+    integer, intent(out), optional :: ierr
+    call put_state_values(key, c_loc(reward), SR_TYPE_FLOAT32, shape(reward), ierr, 'sr_put_reward')
+  end subroutine put_reward_r4
+
+  subroutine put_reward_i4(key, reward, ierr)
+    character(kind=C_CHAR, len=*), intent(in) :: key
+    integer(C_INT32_T), intent(in), target, contiguous, dimension(..) :: reward
+    integer, intent(out), optional :: ierr
+    call put_state_values(key, c_loc(reward), SR_TYPE_INT32, shape(reward), ierr, 'sr_put_reward')
+  end subroutine put_reward_i4
+
+  subroutine put_reward_i8(key, reward, ierr)
+    character(kind=C_CHAR, len=*), intent(in) :: key
+    integer(C_INT64_T), intent(in), target, contiguous, dimension(..) :: reward
+    integer, intent(out), optional :: ierr
+    call put_state_values(key, c_loc(reward), SR_TYPE_INT64, shape(reward), ierr, 'sr_put_reward')
+  end subroutine put_reward_i8
+
+  subroutine get_action_r8(key, action, ierr)
+    character(kind=C_CHAR, len=*), intent(in) :: key
+    real(C_DOUBLE), intent(out), target, contiguous, dimension(..) :: action
+    integer, intent(out), optional :: ierr
+    call receive_action_values(key, c_loc(action), size(action), SR_TYPE_FLOAT64, .false., ierr=ierr)
+  end subroutine get_action_r8
+
+  subroutine get_action_r4(key, action, ierr)
+    character(kind=C_CHAR, len=*), intent(in) :: key
+    real(C_FLOAT), intent(out), target, contiguous, dimension(..) :: action
+    integer, intent(out), optional :: ierr
+    call receive_action_values(key, c_loc(action), size(action), SR_TYPE_FLOAT32, .false., ierr=ierr)
+  end subroutine get_action_r4
+
+  subroutine get_action_i4(key, action, ierr)
+    character(kind=C_CHAR, len=*), intent(in) :: key
+    integer(C_INT32_T), intent(out), target, contiguous, dimension(..) :: action
+    integer, intent(out), optional :: ierr
+    call receive_action_values(key, c_loc(action), size(action), SR_TYPE_INT32, .false., ierr=ierr)
+  end subroutine get_action_i4
+
+  subroutine get_action_i8(key, action, ierr)
+    character(kind=C_CHAR, len=*), intent(in) :: key
+    integer(C_INT64_T), intent(out), target, contiguous, dimension(..) :: action
+    integer, intent(out), optional :: ierr
+    call receive_action_values(key, c_loc(action), size(action), SR_TYPE_INT64, .false., ierr=ierr)
+  end subroutine get_action_i8
+
+  subroutine wait_action_r8(key, action, timeout, timed_out, ierr)
+    character(kind=C_CHAR, len=*), intent(in) :: key
+    real(C_DOUBLE), intent(inout), target, contiguous, dimension(..) :: action
+    real(C_DOUBLE), intent(in), optional :: timeout
+    logical, intent(out), optional :: timed_out
+    integer, intent(out), optional :: ierr
+    call receive_action_values(key, c_loc(action), size(action), SR_TYPE_FLOAT64, .true., timeout, timed_out, ierr)
+  end subroutine wait_action_r8
+
+  subroutine wait_action_r4(key, action, timeout, timed_out, ierr)
+    character(kind=C_CHAR, len=*), intent(in) :: key
+    real(C_FLOAT), intent(inout), target, contiguous, dimension(..) :: action
+    real(C_DOUBLE), intent(in), optional :: timeout
+    logical, intent(out), optional :: timed_out
+    integer, intent(out), optional :: ierr
+    call receive_action_values(key, c_loc(action), size(action), SR_TYPE_FLOAT32, .true., timeout, timed_out, ierr)
+  end subroutine wait_action_r4
+
+  subroutine wait_action_i4(key, action, timeout, timed_out, ierr)
+    character(kind=C_CHAR, len=*), intent(in) :: key
+    integer(C_INT32_T), intent(inout), target, contiguous, dimension(..) :: action
+    real(C_DOUBLE), intent(in), optional :: timeout
+    logical, intent(out), optional :: timed_out
+    integer, intent(out), optional :: ierr
+    call receive_action_values(key, c_loc(action), size(action), SR_TYPE_INT32, .true., timeout, timed_out, ierr)
+  end subroutine wait_action_i4
+
+  subroutine wait_action_i8(key, action, timeout, timed_out, ierr)
+    character(kind=C_CHAR, len=*), intent(in) :: key
+    integer(C_INT64_T), intent(inout), target, contiguous, dimension(..) :: action
+    real(C_DOUBLE), intent(in), optional :: timeout
+    logical, intent(out), optional :: timed_out
+    integer, intent(out), optional :: ierr
+    call receive_action_values(key, c_loc(action), size(action), SR_TYPE_INT64, .true., timeout, timed_out, ierr)
+  end subroutine wait_action_i8
+
+  subroutine put_tensor_r8(key, data)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    real(C_DOUBLE), intent(in), target, contiguous, dimension(..) :: data
+    integer(C_INT) :: code
+    code = sr_put_tensor(global_handle, key, key_length(key), c_loc(data), int(size(data), C_INT), &
+                         SR_TYPE_FLOAT64)
+    if (code /= 0) stop 'sr_put_tensor failed'
+  end subroutine put_tensor_r8
+
+  subroutine put_tensor_r4(key, data)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    real(C_FLOAT), intent(in), target, contiguous, dimension(..) :: data
+    integer(C_INT) :: code
+    code = sr_put_tensor(global_handle, key, key_length(key), c_loc(data), int(size(data), C_INT), &
+                         SR_TYPE_FLOAT32)
+    if (code /= 0) stop 'sr_put_tensor failed'
+  end subroutine put_tensor_r4
+
+  subroutine put_tensor_i1(key, data)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer(C_INT8_T), intent(in), target, contiguous, dimension(..) :: data
+    integer(C_INT) :: code
+    code = sr_put_tensor(global_handle, key, key_length(key), c_loc(data), int(size(data), C_INT), &
+                         SR_TYPE_INT8)
+    if (code /= 0) stop 'sr_put_tensor failed'
+  end subroutine put_tensor_i1
+
+  subroutine put_tensor_i2(key, data)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer(C_INT16_T), intent(in), target, contiguous, dimension(..) :: data
+    integer(C_INT) :: code
+    code = sr_put_tensor(global_handle, key, key_length(key), c_loc(data), int(size(data), C_INT), &
+                         SR_TYPE_INT16)
+    if (code /= 0) stop 'sr_put_tensor failed'
+  end subroutine put_tensor_i2
+
+  subroutine put_tensor_i4(key, data)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer(C_INT32_T), intent(in), target, contiguous, dimension(..) :: data
+    integer(C_INT) :: code
+    code = sr_put_tensor(global_handle, key, key_length(key), c_loc(data), int(size(data), C_INT), &
+                         SR_TYPE_INT32)
+    if (code /= 0) stop 'sr_put_tensor failed'
+  end subroutine put_tensor_i4
+
+  subroutine put_tensor_i8(key, data)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer(C_INT64_T), intent(in), target, contiguous, dimension(..) :: data
+    integer(C_INT) :: code
+    code = sr_put_tensor(global_handle, key, key_length(key), c_loc(data), int(size(data), C_INT), &
+                         SR_TYPE_INT64)
+    if (code /= 0) stop 'sr_put_tensor failed'
+  end subroutine put_tensor_i8
+
+  subroutine get_tensor_r8(key, data)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    real(C_DOUBLE), intent(out), target, contiguous, dimension(..) :: data
+    integer(C_INT) :: code
+    code = sr_get_tensor(global_handle, key, key_length(key), c_loc(data), int(size(data), C_INT), &
+                         SR_TYPE_FLOAT64)
+    if (code /= 0) stop 'sr_get_tensor failed'
+  end subroutine get_tensor_r8
+
+  subroutine get_tensor_r4(key, data)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    real(C_FLOAT), intent(out), target, contiguous, dimension(..) :: data
+    integer(C_INT) :: code
+    code = sr_get_tensor(global_handle, key, key_length(key), c_loc(data), int(size(data), C_INT), &
+                         SR_TYPE_FLOAT32)
+    if (code /= 0) stop 'sr_get_tensor failed'
+  end subroutine get_tensor_r4
+
+  subroutine get_tensor_i1(key, data)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer(C_INT8_T), intent(out), target, contiguous, dimension(..) :: data
+    integer(C_INT) :: code
+    code = sr_get_tensor(global_handle, key, key_length(key), c_loc(data), int(size(data), C_INT), &
+                         SR_TYPE_INT8)
+    if (code /= 0) stop 'sr_get_tensor failed'
+  end subroutine get_tensor_i1
+
+  subroutine get_tensor_i2(key, data)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer(C_INT16_T), intent(out), target, contiguous, dimension(..) :: data
+    integer(C_INT) :: code
+    code = sr_get_tensor(global_handle, key, key_length(key), c_loc(data), int(size(data), C_INT), &
+                         SR_TYPE_INT16)
+    if (code /= 0) stop 'sr_get_tensor failed'
+  end subroutine get_tensor_i2
+
+  subroutine get_tensor_i4(key, data)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer(C_INT32_T), intent(out), target, contiguous, dimension(..) :: data
+    integer(C_INT) :: code
+    code = sr_get_tensor(global_handle, key, key_length(key), c_loc(data), int(size(data), C_INT), &
+                         SR_TYPE_INT32)
+    if (code /= 0) stop 'sr_get_tensor failed'
+  end subroutine get_tensor_i4
+
+  subroutine get_tensor_i8(key, data)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer(C_INT64_T), intent(out), target, contiguous, dimension(..) :: data
+    integer(C_INT) :: code
+    code = sr_get_tensor(global_handle, key, key_length(key), c_loc(data), int(size(data), C_INT), &
+                         SR_TYPE_INT64)
+    if (code /= 0) stop 'sr_get_tensor failed'
+  end subroutine get_tensor_i8
+
+  subroutine wait_tensor_r8(key, data, timeout, timed_out)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    real(C_DOUBLE), intent(inout), target, contiguous, dimension(..) :: data
+    real(C_DOUBLE), intent(in), optional :: timeout
+    logical, intent(out), optional :: timed_out
+    real(C_DOUBLE) :: ctimeout
+    integer(C_INT) :: code
+    ctimeout = -1.0_C_DOUBLE
+    if (present(timeout)) ctimeout = timeout
+    code = sr_wait_tensor(global_handle, key, key_length(key), c_loc(data), int(size(data), C_INT), &
+                          SR_TYPE_FLOAT64, ctimeout)
+    if (present(timed_out)) then
+      timed_out = (code == 2)
+      if (code == 2) return
+    end if
+    if (code /= 0) stop 'sr_wait_tensor failed'
+  end subroutine wait_tensor_r8
+
+  subroutine wait_tensor_r4(key, data, timeout, timed_out)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    real(C_FLOAT), intent(inout), target, contiguous, dimension(..) :: data
+    real(C_DOUBLE), intent(in), optional :: timeout
+    logical, intent(out), optional :: timed_out
+    real(C_DOUBLE) :: ctimeout
+    integer(C_INT) :: code
+    ctimeout = -1.0_C_DOUBLE
+    if (present(timeout)) ctimeout = timeout
+    code = sr_wait_tensor(global_handle, key, key_length(key), c_loc(data), int(size(data), C_INT), &
+                          SR_TYPE_FLOAT32, ctimeout)
+    if (present(timed_out)) then
+      timed_out = (code == 2)
+      if (code == 2) return
+    end if
+    if (code /= 0) stop 'sr_wait_tensor failed'
+  end subroutine wait_tensor_r4
+
+  subroutine wait_tensor_i1(key, data, timeout, timed_out)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer(C_INT8_T), intent(inout), target, contiguous, dimension(..) :: data
+    real(C_DOUBLE), intent(in), optional :: timeout
+    logical, intent(out), optional :: timed_out
+    real(C_DOUBLE) :: ctimeout
+    integer(C_INT) :: code
+    ctimeout = -1.0_C_DOUBLE
+    if (present(timeout)) ctimeout = timeout
+    code = sr_wait_tensor(global_handle, key, key_length(key), c_loc(data), int(size(data), C_INT), &
+                          SR_TYPE_INT8, ctimeout)
+    if (present(timed_out)) then
+      timed_out = (code == 2)
+      if (code == 2) return
+    end if
+    if (code /= 0) stop 'sr_wait_tensor failed'
+  end subroutine wait_tensor_i1
+
+  subroutine wait_tensor_i2(key, data, timeout, timed_out)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer(C_INT16_T), intent(inout), target, contiguous, dimension(..) :: data
+    real(C_DOUBLE), intent(in), optional :: timeout
+    logical, intent(out), optional :: timed_out
+    real(C_DOUBLE) :: ctimeout
+    integer(C_INT) :: code
+    ctimeout = -1.0_C_DOUBLE
+    if (present(timeout)) ctimeout = timeout
+    code = sr_wait_tensor(global_handle, key, key_length(key), c_loc(data), int(size(data), C_INT), &
+                          SR_TYPE_INT16, ctimeout)
+    if (present(timed_out)) then
+      timed_out = (code == 2)
+      if (code == 2) return
+    end if
+    if (code /= 0) stop 'sr_wait_tensor failed'
+  end subroutine wait_tensor_i2
+
+  subroutine wait_tensor_i4(key, data, timeout, timed_out)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer(C_INT32_T), intent(inout), target, contiguous, dimension(..) :: data
+    real(C_DOUBLE), intent(in), optional :: timeout
+    logical, intent(out), optional :: timed_out
+    real(C_DOUBLE) :: ctimeout
+    integer(C_INT) :: code
+    ctimeout = -1.0_C_DOUBLE
+    if (present(timeout)) ctimeout = timeout
+    code = sr_wait_tensor(global_handle, key, key_length(key), c_loc(data), int(size(data), C_INT), &
+                          SR_TYPE_INT32, ctimeout)
+    if (present(timed_out)) then
+      timed_out = (code == 2)
+      if (code == 2) return
+    end if
+    if (code /= 0) stop 'sr_wait_tensor failed'
+  end subroutine wait_tensor_i4
+
+  subroutine wait_tensor_i8(key, data, timeout, timed_out)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer(C_INT64_T), intent(inout), target, contiguous, dimension(..) :: data
+    real(C_DOUBLE), intent(in), optional :: timeout
+    logical, intent(out), optional :: timed_out
+    real(C_DOUBLE) :: ctimeout
+    integer(C_INT) :: code
+    ctimeout = -1.0_C_DOUBLE
+    if (present(timeout)) ctimeout = timeout
+    code = sr_wait_tensor(global_handle, key, key_length(key), c_loc(data), int(size(data), C_INT), &
+                          SR_TYPE_INT64, ctimeout)
+    if (present(timed_out)) then
+      timed_out = (code == 2)
+      if (code == 2) return
+    end if
+    if (code /= 0) stop 'sr_wait_tensor failed'
+  end subroutine wait_tensor_i8
+
+  ! Batched keys: column k of keys is the k-th null-terminated key, its
+  ! sizes(k) values follow those of key k-1 in states / actions
+  subroutine pack_keys(keys, packed, lens)
+    character(kind=C_CHAR), intent(in), dimension(:,:) :: keys
+    character(kind=C_CHAR), intent(out), dimension(size(keys)) :: packed
+    integer(C_INT), intent(out), dimension(size(keys, 2)) :: lens
+    integer :: k, pos
+    pos = 0
+    do k = 1, size(keys, 2)
+      lens(k) = key_length(keys(:, k))
+      packed(pos+1:pos+lens(k)) = keys(1:lens(k), k)
+      pos = pos + lens(k)
+    end do
+  end subroutine pack_keys
+
+  subroutine put_states(keys, states, sizes)
+    character(kind=C_CHAR), intent(in), dimension(:,:) :: keys
+    integer, intent(in), dimension(:) :: sizes
+    real(C_DOUBLE), intent(in), dimension(sum(sizes)) :: states
+    character(kind=C_CHAR), dimension(size(keys)) :: packed
+    integer(C_INT), dimension(size(keys, 2)) :: lens
+    integer(C_INT) :: code
+    call pack_keys(keys, packed, lens)
+    code = sr_put_states(global_handle, packed, lens, size(keys, 2), states, int(sizes, C_INT))
+    if (code /= 0) stop 'sr_put_states failed'
+  end subroutine put_states
+
+  subroutine get_actions(keys, actions, sizes)
+    character(kind=C_CHAR), intent(in), dimension(:,:) :: keys
+    integer, intent(in), dimension(:) :: sizes
+    real(C_DOUBLE), intent(out), dimension(sum(sizes)) :: actions
+    character(kind=C_CHAR), dimension(size(keys)) :: packed
+    integer(C_INT), dimension(size(keys, 2)) :: lens
+    integer(C_INT) :: code
+    call pack_keys(keys, packed, lens)
+    code = sr_get_actions(global_handle, packed, lens, size(keys, 2), actions, int(sizes, C_INT))
+    if (code /= 0) stop 'sr_get_actions failed'
+  end subroutine get_actions
+
+  subroutine wait_actions(keys, actions, sizes, timeout, timed_out)
+    character(kind=C_CHAR), intent(in), dimension(:,:) :: keys
+    integer, intent(in), dimension(:) :: sizes
+    real(C_DOUBLE), intent(inout), dimension(sum(sizes)) :: actions
+    real(C_DOUBLE), intent(in), optional :: timeout
+    logical, intent(out), optional :: timed_out
+    character(kind=C_CHAR), dimension(size(keys)) :: packed
+    integer(C_INT), dimension(size(keys, 2)) :: lens
+    real(C_DOUBLE) :: ctimeout
+    integer(C_INT) :: code
+    ctimeout = -1.0_C_DOUBLE
+    if (present(timeout)) ctimeout = timeout
+    call pack_keys(keys, packed, lens)
+    code = sr_wait_actions(global_handle, packed, lens, size(keys, 2), actions, int(sizes, C_INT), ctimeout)
+    if (present(timed_out)) then
+      timed_out = (code == 2)
+      if (code == 2) return
+    end if
+    if (code /= 0) stop 'sr_wait_actions failed'
+  end subroutine wait_actions
+
+  ! Sparse state: only state(indices(k)) (1-based) are sent; the writer
+  ! stores their 0-based positions in the dense state and their values
+  subroutine put_state_sparse(key, n, state, indices)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer, intent(in) :: n
+    real(C_DOUBLE), intent(in), dimension(n) :: state
+    integer, intent(in), dimension(:) :: indices
+    integer(C_INT) :: code
+    code = sr_put_state_sparse(global_handle, key, key_length(key), state, n, &
+                               int(indices - 1, C_INT), size(indices))
+    if (code /= 0) stop 'sr_put_state_sparse failed'
+  end subroutine put_state_sparse
+
+  subroutine put_state_masked(key, n, state, mask)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer, intent(in) :: n
+    real(C_DOUBLE), intent(in), dimension(n) :: state
+    logical, intent(in), dimension(n) :: mask
+    integer(C_INT) :: code
+    code = sr_put_state_masked(global_handle, key, key_length(key), state, n, merge(1_C_INT, 0_C_INT, mask))
+    if (code /= 0) stop 'sr_put_state_masked failed'
+  end subroutine put_state_masked
+
+  ! Entries that moved by more than threshold since they were last sent
+  subroutine put_state_delta(key, n, state, threshold)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer, intent(in) :: n
+    real(C_DOUBLE), intent(in), dimension(n) :: state
+    real(C_DOUBLE), intent(in) :: threshold
+    integer(C_INT) :: code
+    code = sr_put_state_delta(global_handle, key, key_length(key), state, n, threshold)
+    if (code /= 0) stop 'sr_put_state_delta failed'
+  end subroutine put_state_delta
+
+  ! Only the entries the agent sent are overwritten
+  subroutine get_action_sparse(key, n, action)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer, intent(in) :: n
+    real(C_DOUBLE), intent(inout), dimension(n) :: action
+    integer(C_INT) :: code
+    code = sr_get_action_sparse(global_handle, key, key_length(key), action, n)
+    if (code /= 0) stop 'sr_get_action_sparse failed'
+  end subroutine get_action_sparse
+
+  subroutine wait_action_sparse(key, n, action, timeout, timed_out)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer, intent(in) :: n
+    real(C_DOUBLE), intent(inout), dimension(n) :: action
+    real(C_DOUBLE), intent(in), optional :: timeout
+    logical, intent(out), optional :: timed_out
+    real(C_DOUBLE) :: ctimeout
+    integer(C_INT) :: code
+    ctimeout = -1.0_C_DOUBLE
+    if (present(timeout)) ctimeout = timeout
+    code = sr_wait_action_sparse(global_handle, key, key_length(key), action, n, ctimeout)
+    if (present(timed_out)) then
+      timed_out = (code == 2)
+      if (code == 2) return
+    end if
+    if (code /= 0) stop 'sr_wait_action_sparse failed'
+  end subroutine wait_action_sparse
+
+  ! Trajectory buffering: a step's state(n_points, n_features) is stored
+  ! as [k, n_features, n_points_global]; every n_steps steps are flushed
+  subroutine open_trajectory(key, n_steps, n_features, n_points, n_reward, async)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer, intent(in) :: n_steps, n_features, n_points
+    integer, intent(in), optional :: n_reward
+    logical, intent(in), optional :: async
+    integer(C_INT) :: code, creward, casync
+    creward = 1
+    if (present(n_reward)) creward = n_reward
+    casync = 0
+    if (present(async)) then
+      if (async) casync = 1
+    end if
+    code = sr_open_trajectory(global_handle, key, key_length(key), n_steps, n_features, n_points, &
+                              creward, casync)
+    if (code /= 0) stop 'sr_open_trajectory failed'
+  end subroutine open_trajectory
+
+  subroutine append_step(key, dims, state, reward, step_type)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer, intent(in), dimension(:) :: dims
+    real(C_DOUBLE), intent(in), dimension(product(dims)) :: state
+    real(C_DOUBLE), intent(in), dimension(:) :: reward
+    integer, intent(in) :: step_type
+    integer(C_INT) :: code
+    code = sr_append_step(global_handle, key, key_length(key), state, size(state), reward, size(reward), &
+                          step_type)
+    if (code /= 0) stop 'sr_append_step failed'
+  end subroutine append_step
+
+  subroutine flush_trajectory(key)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer(C_INT) :: code
+    code = sr_flush_trajectory(global_handle, key, key_length(key))
+    if (code /= 0) stop 'sr_flush_trajectory failed'
+  end subroutine flush_trajectory
+
+  subroutine close_trajectory(key)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer(C_INT) :: code
+    code = sr_close_trajectory(global_handle, key, key_length(key))
+    if (code /= 0) stop 'sr_close_trajectory failed'
+  end subroutine close_trajectory
+
+  ! Registered keys: the key is converted once here, the calls below pass
+  ! only the id. With per_step the key is stored as <key>.<step> for the
+  ! step set with set_step. Register in the same order on all ranks.
+  function register_key(key, per_step) result(id)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    logical, intent(in), optional :: per_step
+    integer :: id
+    integer(C_INT) :: code, cper_step, cid
+    cper_step = 0
+    if (present(per_step)) then
+      if (per_step) cper_step = 1
+    end if
+    code = sr_register_key(global_handle, key, key_length(key), cper_step, cid)
+    if (code /= 0) stop 'sr_register_key failed'
+    id = cid
+  end function register_key
+
+  ! Step-versioned ring: a per-step key keeping the last `slots` steps, so
+  ! the agent can write step n+1 while the solver reads step n with
+  ! get_action_step; older slots are deleted in batches from set_step
+  function register_ring_key(key, slots) result(id)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer, intent(in) :: slots
+    integer :: id
+    integer(C_INT) :: code, cid
+    code = sr_register_ring_key(global_handle, key, key_length(key), slots, cid)
+    if (code /= 0) stop 'sr_register_ring_key failed'
+    id = cid
+  end function register_ring_key
+
+  subroutine set_step(step)
+    integer, intent(in) :: step
+    integer(C_INT) :: code
+    code = sr_set_step(global_handle, int(step, C_LONG_LONG))
+    if (code /= 0) stop 'sr_set_step failed'
+  end subroutine set_step
+
+  subroutine put_step_type_id(id, step_type)
+    integer, intent(in) :: id, step_type
+    integer(C_INT) :: code
+    code = sr_put_step_type_id(global_handle, id, step_type)
+    if (code /= 0) stop 'sr_put_step_type failed'
+  end subroutine put_step_type_id
+
+  ! Registered keys store states, rewards and infos flat (product(dims) values per rank)
+  subroutine put_state_id(id, dims, state)
+    integer, intent(in) :: id
+    integer, intent(in), dimension(:) :: dims
+    real(C_DOUBLE), intent(in), dimension(product(dims)) :: state
+    integer(C_INT) :: code
+    code = sr_put_state_id(global_handle, id, state, size(state))
+    if (code /= 0) stop 'sr_put_state failed'
+  end subroutine put_state_id
+
+  subroutine put_reward_id(id, dims, reward)
+    integer, intent(in) :: id
+    integer, intent(in), dimension(:) :: dims
+    real(C_DOUBLE), intent(in), dimension(product(dims)) :: reward
+    integer(C_INT) :: code
+    code = sr_put_reward_id(global_handle, id, reward, size(reward))
+    if (code /= 0) stop 'sr_put_reward failed'
+  end subroutine put_reward_id
+
+  subroutine put_info_id(id, dims, info)
+    integer, intent(in) :: id
+    integer, intent(in), dimension(:) :: dims
+    integer(C_INT), intent(in), dimension(product(dims)) :: info
+    integer(C_INT) :: code
+    code = sr_put_info_id(global_handle, id, info, size(info))
+    if (code /= 0) stop 'sr_put_info failed'
+  end subroutine put_info_id
+
+  subroutine put_real_scalar_id(id, rscalar)
+    integer, intent(in) :: id
+    real(C_DOUBLE), intent(in) :: rscalar
+    integer(C_INT) :: code
+    code = sr_put_real_scalar_id(global_handle, id, rscalar)
+    if (code /= 0) stop 'sr_put_real_scalar failed'
+  end subroutine put_real_scalar_id
+
+  subroutine get_action_id(id, dims, action)
+    integer, intent(in) :: id
+    integer, intent(in), dimension(:) :: dims
+    real(C_DOUBLE), intent(out), dimension(product(dims)) :: action
+    integer(C_INT) :: code
+    code = sr_get_action_id(global_handle, id, action, size(action))
+    if (code /= 0) stop 'sr_get_action failed'
+  end subroutine get_action_id
+
+  subroutine wait_action_id(id, dims, action, timeout, timed_out)
+    integer, intent(in) :: id
+    integer, intent(in), dimension(:) :: dims
+    real(C_DOUBLE), intent(inout), dimension(product(dims)) :: action
+    real(C_DOUBLE), intent(in), optional :: timeout
+    logical, intent(out), optional :: timed_out
+    real(C_DOUBLE) :: ctimeout
+    integer(C_INT) :: code
+    ctimeout = -1.0_C_DOUBLE
+    if (present(timeout)) ctimeout = timeout
+    code = sr_wait_action_id(global_handle, id, action, size(action), ctimeout)
+    if (present(timed_out)) then
+      timed_out = (code == 2)
+      if (code == 2) return
+    end if
+    if (code /= 0) stop 'sr_wait_action failed'
+  end subroutine wait_action_id
+
+  ! Action of a given step of a registered per-step key
+  subroutine get_action_step(id, step, dims, action)
+    integer, intent(in) :: id, step
+    integer, intent(in), dimension(:) :: dims
+    real(C_DOUBLE), intent(out), dimension(product(dims)) :: action
+    integer(C_INT) :: code
+    code = sr_get_action_step(global_handle, id, int(step, C_LONG_LONG), action, size(action))
+    if (code /= 0) stop 'sr_get_action_step failed'
+  end subroutine get_action_step
+
+  subroutine wait_action_step(id, step, dims, action, timeout, timed_out)
+    integer, intent(in) :: id, step
+    integer, intent(in), dimension(:) :: dims
+    real(C_DOUBLE), intent(inout), dimension(product(dims)) :: action
+    real(C_DOUBLE), intent(in), optional :: timeout
+    logical, intent(out), optional :: timed_out
+    real(C_DOUBLE) :: ctimeout
+    integer(C_INT) :: code
+    ctimeout = -1.0_C_DOUBLE
+    if (present(timeout)) ctimeout = timeout
+    code = sr_wait_action_step(global_handle, id, int(step, C_LONG_LONG), action, size(action), ctimeout)
+    if (present(timed_out)) then
+      timed_out = (code == 2)
+      if (code == 2) return
+    end if
+    if (code /= 0) stop 'sr_wait_action_step failed'
+  end subroutine wait_action_step
+
+  subroutine set_wait_policy(spin_checks, short_sleep_us, short_polls, max_sleep_us)
+    integer, intent(in) :: spin_checks, short_sleep_us, short_polls, max_sleep_us
+    integer(C_INT) :: code
+    code = sr_set_wait_policy(global_handle, spin_checks, short_sleep_us, short_polls, max_sleep_us)
+    if (code /= 0) stop 'sr_set_wait_policy failed'
+  end subroutine set_wait_policy
+
+  subroutine get_action_wait_time(total, last)
+    real(C_DOUBLE), intent(out) :: total, last
+    integer(C_INT) :: code
+    code = sr_get_action_wait_time(global_handle, total, last)
+    if (code /= 0) stop 'sr_get_action_wait_time failed'
+  end subroutine get_action_wait_time
+
+  subroutine put_info_key(key, dims, info)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer, intent(in), dimension(:) :: dims
+    integer(C_INT), intent(in), dimension(product(dims)) :: info
+    integer(C_INT) :: code
+    code = sr_put_info(global_handle, key, key_length(key), info, size(info))
+    if (code /= 0) stop 'sr_put_info failed'
+  end subroutine put_info_key
+
+  subroutine put_real_scalar_key(key, rscalar)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    real(C_DOUBLE), intent(in) :: rscalar
+    integer(C_INT) :: code
+    code = sr_put_real_scalar(global_handle, key, key_length(key), rscalar)
+    if (code /= 0) stop 'sr_put_real_scalar failed'
+  end subroutine put_real_scalar_key
+
+  subroutine step_exchange(tag, state_dims, state, reward_dims, reward, step_type, &
+                           action_dims, action, scalars, timeout, timed_out)
+    character(kind=C_CHAR), intent(in), dimension(:) :: tag
+    integer, intent(in), dimension(:) :: state_dims, reward_dims, action_dims
+    real(C_DOUBLE), intent(in), dimension(product(state_dims)) :: state
+    real(C_DOUBLE), intent(in), dimension(product(reward_dims)) :: reward
+    integer, intent(in) :: step_type
+    real(C_DOUBLE), intent(out), dimension(product(action_dims)) :: action
+    real(C_DOUBLE), intent(in), dimension(:), optional :: scalars
+    real(C_DOUBLE), intent(in), optional :: timeout
+    logical, intent(out), optional :: timed_out
+    real(C_DOUBLE) :: no_scalars(1)
+    real(C_DOUBLE) :: ctimeout
+    integer(C_INT) :: code
+    ctimeout = -1.0_C_DOUBLE
+    if (present(timeout)) ctimeout = timeout
+    if (present(scalars)) then
+      code = sr_step_exchange(global_handle, tag, key_length(tag), state, size(state), &
+                              reward, size(reward), step_type, action, size(action), &
+                              scalars, size(scalars), ctimeout)
+    else
+      code = sr_step_exchange(global_handle, tag, key_length(tag), state, size(state), &
+                              reward, size(reward), step_type, action, size(action), &
+                              no_scalars, 0, ctimeout)
+    end if
+    if (present(timed_out)) then
+      timed_out = (code == 2)
+      if (code == 2) return
+    end if
+    if (code /= 0) stop 'sr_step_exchange failed'
+  end subroutine step_exchange
+
+  subroutine iput_state(key, dims, state, request)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer, intent(in), dimension(:) :: dims
+    real(C_DOUBLE), intent(in), dimension(product(dims)) :: state
+    integer, intent(out) :: request
+    integer(C_INT) :: code, creq
+    code = sr_iput_state(global_handle, key, key_length(key), state, size(state), creq)
+    if (code /= 0) stop 'sr_iput_state failed'
+    request = creq
+  end subroutine iput_state
+
+  subroutine iput_reward(key, dims, reward, request)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer, intent(in), dimension(:) :: dims
+    real(C_DOUBLE), intent(in), dimension(product(dims)) :: reward
+    integer, intent(out) :: request
+    integer(C_INT) :: code, creq
+    code = sr_iput_reward(global_handle, key, key_length(key), reward, size(reward), creq)
+    if (code /= 0) stop 'sr_iput_reward failed'
+    request = creq
+  end subroutine iput_reward
+
+  subroutine iput_info(key, dims, info, request)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer, intent(in), dimension(:) :: dims
+    integer(C_INT), intent(in), dimension(product(dims)) :: info
+    integer, intent(out) :: request
+    integer(C_INT) :: code, creq
+    code = sr_iput_info(global_handle, key, key_length(key), info, size(info), creq)
+    if (code /= 0) stop 'sr_iput_info failed'
+    request = creq
+  end subroutine iput_info
+
+  function test_request(request) result(flag)
+    integer, intent(in) :: request
+    logical :: flag
+    integer(C_INT) :: code, cflag
+    code = sr_test(global_handle, request, cflag)
+    if (code /= 0) stop 'sr_test failed'
+    flag = (cflag /= 0)
+  end function test_request
+
+  subroutine wait_request(request)
+    integer, intent(in) :: request
+    integer(C_INT) :: code
+    code = sr_wait(global_handle, request)
+    if (code /= 0) stop 'sr_wait failed'
+  end subroutine wait_request
+
+  subroutine waitall_requests()
+    integer(C_INT) :: code
+    code = sr_waitall(global_handle)
+    if (code /= 0) stop 'sr_waitall failed'
+  end subroutine waitall_requests
+
+  subroutine set_wire_precision(key, precision)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer, intent(in) :: precision
+    integer(C_INT) :: code
+    code = sr_set_wire_precision(global_handle, key, key_length(key), int(precision, C_INT))
+    if (code /= 0) stop 'sr_set_wire_precision failed'
+  end subroutine set_wire_precision
+
+  ! Tensors of at least threshold_bytes (default 0) are stored compressed
+  subroutine set_compression(key, codec, threshold_bytes)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer, intent(in) :: codec
+    integer(C_LONG_LONG), intent(in), optional :: threshold_bytes
+    integer(C_LONG_LONG) :: cthreshold
+    integer(C_INT) :: code
+    cthreshold = 0
+    if (present(threshold_bytes)) cthreshold = threshold_bytes
+    code = sr_set_compression(global_handle, key, key_length(key), int(codec, C_INT), cthreshold)
+    if (code /= 0) stop 'sr_set_compression failed'
+  end subroutine set_compression
+
+  subroutine get_compression_stats(key, ratio, last_ratio, encode_seconds, decode_seconds)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    real(C_DOUBLE), intent(out) :: ratio, last_ratio, encode_seconds, decode_seconds
+    integer(C_INT) :: code
+    code = sr_get_compression_stats(global_handle, key, key_length(key), ratio, last_ratio, &
+                                    encode_seconds, decode_seconds)
+    if (code /= 0) stop 'sr_get_compression_stats failed'
+  end subroutine get_compression_stats
+
+  ! get_action / wait_action of action_key run the MLP published under
+  ! weights_key on this rank's last state_key, refreshed every refresh_steps
+  ! (default 1) reads; an empty weights_key removes the policy
+  subroutine set_local_policy(action_key, state_key, weights_key, refresh_steps)
+    character(kind=C_CHAR), intent(in), dimension(:) :: action_key, state_key, weights_key
+    integer, intent(in), optional :: refresh_steps
+    integer(C_INT) :: code, crefresh
+    crefresh = 1
+    if (present(refresh_steps)) crefresh = int(refresh_steps, C_INT)
+    code = sr_set_local_policy(global_handle, action_key, key_length(action_key), state_key, &
+                               key_length(state_key), weights_key, key_length(weights_key), crefresh)
+    if (code /= 0) stop 'sr_set_local_policy failed'
+  end subroutine set_local_policy
+
+  function get_policy_version(action_key) result(version)
+    character(kind=C_CHAR), intent(in), dimension(:) :: action_key
+    integer :: version
+    integer(C_INT) :: code, cversion
+    code = sr_get_policy_version(global_handle, action_key, key_length(action_key), cversion)
+    if (code /= 0) stop 'sr_get_policy_version failed'
+    version = cversion
+  end function get_policy_version
+
+  subroutine enable_stats(enabled, trace)
+    logical, intent(in) :: enabled
+    logical, intent(in), optional :: trace
+    integer(C_INT) :: code, ctrace
+    ctrace = 0
+    if (present(trace)) ctrace = merge(1, 0, trace)
+    code = sr_enable_stats(global_handle, merge(1, 0, enabled), ctrace)
+    if (code /= 0) stop 'sr_enable_stats failed'
+  end subroutine enable_stats
+
+  ! values: calls, bytes, then count, mean, min, max, p99 (seconds) of phase
+  subroutine get_stats(op, key, phase, values)
+    integer, intent(in) :: op, phase
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    real(C_DOUBLE), intent(out), dimension(SR_STAT_NVALUES) :: values
+    integer(C_INT) :: code
+    code = sr_get_stats(global_handle, int(op, C_INT), key, key_length(key), int(phase, C_INT), values)
+    if (code /= 0) stop 'sr_get_stats failed'
+  end subroutine get_stats
+
+  subroutine reset_stats()
+    integer(C_INT) :: code
+    code = sr_reset_stats(global_handle)
+    if (code /= 0) stop 'sr_reset_stats failed'
+  end subroutine reset_stats
+
+  ! Collective; without path the table goes to stdout of rank 0
+  subroutine dump_stats(path)
+    character(len=*), intent(in), optional :: path
+    integer(C_INT) :: code
+    if (present(path)) then
+      code = sr_dump_stats(global_handle, path, len_trim(path))
+    else
+      code = sr_dump_stats(global_handle, C_NULL_CHAR, 0)
+    end if
+    if (code /= 0) stop 'sr_dump_stats failed'
+  end subroutine dump_stats
+
+  subroutine dump_trace(prefix)
+    character(len=*), intent(in) :: prefix
+    integer(C_INT) :: code
+    code = sr_dump_trace(global_handle, prefix, len_trim(prefix))
+    if (code /= 0) stop 'sr_dump_trace failed'
+  end subroutine dump_trace
+
+  subroutine invalidate_plan(key)
+    character(kind=C_CHAR), intent(in), dimension(:) :: key
+    integer(C_INT) :: code
+    code = sr_invalidate_plan(global_handle, key, key_length(key))
+    if (code /= 0) stop 'sr_invalidate_plan failed'
+  end subroutine invalidate_plan
+
+  subroutine invalidate_plans()
+    integer(C_INT) :: code
+    code = sr_invalidate_plans(global_handle)
+    if (code /= 0) stop 'sr_invalidate_plans failed'
+  end subroutine invalidate_plans
+
+  ! Writers log every put and read to <prefix>.<rank>.srlog; without prefix recording stops
+  subroutine set_record_log(prefix)
+    character(len=*), intent(in), optional :: prefix
+    integer(C_INT) :: code
+    if (present(prefix)) then
+      code = sr_set_record_log(global_handle, prefix, len_trim(prefix))
+    else
+      code = sr_set_record_log(global_handle, C_NULL_CHAR, 0)
+    end if
+    if (code /= 0) stop 'sr_set_record_log failed'
+  end subroutine set_record_log
+
+  ! Log prefix SR_TRANSPORT_REPLAY serves actions from
+  subroutine set_replay_log(prefix)
+    character(len=*), intent(in) :: prefix
+    integer(C_INT) :: code
+    code = sr_set_replay_log(global_handle, prefix, len_trim(prefix))
+    if (code /= 0) stop 'sr_set_replay_log failed'
+  end subroutine set_replay_log
 
 end module smartredis_mpi
@@ -1,6 +1,9 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+#include <algorithm>
 #include <string>
+#include <vector>
 #include "SmartRedisMPI_CInterface.h"
 
 namespace py = pybind11;
@@ -8,8 +11,169 @@ namespace py = pybind11;
 inline const char* str_data(const std::string &s) { return s.c_str(); }
 inline int str_len(const std::string &s) { return static_cast<int>(s.size()); }
 
+template <typename T>
+using carray = py::array_t<T, py::array::c_style | py::array::forcecast>;
+
+// set_strict(True): inputs that are not already C-contiguous arrays of the
+// expected dtype raise instead of being converted (copied)
+static bool strict_arrays = false;
+
+// Run a C call without the GIL: collectives and store I/O may block, and
+// other Python threads keep running meanwhile. Only plain C data is touched.
+template <typename F>
+static int nogil(F &&call) {
+    py::gil_scoped_release release;
+    return call();
+}
+
+// C-contiguous T view of obj: the array itself when it already is one (no
+// copy), else a converted copy, which strict mode refuses
+template <typename T>
+static carray<T> as_input(const py::handle &obj, const char *what) {
+    if (carray<T>::check_(obj)) return py::reinterpret_borrow<carray<T>>(obj);
+    if (strict_arrays)
+        throw py::type_error(std::string(what) + ": expected a C-contiguous " +
+                             py::str(py::dtype::of<T>()).cast<std::string>() + " array (strict mode)");
+    carray<T> arr = carray<T>::ensure(obj);
+    if (!arr)
+        throw py::type_error(std::string(what) + ": cannot convert to a " +
+                             py::str(py::dtype::of<T>()).cast<std::string>() + " array");
+    return arr;
+}
+
+// Destination of an action: a new float64 array when given a size, else the
+// caller's array itself, which must be writable C-contiguous float64
+static carray<double> as_output(const py::handle &obj, const char *what) {
+    if (py::isinstance<py::int_>(obj)) return carray<double>(obj.cast<py::ssize_t>());
+    if (!carray<double>::check_(obj))
+        throw py::type_error(std::string(what) + ": expected a size or a C-contiguous float64 array");
+    carray<double> out = py::reinterpret_borrow<carray<double>>(obj);
+    if (!out.writeable())
+        throw py::value_error(std::string(what) + ": output array is read-only");
+    return out;
+}
+
+// SR_TYPE_* of a numpy dtype (0 if the core has no such tensor type)
+static int tensor_type(const py::dtype &dt) {
+    if (dt.equal(py::dtype::of<double>())) return SR_TYPE_FLOAT64;
+    if (dt.equal(py::dtype::of<float>())) return SR_TYPE_FLOAT32;
+    if (dt.equal(py::dtype::of<int8_t>())) return SR_TYPE_INT8;
+    if (dt.equal(py::dtype::of<int16_t>())) return SR_TYPE_INT16;
+    if (dt.equal(py::dtype::of<int32_t>())) return SR_TYPE_INT32;
+    if (dt.equal(py::dtype::of<int64_t>())) return SR_TYPE_INT64;
+    if (dt.equal(py::dtype::of<uint8_t>())) return SR_TYPE_UINT8;
+    if (dt.equal(py::dtype::of<uint16_t>())) return SR_TYPE_UINT16;
+    return 0;
+}
+
+// Typed tensor input: its own dtype, C-contiguous (copied unless strict)
+static py::array typed_input(const py::handle &obj, const char *what, int &type) {
+    py::array arr = py::array::ensure(obj);
+    if (!arr) throw py::type_error(std::string(what) + ": expected an array");
+    type = tensor_type(arr.dtype());
+    if (!type) throw py::type_error(std::string(what) + ": unsupported dtype");
+    if (!(arr.flags() & py::array::c_style)) {
+        if (strict_arrays)
+            throw py::type_error(std::string(what) + ": expected a C-contiguous array (strict mode)");
+        arr = py::array::ensure(arr, py::array::c_style);
+    }
+    return arr;
+}
+
+// Typed tensor destination: a new array of size and dtype, or the caller's
+// writable C-contiguous array, whose dtype is then the element type
+static py::array typed_output(const py::handle &obj, const py::object &dtype, const char *what, int &type) {
+    py::array out;
+    if (py::isinstance<py::int_>(obj)) {
+        out = py::array(py::dtype::from_args(dtype), {obj.cast<py::ssize_t>()});
+    } else {
+        if (!py::isinstance<py::array>(obj))
+            throw py::type_error(std::string(what) + ": expected a size or an array");
+        out = py::reinterpret_borrow<py::array>(obj);
+        if (!(out.flags() & py::array::c_style) || !out.writeable())
+            throw py::value_error(std::string(what) + ": output must be a writable C-contiguous array");
+    }
+    type = tensor_type(out.dtype());
+    if (!type) throw py::type_error(std::string(what) + ": unsupported dtype");
+    return out;
+}
+
+// A key (str) or an id from register_key (int)
+struct KeyArg {
+    std::string key;
+    int id = 0;
+};
+
+static KeyArg key_arg(const py::handle &obj) {
+    KeyArg k;
+    if (py::isinstance<py::int_>(obj)) k.id = obj.cast<int>();
+    else k.key = obj.cast<std::string>();
+    return k;
+}
+
+// batched keys go to the C interface back to back with their lengths
+static void pack_keys(const std::vector<std::string> &keys, std::string &packed, std::vector<int> &lens) {
+    for(const std::string &k : keys){
+        packed += k;
+        lens.push_back(str_len(k));
+    }
+}
+
+// Batched actions: into a [n_keys, n] float64 array in place, or, given one
+// size per key, as views of one new buffer (key k's values after key k-1's)
+static py::object batch_actions(uintptr_t h, const std::vector<std::string> &keys, const py::object &actions,
+                                double timeout, bool wait) {
+    SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+    const char *what = wait ? "wait_actions" : "get_actions";
+    std::string packed;
+    std::vector<int> lens, sizes;
+    pack_keys(keys, packed, lens);
+
+    carray<double> flat;
+    const bool in_place = py::isinstance<py::array>(actions);
+    if(in_place){
+        flat = as_output(actions, what);
+        if(flat.ndim()!=2 || flat.shape(0)!=static_cast<py::ssize_t>(keys.size()))
+            throw py::value_error(std::string(what) + ": actions must be [n_keys, n]");
+        sizes.assign(keys.size(), static_cast<int>(flat.shape(1)));
+    }else{
+        sizes = actions.cast<std::vector<int>>();
+        if(keys.size()!=sizes.size())
+            throw py::value_error(std::string(what) + ": one size per key");
+        py::ssize_t total = 0;
+        for(int n : sizes) total += n;
+        flat = carray<double>(total);
+    }
+
+    double *data = flat.mutable_data();
+    const int n_keys = static_cast<int>(keys.size());
+    int code = nogil([&]{
+        return wait ? sr_wait_actions(handle, packed.data(), lens.data(), n_keys, data, sizes.data(), timeout)
+                    : sr_get_actions(handle, packed.data(), lens.data(), n_keys, data, sizes.data());
+    });
+    if(code==SR_TIMEOUT) return py::none();
+    if(code!=0)
+        throw std::runtime_error(std::string(what) + " failed");
+    if(in_place) return std::move(flat);
+
+    py::list out;
+    size_t off = 0;
+    for(int n : sizes){
+        out.append(py::array_t<double>(n, data + off, flat));
+        off += n;
+    }
+    return std::move(out);
+}
+
 PYBIND11_MODULE(pysmartredis, m) {
-    m.doc() = "Python wrapper for SmartRedisMPI via C interface";
+    m.doc() = "Python wrapper for SmartRedisMPI via C interface.\n\n"
+              "Arrays that already are C-contiguous with the expected dtype are used in place;\n"
+              "others are converted once (set_strict(True) makes that an error). Actions are\n"
+              "written into a caller-provided float64 array when one is passed instead of a size.\n"
+              "Calls that communicate release the GIL; use a handle from one thread at a time.";
+
+    m.def("set_strict", [](bool strict){ strict_arrays = strict; });
+    m.def("get_strict", [](){ return strict_arrays; });
 
     m.def("create_handle", [](bool clustered=false){
         SR_HANDLE h = sr_mpi_create(clustered?1:0);
@@ -19,27 +183,653 @@ PYBIND11_MODULE(pysmartredis, m) {
 
     m.def("destroy_handle", [](uintptr_t h){
         SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
-        if(sr_mpi_destroy(handle)!=0)
+        if(nogil([&]{ return sr_mpi_destroy(handle); })!=0)
             throw std::runtime_error("Failed to destroy handle");
     });
 
-    m.def("init_smartredis_mpi", [](uintptr_t h, bool clustered=false, int comm=-1){
+    m.attr("TRANSPORT_DEFAULT") = SR_TRANSPORT_DEFAULT;
+    m.attr("TRANSPORT_SMARTREDIS") = SR_TRANSPORT_SMARTREDIS;
+    m.attr("TRANSPORT_SHM") = SR_TRANSPORT_SHM;
+    m.attr("TRANSPORT_REPLAY") = SR_TRANSPORT_REPLAY;
+
+    // comm: None or -1 (MPI_COMM_WORLD), an mpi4py communicator, or a Fortran handle
+    m.def("init_smartredis_mpi", [](uintptr_t h, bool clustered, py::object comm, int transport){
         SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
-        if(sr_init(handle, clustered?1:0, comm)!=0)
+        int fcomm = -1;
+        if(!comm.is_none())
+            fcomm = py::hasattr(comm, "py2f") ? comm.attr("py2f")().cast<int>() : comm.cast<int>();
+        if(nogil([&]{ return sr_init_transport(handle, clustered?1:0, fcomm, transport); })!=0)
             throw std::runtime_error("Failed to init MPI");
-    }, py::arg("h"), py::arg("clustered")=false, py::arg("comm")=-1);
+    }, py::arg("h"), py::arg("clustered")=false, py::arg("comm")=py::none(), py::arg("transport")=-1);
 
     m.def("finalize_smartredis_mpi", [](uintptr_t h){
         SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
-        if(sr_finalize(handle)!=0)
+        if(nogil([&]{ return sr_finalize(handle); })!=0)
             throw std::runtime_error("Failed to finalize MPI");
     });
 
-    // put_state example
-    m.def("put_state", [](uintptr_t h, const std::string &key, py::array_t<double> arr){
+    m.attr("WRITER_ROOT") = SR_WRITER_ROOT;
+    m.attr("WRITER_NODE") = SR_WRITER_NODE;
+    m.attr("WRITER_STRIDE") = SR_WRITER_STRIDE;
+
+    m.def("set_writer_mode", [](uintptr_t h, int mode, int stride){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        if(nogil([&]{ return sr_set_writer_mode(handle, mode, stride); })!=0)
+            throw std::runtime_error("set_writer_mode failed");
+    }, py::arg("h"), py::arg("mode"), py::arg("stride")=0);
+
+    m.attr("COLLECTIVE_FLAT") = SR_COLLECTIVE_FLAT;
+    m.attr("COLLECTIVE_HIERARCHICAL") = SR_COLLECTIVE_HIERARCHICAL;
+
+    m.def("set_collective_mode", [](uintptr_t h, int mode){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        if(nogil([&]{ return sr_set_collective_mode(handle, mode); })!=0)
+            throw std::runtime_error("set_collective_mode failed");
+    });
+
+    // Hybrid MPI + threads: exchanges release the GIL and run on the calling thread's lane
+    m.def("init_mpi_threads", [](){
+        int provided = 0;
+        sr_init_mpi_threads(&provided);
+        return provided;
+    });
+
+    m.def("set_threads", [](uintptr_t h, int n_threads){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        if(nogil([&]{ return sr_set_threads(handle, n_threads); })!=0)
+            throw std::runtime_error("set_threads failed");
+    });
+
+    m.def("bind_thread", [](int lane){ sr_bind_thread(lane); });
+
+    // data operations: key is a str or an id from register_key; arrays are sent flat
+    m.def("put_step_type", [](uintptr_t h, py::object key, int step_type){
         SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
-        py::buffer_info info = arr.request();
-        if(sr_put_state(handle, str_data(key), str_len(key), static_cast<double*>(info.ptr), info.size)!=0)
+        KeyArg k = key_arg(key);
+        if(nogil([&]{ return k.id ? sr_put_step_type_id(handle, k.id, step_type)
+                                  : sr_put_step_type(handle, str_data(k.key), str_len(k.key), step_type); })!=0)
+            throw std::runtime_error("put_step_type failed");
+    });
+
+    m.def("put_state", [](uintptr_t h, py::object key, py::object state){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        KeyArg k = key_arg(key);
+        carray<double> s = as_input<double>(state, "put_state");
+        const double *data = s.data();
+        int n = static_cast<int>(s.size());
+        if(nogil([&]{ return k.id ? sr_put_state_id(handle, k.id, data, n)
+                                  : sr_put_state(handle, str_data(k.key), str_len(k.key), data, n); })!=0)
             throw std::runtime_error("put_state failed");
     });
+
+    m.def("put_reward", [](uintptr_t h, py::object key, py::object reward){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        KeyArg k = key_arg(key);
+        carray<double> r = as_input<double>(reward, "put_reward");
+        const double *data = r.data();
+        int n = static_cast<int>(r.size());
+        if(nogil([&]{ return k.id ? sr_put_reward_id(handle, k.id, data, n)
+                                  : sr_put_reward(handle, str_data(k.key), str_len(k.key), data, n); })!=0)
+            throw std::runtime_error("put_reward failed");
+    });
+
+    // shaped state, distributed over the first axis (C order) or the last
+    // (Fortran order); Fortran-ordered arrays are sent in place as well
+    m.def("put_state_nd", [](uintptr_t h, const std::string &key, py::object state){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        using farray = py::array_t<double, py::array::f_style>;
+        py::array arr;
+        int layout = SR_LAYOUT_CONTIGUOUS;
+        if(farray::check_(state) && !carray<double>::check_(state)){
+            arr = py::reinterpret_borrow<py::array>(state);
+            layout = SR_LAYOUT_FORTRAN;
+        }else{
+            arr = as_input<double>(state, "put_state_nd");
+        }
+        std::vector<int> dims(arr.shape(), arr.shape() + arr.ndim());
+        const double *data = static_cast<const double*>(arr.data());
+        const int ndims = static_cast<int>(dims.size());
+        if(nogil([&]{ return sr_put_state_nd(handle, str_data(key), str_len(key), data, dims.data(),
+                                             ndims, layout); })!=0)
+            throw std::runtime_error("put_state_nd failed");
+    });
+
+    m.def("put_info", [](uintptr_t h, py::object key, py::object info){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        KeyArg k = key_arg(key);
+        carray<int> i = as_input<int>(info, "put_info");
+        const int *data = i.data();
+        int n = static_cast<int>(i.size());
+        if(nogil([&]{ return k.id ? sr_put_info_id(handle, k.id, data, n)
+                                  : sr_put_info(handle, str_data(k.key), str_len(k.key), data, n); })!=0)
+            throw std::runtime_error("put_info failed");
+    });
+
+    m.def("put_real_scalar", [](uintptr_t h, py::object key, double value){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        KeyArg k = key_arg(key);
+        if(nogil([&]{ return k.id ? sr_put_real_scalar_id(handle, k.id, value)
+                                  : sr_put_real_scalar(handle, str_data(k.key), str_len(k.key), value); })!=0)
+            throw std::runtime_error("put_real_scalar failed");
+    });
+
+    // action: its size (returns a new array) or a float64 array filled in place and returned
+    m.def("get_action", [](uintptr_t h, py::object key, py::object action){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        KeyArg k = key_arg(key);
+        carray<double> out = as_output(action, "get_action");
+        double *data = out.mutable_data();
+        int n = static_cast<int>(out.size());
+        if(nogil([&]{ return k.id ? sr_get_action_id(handle, k.id, data, n)
+                                  : sr_get_action(handle, str_data(k.key), str_len(k.key), data, n); })!=0)
+            throw std::runtime_error("get_action failed");
+        return out;
+    });
+
+    // blocking action read; None if it did not appear within timeout seconds
+    m.def("wait_action", [](uintptr_t h, py::object key, py::object action, double timeout) -> py::object {
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        KeyArg k = key_arg(key);
+        carray<double> out = as_output(action, "wait_action");
+        double *data = out.mutable_data();
+        int n = static_cast<int>(out.size());
+        int code = nogil([&]{ return k.id ? sr_wait_action_id(handle, k.id, data, n, timeout)
+                                          : sr_wait_action(handle, str_data(k.key), str_len(k.key), data, n, timeout); });
+        if(code==SR_TIMEOUT) return py::none();
+        if(code!=0)
+            throw std::runtime_error("wait_action failed");
+        return std::move(out);
+    }, py::arg("h"), py::arg("key"), py::arg("action"), py::arg("timeout")=-1.0);
+
+    // typed tensors: sent and stored in the array's own dtype
+    m.def("put_tensor", [](uintptr_t h, const std::string &key, py::object data){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        int type = 0;
+        py::array arr = typed_input(data, "put_tensor", type);
+        const void *ptr = arr.data();
+        int n = static_cast<int>(arr.size());
+        if(nogil([&]{ return sr_put_tensor(handle, str_data(key), str_len(key), ptr, n, type); })!=0)
+            throw std::runtime_error("put_tensor failed");
+    });
+
+    // out: a size (new array of dtype) or an array filled in place and returned
+    m.def("get_tensor", [](uintptr_t h, const std::string &key, py::object out, py::object dtype){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        int type = 0;
+        py::array arr = typed_output(out, dtype, "get_tensor", type);
+        void *ptr = arr.mutable_data();
+        int n = static_cast<int>(arr.size());
+        if(nogil([&]{ return sr_get_tensor(handle, str_data(key), str_len(key), ptr, n, type); })!=0)
+            throw std::runtime_error("get_tensor failed");
+        return arr;
+    }, py::arg("h"), py::arg("key"), py::arg("out"), py::arg("dtype")="float64");
+
+    m.def("wait_tensor", [](uintptr_t h, const std::string &key, py::object out, double timeout,
+                            py::object dtype) -> py::object {
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        int type = 0;
+        py::array arr = typed_output(out, dtype, "wait_tensor", type);
+        void *ptr = arr.mutable_data();
+        int n = static_cast<int>(arr.size());
+        int code = nogil([&]{ return sr_wait_tensor(handle, str_data(key), str_len(key), ptr, n, type, timeout); });
+        if(code==SR_TIMEOUT) return py::none();
+        if(code!=0)
+            throw std::runtime_error("wait_tensor failed");
+        return std::move(arr);
+    }, py::arg("h"), py::arg("key"), py::arg("out"), py::arg("timeout")=-1.0, py::arg("dtype")="float64");
+
+    // registered keys: the data operations above also take the id from register_key
+    m.def("register_key", [](uintptr_t h, const std::string &key, bool per_step){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        int id = 0;
+        if(sr_register_key(handle, str_data(key), str_len(key), per_step?1:0, &id)!=0)
+            throw std::runtime_error("register_key failed");
+        return id;
+    }, py::arg("h"), py::arg("key"), py::arg("per_step")=false);
+
+    // step-versioned ring: a per-step key keeping the last `slots` steps
+    m.def("register_ring_key", [](uintptr_t h, const std::string &key, int slots){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        int id = 0;
+        if(sr_register_ring_key(handle, str_data(key), str_len(key), slots, &id)!=0)
+            throw std::runtime_error("register_ring_key failed");
+        return id;
+    }, py::arg("h"), py::arg("key"), py::arg("slots"));
+
+    m.def("set_step", [](uintptr_t h, long long step){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        if(nogil([&]{ return sr_set_step(handle, step); })!=0)
+            throw std::runtime_error("set_step failed");
+    });
+
+    // action of a given step of a registered per-step key
+    m.def("get_action_step", [](uintptr_t h, int id, long long step, py::object action){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        carray<double> out = as_output(action, "get_action_step");
+        double *data = out.mutable_data();
+        int n = static_cast<int>(out.size());
+        if(nogil([&]{ return sr_get_action_step(handle, id, step, data, n); })!=0)
+            throw std::runtime_error("get_action_step failed");
+        return out;
+    });
+
+    // None if it did not appear within timeout seconds
+    m.def("wait_action_step", [](uintptr_t h, int id, long long step, py::object action,
+                                 double timeout) -> py::object {
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        carray<double> out = as_output(action, "wait_action_step");
+        double *data = out.mutable_data();
+        int n = static_cast<int>(out.size());
+        int code = nogil([&]{ return sr_wait_action_step(handle, id, step, data, n, timeout); });
+        if(code==SR_TIMEOUT) return py::none();
+        if(code!=0)
+            throw std::runtime_error("wait_action_step failed");
+        return std::move(out);
+    }, py::arg("h"), py::arg("id"), py::arg("step"), py::arg("action"), py::arg("timeout")=-1.0);
+
+    // name stored for the key at the current step, e.g. for the agent side
+    m.def("key_name", [](uintptr_t h, int id){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        int len = 0;
+        if(sr_key_name(handle, id, nullptr, 0, &len)!=0)
+            throw std::runtime_error("key_name failed");
+        std::string name(len, '\0');
+        if(sr_key_name(handle, id, &name[0], len, &len)!=0)
+            throw std::runtime_error("key_name failed");
+        return name;
+    });
+
+    // batched keys: one gather for all states, one scatter for all actions.
+    // states: a [n_keys, n] float64 array (sent in place) or one array per key
+    m.def("put_states", [](uintptr_t h, const std::vector<std::string> &keys, py::object states){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        std::string packed;
+        std::vector<int> lens, sizes;
+        pack_keys(keys, packed, lens);
+        carray<double> flat;
+        if(py::isinstance<py::array>(states)){
+            flat = as_input<double>(states, "put_states");
+            if(flat.ndim()!=2 || flat.shape(0)!=static_cast<py::ssize_t>(keys.size()))
+                throw py::value_error("put_states: states must be [n_keys, n]");
+            sizes.assign(keys.size(), static_cast<int>(flat.shape(1)));
+        }else{
+            if(strict_arrays)
+                throw py::type_error("put_states: expected a [n_keys, n] float64 array (strict mode)");
+            std::vector<carray<double>> list;
+            for(py::handle s : states) list.push_back(as_input<double>(s, "put_states"));
+            if(keys.size()!=list.size())
+                throw py::value_error("put_states: one state array per key");
+            py::ssize_t total = 0;
+            for(auto &s : list){
+                sizes.push_back(static_cast<int>(s.size()));
+                total += s.size();
+            }
+            flat = carray<double>(total);
+            double *dst = flat.mutable_data();
+            for(auto &s : list) dst = std::copy(s.data(), s.data() + s.size(), dst);
+        }
+        const double *data = flat.data();
+        const int n_keys = static_cast<int>(keys.size());
+        if(nogil([&]{ return sr_put_states(handle, packed.data(), lens.data(), n_keys, data, sizes.data()); })!=0)
+            throw std::runtime_error("put_states failed");
+    });
+
+    // actions: one size per key (returns a list of arrays) or a [n_keys, n] array filled in place
+    m.def("get_actions", [](uintptr_t h, const std::vector<std::string> &keys, py::object actions){
+        return batch_actions(h, keys, actions, -1.0, false);
+    });
+
+    // None if any key did not appear within timeout seconds
+    m.def("wait_actions", [](uintptr_t h, const std::vector<std::string> &keys, py::object actions,
+                             double timeout){
+        return batch_actions(h, keys, actions, timeout, true);
+    }, py::arg("h"), py::arg("keys"), py::arg("actions"), py::arg("timeout")=-1.0);
+
+    // sparse states: indices are 0-based int32 positions in the local state
+    m.def("put_state_sparse", [](uintptr_t h, const std::string &key, py::object state, py::object indices){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        carray<double> s = as_input<double>(state, "put_state_sparse");
+        carray<int> idx = as_input<int>(indices, "put_state_sparse");
+        const double *data = s.data();
+        const int *ip = idx.data();
+        int n = static_cast<int>(s.size()), n_idx = static_cast<int>(idx.size());
+        if(nogil([&]{ return sr_put_state_sparse(handle, str_data(key), str_len(key), data, n, ip, n_idx); })!=0)
+            throw std::runtime_error("put_state_sparse failed");
+    });
+
+    m.def("put_state_masked", [](uintptr_t h, const std::string &key, py::object state, py::object mask){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        carray<double> s = as_input<double>(state, "put_state_masked");
+        carray<int> msk = as_input<int>(mask, "put_state_masked");
+        if(msk.size()!=s.size())
+            throw py::value_error("put_state_masked: mask and state differ in size");
+        const double *data = s.data();
+        const int *mp = msk.data();
+        int n = static_cast<int>(s.size());
+        if(nogil([&]{ return sr_put_state_masked(handle, str_data(key), str_len(key), data, n, mp); })!=0)
+            throw std::runtime_error("put_state_masked failed");
+    });
+
+    m.def("put_state_delta", [](uintptr_t h, const std::string &key, py::object state, double threshold){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        carray<double> s = as_input<double>(state, "put_state_delta");
+        const double *data = s.data();
+        int n = static_cast<int>(s.size());
+        if(nogil([&]{ return sr_put_state_delta(handle, str_data(key), str_len(key), data, n, threshold); })!=0)
+            throw std::runtime_error("put_state_delta failed");
+    });
+
+    // sparse actions only overwrite the entries the agent sent, so a size
+    // gives a zero-filled array
+    m.def("get_action_sparse", [](uintptr_t h, const std::string &key, py::object action){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        carray<double> out = as_output(action, "get_action_sparse");
+        if(py::isinstance<py::int_>(action)) std::fill_n(out.mutable_data(), out.size(), 0.0);
+        double *data = out.mutable_data();
+        int n = static_cast<int>(out.size());
+        if(nogil([&]{ return sr_get_action_sparse(handle, str_data(key), str_len(key), data, n); })!=0)
+            throw std::runtime_error("get_action_sparse failed");
+        return out;
+    });
+
+    m.def("wait_action_sparse", [](uintptr_t h, const std::string &key, py::object action,
+                                   double timeout) -> py::object {
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        carray<double> out = as_output(action, "wait_action_sparse");
+        if(py::isinstance<py::int_>(action)) std::fill_n(out.mutable_data(), out.size(), 0.0);
+        double *data = out.mutable_data();
+        int n = static_cast<int>(out.size());
+        int code = nogil([&]{ return sr_wait_action_sparse(handle, str_data(key), str_len(key), data, n, timeout); });
+        if(code==SR_TIMEOUT) return py::none();
+        if(code!=0)
+            throw std::runtime_error("wait_action_sparse failed");
+        return std::move(out);
+    }, py::arg("h"), py::arg("key"), py::arg("action"), py::arg("timeout")=-1.0);
+
+    // trajectory buffering: state is [n_features, n_points] (any shape of that size)
+    m.def("open_trajectory", [](uintptr_t h, const std::string &key, int n_steps, int n_features, int n_points,
+                                int n_reward, bool background){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        if(nogil([&]{ return sr_open_trajectory(handle, str_data(key), str_len(key), n_steps, n_features,
+                                                n_points, n_reward, background?1:0); })!=0)
+            throw std::runtime_error("open_trajectory failed");
+    }, py::arg("h"), py::arg("key"), py::arg("n_steps"), py::arg("n_features"), py::arg("n_points"),
+       py::arg("n_reward")=1, py::arg("background")=false);
+
+    m.def("append_step", [](uintptr_t h, const std::string &key, py::object state, py::object reward,
+                            int step_type){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        carray<double> s = as_input<double>(state, "append_step");
+        carray<double> r = as_input<double>(reward, "append_step");
+        const double *sp = s.data(), *rp = r.data();
+        int ns = static_cast<int>(s.size()), nr = static_cast<int>(r.size());
+        // only copies, except every n_steps-th step
+        if(nogil([&]{ return sr_append_step(handle, str_data(key), str_len(key), sp, ns, rp, nr, step_type); })!=0)
+            throw std::runtime_error("append_step failed");
+    }, py::arg("h"), py::arg("key"), py::arg("state"), py::arg("reward"), py::arg("step_type")=0);
+
+    m.def("flush_trajectory", [](uintptr_t h, const std::string &key){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        if(nogil([&]{ return sr_flush_trajectory(handle, str_data(key), str_len(key)); })!=0)
+            throw std::runtime_error("flush_trajectory failed");
+    });
+
+    m.def("close_trajectory", [](uintptr_t h, const std::string &key){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        if(nogil([&]{ return sr_close_trajectory(handle, str_data(key), str_len(key)); })!=0)
+            throw std::runtime_error("close_trajectory failed");
+    });
+
+    m.def("set_wait_policy", [](uintptr_t h, int spin_checks, int short_sleep_us, int short_polls, int max_sleep_us){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        if(sr_set_wait_policy(handle, spin_checks, short_sleep_us, short_polls, max_sleep_us)!=0)
+            throw std::runtime_error("set_wait_policy failed");
+    }, py::arg("h"), py::arg("spin_checks")=10, py::arg("short_sleep_us")=50,
+       py::arg("short_polls")=200, py::arg("max_sleep_us")=10000);
+
+    m.def("get_action_wait_time", [](uintptr_t h){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        double total = 0.0, last = 0.0;
+        if(sr_get_action_wait_time(handle, &total, &last)!=0)
+            throw std::runtime_error("get_action_wait_time failed");
+        return py::make_tuple(total, last);
+    });
+
+    // fused DRL step: returns the action slice of this rank (action: size or output array), None on timeout
+    m.def("step_exchange", [](uintptr_t h, const std::string &tag, py::object state,
+                              py::object reward, int step_type, py::object action,
+                              py::object scalars, double timeout) -> py::object {
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        carray<double> s = as_input<double>(state, "step_exchange");
+        carray<double> r = as_input<double>(reward, "step_exchange");
+        carray<double> sc = scalars.is_none() ? carray<double>(0) : as_input<double>(scalars, "step_exchange");
+        carray<double> out = as_output(action, "step_exchange");
+        const double *sp = s.data(), *rp = r.data(), *scp = sc.data();
+        double *ap = out.mutable_data();
+        int ns = static_cast<int>(s.size()), nr = static_cast<int>(r.size());
+        int na = static_cast<int>(out.size()), nsc = static_cast<int>(sc.size());
+        int code = nogil([&]{ return sr_step_exchange(handle, str_data(tag), str_len(tag), sp, ns, rp, nr, step_type,
+                                                      ap, na, nsc ? scp : nullptr, nsc, timeout); });
+        if(code==SR_TIMEOUT) return py::none();
+        if(code!=0)
+            throw std::runtime_error("step_exchange failed");
+        return std::move(out);
+    }, py::arg("h"), py::arg("tag"), py::arg("state"), py::arg("reward"), py::arg("step_type"),
+       py::arg("action"), py::arg("scalars")=py::none(), py::arg("timeout")=-1.0);
+
+    m.attr("LAYOUT_CONTIGUOUS") = SR_LAYOUT_CONTIGUOUS;
+    m.attr("LAYOUT_FORTRAN") = SR_LAYOUT_FORTRAN;
+
+    // structure-of-arrays state: equal-length 1-D float64 arrays -> [n_fields, n_points_global]
+    m.def("put_fields", [](uintptr_t h, const std::string &key, py::list fields, int layout){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        std::vector<carray<double>> hold;
+        std::vector<const double*> ptrs;
+        for(py::handle f : fields){
+            hold.push_back(as_input<double>(f, "put_fields"));
+            ptrs.push_back(hold.back().data());
+        }
+        py::ssize_t n_points = hold.empty() ? 0 : hold[0].size();
+        for(auto &f : hold){
+            if(f.size()!=n_points)
+                throw py::value_error("put_fields: fields must have equal length");
+        }
+        const int n_fields = static_cast<int>(ptrs.size());
+        if(nogil([&]{ return sr_put_fields(handle, str_data(key), str_len(key), ptrs.data(), n_fields,
+                                           static_cast<int>(n_points), 1, layout); })!=0)
+            throw std::runtime_error("put_fields failed");
+    }, py::arg("h"), py::arg("key"), py::arg("fields"), py::arg("layout")=SR_LAYOUT_CONTIGUOUS);
+
+    // non-blocking puts return a request id completed by test/wait/waitall;
+    // the library copies the data, so the array may be reused right away
+    m.def("iput_state", [](uintptr_t h, const std::string &key, py::object state){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        carray<double> s = as_input<double>(state, "iput_state");
+        const double *data = s.data();
+        int n = static_cast<int>(s.size());
+        int request = -1;
+        if(nogil([&]{ return sr_iput_state(handle, str_data(key), str_len(key), data, n, &request); })!=0)
+            throw std::runtime_error("iput_state failed");
+        return request;
+    });
+
+    m.def("iput_reward", [](uintptr_t h, const std::string &key, py::object reward){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        carray<double> r = as_input<double>(reward, "iput_reward");
+        const double *data = r.data();
+        int n = static_cast<int>(r.size());
+        int request = -1;
+        if(nogil([&]{ return sr_iput_reward(handle, str_data(key), str_len(key), data, n, &request); })!=0)
+            throw std::runtime_error("iput_reward failed");
+        return request;
+    });
+
+    m.def("iput_info", [](uintptr_t h, const std::string &key, py::object info){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        carray<int> i = as_input<int>(info, "iput_info");
+        const int *data = i.data();
+        int n = static_cast<int>(i.size());
+        int request = -1;
+        if(nogil([&]{ return sr_iput_info(handle, str_data(key), str_len(key), data, n, &request); })!=0)
+            throw std::runtime_error("iput_info failed");
+        return request;
+    });
+
+    m.def("test_request", [](uintptr_t h, int request){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        int flag = 0;
+        if(nogil([&]{ return sr_test(handle, request, &flag); })!=0)
+            throw std::runtime_error("test_request failed");
+        return flag != 0;
+    });
+
+    m.def("wait_request", [](uintptr_t h, int request){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        if(nogil([&]{ return sr_wait(handle, request); })!=0)
+            throw std::runtime_error("wait_request failed");
+    });
+
+    m.def("waitall_requests", [](uintptr_t h){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        if(nogil([&]{ return sr_waitall(handle); })!=0)
+            throw std::runtime_error("waitall_requests failed");
+    });
+
+    // wire precision of a key; bf16/fp16 land in Redis as uint16 bit patterns
+    m.attr("WIRE_FLOAT64") = SR_WIRE_FLOAT64;
+    m.attr("WIRE_FLOAT32") = SR_WIRE_FLOAT32;
+    m.attr("WIRE_BFLOAT16") = SR_WIRE_BFLOAT16;
+    m.attr("WIRE_FLOAT16") = SR_WIRE_FLOAT16;
+    m.def("set_wire_precision", [](uintptr_t h, const std::string &key, int precision){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        if(sr_set_wire_precision(handle, str_data(key), str_len(key), precision)!=0)
+            throw std::runtime_error("set_wire_precision failed");
+    });
+
+    // lossless compression of a key; decode frames on the agent with srmpi_codec.py
+    m.attr("CODEC_NONE") = SR_CODEC_NONE;
+    m.attr("CODEC_SHUFFLE_LZ") = SR_CODEC_SHUFFLE_LZ;
+    m.attr("CODEC_XOR_SHUFFLE_LZ") = SR_CODEC_XOR_SHUFFLE_LZ;
+    m.def("set_compression", [](uintptr_t h, const std::string &key, int codec, long long threshold_bytes){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        if(sr_set_compression(handle, str_data(key), str_len(key), codec, threshold_bytes)!=0)
+            throw std::runtime_error("set_compression failed");
+    }, py::arg("h"), py::arg("key"), py::arg("codec"), py::arg("threshold_bytes")=0);
+
+    // (ratio, last_ratio, encode_seconds, decode_seconds) measured on this writer
+    m.def("get_compression_stats", [](uintptr_t h, const std::string &key){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        double ratio = 1.0, last_ratio = 1.0, encode_seconds = 0.0, decode_seconds = 0.0;
+        if(sr_get_compression_stats(handle, str_data(key), str_len(key), &ratio, &last_ratio,
+                                    &encode_seconds, &decode_seconds)!=0)
+            throw std::runtime_error("get_compression_stats failed");
+        return py::make_tuple(ratio, last_ratio, encode_seconds, decode_seconds);
+    });
+
+    // local policy: get_action(action_key) runs the MLP published with srmpi_policy.publish
+    // on this rank's last state_key; weights_key="" removes it. Collective refreshes.
+    m.def("set_local_policy", [](uintptr_t h, const std::string &action_key, const std::string &state_key,
+                                 const std::string &weights_key, int refresh_steps){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        if(sr_set_local_policy(handle, str_data(action_key), str_len(action_key), str_data(state_key),
+                               str_len(state_key), str_data(weights_key), str_len(weights_key), refresh_steps)!=0)
+            throw std::runtime_error("set_local_policy failed");
+    }, py::arg("h"), py::arg("action_key"), py::arg("state_key"), py::arg("weights_key"),
+       py::arg("refresh_steps")=1);
+
+    m.def("get_policy_version", [](uintptr_t h, const std::string &action_key){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        int version = -1;
+        if(sr_get_policy_version(handle, str_data(action_key), str_len(action_key), &version)!=0)
+            throw std::runtime_error("get_policy_version failed");
+        return version;
+    });
+
+    // instrumentation: per (op, key) counters, phases split into MPI / Redis / agent wait
+    m.attr("OP_PUT_STATE") = SR_OP_PUT_STATE;
+    m.attr("OP_PUT_INFO") = SR_OP_PUT_INFO;
+    m.attr("OP_PUT_FIELDS") = SR_OP_PUT_FIELDS;
+    m.attr("OP_GET_ACTION") = SR_OP_GET_ACTION;
+    m.attr("OP_STEP_EXCHANGE") = SR_OP_STEP_EXCHANGE;
+    m.attr("OP_IPUT") = SR_OP_IPUT;
+    m.attr("OP_PUT_SCALAR") = SR_OP_PUT_SCALAR;
+    m.attr("OP_PUT_BATCH") = SR_OP_PUT_BATCH;
+    m.attr("OP_GET_BATCH") = SR_OP_GET_BATCH;
+    m.attr("OP_PUT_SPARSE") = SR_OP_PUT_SPARSE;
+    m.attr("OP_GET_SPARSE") = SR_OP_GET_SPARSE;
+    m.attr("OP_PUT_TRAJECTORY") = SR_OP_PUT_TRAJECTORY;
+    m.attr("OP_PUT_TENSOR") = SR_OP_PUT_TENSOR;
+    m.attr("OP_GET_TENSOR") = SR_OP_GET_TENSOR;
+    m.attr("OP_RING_GC") = SR_OP_RING_GC;
+    m.attr("OP_POLICY_LOAD") = SR_OP_POLICY_LOAD;
+    m.attr("OP_POLICY_EVAL") = SR_OP_POLICY_EVAL;
+    m.def("enable_stats", [](uintptr_t h, bool enabled, bool trace){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        if(nogil([&]{ return sr_enable_stats(handle, enabled?1:0, trace?1:0); })!=0)
+            throw std::runtime_error("enable_stats failed");
+    }, py::arg("h"), py::arg("enabled")=true, py::arg("trace")=false);
+
+    m.def("get_stats", [](uintptr_t h, int op, const std::string &key){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        static const char *phases[] = {"total", "mpi", "redis", "wait"};
+        py::dict result;
+        for(int phase=SR_PHASE_TOTAL; phase<=SR_PHASE_WAIT; phase++){
+            double v[SR_STAT_NVALUES];
+            if(sr_get_stats(handle, op, str_data(key), str_len(key), phase, v)!=0)
+                throw std::runtime_error("get_stats failed");
+            result["calls"] = static_cast<long long>(v[0]);
+            result["bytes"] = static_cast<long long>(v[1]);
+            py::dict p;
+            p["count"] = static_cast<long long>(v[2]);
+            p["mean"] = v[3];
+            p["min"] = v[4];
+            p["max"] = v[5];
+            p["p99"] = v[6];
+            result[phases[phase]] = p;
+        }
+        return result;
+    });
+
+    m.def("reset_stats", [](uintptr_t h){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        if(sr_reset_stats(handle)!=0)
+            throw std::runtime_error("reset_stats failed");
+    });
+
+    m.def("dump_stats", [](uintptr_t h, const std::string &path){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        if(nogil([&]{ return sr_dump_stats(handle, str_data(path), str_len(path)); })!=0)
+            throw std::runtime_error("dump_stats failed");
+    }, py::arg("h"), py::arg("path")="");
+
+    m.def("set_record_log", [](uintptr_t h, const std::string &prefix){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        if(nogil([&]{ return sr_set_record_log(handle, str_data(prefix), str_len(prefix)); })!=0)
+            throw std::runtime_error("set_record_log failed");
+    }, py::arg("h"), py::arg("prefix")="");
+
+    m.def("set_replay_log", [](uintptr_t h, const std::string &prefix){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        if(nogil([&]{ return sr_set_replay_log(handle, str_data(prefix), str_len(prefix)); })!=0)
+            throw std::runtime_error("set_replay_log failed");
+    });
+
+    m.def("dump_trace", [](uintptr_t h, const std::string &prefix){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        if(nogil([&]{ return sr_dump_trace(handle, str_data(prefix), str_len(prefix)); })!=0)
+            throw std::runtime_error("dump_trace failed");
+    });
+
+    // exchange plans are cached per key; drop them when the decomposition changes
+    m.def("invalidate_plan", [](uintptr_t h, const std::string &key){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        if(nogil([&]{ return sr_invalidate_plan(handle, str_data(key), str_len(key)); })!=0)
+            throw std::runtime_error("invalidate_plan failed");
+    });
+
+    m.def("invalidate_plans", [](uintptr_t h){
+        SR_HANDLE handle = reinterpret_cast<SR_HANDLE>(h);
+        if(nogil([&]{ return sr_invalidate_plans(handle); })!=0)
+            throw std::runtime_error("invalidate_plans failed");
+    });
 }
@@ -0,0 +1,219 @@
+"""Agent-side codec for SmartRedisMPI compressed tensors.
+
+A compressed tensor is a uint8 frame (see SmartRedisMPI_Compression.h):
+a 20-byte header, ndims uint64 dims, then the payload, optionally byte
+shuffled (with XOR delta) and LZ coded. States written with
+set_compression arrive as such frames; actions for a key with compression
+enabled must be written as a DataSet named after the key holding the frame
+as tensor "frame" (put_action below).
+
+Sparse states (put_state_sparse/_masked/_delta) are a DataSet with int32
+"indices" into the dense state and "values", both absent when nothing
+changed, and metadata "size". Sparse actions mirror them: a DataSet with
+int32 "indices" into the dense action and "values" in the key's wire
+precision (put_sparse_action below).
+"""
+
+import struct
+
+import numpy as np
+
+MAGIC = b"SRZ1"
+CODEC_NONE = 0
+CODEC_SHUFFLE_LZ = 1
+CODEC_XOR_SHUFFLE_LZ = 2
+
+# SRTensorType values
+_DTYPES = {1: np.float64, 2: np.float32, 3: np.int8, 4: np.int16,
+           5: np.int32, 6: np.int64, 7: np.uint8, 8: np.uint16}
+_TYPE_CODES = {np.dtype(v): k for k, v in _DTYPES.items()}
+
+_MIN_MATCH = 4
+_MAX_OFFSET = 65535
+
+
+def is_frame(data):
+    data = np.asarray(data)
+    return data.dtype == np.uint8 and data.size >= 20 and data[:4].tobytes() == MAGIC
+
+
+def _read_length(buf, ip, length):
+    while True:
+        b = buf[ip]
+        ip += 1
+        length += b
+        if b != 255:
+            return length, ip
+
+
+def _lz_decompress(buf, raw_bytes):
+    out = bytearray()
+    ip, end = 0, len(buf)
+    while ip < end:
+        token = buf[ip]
+        ip += 1
+        lit = token >> 4
+        if lit == 15:
+            lit, ip = _read_length(buf, ip, lit)
+        out += buf[ip:ip + lit]
+        ip += lit
+        if ip == end:
+            break
+        offset = buf[ip] | (buf[ip + 1] << 8)
+        ip += 2
+        m = token & 15
+        if m == 15:
+            m, ip = _read_length(buf, ip, m)
+        m += _MIN_MATCH
+        start = len(out) - offset
+        if offset >= m:
+            out += out[start:start + m]
+        else:
+            run = out[start:]
+            out += (run * (m // offset + 1))[:m]
+    if len(out) != raw_bytes:
+        raise ValueError("corrupt compressed frame")
+    return bytes(out)
+
+
+def _put_length(out, length):
+    while length >= 255:
+        out.append(255)
+        length -= 255
+    out.append(length)
+
+
+def _emit(out, lit, offset, match):
+    m = match - _MIN_MATCH if match else 0
+    out.append((min(len(lit), 15) << 4) | min(m, 15))
+    if len(lit) >= 15:
+        _put_length(out, len(lit) - 15)
+    out += lit
+    if not match:
+        return
+    out += struct.pack("<H", offset)
+    if m >= 15:
+        _put_length(out, m - 15)
+
+
+def _lz_compress(data):
+    """Greedy LZ in pure Python; meant for action-sized tensors."""
+    out = bytearray()
+    table = {}
+    anchor = i = 0
+    n = len(data)
+    while i + _MIN_MATCH <= n:
+        seq = data[i:i + _MIN_MATCH]
+        ref = table.get(seq)
+        table[seq] = i
+        if ref is not None and i - ref <= _MAX_OFFSET:
+            m = _MIN_MATCH
+            while i + m < n and data[ref + m] == data[i + m]:
+                m += 1
+            _emit(out, data[anchor:i], i - ref, m)
+            i += m
+            anchor = i
+        else:
+            i += 1
+    _emit(out, data[anchor:], 0, 0)
+    return bytes(out)
+
+
+def _planes(arr, xor_delta):
+    b = np.ascontiguousarray(arr).reshape(-1).view(np.uint8).reshape(-1, arr.itemsize)
+    if xor_delta and len(b) > 1:
+        b = b.copy()
+        b[1:] ^= b[:-1].copy()
+    return np.ascontiguousarray(b.T).tobytes()
+
+
+def decode(frame):
+    """Restore the tensor of a frame with its dtype and shape."""
+    buf = np.asarray(frame, dtype=np.uint8).tobytes()
+    if buf[:4] != MAGIC:
+        raise ValueError("not a compressed frame")
+    codec, elem_size, dtype, layout, ndims, raw_bytes = struct.unpack_from("<BBBBIQ", buf, 4)
+    dims = struct.unpack_from("<%dQ" % ndims, buf, 20)
+    payload = buf[20 + 8 * ndims:]
+    if codec == CODEC_NONE:
+        raw = payload
+    else:
+        planes = np.frombuffer(_lz_decompress(payload, raw_bytes), dtype=np.uint8)
+        b = planes.reshape(elem_size, -1).T
+        if codec == CODEC_XOR_SHUFFLE_LZ:
+            b = np.bitwise_xor.accumulate(b, axis=0)
+        raw = np.ascontiguousarray(b).tobytes()
+    values = np.frombuffer(raw, dtype=_DTYPES.get(dtype, np.uint8))
+    return values.reshape(dims, order="F" if layout == 1 else "C")
+
+
+def encode(arr, codec=CODEC_XOR_SHUFFLE_LZ):
+    """Frame a C-ordered array (any supported dtype) with the given codec."""
+    arr = np.ascontiguousarray(arr)
+    header = struct.pack("<4sBBBBIQ", MAGIC, codec, arr.itemsize, _TYPE_CODES[arr.dtype], 0,
+                         arr.ndim, arr.nbytes)
+    header += struct.pack("<%dQ" % arr.ndim, *arr.shape)
+    if codec == CODEC_NONE:
+        payload = arr.tobytes()
+    else:
+        payload = _lz_compress(_planes(arr, codec == CODEC_XOR_SHUFFLE_LZ))
+    return np.frombuffer(header + payload, dtype=np.uint8)
+
+
+def get_state(client, key):
+    """Read a state tensor, decoding it if it was compressed."""
+    data = client.get_tensor(key)
+    return decode(data) if is_frame(data) else data
+
+
+def put_action(client, key, arr, codec=CODEC_XOR_SHUFFLE_LZ, threshold=0):
+    """Write an action for a key with compression enabled on the solver side."""
+    from smartredis import Dataset
+    arr = np.asarray(arr)
+    dataset = Dataset(key)
+    dataset.add_tensor("frame", encode(arr, codec if arr.nbytes >= threshold else CODEC_NONE))
+    client.put_dataset(dataset)
+
+
+def sparse_tensors(indices, values):
+    """indices and values of a sparse action. values keep their dtype, which
+    must be the wire type of the key: float64, float32, or uint16 holding
+    bfloat16 / float16 bits (a float16 array is passed as its bits)."""
+    indices = np.ascontiguousarray(indices, dtype=np.int32).ravel()
+    values = np.ascontiguousarray(values).ravel()
+    if values.dtype == np.float16:
+        values = values.view(np.uint16)
+    if values.dtype not in (np.float64, np.float32, np.uint16):
+        raise ValueError("sparse action: values must be float64, float32 or uint16, not %s" % values.dtype)
+    if indices.size != values.size:
+        raise ValueError("sparse action: one value per index")
+    return indices, values
+
+
+def get_sparse_state(client, key, dense=None):
+    """Read a sparse state into dense (a float64 array of metadata "size",
+    created with zeros when None); returns (dense, indices)."""
+    dataset = client.get_dataset(key)
+    size = int(dataset.get_meta_scalars("size")[0])
+    if dense is None:
+        dense = np.zeros(size)
+    if "indices" in dataset.get_tensor_names():
+        indices = dataset.get_tensor("indices")
+        dense[indices] = dataset.get_tensor("values")
+    else:
+        indices = np.empty(0, dtype=np.int32)
+    return dense, indices
+
+
+def put_sparse_action(client, key, indices, values):
+    """Write the entries of a sparse action read by get_action_sparse; values
+    in the key's wire type (sparse_tensors). Metadata "nnz" keeps an empty
+    update a valid DataSet."""
+    from smartredis import Dataset
+    indices, values = sparse_tensors(indices, values)
+    dataset = Dataset(key)
+    if indices.size:
+        dataset.add_tensor("indices", indices)
+        dataset.add_tensor("values", values)
+    dataset.add_meta_scalar("nnz", np.int32(indices.size))
+    client.put_dataset(dataset)
@@ -0,0 +1,117 @@
+"""Reader for SmartRedisMPI record logs.
+
+With set_record_log(prefix) (or SRMPI_RECORD=prefix) every writer rank
+appends what it puts and reads to <prefix>.<rank>.srlog (layout in
+SmartRedisMPI_Record.h). The same files drive TRANSPORT_REPLAY, and can be
+read here without MPI or a database, e.g. to train offline on a recorded
+run:
+
+    log = RecordLog("run1.0.srlog")
+    for rec, step in log.groups("env0.step"):       # step_exchange DataSets
+        train(step["state"], step["reward"])
+    actions = [a for _, a in log.reads("env0.action")]
+
+Payloads are read-only views into the mapped file. Compressed keys hold
+their srmpi_codec frame, which value() decodes.
+"""
+
+import collections
+import glob
+import mmap
+import struct
+
+import numpy as np
+
+from srmpi_codec import decode, is_frame
+
+MAGIC = b"SRMPILOG"
+VERSION = 1
+HEADER_BYTES = 64
+RECORD_HEADER_BYTES = 48
+
+# RecordKind values
+PUT, GET, FRAME, GROUP, TAKE = 0, 1, 2, 3, 4
+
+# SRTensorType values
+_DTYPES = {1: np.float64, 2: np.float32, 3: np.int8, 4: np.int16,
+           5: np.int32, 6: np.int64, 7: np.uint8, 8: np.uint16}
+
+Record = collections.namedtuple("Record", "kind key step t_begin t_end data")
+Record.__doc__ = "One logged tensor; t_begin/t_end in ns since RecordLog.t0."
+
+
+def value(rec):
+    """Payload of a record, decoded if it is a compressed frame."""
+    return decode(rec.data) if is_frame(rec.data) else rec.data
+
+
+class RecordLog:
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self._mm = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        if self._mm[:8] != MAGIC:
+            raise ValueError("%s is not a SmartRedisMPI record log" % path)
+        version, self.rank, used, self.t0 = struct.unpack_from("<IIQq", self._mm, 8)
+        if version != VERSION:
+            raise ValueError("%s: unsupported log version %d" % (path, version))
+        self.path = path
+        self._used = min(used, len(self._mm))
+
+    def __iter__(self):
+        buf, off = self._mm, HEADER_BYTES
+        while off + RECORD_HEADER_BYTES <= self._used:
+            kind, dtype, ndims, key_len, step, t_begin, t_end, nbytes = struct.unpack_from("<IIIIQQQQ", buf, off)
+            size = (RECORD_HEADER_BYTES + 8 * ndims + key_len + nbytes + 7) // 8 * 8
+            if off + size > self._used:
+                return  # truncated last record
+            dims = struct.unpack_from("<%dQ" % ndims, buf, off + RECORD_HEADER_BYTES)
+            p = off + RECORD_HEADER_BYTES + 8 * ndims
+            key = bytes(buf[p:p + key_len]).decode()
+            data = np.frombuffer(buf, dtype=_DTYPES.get(dtype, np.uint8), offset=p + key_len,
+                                 count=nbytes // np.dtype(_DTYPES.get(dtype, np.uint8)).itemsize)
+            yield Record(kind, key, step, t_begin, t_end, data.reshape(dims))
+            off += size
+
+    def records(self, key=None, kind=None):
+        return (r for r in self if (key is None or r.key == key) and (kind is None or r.kind == kind))
+
+    def reads(self, key):
+        """(record, value) of every read of key: the actions the run received.
+        A taken group (sparse action) gives {name: value} of its tensors."""
+        prefix = key + "."
+        pending = {}
+        for r in self:
+            if r.kind == GET and r.key.startswith(prefix):
+                pending[r.key[len(prefix):]] = value(r)
+            elif r.key == key and r.kind in (GET, FRAME):
+                yield r, value(r)
+            elif r.key == key and r.kind == TAKE:
+                # Entries are logged before their marker
+                yield r, pending
+                pending = {}
+
+    def puts(self, key):
+        """(record, value) of every tensor written under key."""
+        for r in self.records(key, PUT):
+            yield r, value(r)
+
+    def groups(self, key):
+        """(marker record, {name: value}) of every group (DataSet) put under key."""
+        prefix = key + "."
+        pending = {}
+        for r in self:
+            if r.kind == PUT and r.key.startswith(prefix):
+                pending[r.key[len(prefix):]] = value(r)
+            elif r.kind == GROUP and r.key == key:
+                # Entries are logged before their marker
+                yield r, pending
+                pending = {}
+
+    def close(self):
+        self._mm.close()
+
+
+def open_logs(prefix):
+    """RecordLog of every writer of a run, ordered by rank."""
+    logs = [RecordLog(p) for p in glob.glob(glob.escape(prefix) + ".*.srlog")]
+    return sorted(logs, key=lambda log: log.rank)
@@ -0,0 +1,60 @@
+"""Agent-side publishing of local policies (set_local_policy).
+
+The solver evaluates the policy itself, so the agent only publishes new
+weights now and then, e.g. after each training update:
+
+    layers = [(W0, b0), (W1, b1), (W2, b2)]   # W_k of shape (out, in)
+    publish(client, "policy", layers, version=update, activation=TANH)
+
+The weights go out as two tensors (layout in SmartRedisMPI_Policy.h):
+float32 "<key>.params" holding W_0, b_0, W_1, b_1, ... and int32
+"<key>.meta" holding version, n_layers, activation and the layer widths.
+.params is written first, so a solver that sees a new version in .meta
+reads the matching weights. evaluate() is the same network in NumPy.
+"""
+
+import numpy as np
+
+META_LEN = 16
+MAX_LAYERS = META_LEN - 4
+
+# PolicyActivation values, used by the hidden layers (the output is linear)
+TANH, RELU = 0, 1
+
+
+def pack(layers, version, activation=TANH):
+    """(meta, params) arrays of a list of (W, b) layers."""
+    if not 1 <= len(layers) <= MAX_LAYERS:
+        raise ValueError("a local policy has 1 to %d layers" % MAX_LAYERS)
+    if activation not in (TANH, RELU):
+        raise ValueError("unknown activation %r" % activation)
+    widths = [np.shape(layers[0][0])[1]]
+    blocks = []
+    for w, b in layers:
+        w = np.asarray(w, dtype=np.float32)
+        b = np.asarray(b, dtype=np.float32).reshape(-1)
+        if w.ndim != 2 or w.shape[1] != widths[-1] or b.size != w.shape[0]:
+            raise ValueError("layer %d: W must be (out, %d) and b (out,)" % (len(widths) - 1, widths[-1]))
+        widths.append(w.shape[0])
+        blocks += [w.reshape(-1), b]
+    meta = np.zeros(META_LEN, dtype=np.int32)
+    meta[:3] = (version, len(layers), activation)
+    meta[3:3 + len(widths)] = widths
+    return meta, np.concatenate(blocks)
+
+
+def publish(client, key, layers, version, activation=TANH):
+    """Write the weights read by the solvers' set_local_policy(..., key)."""
+    meta, params = pack(layers, version, activation)
+    client.put_tensor(key + ".params", params)
+    client.put_tensor(key + ".meta", meta)
+
+
+def evaluate(layers, state, activation=TANH):
+    """Actions of states shaped (n_points, n_inputs), as the solver computes them."""
+    x = np.asarray(state, dtype=np.float32)
+    for k, (w, b) in enumerate(layers):
+        x = x @ np.asarray(w, dtype=np.float32).T + np.asarray(b, dtype=np.float32).reshape(-1)
+        if k + 1 < len(layers):
+            x = np.tanh(x) if activation == TANH else np.maximum(x, 0)
+    return x
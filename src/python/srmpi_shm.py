@@ -0,0 +1,343 @@
+"""Agent-side reader/writer for the SmartRedisMPI shared-memory transport.
+
+With TRANSPORT_SHM (or SRMPI_TRANSPORT=shm) the writer ranks publish every
+key as a POSIX shared-memory segment /dev/shm/<prefix>.<key> holding a
+ring of sequence-numbered slots (layout in SmartRedisMPI_ShmTransport.h).
+ShmChannel mirrors the part of the SmartRedis client an agent needs:
+get_tensor returns the oldest unconsumed message of a key, delete_tensor
+consumes it, put_tensor publishes the next one and wakes waiters through
+the segment's futex. One producer and one consumer per key.
+
+    ch = ShmChannel()
+    step = ch.get_step("env0", timeout=10.0)      # step_exchange DataSet
+    ch.put_tensor("env0.action", policy(step["state"]))
+
+Compressed actions (set_compression) are put as the uint8 frame from
+srmpi_codec.encode. Counters are updated with aligned 8-byte stores, which
+is what the C++ side expects on x86-64.
+"""
+
+import ctypes
+import ctypes.util
+import mmap
+import os
+import platform
+import time
+
+import numpy as np
+
+from srmpi_codec import sparse_tensors
+
+MAGIC = int.from_bytes(b"SRMPISHM", "little")
+VERSION = 1
+HEADER_BYTES = 128
+SLOT_HEADER_BYTES = 128
+MAX_DIMS = 8
+MIN_CAPACITY = 4096
+
+# SRTensorType / SRMemoryLayout values
+_DTYPES = {1: np.float64, 2: np.float32, 3: np.int8, 4: np.int16,
+           5: np.int32, 6: np.int64, 7: np.uint8, 8: np.uint16}
+_TYPE_CODES = {np.dtype(v): k for k, v in _DTYPES.items()}
+LAYOUT_CONTIGUOUS = 2
+LAYOUT_FORTRAN = 4
+
+_SYS_FUTEX = {"x86_64": 202, "aarch64": 98, "ppc64le": 221}.get(platform.machine())
+_FUTEX_WAIT, _FUTEX_WAKE = 0, 1
+_libc = ctypes.CDLL(ctypes.util.find_library("c"), use_errno=True)
+
+
+class _Timespec(ctypes.Structure):
+    _fields_ = [("tv_sec", ctypes.c_long), ("tv_nsec", ctypes.c_long)]
+
+
+class _Segment:
+    """One mapped segment; q/w view it as uint64/uint32 words."""
+
+    def __init__(self, mm):
+        self.mm = mm
+        self.q = memoryview(mm).cast("Q")
+        self.w = memoryview(mm).cast("I")
+        self.notify = ctypes.c_uint32.from_buffer(mm, 48)
+
+    n_slots = property(lambda self: self.w[3])
+    capacity = property(lambda self: self.q[2])
+    stride = property(lambda self: self.q[3])
+    write_seq = property(lambda self: self.q[4])
+    read_seq = property(lambda self: self.q[5])
+    retired = property(lambda self: self.w[13])
+
+    def slot(self, seq):
+        return HEADER_BYTES + (seq % self.n_slots) * self.stride
+
+    def oldest(self):
+        w, r = self.write_seq, self.read_seq
+        return max(r, w - self.n_slots if w > self.n_slots else 0), w
+
+    def available(self):
+        return self.write_seq > self.read_seq
+
+    def wake(self):
+        self.w[12] = (self.w[12] + 1) & 0xFFFFFFFF
+        if _SYS_FUTEX is not None:
+            _libc.syscall(_SYS_FUTEX, ctypes.addressof(self.notify), _FUTEX_WAKE, 0x7FFFFFFF, None, None, 0)
+
+    def sleep(self, seen, timeout):
+        if _SYS_FUTEX is None:
+            time.sleep(min(timeout, 1e-4))
+            return
+        ts = _Timespec(int(timeout), int((timeout % 1.0) * 1e9))
+        _libc.syscall(_SYS_FUTEX, ctypes.addressof(self.notify), _FUTEX_WAIT, ctypes.c_uint32(seen),
+                      ctypes.byref(ts), None, 0)
+
+    def close(self):
+        del self.notify
+        self.q.release()
+        self.w.release()
+        self.mm.close()
+
+
+class ShmChannel:
+    def __init__(self, prefix=None, slots=None):
+        self.prefix = prefix or os.environ.get("SRMPI_SHM_PREFIX", "srmpi")
+        self.slots = max(1, int(slots or os.environ.get("SRMPI_SHM_SLOTS", 4)))
+        self._segments = {}
+
+    def _path(self, key):
+        return "/dev/shm/" + self.prefix + "." + key.replace("/", "_")
+
+    # --- segments ---
+
+    def _map(self, key):
+        try:
+            fd = os.open(self._path(key), os.O_RDWR)
+        except FileNotFoundError:
+            return None
+        try:
+            size = os.fstat(fd).st_size
+            if size < HEADER_BYTES:
+                return None
+            seg = _Segment(mmap.mmap(fd, size))
+        finally:
+            os.close(fd)
+        if seg.q[0] != MAGIC or seg.w[2] != VERSION or HEADER_BYTES + seg.n_slots * seg.stride > size:
+            seg.close()
+            return None
+        return seg
+
+    def _create(self, key, capacity, src=None):
+        stride = SLOT_HEADER_BYTES + (capacity + 63) // 64 * 64
+        size = HEADER_BYTES + self.slots * stride
+        fd = os.open(self._path(key), os.O_RDWR | os.O_CREAT | os.O_EXCL, 0o600)
+        try:
+            os.ftruncate(fd, size)
+            seg = _Segment(mmap.mmap(fd, size))
+        finally:
+            os.close(fd)
+        seg.w[2], seg.w[3] = VERSION, self.slots
+        seg.q[2], seg.q[3] = capacity, stride
+        r = w = 0
+        if src is not None:
+            # Hand over the unread messages under their sequence numbers
+            r, w = src.oldest()
+            r = max(r, w - self.slots)
+            for q in range(r, w):
+                a, b = src.slot(q), seg.slot(q)
+                n = SLOT_HEADER_BYTES + src.q[a // 8 + 2]
+                seg.mm[b:b + n] = src.mm[a:a + n]
+        seg.q[4], seg.q[5] = w, r
+        seg.q[0] = MAGIC  # last: readers map only complete headers
+        return seg
+
+    def _consumer(self, key):
+        old = self._segments.get(key)
+        if old is not None:
+            if not old.retired or old.available():
+                return old
+            # Drained a retired segment: switch once its successor exists,
+            # skipping the handed-over messages consumed here
+            seg = self._map(key)
+            if seg is None:
+                return old
+            seg.q[5] = max(seg.read_seq, old.read_seq)
+            old.close()
+            self._segments[key] = seg
+            return seg
+        seg = self._map(key)
+        if seg is not None:
+            self._segments[key] = seg
+        return seg
+
+    def _producer(self, key, nbytes):
+        seg = self._segments.pop(key, None)
+        if seg is None:
+            seg = self._map(key)
+            if seg is not None and seg.retired:
+                seg.close()
+                seg = None
+        if seg is not None and seg.capacity >= nbytes:
+            self._segments[key] = seg
+            return seg
+        if seg is None:
+            seg = self._create(key, max(nbytes, MIN_CAPACITY))
+        else:
+            # Too small: retire it, readers drain it and move to the new one
+            old = seg
+            old.w[13] = 1
+            os.unlink(self._path(key))
+            try:
+                seg = self._create(key, max(nbytes, 2 * old.capacity), old)
+            finally:
+                old.wake()
+                old.close()
+        self._segments[key] = seg
+        return seg
+
+    # --- tensors ---
+
+    def put_tensor(self, key, arr):
+        arr = np.asarray(arr)
+        fortran = arr.ndim > 1 and arr.flags.f_contiguous and not arr.flags.c_contiguous
+        if arr.ndim > MAX_DIMS or arr.dtype not in _TYPE_CODES:
+            raise ValueError("unsupported tensor for shared memory: %s %s" % (arr.dtype, arr.shape))
+        data = arr.tobytes(order="F" if fortran else "C")
+        seg = self._producer(key, len(data))
+        s = seg.write_seq
+        b = seg.slot(s)
+        seg.q[b // 8] = 2 * s + 1
+        seg.w[b // 4 + 2] = _TYPE_CODES[arr.dtype]
+        seg.w[b // 4 + 3] = arr.ndim
+        seg.q[b // 8 + 2] = len(data)
+        for i, d in enumerate(arr.shape):
+            seg.q[b // 8 + 3 + i] = d
+        seg.w[b // 4 + 22] = LAYOUT_FORTRAN if fortran else LAYOUT_CONTIGUOUS
+        seg.mm[b + SLOT_HEADER_BYTES:b + SLOT_HEADER_BYTES + len(data)] = data
+        seg.q[b // 8] = 2 * s + 2
+        seg.q[4] = s + 1
+        seg.wake()
+
+    def get_tensor(self, key):
+        """Oldest unconsumed message of key (a copy); KeyError if none."""
+        seg = self._consumer(key)
+        while seg is not None:
+            s, w = seg.oldest()
+            if w <= s:
+                break
+            b = seg.slot(s)
+            state = seg.q[b // 8]
+            if state != 2 * s + 2:
+                continue
+            dtype = _DTYPES.get(seg.w[b // 4 + 2], np.uint8)
+            dims = tuple(seg.q[b // 8 + 3:b // 8 + 3 + min(seg.w[b // 4 + 3], MAX_DIMS)])
+            layout = seg.w[b // 4 + 22]
+            nbytes = min(seg.q[b // 8 + 2], seg.capacity)
+            data = bytes(seg.mm[b + SLOT_HEADER_BYTES:b + SLOT_HEADER_BYTES + nbytes])
+            if seg.q[b // 8] == state:
+                order = "F" if layout == LAYOUT_FORTRAN else "C"
+                return np.frombuffer(data, dtype=dtype).reshape(dims, order=order)
+        raise KeyError(key)
+
+    def delete_tensor(self, key):
+        seg = self._consumer(key)
+        if seg is None:
+            return
+        s, w = seg.oldest()
+        if w > s:
+            seg.q[5] = s + 1
+
+    def take_tensor(self, key):
+        arr = self.get_tensor(key)
+        self.delete_tensor(key)
+        return arr
+
+    def tensor_exists(self, key):
+        seg = self._consumer(key)
+        return seg is not None and seg.available()
+
+    def wait(self, key, timeout=None):
+        """Block until key has a message; False after timeout seconds."""
+        deadline = None if timeout is None else time.monotonic() + timeout
+        while True:
+            seg = self._consumer(key)
+            seen = seg.w[12] if seg is not None else 0
+            if seg is not None and seg.available():
+                return True
+            remaining = 1.0 if deadline is None else deadline - time.monotonic()
+            if remaining <= 0:
+                return False
+            if seg is not None:
+                seg.sleep(seen, min(remaining, 1.0))
+            else:
+                time.sleep(min(remaining, 1e-3))
+
+    def get_step(self, tag, timeout=None, shard=None):
+        """Take one step_exchange group: dict of state, reward, step_type, scalars
+        (and shard_id/n_shards with sharded writers); None on timeout."""
+        base = tag + ".step" + ("" if shard is None else ".shard%d" % shard)
+        if not self.wait(base, timeout):
+            return None
+        self.take_tensor(base)
+        step = {}
+        for name in ("state", "reward", "step_type", "scalars", "shard_id", "n_shards"):
+            if self.tensor_exists(base + "." + name):
+                step[name] = self.take_tensor(base + "." + name)
+        if "step_type" in step:
+            step["step_type"] = int(step["step_type"][0])
+        return step
+
+    def get_trajectory(self, key, timeout=None, shard=None):
+        """Take one trajectory flush: dict of state [k, features, points],
+        reward [k, n] (if sent), step_type and step; None on timeout."""
+        base = key + ("" if shard is None else ".shard%d" % shard)
+        if not self.wait(base, timeout):
+            return None
+        # the marker counts the entries: reward is left out when empty
+        entries = int(self.take_tensor(base)[0])
+        names = ["state", "step_type", "step"]
+        if shard is not None:
+            names += ["shard_id", "n_shards"]
+        if entries > len(names):
+            names.insert(1, "reward")
+        return {name: self.take_tensor(base + "." + name) for name in names}
+
+    def get_sparse(self, key, dense=None, timeout=None):
+        """Take one sparse state group into dense (float64 of its "size",
+        zeros when None); returns (dense, indices), or None on timeout."""
+        if not self.wait(key, timeout):
+            return None
+        # the marker counts the group's entries; just "size" when nothing changed
+        entries = int(self.take_tensor(key)[0])
+        size = int(self.take_tensor(key + ".size")[0])
+        if dense is None:
+            dense = np.zeros(size)
+        indices = np.empty(0, dtype=np.int32)
+        if entries > 1:
+            indices = self.take_tensor(key + ".indices")
+            dense[indices] = self.take_tensor(key + ".values")
+        return dense, indices
+
+    def put_sparse_action(self, key, indices, values):
+        """Publish the entries read by get_action_sparse: int32 positions
+        into the dense action and their values in the key's wire type
+        (srmpi_codec.sparse_tensors), as <key>.indices / <key>.values, then
+        the marker <key>."""
+        indices, values = sparse_tensors(indices, values)
+        if indices.size:
+            self.put_tensor(key + ".indices", indices)
+            self.put_tensor(key + ".values", values)
+        self.put_tensor(key, np.array([2 if indices.size else 0], dtype=np.int32))
+
+    def close(self):
+        for seg in self._segments.values():
+            seg.close()
+        self._segments.clear()
+
+    def unlink_all(self):
+        """Remove every segment of this prefix, e.g. leftovers of a previous run."""
+        self.close()
+        for name in os.listdir("/dev/shm"):
+            if name.startswith(self.prefix + "."):
+                try:
+                    os.unlink("/dev/shm/" + name)
+                except FileNotFoundError:
+                    pass
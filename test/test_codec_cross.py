@@ -0,0 +1,66 @@
+# python3 test/test_codec_cross.py build/test/test_fake_backend
+#
+# Cross-checks the frame codec of src/python/srmpi_codec.py against the C++
+# one (SmartRedisMPI_Compression.cpp): frames encoded here are decoded by the
+# test binary (--codec-cross), and the frames it encodes are decoded here.
+
+import os
+import subprocess
+import sys
+import tempfile
+
+import numpy as np
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "src", "python"))
+
+import srmpi_codec as codec
+
+
+def cases():
+    rng = np.random.default_rng(7)
+    return {
+        "smooth": np.sin(0.01 * np.arange(1000)),
+        "constant": np.full(3000, 2.5),
+        "one": np.array([-1.25]),
+        "empty": np.zeros(0),
+        "noise": rng.random(257, dtype=np.float32),
+        "ramp": (np.arange(1024) // 7).astype(np.int32),
+        "int64": np.arange(-300, 300, dtype=np.int64) ** 2,
+        "shorts": np.array([1, 2, 3], dtype=np.uint16),
+        "bytes": np.tile(np.arange(40, dtype=np.uint8), 20),
+    }
+
+
+def main():
+    exe = sys.argv[1]
+    failed = 0
+    with tempfile.TemporaryDirectory() as tmp:
+        written = {}
+        with open(os.path.join(tmp, "cases.txt"), "w") as listing:
+            for name, arr in cases().items():
+                for c in (codec.CODEC_NONE, codec.CODEC_SHUFFLE_LZ, codec.CODEC_XOR_SHUFFLE_LZ):
+                    case = "%s_%d" % (name, c)
+                    arr.tofile(os.path.join(tmp, case + ".raw"))
+                    codec.encode(arr, c).tofile(os.path.join(tmp, case + ".py.frame"))
+                    listing.write("%s %d %d %d %d\n" % (case, codec._TYPE_CODES[arr.dtype], arr.itemsize,
+                                                         arr.size, c))
+                    written[case] = arr
+        if subprocess.call([exe, "--codec-cross", tmp]) != 0:
+            failed += 1
+        for case, arr in written.items():
+            path = os.path.join(tmp, case + ".cpp.frame")
+            try:
+                out = codec.decode(np.fromfile(path, dtype=np.uint8))
+            except (OSError, ValueError) as e:
+                print("codec cross: %s: Python decode of the C++ frame failed: %s" % (case, e))
+                failed += 1
+                continue
+            if out.dtype != arr.dtype or out.shape != arr.shape or out.tobytes() != arr.tobytes():
+                print("codec cross: %s: Python decode of the C++ frame differs" % case)
+                failed += 1
+    print("codec cross: %s" % ("ok" if failed == 0 else "FAILED"))
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
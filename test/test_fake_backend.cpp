@@ -0,0 +1,1701 @@
+// Tests of the core against the in-process fake store (bench/fake), so no
+// Redis is needed. Built and run by `make test`:
+//
+//   mpirun -n 4 build/test/test_fake_backend
+//   python3 test/test_codec_cross.py build/test/test_fake_backend
+//
+// Rank 0 is the writer (WRITER_ROOT) and also plays the agent on its own
+// store. Sections:
+//   wire      pack_wire / unpack_wire for fp32, bf16 and fp16 against
+//             reference bits, special values through both the vector body
+//             and the scalar tail, every 16-bit pattern decoded both ways
+//   codec     frame round trip for every codec, corrupt frames, compressed
+//             put_state / get_action end to end
+//   sparse    owner bucketing of sparse states and actions, ranks without
+//             entries included, fp32 and empty actions
+//   hier      hierarchical collectives with ranks not numbered node by node
+//             (SRMPI_NODES=2), so the writer reorders blocks
+//   ring      step-versioned keys: slots outside the window are deleted,
+//             consumed actions are not kept, late writes are collected
+//   replay    a recorded run replayed from its log gives the same actions
+//   errors    a failed writer read fails on every rank instead of hanging,
+//             as does a size change on one rank with stats enabled
+//   step      flat step_exchange in float64 and float32, scalars, and a
+//             timeout when no action comes
+//   batch     put_states / get_actions / wait_actions over keys of
+//             different sizes and wire precisions
+//   iput      non-blocking puts land without test/wait when a progress
+//             thread runs, in wire precision, compressed and hierarchical
+//   fields    put_fields in both layouts with a stride, float64 and float32,
+//             flat and hierarchical; put_state_nd shapes
+//   stats     counters, phases and percentiles, dump_stats rows and the
+//             per-rank trace files
+//   shm       TRANSPORT_SHM rings: order, lapped readers, growth, futex
+//             wakeups, groups, and put_state / wait_action end to end
+//   traj      trajectory groups: automatic and partial flushes, async in
+//             float32 without rewards, closed and mis-sized trajectories
+//   tensor    typed put_tensor / get_tensor for every element type, compile
+//             and run time, compressed, wrong type and timeout
+//   lanes     set_threads: concurrent exchanges on per-thread lanes,
+//             shared settings and registered keys, stats summed over lanes
+//   policy    the MLP kernel against a double-precision reference, and
+//             set_local_policy: store reads before weights, refreshes,
+//             mismatched states, removal
+// With --codec-cross DIR (no MPI) it decodes the frames srmpi_codec.py
+// wrote to DIR and writes its own for the script to decode.
+
+#include "SmartRedisMPI.h"
+#include "SmartRedisMPI_ShmTransport.h"
+#include "SmartRedisMPI_Policy.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static int g_rank = 0;
+static int g_failures = 0;
+
+static void check(bool ok, const std::string &what) {
+    if (ok) return;
+    g_failures++;
+    std::fprintf(stderr, "rank %d: FAILED %s\n", g_rank, what.c_str());
+}
+
+// Message of the exception f throws, "" if it returns
+template <typename F>
+static std::string failure_of(F f) {
+    try {
+        f();
+    } catch (const std::exception &e) {
+        return e.what();
+    }
+    return "";
+}
+
+// Every rank must fail; the others learn the writer's error from it
+static void check_writer_failure(const std::string &msg, const std::string &what) {
+    check(!msg.empty(), what + ": no exception");
+    if (g_rank != 0 && !msg.empty())
+        check(msg.find("writer failed") != std::string::npos, what + ": unexpected message '" + msg + "'");
+}
+
+// Local sizes and offsets of a decomposition, known on every rank
+struct Layout {
+    std::vector<int> sizes;
+    std::vector<int> displs;
+    int total = 0;
+};
+
+static Layout layout_of(int n) {
+    int nprocs = 0;
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    Layout l;
+    l.sizes.resize(nprocs);
+    MPI_Allgather(&n, 1, MPI_INT, l.sizes.data(), 1, MPI_INT, MPI_COMM_WORLD);
+    l.displs.resize(nprocs);
+    for (int i=0;i<nprocs;i++) {
+        l.displs[i] = l.total;
+        l.total += l.sizes[i];
+    }
+    return l;
+}
+
+static std::vector<unsigned char> stored_bytes(const std::string &key) {
+    SmartRedis::fake::Store &s = SmartRedis::fake::store();
+    auto it = s.tensors.find(key);
+    return it == s.tensors.end() ? std::vector<unsigned char>() : it->second.bytes;
+}
+
+static size_t stored_with_prefix(const std::string &prefix) {
+    size_t n = 0;
+    for (const auto &kv : SmartRedis::fake::store().tensors)
+        if (kv.first.compare(0, prefix.size(), prefix) == 0) n++;
+    return n;
+}
+
+// Stored tensor of key widened to double, with its dims
+static std::vector<double> stored_values(const std::string &key, std::vector<size_t> &dims) {
+    SmartRedis::fake::Store &s = SmartRedis::fake::store();
+    auto it = s.tensors.find(key);
+    dims.clear();
+    if (it == s.tensors.end()) return std::vector<double>();
+    const SmartRedis::fake::Tensor &t = it->second;
+    dims = t.dims;
+    std::vector<double> v(SmartRedis::fake::count(t.dims));
+    for (size_t i=0;i<v.size();i++) {
+        if (t.type == SRTensorTypeFloat) {
+            float f;
+            std::memcpy(&f, t.bytes.data() + i * sizeof(float), sizeof(float));
+            v[i] = f;
+        } else {
+            std::memcpy(&v[i], t.bytes.data() + i * sizeof(double), sizeof(double));
+        }
+    }
+    return v;
+}
+
+static void put_frame(SmartRedis::Client &agent, const std::string &key, const std::vector<unsigned char> &frame) {
+    SmartRedis::DataSet dataset(key);
+    dataset.add_tensor("frame", frame.data(), {frame.size()}, SRTensorTypeUint8, SRMemLayoutContiguous);
+    agent.put_dataset(dataset);
+}
+
+// Sparse action group as the agent writes it: values in the key's wire type
+static void put_sparse(SmartRedis::Client &agent, const std::string &key, const std::vector<int32_t> &positions,
+                       const void *values, size_t n_values, SRTensorType type) {
+    SmartRedis::DataSet dataset(key);
+    if (!positions.empty()) {
+        dataset.add_tensor("indices", positions.data(), {positions.size()}, SRTensorTypeInt32, SRMemLayoutContiguous);
+        dataset.add_tensor("values", values, {n_values}, type, SRMemLayoutContiguous);
+    }
+    agent.put_dataset(dataset);
+}
+
+// === Wire precision ===
+
+static uint32_t bits32(float f) {
+    uint32_t x;
+    std::memcpy(&x, &f, sizeof(x));
+    return x;
+}
+
+static uint64_t bits64(double d) {
+    uint64_t x;
+    std::memcpy(&x, &d, sizeof(x));
+    return x;
+}
+
+// binary16 decoded by the definition, independently of the library
+static double half_reference(uint16_t h) {
+    const int exp = (h >> 10) & 0x1F;
+    const int mant = h & 0x3FF;
+    double v;
+    if (exp == 0) v = std::ldexp(static_cast<double>(mant), -24);
+    else if (exp == 0x1F) v = mant ? std::numeric_limits<double>::quiet_NaN() : std::numeric_limits<double>::infinity();
+    else v = std::ldexp(1.0 + mant / 1024.0, exp - 15);
+    return (h & 0x8000) ? -v : v;
+}
+
+static double bf16_reference(uint16_t h) {
+    const uint32_t x = static_cast<uint32_t>(h) << 16;
+    float f;
+    std::memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+static bool same_value(double a, double b) {
+    if (std::isnan(a) || std::isnan(b)) return std::isnan(a) && std::isnan(b) && std::signbit(a) == std::signbit(b);
+    return bits64(a) == bits64(b);
+}
+
+static void test_wire() {
+    const double inf = std::numeric_limits<double>::infinity();
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    struct Expected { double v; uint16_t bf16; uint16_t fp16; };
+    const Expected table[] = {
+        {0.0, 0x0000, 0x0000},
+        {-0.0, 0x8000, 0x8000},
+        {1.0, 0x3F80, 0x3C00},
+        {-2.0, 0xC000, 0xC000},
+        {1.0 + std::ldexp(1.0, -8), 0x3F80, 0x3C04},      // bf16 tie, to even
+        {1.0 + 3 * std::ldexp(1.0, -8), 0x3F82, 0x3C0C},  // bf16 tie, to even (up)
+        {1.0 + std::ldexp(1.0, -11), 0x3F80, 0x3C00},     // fp16 tie, to even
+        {1.0 + 3 * std::ldexp(1.0, -11), 0x3F80, 0x3C02}, // fp16 tie, to even (up)
+        {65504.0, 0x4780, 0x7BFF},                        // largest fp16
+        {65519.0, 0x4780, 0x7BFF},
+        {65520.0, 0x4780, 0x7C00},                        // fp16 overflow by rounding
+        {1e6, 0x4974, 0x7C00},
+        {std::ldexp(1.0, -14), 0x3880, 0x0400},           // smallest normal fp16
+        {std::ldexp(1.0, -14) - std::ldexp(1.0, -24), 0x3880, 0x03FF},
+        {std::ldexp(1.0, -24), 0x3380, 0x0001},           // smallest subnormal fp16
+        {-std::ldexp(1.0, -24), 0xB380, 0x8001},
+        {std::ldexp(1.0, -25), 0x3300, 0x0000},           // tie, to even (zero)
+        {3 * std::ldexp(1.0, -26), 0x3340, 0x0001},
+        {1e-40, 0x0001, 0x0000},                          // float subnormal
+        {1e-310, 0x0000, 0x0000},                         // double subnormal, float zero
+        {3.4028234663852886e38, 0x7F80, 0x7C00},          // largest float, bf16 rounds up
+        {inf, 0x7F80, 0x7C00},
+        {-inf, 0xFF80, 0xFC00},
+        {nan, 0x7FC0, 0x7E00},
+        {-nan, 0xFFC0, 0xFE00},
+    };
+    const size_t n_values = sizeof(table) / sizeof(table[0]);
+
+    std::vector<double> values(n_values);
+    for (size_t i=0;i<n_values;i++) values[i] = table[i].v;
+
+    for (int precision : {WIRE_FLOAT32, WIRE_BFLOAT16, WIRE_FLOAT16}) {
+        const std::string name = precision == WIRE_FLOAT32 ? "fp32" : precision == WIRE_BFLOAT16 ? "bf16" : "fp16";
+        const size_t width = precision == WIRE_FLOAT32 ? 4 : 2;
+
+        // One value at a time takes the scalar kernel
+        std::vector<unsigned char> single(n_values * width);
+        for (size_t i=0;i<n_values;i++) pack_wire(&values[i], single.data() + i * width, 1, precision);
+        for (size_t i=0;i<n_values;i++) {
+            const unsigned char *p = single.data() + i * width;
+            if (precision == WIRE_FLOAT32) {
+                float got;
+                std::memcpy(&got, p, sizeof(got));
+                const float want = static_cast<float>(values[i]);
+                check(std::isnan(want) ? std::isnan(got) && std::signbit(got) == std::signbit(want)
+                                       : bits32(got) == bits32(want),
+                      "fp32 pack of entry " + std::to_string(i));
+            } else {
+                uint16_t got;
+                std::memcpy(&got, p, sizeof(got));
+                const uint16_t want = precision == WIRE_BFLOAT16 ? table[i].bf16 : table[i].fp16;
+                char msg[96];
+                std::snprintf(msg, sizeof(msg), "%s pack of entry %zu: 0x%04X, expected 0x%04X",
+                              name.c_str(), i, got, want);
+                check(got == want, msg);
+            }
+        }
+
+        // The whole table from every start offset: each value passes through
+        // the vector body and the scalar tail, which must agree bit for bit
+        for (size_t offset=0;offset<4;offset++) {
+            const size_t n = n_values - offset;
+            std::vector<unsigned char> packed(n * width);
+            pack_wire(values.data() + offset, packed.data(), n, precision);
+            check(std::memcmp(packed.data(), single.data() + offset * width, n * width) == 0,
+                  name + " pack, vector and scalar kernels differ at offset " + std::to_string(offset));
+
+            std::vector<double> bulk(n), one(n);
+            unpack_wire(packed.data(), bulk.data(), n, precision);
+            for (size_t i=0;i<n;i++) unpack_wire(packed.data() + i * width, &one[i], 1, precision);
+            bool same = true;
+            for (size_t i=0;i<n;i++) same = same && same_value(bulk[i], one[i]);
+            check(same, name + " unpack, vector and scalar kernels differ at offset " + std::to_string(offset));
+        }
+        if (precision == WIRE_FLOAT32) continue;
+
+        // Every 16-bit pattern: decoded as by definition in bulk and one by
+        // one, and packed back to itself (NaNs to a NaN)
+        std::vector<uint16_t> patterns(65536);
+        for (size_t h=0;h<patterns.size();h++) patterns[h] = static_cast<uint16_t>(h);
+        std::vector<double> decoded(patterns.size());
+        unpack_wire(patterns.data(), decoded.data(), patterns.size(), precision);
+        std::vector<uint16_t> repacked(patterns.size());
+        pack_wire(decoded.data(), repacked.data(), decoded.size(), precision);
+        size_t bad_decode = 0, bad_scalar = 0, bad_repack = 0;
+        for (size_t h=0;h<patterns.size();h++) {
+            const uint16_t p = patterns[h];
+            const double want = precision == WIRE_BFLOAT16 ? bf16_reference(p) : half_reference(p);
+            if (!same_value(decoded[h], want)) bad_decode++;
+            double one = 0.0;
+            unpack_wire(&p, &one, 1, precision);
+            if (!same_value(one, want)) bad_scalar++;
+            const bool nan_pattern = std::isnan(want);
+            double back = 0.0;
+            unpack_wire(&repacked[h], &back, 1, precision);
+            if (nan_pattern ? !std::isnan(back) : repacked[h] != p) bad_repack++;
+        }
+        check(bad_decode == 0, name + " bulk decode wrong for " + std::to_string(bad_decode) + " patterns");
+        check(bad_scalar == 0, name + " scalar decode wrong for " + std::to_string(bad_scalar) + " patterns");
+        check(bad_repack == 0, name + " round trip wrong for " + std::to_string(bad_repack) + " patterns");
+    }
+}
+
+// === Frame codec ===
+
+struct CodecCase {
+    std::string name;
+    SRTensorType type;
+    std::vector<unsigned char> bytes;
+    size_t n;
+};
+
+template <typename T>
+static CodecCase codec_case(const std::string &name, SRTensorType type, const std::vector<T> &v) {
+    CodecCase c;
+    c.name = name;
+    c.type = type;
+    c.n = v.size();
+    const unsigned char *p = reinterpret_cast<const unsigned char*>(v.data());
+    c.bytes.assign(p, p + v.size() * sizeof(T));
+    return c;
+}
+
+static std::vector<CodecCase> codec_cases() {
+    std::vector<CodecCase> cases;
+    std::vector<double> smooth(1000), constant(3000, 2.5), one(1, -1.25), empty;
+    for (size_t i=0;i<smooth.size();i++) smooth[i] = std::sin(0.01 * i);
+    std::vector<float> noise(257);
+    uint32_t seed = 12345;
+    for (float &x : noise) {
+        seed = seed * 1664525u + 1013904223u;
+        x = static_cast<float>(seed >> 8) / 16777216.0f;
+    }
+    std::vector<int32_t> ramp(1024);
+    for (size_t i=0;i<ramp.size();i++) ramp[i] = static_cast<int32_t>(i / 7);
+    std::vector<uint16_t> shorts = {1, 2, 3};
+    cases.push_back(codec_case("smooth", SRTensorTypeDouble, smooth));
+    cases.push_back(codec_case("constant", SRTensorTypeDouble, constant));
+    cases.push_back(codec_case("one", SRTensorTypeDouble, one));
+    cases.push_back(codec_case("empty", SRTensorTypeDouble, empty));
+    cases.push_back(codec_case("noise", SRTensorTypeFloat, noise));
+    cases.push_back(codec_case("ramp", SRTensorTypeInt32, ramp));
+    cases.push_back(codec_case("shorts", SRTensorTypeUint16, shorts));
+    return cases;
+}
+
+static void test_codec_frames() {
+    std::vector<unsigned char> frame, scratch, restored;
+    for (const CodecCase &c : codec_cases()) {
+        for (int codec=CODEC_NONE;codec<=CODEC_XOR_SHUFFLE_LZ;codec++) {
+            const std::string what = "codec " + std::to_string(codec) + " on " + c.name;
+            FrameHeader header;
+            header.codec = codec;
+            header.elem_size = static_cast<int>(SmartRedis::fake::type_size(c.type));
+            header.dtype = c.type;
+            header.dims = {c.n};
+            encode_frame(c.bytes.data(), c.n, header, frame, scratch);
+            check(is_frame(frame.data(), frame.size()), what + ": no frame header");
+
+            FrameHeader parsed;
+            read_frame_header(frame.data(), frame.size(), parsed);
+            check(parsed.codec == codec && parsed.elem_size == header.elem_size && parsed.dtype == c.type &&
+                  parsed.dims == header.dims && parsed.raw_bytes == c.bytes.size(), what + ": header fields");
+
+            restored.assign(c.bytes.size(), 0);
+            decode_frame(frame.data(), frame.size(), restored.data(), restored.size(), scratch);
+            check(restored == c.bytes, what + ": round trip");
+
+            check(!failure_of([&] { decode_frame(frame.data(), frame.size(), restored.data(),
+                                                  restored.size() + 1, scratch); }).empty(),
+                  what + ": wrong destination size accepted");
+            const size_t payload = frame.size() - 20 - 8 * header.dims.size();
+            if (c.bytes.size() >= 64)
+                check(!failure_of([&] { decode_frame(frame.data(), frame.size() - payload / 2, restored.data(),
+                                                      restored.size(), scratch); }).empty(),
+                      what + ": truncated frame accepted");
+        }
+    }
+
+    // Long runs need the extended match lengths, and must actually shrink
+    const CodecCase constant = codec_cases()[1];
+    FrameHeader header;
+    header.codec = CODEC_XOR_SHUFFLE_LZ;
+    header.elem_size = 8;
+    header.dtype = SRTensorTypeDouble;
+    header.dims = {constant.n};
+    encode_frame(constant.bytes.data(), constant.n, header, frame, scratch);
+    check(frame.size() < constant.bytes.size() / 20, "constant field does not compress");
+    check(!failure_of([&] { unsigned char junk[8] = {0}; FrameHeader h;
+                            read_frame_header(junk, sizeof(junk), h); }).empty(), "bad magic accepted");
+}
+
+// Collective: compressed states and actions end to end
+static void test_codec_exchange(SmartRedisMPI &sr, SmartRedis::Client &agent) {
+    const int n = 200 + 30 * g_rank;
+    const Layout l = layout_of(n);
+    std::vector<double> state(n), action(n, 0.0);
+    for (int i=0;i<n;i++) state[i] = std::cos(0.001 * (l.displs[g_rank] + i));
+
+    sr.set_compression("cz_state", CODEC_XOR_SHUFFLE_LZ, 0);
+    sr.put_state("cz_state", state.data(), n);
+    if (g_rank == 0) {
+        const std::vector<unsigned char> frame = stored_bytes("cz_state");
+        std::vector<double> all(l.total), want(l.total);
+        std::vector<unsigned char> scratch;
+        check(is_frame(frame.data(), frame.size()), "compressed state is not a frame");
+        check(failure_of([&] { decode_frame(frame.data(), frame.size(), all.data(), all.size() * sizeof(double),
+                                            scratch); }).empty(), "compressed state does not decode");
+        for (int g=0;g<l.total;g++) want[g] = std::cos(0.001 * g);
+        check(all == want, "compressed state content");
+
+        FrameHeader header;
+        header.codec = CODEC_SHUFFLE_LZ;
+        header.elem_size = 8;
+        header.dtype = SRTensorTypeDouble;
+        header.dims = {static_cast<size_t>(l.total)};
+        std::vector<unsigned char> out;
+        for (double &x : want) x = -x;
+        encode_frame(want.data(), want.size(), header, out, scratch);
+        put_frame(agent, "cz_action", out);
+    }
+    sr.set_compression("cz_action", CODEC_SHUFFLE_LZ, 0);
+    sr.get_action("cz_action", action.data(), n);
+    bool ok = true;
+    for (int i=0;i<n;i++) ok = ok && action[i] == -state[i];
+    check(ok, "compressed action content");
+}
+
+// --codec-cross DIR: cases.txt lists "name dtype elem_size n codec"; decode
+// name.py.frame against name.raw, then write name.cpp.frame
+static int codec_cross(const std::string &dir) {
+    std::ifstream list(dir + "/cases.txt");
+    std::string line;
+    int bad = 0, cases = 0;
+    std::vector<unsigned char> frame, scratch, restored;
+    auto slurp = [](const std::string &path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::vector<unsigned char>((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    };
+    while (std::getline(list, line)) {
+        std::istringstream fields(line);
+        std::string name;
+        int dtype = 0, elem_size = 0, codec = 0;
+        size_t n = 0;
+        if (!(fields >> name >> dtype >> elem_size >> n >> codec)) continue;
+        cases++;
+        const std::vector<unsigned char> raw = slurp(dir + "/" + name + ".raw");
+        const std::vector<unsigned char> py = slurp(dir + "/" + name + ".py.frame");
+        restored.assign(raw.size(), 0);
+        const std::string err = failure_of([&] { decode_frame(py.data(), py.size(), restored.data(),
+                                                              restored.size(), scratch); });
+        if (!err.empty() || restored != raw) {
+            std::fprintf(stderr, "codec cross: %s: C++ decode of the Python frame failed %s\n",
+                         name.c_str(), err.c_str());
+            bad++;
+        }
+
+        FrameHeader header;
+        header.codec = codec;
+        header.elem_size = elem_size;
+        header.dtype = static_cast<SRTensorType>(dtype);
+        header.dims = {n};
+        encode_frame(raw.data(), n, header, frame, scratch);
+        std::ofstream out(dir + "/" + name + ".cpp.frame", std::ios::binary);
+        out.write(reinterpret_cast<const char*>(frame.data()), static_cast<std::streamsize>(frame.size()));
+    }
+    std::printf("codec cross: %d cases, %d failed\n", cases, bad);
+    return bad == 0 && cases > 0 ? 0 : 1;
+}
+
+// === Sparse states and actions ===
+
+static void test_sparse(SmartRedisMPI &sr, SmartRedis::Client &agent) {
+    // Every third rank owns nothing, the others r + 3 entries
+    const int n = g_rank % 3 == 1 ? 0 : g_rank + 3;
+    const Layout l = layout_of(n);
+    std::vector<double> state(n);
+    for (int i=0;i<n;i++) state[i] = 100.0 * g_rank + i;
+
+    // Last entry first: positions keep the order each rank gave
+    std::vector<int> indices;
+    if (n > 0) indices = {n - 1, 0};
+    sr.put_state_sparse("sp_state", state.data(), n, indices.data(), indices.size());
+    if (g_rank == 0) {
+        std::vector<int32_t> want_idx;
+        std::vector<double> want_val;
+        for (size_t r=0;r<l.sizes.size();r++) {
+            if (l.sizes[r] == 0) continue;
+            want_idx.push_back(l.displs[r] + l.sizes[r] - 1);
+            want_idx.push_back(l.displs[r]);
+            want_val.push_back(100.0 * r + l.sizes[r] - 1);
+            want_val.push_back(100.0 * r);
+        }
+        SmartRedis::DataSet dataset = agent.get_dataset("sp_state");
+        std::vector<int32_t> got_idx(want_idx.size());
+        std::vector<double> got_val(want_val.size());
+        const std::string err = failure_of([&] {
+            dataset.unpack_tensor("indices", got_idx.data(), {got_idx.size()}, SRTensorTypeInt32,
+                                  SRMemLayoutContiguous);
+            dataset.unpack_tensor("values", got_val.data(), {got_val.size()}, SRTensorTypeDouble,
+                                  SRMemLayoutContiguous);
+        });
+        check(err.empty() && got_idx == want_idx && got_val == want_val, "sparse state bucketing " + err);
+    }
+
+    // Unchanged entries are not sent again: the group has no tensors
+    sr.put_state_delta("sp_delta", state.data(), n, 0.0);
+    sr.put_state_delta("sp_delta", state.data(), n, 0.0);
+    if (g_rank == 0) {
+        SmartRedis::DataSet dataset = agent.get_dataset("sp_delta");
+        int32_t idx = 0;
+        check(!failure_of([&] { dataset.unpack_tensor("indices", &idx, {1}, SRTensorTypeInt32,
+                                                      SRMemLayoutContiguous); }).empty(),
+              "unchanged delta state still carries entries");
+    }
+
+    // Every other position from the end, in descending order, so the
+    // writer has to sort entries to their owners
+    if (g_rank == 0) {
+        std::vector<int32_t> positions;
+        std::vector<double> values;
+        for (int g=l.total-1;g>=0;g-=2) {
+            positions.push_back(g);
+            values.push_back(1000.0 + g);
+        }
+        put_sparse(agent, "sp_action", positions, values.data(), values.size(), SRTensorTypeDouble);
+        std::vector<float> values32(values.begin(), values.end());
+        put_sparse(agent, "sp_action32", positions, values32.data(), values32.size(), SRTensorTypeFloat);
+    }
+    std::vector<double> action(n, -1.0), action32(n, -1.0);
+    sr.get_action_sparse("sp_action", action.data(), n);
+    // In the key's wire precision, through the wait without a timeout
+    sr.set_wire_precision("sp_action32", WIRE_FLOAT32);
+    check(sr.wait_action_sparse("sp_action32", action32.data(), n, -1.0), "sparse wait without a timeout");
+    bool ok = true;
+    for (int i=0;i<n;i++) {
+        const int g = l.displs[g_rank] + i;
+        ok = ok && action[i] == ((l.total - 1 - g) % 2 == 0 ? 1000.0 + g : -1.0);
+    }
+    check(ok, "sparse action bucketing");
+    check(action32 == action, "fp32 sparse action");
+
+    // No entries: nothing changes
+    if (g_rank == 0) put_sparse(agent, "sp_action", {}, nullptr, 0, SRTensorTypeDouble);
+    sr.get_action_sparse("sp_action", action.data(), n);
+    check(action32 == action, "empty sparse action changed entries");
+    check(!sr.wait_action_sparse("sp_missing", action.data(), n, 0.02), "sparse wait without an action");
+}
+
+// === Hierarchical collectives ===
+
+static void test_hierarchical(SmartRedis::Client &agent) {
+    // Two pretend nodes of alternating ranks: blocks arrive as 0,2,..,1,3,..
+    setenv("SRMPI_NODES", "2", 1);
+    {
+        SmartRedisMPI sr(false);
+        sr.set_collective_mode(SmartRedisMPI::COLLECTIVE_HIERARCHICAL);
+        sr.set_wire_precision("hier_f32", WIRE_FLOAT32);
+        const int n = g_rank + 1;
+        const Layout l = layout_of(n);
+        std::vector<double> state(n), action(n), reward(1, 0.5 * g_rank);
+        // Three rounds, so both halves of the node windows are used
+        for (int round=0;round<3;round++) {
+            for (int i=0;i<n;i++) state[i] = 1000.0 * round + l.displs[g_rank] + i;
+            sr.put_state("hier_state", state.data(), n);
+            sr.put_state("hier_f32", state.data(), n);
+            std::vector<double> want(l.total);
+            for (int g=0;g<l.total;g++) want[g] = 1000.0 * round + g;
+            if (g_rank == 0) {
+                std::vector<double> got(l.total);
+                std::vector<float> got32(l.total);
+                agent.unpack_tensor("hier_state", got.data(), {got.size()}, SRTensorTypeDouble, SRMemLayoutContiguous);
+                agent.unpack_tensor("hier_f32", got32.data(), {got32.size()}, SRTensorTypeFloat,
+                                    SRMemLayoutContiguous);
+                check(got == want, "hierarchical gather order, round " + std::to_string(round));
+                check(std::vector<double>(got32.begin(), got32.end()) == want,
+                      "hierarchical fp32 gather order, round " + std::to_string(round));
+                for (double &x : want) x = -x;
+                agent.put_tensor("hier_action", want.data(), {want.size()}, SRTensorTypeDouble,
+                                 SRMemLayoutContiguous);
+                agent.put_tensor("hstep.action", want.data(), {want.size()}, SRTensorTypeDouble,
+                                 SRMemLayoutContiguous);
+            }
+            sr.get_action("hier_action", action.data(), n);
+            bool ok = true;
+            for (int i=0;i<n;i++) ok = ok && action[i] == -state[i];
+            check(ok, "hierarchical scatter order, round " + std::to_string(round));
+
+            std::fill(action.begin(), action.end(), 0.0);
+            sr.step_exchange("hstep", state.data(), n, reward.data(), 1, 0, action.data(), n);
+            ok = true;
+            for (int i=0;i<n;i++) ok = ok && action[i] == -state[i];
+            check(ok, "hierarchical step_exchange action, round " + std::to_string(round));
+            if (g_rank == 0) {
+                SmartRedis::DataSet dataset = agent.get_dataset("hstep.step");
+                std::vector<double> got(l.total), rewards(l.sizes.size());
+                dataset.unpack_tensor("state", got.data(), {got.size()}, SRTensorTypeDouble, SRMemLayoutContiguous);
+                dataset.unpack_tensor("reward", rewards.data(), {rewards.size()}, SRTensorTypeDouble,
+                                      SRMemLayoutContiguous);
+                for (double &x : want) x = -x;
+                bool in_order = got == want;
+                for (size_t r=0;r<rewards.size();r++) in_order = in_order && rewards[r] == 0.5 * r;
+                check(in_order, "hierarchical step_exchange order, round " + std::to_string(round));
+            }
+        }
+    }
+    unsetenv("SRMPI_NODES");
+}
+
+// === Step-versioned ring ===
+
+static void test_ring(SmartRedisMPI &sr, SmartRedis::Client &agent) {
+    const int slots = 2;
+    const int n = 3;
+    const Layout l = layout_of(n);
+    const int state_id = sr.register_ring_key("ring_state", slots);
+    const int action_id = sr.register_ring_key("ring_action", slots);
+    const int late_id = sr.register_ring_key("ring_late", slots);
+    std::vector<double> state(n, 1.0), action(n), all(l.total);
+    const int steps = 12;
+    size_t most = 0;
+    for (int step=0;step<steps;step++) {
+        sr.set_step(step);
+        sr.put_state(state_id, state.data(), n);
+        if (g_rank == 0) {
+            for (int g=0;g<l.total;g++) all[g] = step + 0.001 * g;
+            agent.put_tensor(sr.key_name(action_id), all.data(), {all.size()}, SRTensorTypeDouble,
+                             SRMemLayoutContiguous);
+        }
+        sr.get_action(action_id, action.data(), n);
+        check(action[0] == step + 0.001 * l.displs[g_rank], "ring action of step " + std::to_string(step));
+
+        // The agent answers only after the solver gave up on the slot
+        check(!sr.wait_action(late_id, action.data(), n, 0.005), "late ring slot read before it was written");
+        if (g_rank == 0) {
+            agent.put_tensor(sr.key_name(late_id), all.data(), {all.size()}, SRTensorTypeDouble,
+                             SRMemLayoutContiguous);
+            most = std::max(most, stored_with_prefix("ring_state.") + stored_with_prefix("ring_late."));
+        }
+    }
+    check(!failure_of([&] { sr.get_action_step(action_id, steps - 1 - slots, action.data(), n); }).empty(),
+          "ring read outside the window accepted");
+    if (g_rank == 0) {
+        // Consumed actions are gone; put and late slots stay within 2 * slots
+        check(stored_with_prefix("ring_action.") == 0, "consumed ring actions left in the store");
+        check(most <= 2 * 2 * slots, "ring kept " + std::to_string(most) + " slots of two keys");
+        for (int step=steps-slots;step<steps;step++) {
+            check(SmartRedis::fake::store().tensors.count("ring_state." + std::to_string(step)) == 1,
+                  "ring state of step " + std::to_string(step) + " deleted inside the window");
+        }
+    }
+    sr.set_step(0);
+}
+
+// === Record and replay ===
+
+static void test_replay(SmartRedis::Client &agent) {
+    // One log prefix for every rank, taken from rank 0's pid
+    long pid = static_cast<long>(getpid());
+    MPI_Bcast(&pid, 1, MPI_LONG, 0, MPI_COMM_WORLD);
+    const char *tmp = std::getenv("TMPDIR");
+    const std::string prefix = std::string(tmp ? tmp : "/tmp") + "/srmpi_test_" + std::to_string(pid);
+
+    const int n = 4 + g_rank;
+    const Layout l = layout_of(n);
+    const int steps = 4;
+    std::vector<double> state(n, 1.0), recorded(steps * static_cast<size_t>(n)), sparse_recorded(recorded.size());
+    {
+        SmartRedisMPI sr(false);
+        sr.set_record_log(prefix);
+        for (int step=0;step<steps;step++) {
+            if (g_rank == 0) {
+                std::vector<double> all(l.total);
+                for (int g=0;g<l.total;g++) all[g] = 10.0 * step + g;
+                agent.put_tensor("rr_action", all.data(), {all.size()}, SRTensorTypeDouble, SRMemLayoutContiguous);
+                // Every other step without entries
+                const double value = -1.0 - step;
+                if (step % 2 == 0) put_sparse(agent, "rr_sparse", {step % l.total}, &value, 1, SRTensorTypeDouble);
+                else put_sparse(agent, "rr_sparse", {}, nullptr, 0, SRTensorTypeDouble);
+            }
+            sr.put_state("rr_state", state.data(), n);
+            sr.get_action("rr_action", recorded.data() + step * n, n);
+            sr.get_action_sparse("rr_sparse", sparse_recorded.data() + step * n, n);
+        }
+        sr.set_record_log("");
+    }
+
+    std::vector<double> replayed(recorded.size(), 0.0), sparse_replayed(recorded.size(), 0.0);
+    {
+        SmartRedisMPI sr(false, MPI_COMM_WORLD, TRANSPORT_REPLAY);
+        sr.set_replay_log(prefix);
+        for (int step=0;step<steps;step++) {
+            sr.put_state("rr_state", state.data(), n);
+            sr.get_action("rr_action", replayed.data() + step * n, n);
+            sr.get_action_sparse("rr_sparse", sparse_replayed.data() + step * n, n);
+        }
+        std::vector<double> extra(n);
+        check(!sr.wait_action("rr_action", extra.data(), n, 0.01), "replay served more actions than recorded");
+    }
+    check(replayed == recorded, "replayed actions differ from the recorded run");
+    check(sparse_replayed == sparse_recorded, "replayed sparse actions differ from the recorded run");
+    if (g_rank == 0) std::remove(record_log_path(prefix, 0).c_str());
+}
+
+// === Writer errors ===
+
+static void test_writer_errors(SmartRedisMPI &sr, SmartRedis::Client &agent) {
+    const int n = 5;
+    const Layout l = layout_of(n);
+    std::vector<double> state(n, 1.0), action(n);
+
+    // Action of the wrong size: the writer's read throws
+    if (g_rank == 0) {
+        std::vector<double> wrong(l.total + 1, 0.0);
+        agent.put_tensor("err_size", wrong.data(), {wrong.size()}, SRTensorTypeDouble, SRMemLayoutContiguous);
+    }
+    check_writer_failure(failure_of([&] { sr.get_action("err_size", action.data(), n); }), "get_action");
+    check_writer_failure(failure_of([&] { sr.wait_action("err_size", action.data(), n, 1.0); }), "wait_action");
+
+    // Sparse groups: fewer values than indices, values not in the wire
+    // precision, and a position out of range
+    const double values[2] = {1.0, 2.0};
+    const float value32 = 1.0f;
+    if (g_rank == 0) put_sparse(agent, "err_sparse", {0, 1}, values, 1, SRTensorTypeDouble);
+    check_writer_failure(failure_of([&] { sr.get_action_sparse("err_sparse", action.data(), n); }),
+                         "sparse value count");
+    if (g_rank == 0) put_sparse(agent, "err_sparse", {0}, &value32, 1, SRTensorTypeFloat);
+    check_writer_failure(failure_of([&] { sr.get_action_sparse("err_sparse", action.data(), n); }),
+                         "sparse value type");
+    if (g_rank == 0) put_sparse(agent, "err_sparse", {l.total}, values, 1, SRTensorTypeDouble);
+    check_writer_failure(failure_of([&] { sr.wait_action_sparse("err_sparse", action.data(), n, 1.0); }),
+                         "sparse position");
+
+    // Compressed action that is a frame header and junk
+    if (g_rank == 0) {
+        std::vector<unsigned char> frame(28, 0x5A);
+        std::memcpy(frame.data(), "SRZ1", 4);
+        frame[4] = CODEC_SHUFFLE_LZ;
+        frame[5] = 8;
+        frame[6] = SRTensorTypeDouble;
+        frame[7] = 0;
+        frame[8] = 0; frame[9] = 0; frame[10] = 0; frame[11] = 0;
+        const uint64_t raw = static_cast<uint64_t>(l.total) * sizeof(double);
+        for (int i=0;i<8;i++) frame[12 + i] = static_cast<unsigned char>(raw >> (8 * i));
+        put_frame(agent, "err_cz", frame);
+    }
+    sr.set_compression("err_cz", CODEC_SHUFFLE_LZ, 0);
+    check_writer_failure(failure_of([&] { sr.get_action("err_cz", action.data(), n); }), "compressed frame");
+
+    // Policy weights whose meta is not int32
+    sr.set_local_policy("err_pa", "err_ps", "err_w", 1);
+    if (g_rank == 0) {
+        float meta[3] = {0.0f, 0.0f, 0.0f};
+        agent.put_tensor("err_w.meta", meta, {3}, SRTensorTypeFloat, SRMemLayoutContiguous);
+    }
+    sr.put_state("err_ps", state.data(), n);
+    check_writer_failure(failure_of([&] { sr.get_action("err_pa", action.data(), n); }), "policy refresh");
+    sr.set_local_policy("err_pa", "err_ps", "", 1);
+
+    // A timeout is not an error: false everywhere
+    check(!sr.wait_action("err_none", action.data(), n, 0.02), "wait on a missing action");
+
+    // The instance is still usable afterwards
+    if (g_rank == 0) {
+        std::vector<double> all(l.total, 7.0);
+        agent.put_tensor("err_ok", all.data(), {all.size()}, SRTensorTypeDouble, SRMemLayoutContiguous);
+    }
+    check(failure_of([&] { sr.get_action("err_ok", action.data(), n); }).empty() && action[0] == 7.0,
+          "exchange after writer errors");
+
+    // With stats on, a size change on one rank only throws on every rank
+    int nprocs = 0;
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    sr.enable_stats(true);
+    sr.put_state("err_resize", state.data(), n);
+    const size_t m = g_rank == nprocs - 1 ? n - 1 : n;
+    check(!failure_of([&] { sr.put_state("err_resize", state.data(), m); }).empty(), "one-rank size change");
+    sr.invalidate_plan("err_resize");
+    sr.put_state("err_resize", state.data(), m);
+    sr.enable_stats(false);
+}
+
+// === Fused step exchange ===
+
+static void test_step_exchange(SmartRedisMPI &sr, SmartRedis::Client &agent) {
+    const int n = 3 + g_rank, n_reward = g_rank % 2 + 1;
+    const Layout l = layout_of(n), lr = layout_of(n_reward);
+    std::vector<double> state(n), reward(n_reward), action(n);
+    const std::vector<double> scalars = {1.5, -2.0};
+    for (int i=0;i<n;i++) state[i] = l.displs[g_rank] + i + 0.5;
+    for (int i=0;i<n_reward;i++) reward[i] = 100.0 + lr.displs[g_rank] + i;
+
+    sr.set_wire_precision("fstep32.step", WIRE_FLOAT32);
+    for (const std::string tag : {"fstep", "fstep32"}) {
+        if (g_rank == 0) {
+            std::vector<double> act(l.total);
+            for (int g=0;g<l.total;g++) act[g] = -g;
+            agent.put_tensor(tag + ".action", act.data(), {act.size()}, SRTensorTypeDouble, SRMemLayoutContiguous);
+        }
+        check(sr.step_exchange(tag, state.data(), n, reward.data(), n_reward, 7, action.data(), n,
+                               scalars.data(), scalars.size()), tag + ": step_exchange timed out");
+        bool ok = true;
+        for (int i=0;i<n;i++) ok = ok && action[i] == -(l.displs[g_rank] + i);
+        check(ok, tag + ": step_exchange action");
+        if (g_rank != 0) continue;
+
+        SmartRedis::DataSet dataset = agent.get_dataset(tag + ".step");
+        const SRTensorType type = tag == "fstep" ? SRTensorTypeDouble : SRTensorTypeFloat;
+        std::vector<double> got(l.total), rewards(lr.total);
+        if (type == SRTensorTypeDouble) {
+            dataset.unpack_tensor("state", got.data(), {got.size()}, type, SRMemLayoutContiguous);
+            dataset.unpack_tensor("reward", rewards.data(), {rewards.size()}, type, SRMemLayoutContiguous);
+        } else {
+            std::vector<float> s32(l.total), r32(lr.total);
+            dataset.unpack_tensor("state", s32.data(), {s32.size()}, type, SRMemLayoutContiguous);
+            dataset.unpack_tensor("reward", r32.data(), {r32.size()}, type, SRMemLayoutContiguous);
+            got.assign(s32.begin(), s32.end());
+            rewards.assign(r32.begin(), r32.end());
+        }
+        ok = true;
+        for (int g=0;g<l.total;g++) ok = ok && got[g] == g + 0.5;
+        for (int g=0;g<lr.total;g++) ok = ok && rewards[g] == 100.0 + g;
+        check(ok, tag + ": stored state and reward");
+        check(!agent.tensor_exists(tag + ".action"), tag + ": action not consumed");
+    }
+
+    // A stalled agent: false everywhere, the action untouched, the step stored
+    std::fill(action.begin(), action.end(), 9.0);
+    check(!sr.step_exchange("fstep_none", state.data(), n, reward.data(), n_reward, 0, action.data(), n,
+                            nullptr, 0, 0.05), "step_exchange without an action did not time out");
+    check(action == std::vector<double>(n, 9.0), "action changed on timeout");
+    if (g_rank == 0) check(agent.dataset_exists("fstep_none.step"), "step not stored before the timeout");
+}
+
+// === Batched keys ===
+
+static void test_batch(SmartRedisMPI &sr, SmartRedis::Client &agent) {
+    const std::vector<std::string> keys = {"bt_a", "bt_b"};
+    const std::vector<size_t> sizes = {static_cast<size_t>(2 + g_rank), 1};
+    const Layout la = layout_of(static_cast<int>(sizes[0])), lb = layout_of(1);
+    sr.set_wire_precision("bt_b", WIRE_FLOAT32);
+    std::vector<double> a(sizes[0]), b(1, 0.5 + g_rank);
+    for (size_t i=0;i<sizes[0];i++) a[i] = la.displs[g_rank] + i;
+    sr.put_states(keys, {a.data(), b.data()}, sizes);
+    if (g_rank == 0) {
+        std::vector<double> got_a(la.total);
+        std::vector<float> got_b(lb.total);
+        agent.unpack_tensor("bt_a", got_a.data(), {got_a.size()}, SRTensorTypeDouble, SRMemLayoutContiguous);
+        agent.unpack_tensor("bt_b", got_b.data(), {got_b.size()}, SRTensorTypeFloat, SRMemLayoutContiguous);
+        bool ok = true;
+        for (int g=0;g<la.total;g++) ok = ok && got_a[g] == g;
+        for (int g=0;g<lb.total;g++) ok = ok && got_b[g] == 0.5f + g;
+        check(ok, "put_states content");
+    }
+
+    auto publish = [&](const std::string &key, const Layout &l, double sign) {
+        std::vector<double> all(l.total);
+        for (int g=0;g<l.total;g++) all[g] = sign * (g + 1);
+        if (key == "bt_b") {
+            std::vector<float> all32(all.begin(), all.end());
+            agent.put_tensor(key, all32.data(), {all32.size()}, SRTensorTypeFloat, SRMemLayoutContiguous);
+        } else {
+            agent.put_tensor(key, all.data(), {all.size()}, SRTensorTypeDouble, SRMemLayoutContiguous);
+        }
+    };
+    auto check_actions = [&](const std::vector<double> &ga, const std::vector<double> &gb, double sign,
+                             const std::string &what) {
+        bool ok = gb[0] == sign * (lb.displs[g_rank] + 1);
+        for (size_t i=0;i<sizes[0];i++) ok = ok && ga[i] == sign * (la.displs[g_rank] + i + 1);
+        check(ok, what);
+    };
+    std::vector<double> ga(sizes[0]), gb(1);
+    if (g_rank == 0) {
+        publish("bt_a", la, 1.0);
+        publish("bt_b", lb, 1.0);
+    }
+    sr.get_actions(keys, {ga.data(), gb.data()}, sizes);
+    check_actions(ga, gb, 1.0, "get_actions content");
+
+    // No timeout: the writer-only wait
+    if (g_rank == 0) {
+        publish("bt_a", la, -1.0);
+        publish("bt_b", lb, -1.0);
+    }
+    check(sr.wait_actions(keys, {ga.data(), gb.data()}, sizes, -1.0), "wait_actions without a timeout");
+    check_actions(ga, gb, -1.0, "wait_actions content");
+
+    // One key missing: false everywhere and the other key is not read
+    if (g_rank == 0) publish("bt_a", la, 2.0);
+    check(!sr.wait_actions(keys, {ga.data(), gb.data()}, sizes, 0.02), "wait_actions with a key missing");
+    check_actions(ga, gb, -1.0, "actions changed on a batch timeout");
+    if (g_rank == 0) check(agent.tensor_exists("bt_a"), "batch timeout consumed a key");
+}
+
+// === Non-blocking puts ===
+
+static bool wait_stored(const std::string &key, double seconds) {
+    for (int i=0;i<seconds*1000 && !SmartRedis::fake::store().tensors.count(key);i++) usleep(1000);
+    return SmartRedis::fake::store().tensors.count(key) > 0;
+}
+
+static void test_iput(SmartRedisMPI &sr, int thread_level) {
+    const int n = 100 + 10 * g_rank;
+    const Layout l = layout_of(n);
+    std::vector<double> state(n);
+    for (int i=0;i<n;i++) state[i] = 0.25 * ((l.displs[g_rank] + i) % 8);
+    std::vector<double> want(l.total);
+    for (int g=0;g<l.total;g++) want[g] = 0.25 * (g % 8);
+
+    // The progress thread gathers and the I/O thread writes while nobody
+    // calls into the library
+    int req = sr.iput_state("ip_state", state);
+    if (thread_level == MPI_THREAD_MULTIPLE && g_rank == 0)
+        check(wait_stored("ip_state", 5.0), "iput written before wait");
+    sr.wait(req);
+    if (g_rank == 0) {
+        std::vector<unsigned char> got = stored_bytes("ip_state");
+        check(got.size() == want.size() * sizeof(double) &&
+              std::memcmp(got.data(), want.data(), got.size()) == 0, "iput_state content");
+    }
+
+    // Packed and framed like put_state
+    sr.set_wire_precision("ip_f32", WIRE_FLOAT32);
+    sr.set_compression("ip_f32", CODEC_SHUFFLE_LZ, 0);
+    req = sr.iput_state("ip_f32", state);
+    std::vector<int> info(2, g_rank);
+    sr.iput_info("ip_info", info);
+    sr.waitall();
+    if (g_rank == 0) {
+        const std::vector<unsigned char> frame = stored_bytes("ip_f32");
+        std::vector<float> all(l.total);
+        std::vector<unsigned char> scratch;
+        check(is_frame(frame.data(), frame.size()), "iput with compression is not a frame");
+        check(failure_of([&] { decode_frame(frame.data(), frame.size(), all.data(), all.size() * sizeof(float),
+                                            scratch); }).empty(), "compressed iput does not decode");
+        check(std::vector<double>(all.begin(), all.end()) == want, "fp32 iput content");
+        check(sr.get_compression_stats("ip_f32").calls == 1, "iput compression stats");
+
+        std::vector<unsigned char> got = stored_bytes("ip_info");
+        std::vector<int32_t> ints(got.size() / sizeof(int32_t));
+        std::memcpy(ints.data(), got.data(), got.size());
+        bool ok = ints.size() == 2 * l.sizes.size();
+        for (size_t i=0;ok && i<ints.size();i++) ok = ints[i] == static_cast<int>(i / 2);
+        check(ok, "iput_info content");
+    }
+
+    // Several requests in flight through the two-stage gather, ranks not
+    // numbered node by node
+    setenv("SRMPI_NODES", "2", 1);
+    {
+        SmartRedisMPI hier(false);
+        hier.set_collective_mode(SmartRedisMPI::COLLECTIVE_HIERARCHICAL);
+        hier.set_wire_precision("ip_hier_f16", WIRE_FLOAT16);
+        std::vector<int> reqs;
+        for (int round=0;round<3;round++) {
+            std::vector<double> v(state);
+            for (double &x : v) x += round;
+            reqs.push_back(hier.iput_state("ip_hier" + std::to_string(round), v));
+            reqs.push_back(hier.iput_state("ip_hier_f16", v));
+            hier.wait(reqs[reqs.size() - 2]);
+            hier.wait(reqs.back());
+            if (g_rank != 0) continue;
+            std::vector<double> got(l.total), got16(l.total);
+            std::vector<unsigned char> raw = stored_bytes("ip_hier" + std::to_string(round));
+            check(raw.size() == got.size() * sizeof(double), "hierarchical iput size");
+            if (raw.size() == got.size() * sizeof(double)) std::memcpy(got.data(), raw.data(), raw.size());
+            raw = stored_bytes("ip_hier_f16");
+            check(raw.size() == got16.size() * sizeof(uint16_t), "hierarchical fp16 iput size");
+            if (raw.size() == got16.size() * sizeof(uint16_t))
+                unpack_wire(raw.data(), got16.data(), got16.size(), WIRE_FLOAT16);
+            bool ok = true, ok16 = true;
+            for (int g=0;g<l.total;g++) {
+                ok = ok && got[g] == want[g] + round;
+                ok16 = ok16 && got16[g] == want[g] + round;
+            }
+            check(ok, "hierarchical iput order, round " + std::to_string(round));
+            check(ok16, "hierarchical fp16 iput order, round " + std::to_string(round));
+        }
+    }
+    unsetenv("SRMPI_NODES");
+}
+
+// === Multi-field and shaped states ===
+
+// Field f of global point g is 100 f + g + 1000 round; the writer's tensor
+// is [nf, N] in C order, or point-major in Fortran order
+static void check_fields(const std::string &key, const Layout &l, int nf, SRMemoryLayout layout, int round,
+                         const std::string &what) {
+    if (g_rank != 0) return;
+    std::vector<size_t> dims;
+    const std::vector<double> got = stored_values(key, dims);
+    check(dims == std::vector<size_t>({static_cast<size_t>(nf), static_cast<size_t>(l.total)}),
+          what + ": dims");
+    bool ok = got.size() == static_cast<size_t>(nf * l.total);
+    for (int f=0;ok && f<nf;f++)
+        for (int g=0;g<l.total;g++) {
+            const size_t at = layout == SRMemLayoutContiguous ? f * l.total + g : g * nf + f;
+            ok = ok && got[at] == 100.0 * f + g + 1000.0 * round;
+        }
+    check(ok, what + ": values");
+}
+
+static void put_fields_round(SmartRedisMPI &sr, const std::string &key, const Layout &l, int n,
+                             SRMemoryLayout layout, int round) {
+    const int nf = 3;
+    const size_t stride = 2;
+    std::vector<std::vector<double>> fields(nf, std::vector<double>(n * stride, -1.0));
+    std::vector<const double*> ptrs;
+    for (int f=0;f<nf;f++) {
+        for (int i=0;i<n;i++) fields[f][i*stride] = 100.0 * f + l.displs[g_rank] + i + 1000.0 * round;
+        ptrs.push_back(fields[f].data());
+    }
+    sr.put_fields(key, ptrs, n, layout, stride);
+    check_fields(key, l, nf, layout, round, key + " round " + std::to_string(round));
+}
+
+static void test_fields(SmartRedisMPI &sr) {
+    const int n = g_rank + 2;
+    const Layout l = layout_of(n);
+    sr.set_wire_precision("fl_c32", WIRE_FLOAT32);
+    sr.set_wire_precision("fl_f32", WIRE_FLOAT32);
+    for (int round=0;round<2;round++) {
+        put_fields_round(sr, "fl_c", l, n, SRMemLayoutContiguous, round);
+        put_fields_round(sr, "fl_f", l, n, SRMemLayoutFortranContiguous, round);
+        put_fields_round(sr, "fl_c32", l, n, SRMemLayoutContiguous, round);
+        put_fields_round(sr, "fl_f32", l, n, SRMemLayoutFortranContiguous, round);
+    }
+    if (g_rank == 0)
+        check(SmartRedis::fake::store().tensors.at("fl_c32").type == SRTensorTypeFloat,
+              "put_fields stores the wire type");
+
+    // Switching a key to a narrower precision moves it to the packed path
+    sr.set_wire_precision("fl_c", WIRE_FLOAT32);
+    put_fields_round(sr, "fl_c", l, n, SRMemLayoutContiguous, 2);
+
+    // Shaped states: the distributed dimension is the first (C) or last (Fortran)
+    std::vector<double> state(2 * n);
+    for (int i=0;i<n;i++)
+        for (int j=0;j<2;j++) state[i*2+j] = 10.0 * (l.displs[g_rank] + i) + j;
+    sr.put_state_nd("nd_c", state.data(), {static_cast<size_t>(n), 2}, SRMemLayoutContiguous);
+    sr.put_state_nd("nd_f", state.data(), {2, static_cast<size_t>(n)}, SRMemLayoutFortranContiguous);
+    if (g_rank == 0) {
+        std::vector<size_t> dims_c, dims_f;
+        const std::vector<double> got_c = stored_values("nd_c", dims_c), got_f = stored_values("nd_f", dims_f);
+        check(dims_c == std::vector<size_t>({static_cast<size_t>(l.total), 2}), "put_state_nd C dims");
+        check(dims_f == std::vector<size_t>({2, static_cast<size_t>(l.total)}), "put_state_nd Fortran dims");
+        bool ok = got_c.size() == static_cast<size_t>(2 * l.total) && got_f == got_c;
+        for (int g=0;ok && g<l.total;g++)
+            for (int j=0;j<2;j++) ok = ok && got_c[g*2+j] == 10.0 * g + j;
+        check(ok, "put_state_nd values");
+    }
+
+    // Hierarchical: blocks arrive node by node and are reordered
+    setenv("SRMPI_NODES", "2", 1);
+    {
+        SmartRedisMPI hier(false);
+        hier.set_collective_mode(SmartRedisMPI::COLLECTIVE_HIERARCHICAL);
+        hier.set_wire_precision("flh_f32", WIRE_FLOAT32);
+        for (int round=0;round<3;round++) {
+            put_fields_round(hier, "flh_c", l, n, SRMemLayoutContiguous, round);
+            put_fields_round(hier, "flh_f32", l, n, SRMemLayoutFortranContiguous, round);
+        }
+    }
+    unsetenv("SRMPI_NODES");
+}
+
+// === Statistics ===
+
+static bool file_has(const std::string &path, const std::string &text) {
+    std::ifstream in(path);
+    std::stringstream all;
+    all << in.rdbuf();
+    return in && all.str().find(text) != std::string::npos;
+}
+
+static void test_stats(SmartRedisMPI &sr) {
+    // Histogram percentiles: within one bucket (2^(1/8)) and never above max
+    LatencyStats lat;
+    for (int i=0;i<99;i++) lat.add(1e-3);
+    lat.add(1.0);
+    check(lat.count == 100 && lat.min == 1e-3 && lat.max == 1.0, "latency min / max");
+    check(std::fabs(lat.mean() - 1.099e-2) < 1e-12, "latency mean");
+    check(lat.percentile(0.99) >= 1e-3 && lat.percentile(0.99) < 1e-3 * 1.1, "latency p99");
+    check(lat.percentile(1.0) == 1.0, "latency p100 is the max");
+
+    const int n = 4;
+    std::vector<double> state(n, 1.0), action(n);
+    sr.put_state("st_a", state.data(), n);
+    check(sr.get_stats(OP_PUT_STATE, "st_a").calls == 0, "no counters while disabled");
+
+    sr.enable_stats(true);
+    for (int i=0;i<3;i++) sr.put_state("st_a", state.data(), n);
+    check(!sr.wait_action("st_none", action.data(), n, 0.01), "wait on a missing action");
+    const OpStats put = sr.get_stats(OP_PUT_STATE, "st_a");
+    check(put.calls == 3 && put.bytes == 3 * n * sizeof(double), "put_state calls and bytes");
+    const LatencyStats &total = put.phase[PHASE_TOTAL];
+    check(total.count == 3 && total.min <= total.mean() && total.mean() <= total.max, "put_state latency");
+    check(put.phase[PHASE_MPI].count >= 3, "put_state mpi phase");
+    check(put.phase[PHASE_REDIS].count == (g_rank == 0 ? 3u : 0u), "put_state redis phase on the writer only");
+    const OpStats wait = sr.get_stats(OP_GET_ACTION, "st_none");
+    check(wait.calls == 1, "wait_action counted");
+    if (g_rank == 0) check(wait.phase[PHASE_WAIT].count >= 1, "wait phase on the writer");
+
+    // dump_stats: rank 0 writes one row per (op, key); dump_trace one file per rank
+    int pid = static_cast<int>(getpid());
+    MPI_Bcast(&pid, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    const std::string prefix = "/tmp/srmpi_test_stats." + std::to_string(pid);
+    sr.dump_stats(prefix + ".txt");
+    if (g_rank == 0) {
+        check(file_has(prefix + ".txt", "# op key calls bytes"), "stats dump header");
+        check(file_has(prefix + ".txt", "put_state st_a 3 " + std::to_string(3 * n * sizeof(double)) + " |"),
+              "stats dump row");
+        check(file_has(prefix + ".txt", "get_action st_none 1 "), "stats dump wait row");
+        std::remove((prefix + ".txt").c_str());
+    }
+    sr.reset_stats();
+    check(sr.get_stats(OP_PUT_STATE, "st_a").calls == 0, "reset_stats");
+
+    sr.enable_stats(true, true);
+    sr.put_state("st_a", state.data(), n);
+    sr.dump_trace(prefix);
+    const std::string trace = prefix + "." + std::to_string(g_rank) + ".json";
+    check(file_has(trace, "{\"traceEvents\":[") && file_has(trace, "\"name\":\"put_state\"") &&
+          file_has(trace, "\"key\":\"st_a\""), "trace file");
+    std::remove(trace.c_str());
+    sr.enable_stats(false);
+    sr.reset_stats();
+}
+
+// === Shared-memory transport ===
+
+// Unlinks the segments a test left under /dev/shm/<prefix>.*
+static void remove_segments(const std::string &prefix) {
+    DIR *dir = opendir("/dev/shm");
+    if (!dir) return;
+    while (struct dirent *e = readdir(dir)) {
+        const std::string name = e->d_name;
+        if (name.compare(0, prefix.size() + 1, prefix + ".") == 0) shm_unlink(("/" + name).c_str());
+    }
+    closedir(dir);
+}
+
+static double shm_read(ShmTransport &t, const std::string &key) {
+    double v = 0.0;
+    t.unpack_tensor(key, &v, {1}, SRTensorTypeDouble, SRMemLayoutContiguous);
+    t.delete_tensor(key);
+    return v;
+}
+
+// Producer and consumer are two transports of one process, as they would be
+// two processes on the node
+static void test_shm_rings(const std::string &prefix) {
+    ShmTransport producer, consumer;
+    auto put = [&](const std::string &key, double v) {
+        producer.put_tensor(key, &v, {1}, SRTensorTypeDouble, SRMemLayoutContiguous);
+    };
+
+    // A reader that keeps up sees every message in order, then nothing
+    check(!consumer.tensor_exists("order"), "no segment yet");
+    for (int i=0;i<3;i++) put("order", i);
+    bool ok = true;
+    for (int i=0;i<3;i++) ok = ok && shm_read(consumer, "order") == i;
+    check(ok && !consumer.tensor_exists("order"), "ring order");
+
+    // A lapped reader skips to the newest n_slots (SRMPI_SHM_SLOTS=4)
+    for (int i=0;i<6;i++) put("lap", i);
+    ok = true;
+    for (int i=2;i<6;i++) ok = ok && shm_read(consumer, "lap") == i;
+    check(ok && !consumer.tensor_exists("lap"), "lapped reader");
+
+    // A put larger than a slot recreates the segment with the unread slots
+    put("grow", 1.0);
+    std::vector<double> big(4096);
+    for (size_t i=0;i<big.size();i++) big[i] = static_cast<double>(i);
+    producer.put_tensor("grow", big.data(), {64, 64}, SRTensorTypeDouble, SRMemLayoutContiguous);
+    check(shm_read(consumer, "grow") == 1.0, "unread slot kept across growth");
+    std::vector<double> got(big.size());
+    consumer.unpack_tensor("grow", got.data(), {64, 64}, SRTensorTypeDouble, SRMemLayoutContiguous);
+    consumer.delete_tensor("grow");
+    check(got == big, "message after growth");
+    check(failure_of([&] { consumer.unpack_tensor("grow", got.data(), {64, 64}, SRTensorTypeDouble,
+                                                   SRMemLayoutContiguous); }) != "", "read of a consumed ring");
+
+    // Waiters sleep on the futex until the next put
+    check(!consumer.wait_for("wake", false, 20000), "wait_for times out");
+    std::thread late([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        put("wake", 5.0);
+    });
+    const bool woke = consumer.wait_for("wake", false, 5000000);
+    late.join();
+    check(woke && shm_read(consumer, "wake") == 5.0, "wait_for wakes on a put");
+
+    // Groups: entries first, then the marker; absent names are not found
+    const int32_t idx[2] = {3, 1};
+    std::vector<GroupMeta> meta(1);
+    meta[0].name = "nnz";
+    meta[0].ints = {2};
+    producer.put_group("grp", {{"indices", idx, {2}, SRTensorTypeInt32}}, meta);
+    std::vector<GroupData> taken(3);
+    taken[0].name = "indices";
+    taken[1].name = "nnz";
+    taken[2].name = "missing";
+    consumer.take_group("grp", taken);
+    int32_t first = 0;
+    if (taken[0].found) std::memcpy(&first, taken[0].bytes.data(), sizeof(first));
+    check(taken[0].found && taken[0].count == 2 && taken[0].type == SRTensorTypeInt32 && first == 3 &&
+          taken[1].found && taken[1].count == 1 && !taken[2].found, "take_group");
+    check(!consumer.tensor_exists("grp"), "group marker consumed");
+
+    producer.delete_tensors({"order", "lap", "grow", "wake", "grp", "grp.indices", "grp.nnz"});
+    check(access(("/dev/shm/" + prefix + ".order").c_str(), F_OK) != 0, "delete_tensors unlinks");
+}
+
+static void test_shm(SmartRedis::Client &) {
+    long pid = static_cast<long>(getpid());
+    MPI_Bcast(&pid, 1, MPI_LONG, 0, MPI_COMM_WORLD);
+    const std::string prefix = "srmpi_test_" + std::to_string(pid);
+    setenv("SRMPI_SHM_PREFIX", prefix.c_str(), 1);
+    setenv("SRMPI_SHM_SLOTS", "4", 1);
+    if (g_rank == 0) test_shm_rings(prefix);
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    // End to end: rank 0 plays the agent on the node's segments
+    const int n = 2 + g_rank;
+    const Layout l = layout_of(n);
+    {
+        SmartRedisMPI sr(false, MPI_COMM_WORLD, TRANSPORT_SHM);
+        sr.set_wire_precision("shm_f32", WIRE_FLOAT32);
+        std::unique_ptr<ShmTransport> agent(g_rank == 0 ? new ShmTransport() : nullptr);
+        std::vector<double> state(n), action(n);
+        for (int step=0;step<3;step++) {
+            for (int i=0;i<n;i++) state[i] = 10.0 * step + l.displs[g_rank] + i;
+            sr.put_state("shm_state", state.data(), n);
+            sr.put_state("shm_f32", state.data(), n);
+            if (g_rank == 0) {
+                std::vector<double> got(l.total), want(l.total);
+                std::vector<float> got32(l.total);
+                for (int g=0;g<l.total;g++) want[g] = 10.0 * step + g;
+                agent->unpack_tensor("shm_state", got.data(), {got.size()}, SRTensorTypeDouble,
+                                     SRMemLayoutContiguous);
+                agent->delete_tensor("shm_state");
+                agent->unpack_tensor("shm_f32", got32.data(), {got32.size()}, SRTensorTypeFloat,
+                                     SRMemLayoutContiguous);
+                agent->delete_tensor("shm_f32");
+                check(got == want && std::vector<double>(got32.begin(), got32.end()) == want,
+                      "shm states, step " + std::to_string(step));
+                for (double &x : want) x = -x;
+                agent->put_tensor("shm_action", want.data(), {want.size()}, SRTensorTypeDouble,
+                                  SRMemLayoutContiguous);
+            }
+            check(sr.wait_action("shm_action", action.data(), n, 5.0), "shm action arrives");
+            bool ok = true;
+            for (int i=0;i<n;i++) ok = ok && action[i] == -state[i];
+            check(ok, "shm action, step " + std::to_string(step));
+        }
+        // Consumed: the next wait times out on every rank
+        check(!sr.wait_action("shm_action", action.data(), n, 0.02), "shm action consumed");
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (g_rank == 0) remove_segments(prefix);
+    unsetenv("SRMPI_SHM_PREFIX");
+    unsetenv("SRMPI_SHM_SLOTS");
+}
+
+// === Trajectory buffering ===
+
+// Tensor name of a stored group as doubles (float32 widened), with its dims
+// and type; empty dims if the group does not hold it
+template <typename T>
+static std::vector<double> group_values(SmartRedis::DataSet &dataset, const std::string &name,
+                                        std::vector<size_t> &dims, SRTensorType &type) {
+    dims.clear();
+    void *data = nullptr;
+    if (failure_of([&] { dataset.get_tensor(name, data, dims, type, SRMemLayoutContiguous); }) != "")
+        return std::vector<double>();
+    size_t n = 1;
+    for (size_t d : dims) n *= d;
+    const T *p = static_cast<const T*>(data);
+    return std::vector<double>(p, p + n);
+}
+
+// State (s, f, global point g) of step s is 100 s + 10 f + g; rank r's
+// reward is s + 0.5 r
+static void append_steps(SmartRedisMPI &sr, const std::string &key, const Layout &l, int nf, int n_reward,
+                         int first, int count) {
+    const int n = l.sizes[g_rank];
+    std::vector<double> state(nf * n), reward(n_reward, 0.0);
+    for (int s=first;s<first+count;s++) {
+        for (int f=0;f<nf;f++)
+            for (int i=0;i<n;i++) state[f*n+i] = 100.0 * s + 10.0 * f + l.displs[g_rank] + i;
+        if (n_reward > 0) reward[0] = s + 0.5 * g_rank;
+        sr.append_step(key, state.data(), state.size(), reward.data(), reward.size(), s % 2);
+    }
+}
+
+// The group holds steps first .. first+k-1
+template <typename T>
+static void check_trajectory(SmartRedis::Client &agent, const std::string &key, const Layout &l, int nf,
+                             bool rewards, int first, int k, SRTensorType state_type) {
+    if (g_rank != 0) return;
+    const std::string what = key + " steps " + std::to_string(first) + "+" + std::to_string(k);
+    SmartRedis::DataSet dataset = agent.get_dataset(key);
+    std::vector<size_t> dims;
+    SRTensorType type;
+    const std::vector<double> state = group_values<T>(dataset, "state", dims, type);
+    check(dims == std::vector<size_t>({static_cast<size_t>(k), static_cast<size_t>(nf),
+                                       static_cast<size_t>(l.total)}) && type == state_type, what + ": state dims");
+    bool ok = state.size() == static_cast<size_t>(k * nf * l.total);
+    for (int s=0;ok && s<k;s++)
+        for (int f=0;f<nf;f++)
+            for (int g=0;g<l.total;g++)
+                ok = ok && state[(s*nf + f)*l.total + g] == 100.0 * (first + s) + 10.0 * f + g;
+    check(ok, what + ": state values");
+
+    const std::vector<double> types = group_values<int32_t>(dataset, "step_type", dims, type);
+    const std::vector<double> steps = group_values<int64_t>(dataset, "step", dims, type);
+    ok = types.size() == static_cast<size_t>(k) && steps.size() == types.size();
+    for (int s=0;ok && s<k;s++) ok = types[s] == (first + s) % 2 && steps[s] == first + s;
+    check(ok, what + ": step_type and step");
+
+    const std::vector<double> reward = group_values<double>(dataset, "reward", dims, type);
+    const size_t nprocs = l.sizes.size();
+    if (!rewards) {
+        check(dims.empty(), what + ": no reward tensor");
+        return;
+    }
+    ok = dims == std::vector<size_t>({static_cast<size_t>(k), nprocs});
+    for (int s=0;ok && s<k;s++)
+        for (size_t r=0;r<nprocs;r++) ok = ok && reward[s*nprocs + r] == first + s + 0.5 * r;
+    check(ok, what + ": rewards");
+}
+
+static void test_trajectory(SmartRedisMPI &sr, SmartRedis::Client &agent) {
+    const int nf = 2;
+    const Layout l = layout_of(g_rank + 1);
+
+    // Blocking: a full buffer flushes by itself, flush_trajectory sends a partial one
+    sr.open_trajectory("tr_sync", 3, nf, l.sizes[g_rank], 1, false);
+    append_steps(sr, "tr_sync", l, nf, 1, 0, 3);
+    check_trajectory<double>(agent, "tr_sync", l, nf, true, 0, 3, SRTensorTypeDouble);
+    append_steps(sr, "tr_sync", l, nf, 1, 3, 2);
+    sr.flush_trajectory("tr_sync");
+    check_trajectory<double>(agent, "tr_sync", l, nf, true, 3, 2, SRTensorTypeDouble);
+    sr.close_trajectory("tr_sync");
+
+    // Async in float32 without rewards: close waits for the last group
+    sr.set_wire_precision("tr_async", WIRE_FLOAT32);
+    sr.open_trajectory("tr_async", 2, nf, l.sizes[g_rank], 0, true);
+    append_steps(sr, "tr_async", l, nf, 0, 0, 5);
+    sr.close_trajectory("tr_async");
+    check_trajectory<float>(agent, "tr_async", l, nf, false, 4, 1, SRTensorTypeFloat);
+
+    // Closed trajectories are gone; a step of the wrong size is refused
+    check(failure_of([&] { sr.flush_trajectory("tr_sync"); }) != "", "flush of a closed trajectory");
+    sr.open_trajectory("tr_bad", 2, nf, l.sizes[g_rank], 1, false);
+    std::vector<double> wrong(nf * l.sizes[g_rank] + 1), reward(1);
+    check(failure_of([&] { sr.append_step("tr_bad", wrong.data(), wrong.size(), reward.data(), 1, 0); }) != "",
+          "append_step of the wrong size");
+    sr.close_trajectory("tr_bad");
+}
+
+// === Typed tensors ===
+
+// Value of global element g in T; int64 values need more than 32 bits
+template <typename T>
+static T typed_value(int g, int sign) {
+    int64_t v = sign * (37LL * g - 50);
+    if (std::is_integral<T>::value && sizeof(T) == 8) v += sign * (static_cast<int64_t>(g) << 40);
+    return static_cast<T>(v);
+}
+
+// Round trip of one element type: stored as is, scattered back in place
+template <typename T>
+static void check_typed(SmartRedisMPI &sr, SmartRedis::Client &agent, const std::string &key, const Layout &l,
+                        bool runtime) {
+    const int n = l.sizes[g_rank];
+    const SRTensorType type = TensorTraits<T>::type;
+    std::vector<T> local(n), back(n);
+    for (int i=0;i<n;i++) local[i] = typed_value<T>(l.displs[g_rank] + i, 1);
+    if (runtime) sr.put_tensor(key, local.data(), n, type);
+    else sr.put_tensor(key, local);
+    if (g_rank == 0) {
+        std::vector<T> all(l.total);
+        for (int g=0;g<l.total;g++) all[g] = typed_value<T>(g, 1);
+        const std::vector<unsigned char> want(reinterpret_cast<const unsigned char*>(all.data()),
+                                              reinterpret_cast<const unsigned char*>(all.data() + all.size()));
+        check(SmartRedis::fake::store().tensors.at(key).type == type && stored_bytes(key) == want,
+              key + ": stored in its own type");
+        for (int g=0;g<l.total;g++) all[g] = typed_value<T>(g, -1);
+        agent.put_tensor(key + ".back", all.data(), {all.size()}, type, SRMemLayoutContiguous);
+    }
+    if (runtime) sr.get_tensor(key + ".back", back.data(), n, type);
+    else sr.get_tensor(key + ".back", back);
+    bool ok = true;
+    for (int i=0;i<n;i++) ok = ok && back[i] == typed_value<T>(l.displs[g_rank] + i, -1);
+    check(ok, key + ": scattered in its own type");
+}
+
+static void test_tensor(SmartRedisMPI &sr, SmartRedis::Client &agent) {
+    const Layout l = layout_of(3 + g_rank);
+    check_typed<double>(sr, agent, "ty_f64", l, false);
+    check_typed<float>(sr, agent, "ty_f32", l, false);
+    check_typed<int8_t>(sr, agent, "ty_i8", l, false);
+    check_typed<int16_t>(sr, agent, "ty_i16", l, true);
+    check_typed<int32_t>(sr, agent, "ty_i32", l, false);
+    check_typed<int64_t>(sr, agent, "ty_i64", l, true);
+    check_typed<uint8_t>(sr, agent, "ty_u8", l, true);
+    check_typed<uint16_t>(sr, agent, "ty_u16", l, false);
+
+    // Wire precision does not apply to typed tensors
+    sr.set_wire_precision("ty_wide", WIRE_FLOAT32);
+    check_typed<double>(sr, agent, "ty_wide", l, false);
+
+    // Compression does: the writer stores a frame of the native bytes
+    const Layout lz = layout_of(256);
+    std::vector<int32_t> flags(256, 1);
+    sr.set_compression("ty_zip", CODEC_SHUFFLE_LZ, 0);
+    sr.put_tensor("ty_zip", flags);
+    if (g_rank == 0) {
+        const std::vector<unsigned char> frame = stored_bytes("ty_zip");
+        std::vector<int32_t> all(lz.total, 0);
+        std::vector<unsigned char> scratch;
+        FrameHeader header;
+        const bool decoded = is_frame(frame.data(), frame.size()) && failure_of([&] {
+            read_frame_header(frame.data(), frame.size(), header);
+            decode_frame(frame.data(), frame.size(), all.data(), all.size() * sizeof(int32_t), scratch);
+        }).empty();
+        check(decoded && header.dtype == SRTensorTypeInt32 && all == std::vector<int32_t>(lz.total, 1),
+              "compressed int32 tensor");
+    }
+
+    // A stored tensor of another type fails on every rank; a missing one times out
+    const int n = l.sizes[g_rank];
+    std::vector<int32_t> got(n);
+    if (g_rank == 0) {
+        std::vector<float> other(l.total, 1.0f);
+        agent.put_tensor("ty_other", other.data(), {other.size()}, SRTensorTypeFloat, SRMemLayoutContiguous);
+    }
+    check_writer_failure(failure_of([&] { sr.get_tensor("ty_other", got); }), "get_tensor of another type");
+    check(!sr.wait_tensor("ty_none", got.data(), n, 0.02), "wait_tensor on a missing tensor");
+}
+
+// === Thread lanes ===
+
+static void test_lanes(SmartRedis::Client &agent, int thread_level) {
+    SmartRedisMPI sr(false);
+    if (thread_level < MPI_THREAD_MULTIPLE) {
+        check(failure_of([&] { sr.set_threads(2); }) != "", "set_threads without MPI_THREAD_MULTIPLE");
+        return;
+    }
+    const int n_threads = 3;
+    const int n = 2 + g_rank;
+    const Layout l = layout_of(n);
+    // Settings made before set_threads reach every lane
+    sr.set_wire_precision("ln_1", WIRE_FLOAT32);
+    sr.enable_stats(true);
+    sr.set_threads(n_threads);
+    check(sr.get_threads() == n_threads, "get_threads");
+    const int id = sr.register_key("ln_reg");
+
+    // Lane t's key: state value 100 t + g, action its negation
+    auto key = [](int t) { return "ln_" + std::to_string(t); };
+    if (g_rank == 0) {
+        for (int t=0;t<n_threads;t++) {
+            std::vector<double> action(l.total);
+            for (int g=0;g<l.total;g++) action[g] = -(100.0 * t + g);
+            agent.put_tensor(key(t) + ".act", action.data(), {action.size()}, SRTensorTypeDouble,
+                             SRMemLayoutContiguous);
+        }
+    }
+    std::vector<std::string> errors(n_threads);
+    std::vector<bool> actions_ok(n_threads, false);
+    std::vector<std::thread> threads;
+    for (int t=0;t<n_threads;t++) {
+        threads.emplace_back([&, t] {
+            SmartRedisMPI::bind_thread(t);
+            errors[t] = failure_of([&] {
+                SmartRedisMPI &lane = sr.for_thread();
+                std::vector<double> state(n), action(n);
+                for (int i=0;i<n;i++) state[i] = 100.0 * t + l.displs[g_rank] + i;
+                lane.put_state(key(t), state.data(), n);
+                lane.put_state(id, state.data(), n);
+                bool ok = lane.wait_action(key(t) + ".act", action.data(), n, 10.0);
+                for (int i=0;i<n;i++) ok = ok && action[i] == -state[i];
+                actions_ok[t] = ok;
+            });
+            SmartRedisMPI::bind_thread(-1);
+        });
+    }
+    for (std::thread &th : threads) th.join();
+    for (int t=0;t<n_threads;t++) {
+        check(errors[t].empty(), "lane " + std::to_string(t) + ": " + errors[t]);
+        check(actions_ok[t], "lane " + std::to_string(t) + " action");
+    }
+    if (g_rank == 0) {
+        for (int t=0;t<n_threads;t++) {
+            std::vector<size_t> dims;
+            const std::vector<double> got = stored_values(key(t), dims);
+            bool ok = got.size() == static_cast<size_t>(l.total);
+            for (int g=0;ok && g<l.total;g++) ok = got[g] == 100.0 * t + g;
+            check(ok, "lane " + std::to_string(t) + " state");
+        }
+        check(SmartRedis::fake::store().tensors.at("ln_1").type == SRTensorTypeFloat, "wire precision on a lane");
+    }
+    // Stats sum over lanes: every lane put the registered key once
+    check(sr.get_stats(OP_PUT_STATE, "ln_0").calls == 1, "stats of one lane");
+    check(sr.get_stats(OP_PUT_STATE, "ln_reg").calls == static_cast<uint64_t>(n_threads), "stats summed over lanes");
+
+    SmartRedisMPI::bind_thread(n_threads);
+    check(failure_of([&] { sr.for_thread(); }) != "", "thread without a lane");
+    SmartRedisMPI::bind_thread(-1);
+    sr.set_threads(1);
+    check(sr.get_threads() == 1 && &sr.for_thread() == &sr, "back to one lane");
+}
+
+// === Local policy ===
+
+// Policy weights as srmpi_policy.py publishes them: meta block and float32
+// W_k [w_{k+1}, w_k] row-major followed by b_k, from a fixed LCG
+struct PolicyWeights {
+    std::vector<int32_t> meta;
+    std::vector<float> params;
+};
+
+static PolicyWeights policy_weights(int version, int activation, const std::vector<int> &widths, uint32_t seed) {
+    PolicyWeights w;
+    w.meta.assign(POLICY_META_LEN, 0);
+    w.meta[0] = version;
+    w.meta[1] = static_cast<int32_t>(widths.size()) - 1;
+    w.meta[2] = activation;
+    for (size_t k=0;k<widths.size();k++) w.meta[3 + k] = widths[k];
+    w.params.resize(policy_param_count(w.meta.data()));
+    for (float &x : w.params) {
+        seed = seed * 1664525u + 1013904223u;
+        x = static_cast<float>((seed >> 8) * (1.0 / 16777216.0) - 0.5);
+    }
+    return w;
+}
+
+// Double-precision forward pass of one point
+static std::vector<double> reference_mlp(const PolicyWeights &w, const float *point) {
+    const int n_layers = w.meta[1];
+    std::vector<double> x(point, point + w.meta[3]);
+    size_t offset = 0;
+    for (int k=0;k<n_layers;k++) {
+        const int n_in = w.meta[3 + k], n_out = w.meta[4 + k];
+        std::vector<double> y(n_out);
+        for (int o=0;o<n_out;o++) {
+            double sum = w.params[offset + static_cast<size_t>(n_out) * n_in + o];
+            for (int i=0;i<n_in;i++) sum += static_cast<double>(w.params[offset + o * n_in + i]) * x[i];
+            if (k + 1 < n_layers) sum = w.meta[2] == POLICY_TANH ? std::tanh(sum) : std::max(sum, 0.0);
+            y[o] = sum;
+        }
+        offset += static_cast<size_t>(n_out) * (n_in + 1);
+        x.swap(y);
+    }
+    return x;
+}
+
+// Largest difference to the reference over point-major states
+static double policy_error(const PolicyWeights &w, const std::vector<float> &state, const double *action,
+                           size_t n_points) {
+    const size_t n_in = w.meta[3], n_out = w.meta[3 + w.meta[1]];
+    double err = 0.0;
+    for (size_t p=0;p<n_points;p++) {
+        const std::vector<double> want = reference_mlp(w, state.data() + p * n_in);
+        for (size_t o=0;o<n_out;o++) err = std::max(err, std::fabs(action[p * n_out + o] - want[o]));
+    }
+    return err;
+}
+
+static std::vector<float> policy_state(size_t n_values, int offset) {
+    std::vector<float> state(n_values);
+    for (size_t i=0;i<n_values;i++) state[i] = static_cast<float>(std::sin(0.37 * (offset + i)) * 2.0);
+    return state;
+}
+
+static void publish_policy(SmartRedis::Client &agent, const std::string &key, const PolicyWeights &w) {
+    agent.put_tensor(key + ".params", w.params.data(), {w.params.size()}, SRTensorTypeFloat, SRMemLayoutContiguous);
+    agent.put_tensor(key + ".meta", w.meta.data(), {w.meta.size()}, SRTensorTypeInt32, SRMemLayoutContiguous);
+}
+
+static void test_policy(SmartRedisMPI &sr, SmartRedis::Client &agent) {
+    // The kernel against the reference: full blocks and a tail, both activations
+    const double tol = 1e-5;
+    const size_t n_points = 2 * MLPPolicy::POLICY_BLOCK + 22;
+    for (int activation : {POLICY_TANH, POLICY_RELU}) {
+        const PolicyWeights w = policy_weights(1, activation, {3, 16, 16, 2}, 11u + activation);
+        MLPPolicy mlp;
+        std::vector<float> params = w.params;
+        mlp.load(w.meta.data(), params);
+        const std::vector<float> state = policy_state(n_points * 3, 0);
+        std::vector<double> action(n_points * 2);
+        mlp.evaluate(state.data(), n_points, action.data());
+        check(policy_error(w, state, action.data(), n_points) < tol,
+              std::string("MLP kernel vs reference, ") + (activation == POLICY_TANH ? "tanh" : "relu"));
+    }
+    std::vector<int32_t> meta(POLICY_META_LEN, 0);
+    meta[1] = 1;
+    meta[2] = POLICY_TANH;
+    meta[3] = 3;
+    check(policy_param_count(meta.data()) == 0, "meta with a zero width");
+    meta[4] = 2;
+    check(policy_param_count(meta.data()) == 8, "meta parameter count");
+
+    // End to end: store reads until weights appear, then local evaluation
+    // refreshed every third read
+    const int n = 5 + g_rank;
+    const Layout l = layout_of(n);
+    const std::vector<float> state32 = policy_state(3 * n, 3 * l.displs[g_rank]);
+    const std::vector<double> state(state32.begin(), state32.end());
+    std::vector<double> action(2 * n);
+    sr.set_local_policy("pl_act", "pl_state", "pl_w", 3);
+    sr.put_state("pl_state", state.data(), state.size());
+    if (g_rank == 0) {
+        std::vector<double> from_agent(2 * l.total, 4.0);
+        agent.put_tensor("pl_act", from_agent.data(), {from_agent.size()}, SRTensorTypeDouble, SRMemLayoutContiguous);
+    }
+    sr.get_action("pl_act", action.data(), action.size());
+    check(sr.get_policy_version("pl_act") == -1 && action[0] == 4.0, "action from the store before weights");
+
+    const PolicyWeights v1 = policy_weights(1, POLICY_TANH, {3, 8, 2}, 5u);
+    const PolicyWeights v2 = policy_weights(2, POLICY_RELU, {3, 8, 8, 2}, 6u);
+    if (g_rank == 0) publish_policy(agent, "pl_w", v1);
+    // Reads since set_local_policy count towards the refresh, the store read
+    // included: v1 loads on the second, v2 (published after it) on the fourth
+    for (int read=0;read<2;read++) {
+        if (read == 1 && g_rank == 0) publish_policy(agent, "pl_w", v2);
+        sr.put_state("pl_state", state.data(), state.size());
+        sr.get_action("pl_act", action.data(), action.size());
+        check(sr.get_policy_version("pl_act") == 1 && policy_error(v1, state32, action.data(), n) < tol,
+              "local action v1, read " + std::to_string(read));
+    }
+    sr.get_action("pl_act", action.data(), action.size());
+    check(sr.get_policy_version("pl_act") == 2 && policy_error(v2, state32, action.data(), n) < tol,
+          "local action after the refresh");
+    if (g_rank == 0) {
+        std::vector<size_t> dims;
+        check(stored_values("pl_state", dims).size() == 3 * static_cast<size_t>(l.total), "state still uploaded");
+    }
+
+    // A state that does not match the policy fails; removing it goes back to the store
+    sr.invalidate_plan("pl_state");
+    sr.put_state("pl_state", state.data(), state.size() - 1);
+    check(failure_of([&] { sr.get_action("pl_act", action.data(), action.size()); }) != "",
+          "state of the wrong size");
+    sr.set_local_policy("pl_act", "", "", 1);
+    if (g_rank == 0) {
+        std::vector<double> from_agent(2 * l.total, 4.0);
+        agent.put_tensor("pl_act", from_agent.data(), {from_agent.size()}, SRTensorTypeDouble, SRMemLayoutContiguous);
+    }
+    sr.get_action("pl_act", action.data(), action.size());
+    check(action[0] == 4.0 && sr.get_policy_version("pl_act") == -1, "action from the store after removal");
+}
+
+int main(int argc, char **argv) {
+    if (argc == 3 && std::string(argv[1]) == "--codec-cross") return codec_cross(argv[2]);
+
+    const int thread_level = SmartRedisMPI::init_mpi_threads(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &g_rank);
+    {
+        SmartRedisMPI sr(false);
+        SmartRedis::Client agent(false, "default");
+
+        auto run = [&](const char *name, auto f) {
+            const int before = g_failures;
+            const std::string err = failure_of(f);
+            check(err.empty(), std::string(name) + ": " + err);
+            int failed = g_failures - before, total = 0;
+            MPI_Allreduce(&failed, &total, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+            if (g_rank == 0) std::printf("%-8s %s\n", name, total == 0 ? "ok" : "FAILED");
+        };
+        run("wire", [&] { test_wire(); });
+        run("codec", [&] { test_codec_frames(); test_codec_exchange(sr, agent); });
+        run("sparse", [&] { test_sparse(sr, agent); });
+        run("hier", [&] { test_hierarchical(agent); });
+        run("ring", [&] { test_ring(sr, agent); });
+        run("replay", [&] { test_replay(agent); });
+        run("errors", [&] { test_writer_errors(sr, agent); });
+        run("step", [&] { test_step_exchange(sr, agent); });
+        run("batch", [&] { test_batch(sr, agent); });
+        run("iput", [&] { test_iput(sr, thread_level); });
+        run("fields", [&] { test_fields(sr); });
+        run("stats", [&] { test_stats(sr); });
+        run("shm", [&] { test_shm(agent); });
+        run("traj", [&] { test_trajectory(sr, agent); });
+        run("tensor", [&] { test_tensor(sr, agent); });
+        run("lanes", [&] { test_lanes(agent, thread_level); });
+        run("policy", [&] { test_policy(sr, agent); });
+    }
+    int total = 0;
+    MPI_Allreduce(&g_failures, &total, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Finalize();
+    return total == 0 ? 0 : 1;
+}